@@ -33,4 +33,16 @@ make clean
 cd ../../..
 cd source/cctracker/Release
 make clean
+cd ../../..
+cd source/ccbench/Debug
+make clean
+cd ../../..
+cd source/ccbench/Release
+make clean
+cd ../../..
+cd source/ccload/Debug
+make clean
+cd ../../..
+cd source/ccload/Release
+make clean
 cd ../../..
\ No newline at end of file
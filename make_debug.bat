@@ -15,4 +15,10 @@ make all
 cd ../../..
 cd source/cctracker/Debug
 make all
+cd ../../..
+cd source/ccbench/Debug
+make all
+cd ../../..
+cd source/ccload/Debug
+make all
 cd ../../..
\ No newline at end of file
@@ -15,4 +15,10 @@ make all
 cd ../../..
 cd source/cctracker/Release
 make all
+cd ../../..
+cd source/ccbench/Release
+make all
+cd ../../..
+cd source/ccload/Release
+make all
 cd ../../..
\ No newline at end of file
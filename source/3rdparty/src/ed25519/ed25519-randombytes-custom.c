@@ -6,23 +6,14 @@
  * ed25519-randombytes-custom.c
 */
 
-#include <stdio.h>
-#include <string.h>
-#include <stdlib.h>
+#include <CCcrypto.hpp>
 
 #include "ed25519-randombytes-custom.h"
 
+// used by ed25519_sign_open_batch to pick the random scalars that combine the signatures in a batch;
+// these must not be predictable by whoever supplied the signatures, so they come from the system RNG
+
 void ed25519_randombytes_unsafe(void *p, size_t len)
 {
-	const char *msg = "ERROR: ed25519_randombytes_unsafe called\n";
-
-	printf(msg);
-	fprintf(stderr, msg);
-
-	memset(p, 0, len);
-
-	int i;
-
-	for (i = 0; i < len; ++i)
-		*((unsigned char *)p + i) = rand();
+	CCRandom(p, len);
 }
@@ -0,0 +1,8 @@
+################################################################################
+# Automatically-generated file. Do not edit!
+################################################################################
+
+USER_OBJS :=
+
+LIBS := -lcc -lcccommon -l3rdparty -lboost_program_options -lboost_log -lboost_filesystem -lboost_system -lboost_thread -lWs2_32 -lMswsock -lgmpxx -lgmp
+
@@ -0,0 +1,313 @@
+################################################################################
+# Automatically-generated file. Do not edit!
+################################################################################
+
+# Add inputs and outputs from these tool invocations to the build variables 
+CPP_SRCS += \
+C:/CredaCash/source/ccnode/src/block.cpp \
+C:/CredaCash/source/ccnode/src/blockchain.cpp \
+C:/CredaCash/source/ccnode/src/blockserve.cpp \
+C:/CredaCash/source/ccnode/src/blocksigs.cpp \
+C:/CredaCash/source/ccnode/src/blocksync.cpp \
+C:/CredaCash/source/ccnode/src/blocktree.cpp \
+C:/CredaCash/source/ccnode/src/commitments.cpp \
+C:/CredaCash/source/ccnode/src/control.cpp \
+C:/CredaCash/source/ccnode/src/dbconn-persistent.cpp \
+C:/CredaCash/source/ccnode/src/dbconn-processq.cpp \
+C:/CredaCash/source/ccnode/src/dbconn-relay.cpp \
+C:/CredaCash/source/ccnode/src/dbconn-snapshot.cpp \
+C:/CredaCash/source/ccnode/src/dbconn-tempserials.cpp \
+C:/CredaCash/source/ccnode/src/dbconn-validobjs.cpp \
+C:/CredaCash/source/ccnode/src/dbconn-wal.cpp \
+C:/CredaCash/source/ccnode/src/dbconn.cpp \
+C:/CredaCash/source/ccnode/src/expire.cpp \
+C:/CredaCash/source/ccnode/src/hostdir.cpp \
+C:/CredaCash/source/ccnode/src/metrics.cpp \
+C:/CredaCash/source/ccnode/src/processblock.cpp \
+C:/CredaCash/source/ccnode/src/processtx.cpp \
+C:/CredaCash/source/ccnode/src/reindex.cpp \
+C:/CredaCash/source/ccnode/src/relay.cpp \
+C:/CredaCash/source/ccnode/src/replycache.cpp \
+C:/CredaCash/source/ccnode/src/service_base.cpp \
+C:/CredaCash/source/ccnode/src/tor.cpp \
+C:/CredaCash/source/ccnode/src/torpool.cpp \
+C:/CredaCash/source/ccnode/src/transact.cpp \
+C:/CredaCash/source/ccnode/src/util.cpp \
+C:/CredaCash/source/ccnode/src/witness.cpp 
+
+OBJS += \
+./import-ccnode/block.o \
+./import-ccnode/blockchain.o \
+./import-ccnode/blockserve.o \
+./import-ccnode/blocksigs.o \
+./import-ccnode/blocksync.o \
+./import-ccnode/blocktree.o \
+./import-ccnode/commitments.o \
+./import-ccnode/control.o \
+./import-ccnode/dbconn-persistent.o \
+./import-ccnode/dbconn-processq.o \
+./import-ccnode/dbconn-relay.o \
+./import-ccnode/dbconn-snapshot.o \
+./import-ccnode/dbconn-tempserials.o \
+./import-ccnode/dbconn-validobjs.o \
+./import-ccnode/dbconn-wal.o \
+./import-ccnode/dbconn.o \
+./import-ccnode/expire.o \
+./import-ccnode/hostdir.o \
+./import-ccnode/metrics.o \
+./import-ccnode/processblock.o \
+./import-ccnode/processtx.o \
+./import-ccnode/reindex.o \
+./import-ccnode/relay.o \
+./import-ccnode/replycache.o \
+./import-ccnode/service_base.o \
+./import-ccnode/tor.o \
+./import-ccnode/torpool.o \
+./import-ccnode/transact.o \
+./import-ccnode/util.o \
+./import-ccnode/witness.o 
+
+CPP_DEPS += \
+./import-ccnode/block.d \
+./import-ccnode/blockchain.d \
+./import-ccnode/blockserve.d \
+./import-ccnode/blocksigs.d \
+./import-ccnode/blocksync.d \
+./import-ccnode/blocktree.d \
+./import-ccnode/commitments.d \
+./import-ccnode/control.d \
+./import-ccnode/dbconn-persistent.d \
+./import-ccnode/dbconn-processq.d \
+./import-ccnode/dbconn-relay.d \
+./import-ccnode/dbconn-snapshot.d \
+./import-ccnode/dbconn-tempserials.d \
+./import-ccnode/dbconn-validobjs.d \
+./import-ccnode/dbconn-wal.d \
+./import-ccnode/dbconn.d \
+./import-ccnode/expire.d \
+./import-ccnode/hostdir.d \
+./import-ccnode/metrics.d \
+./import-ccnode/processblock.d \
+./import-ccnode/processtx.d \
+./import-ccnode/reindex.d \
+./import-ccnode/relay.d \
+./import-ccnode/replycache.d \
+./import-ccnode/service_base.d \
+./import-ccnode/tor.d \
+./import-ccnode/torpool.d \
+./import-ccnode/transact.d \
+./import-ccnode/util.d \
+./import-ccnode/witness.d 
+
+
+# Each subdirectory must supply rules for building sources it contributes
+import-ccnode/block.o: C:/CredaCash/source/ccnode/src/block.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: Cross G++ Compiler'
+	g++ -std=c++0x -IC:/CredaCash/source -IC:/CredaCash/source/ccnode/src -IC:/CredaCash/source/cclib/src -IC:/CredaCash/source/cccommon/src -IC:/CredaCash/depends -IC:/CredaCash/depends/gmp -IC:/CredaCash/depends/boost -O2 -Wall -Wextra -c -fmessage-length=0 -Wno-unused-parameter -Wstrict-overflow=4 -Werror=sign-compare -isystem C:/CredaCash/depends/boost -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+import-ccnode/blockchain.o: C:/CredaCash/source/ccnode/src/blockchain.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: Cross G++ Compiler'
+	g++ -std=c++0x -IC:/CredaCash/source -IC:/CredaCash/source/ccnode/src -IC:/CredaCash/source/cclib/src -IC:/CredaCash/source/cccommon/src -IC:/CredaCash/depends -IC:/CredaCash/depends/gmp -IC:/CredaCash/depends/boost -O2 -Wall -Wextra -c -fmessage-length=0 -Wno-unused-parameter -Wstrict-overflow=4 -Werror=sign-compare -isystem C:/CredaCash/depends/boost -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+import-ccnode/blockserve.o: C:/CredaCash/source/ccnode/src/blockserve.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: Cross G++ Compiler'
+	g++ -std=c++0x -IC:/CredaCash/source -IC:/CredaCash/source/ccnode/src -IC:/CredaCash/source/cclib/src -IC:/CredaCash/source/cccommon/src -IC:/CredaCash/depends -IC:/CredaCash/depends/gmp -IC:/CredaCash/depends/boost -O2 -Wall -Wextra -c -fmessage-length=0 -Wno-unused-parameter -Wstrict-overflow=4 -Werror=sign-compare -isystem C:/CredaCash/depends/boost -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+import-ccnode/blocksigs.o: C:/CredaCash/source/ccnode/src/blocksigs.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: Cross G++ Compiler'
+	g++ -std=c++0x -IC:/CredaCash/source -IC:/CredaCash/source/ccnode/src -IC:/CredaCash/source/cclib/src -IC:/CredaCash/source/cccommon/src -IC:/CredaCash/depends -IC:/CredaCash/depends/gmp -IC:/CredaCash/depends/boost -O2 -Wall -Wextra -c -fmessage-length=0 -Wno-unused-parameter -Wstrict-overflow=4 -Werror=sign-compare -isystem C:/CredaCash/depends/boost -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+import-ccnode/blocksync.o: C:/CredaCash/source/ccnode/src/blocksync.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: Cross G++ Compiler'
+	g++ -std=c++0x -IC:/CredaCash/source -IC:/CredaCash/source/ccnode/src -IC:/CredaCash/source/cclib/src -IC:/CredaCash/source/cccommon/src -IC:/CredaCash/depends -IC:/CredaCash/depends/gmp -IC:/CredaCash/depends/boost -O2 -Wall -Wextra -c -fmessage-length=0 -Wno-unused-parameter -Wstrict-overflow=4 -Werror=sign-compare -isystem C:/CredaCash/depends/boost -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+import-ccnode/blocktree.o: C:/CredaCash/source/ccnode/src/blocktree.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: Cross G++ Compiler'
+	g++ -std=c++0x -IC:/CredaCash/source -IC:/CredaCash/source/ccnode/src -IC:/CredaCash/source/cclib/src -IC:/CredaCash/source/cccommon/src -IC:/CredaCash/depends -IC:/CredaCash/depends/gmp -IC:/CredaCash/depends/boost -O2 -Wall -Wextra -c -fmessage-length=0 -Wno-unused-parameter -Wstrict-overflow=4 -Werror=sign-compare -isystem C:/CredaCash/depends/boost -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+import-ccnode/commitments.o: C:/CredaCash/source/ccnode/src/commitments.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: Cross G++ Compiler'
+	g++ -std=c++0x -IC:/CredaCash/source -IC:/CredaCash/source/ccnode/src -IC:/CredaCash/source/cclib/src -IC:/CredaCash/source/cccommon/src -IC:/CredaCash/depends -IC:/CredaCash/depends/gmp -IC:/CredaCash/depends/boost -O2 -Wall -Wextra -c -fmessage-length=0 -Wno-unused-parameter -Wstrict-overflow=4 -Werror=sign-compare -isystem C:/CredaCash/depends/boost -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+import-ccnode/control.o: C:/CredaCash/source/ccnode/src/control.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: Cross G++ Compiler'
+	g++ -std=c++0x -IC:/CredaCash/source -IC:/CredaCash/source/ccnode/src -IC:/CredaCash/source/cclib/src -IC:/CredaCash/source/cccommon/src -IC:/CredaCash/depends -IC:/CredaCash/depends/gmp -IC:/CredaCash/depends/boost -O2 -Wall -Wextra -c -fmessage-length=0 -Wno-unused-parameter -Wstrict-overflow=4 -Werror=sign-compare -isystem C:/CredaCash/depends/boost -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+import-ccnode/dbconn-persistent.o: C:/CredaCash/source/ccnode/src/dbconn-persistent.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: Cross G++ Compiler'
+	g++ -std=c++0x -IC:/CredaCash/source -IC:/CredaCash/source/ccnode/src -IC:/CredaCash/source/cclib/src -IC:/CredaCash/source/cccommon/src -IC:/CredaCash/depends -IC:/CredaCash/depends/gmp -IC:/CredaCash/depends/boost -O2 -Wall -Wextra -c -fmessage-length=0 -Wno-unused-parameter -Wstrict-overflow=4 -Werror=sign-compare -isystem C:/CredaCash/depends/boost -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+import-ccnode/dbconn-processq.o: C:/CredaCash/source/ccnode/src/dbconn-processq.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: Cross G++ Compiler'
+	g++ -std=c++0x -IC:/CredaCash/source -IC:/CredaCash/source/ccnode/src -IC:/CredaCash/source/cclib/src -IC:/CredaCash/source/cccommon/src -IC:/CredaCash/depends -IC:/CredaCash/depends/gmp -IC:/CredaCash/depends/boost -O2 -Wall -Wextra -c -fmessage-length=0 -Wno-unused-parameter -Wstrict-overflow=4 -Werror=sign-compare -isystem C:/CredaCash/depends/boost -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+import-ccnode/dbconn-relay.o: C:/CredaCash/source/ccnode/src/dbconn-relay.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: Cross G++ Compiler'
+	g++ -std=c++0x -IC:/CredaCash/source -IC:/CredaCash/source/ccnode/src -IC:/CredaCash/source/cclib/src -IC:/CredaCash/source/cccommon/src -IC:/CredaCash/depends -IC:/CredaCash/depends/gmp -IC:/CredaCash/depends/boost -O2 -Wall -Wextra -c -fmessage-length=0 -Wno-unused-parameter -Wstrict-overflow=4 -Werror=sign-compare -isystem C:/CredaCash/depends/boost -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+import-ccnode/dbconn-snapshot.o: C:/CredaCash/source/ccnode/src/dbconn-snapshot.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: Cross G++ Compiler'
+	g++ -std=c++0x -IC:/CredaCash/source -IC:/CredaCash/source/ccnode/src -IC:/CredaCash/source/cclib/src -IC:/CredaCash/source/cccommon/src -IC:/CredaCash/depends -IC:/CredaCash/depends/gmp -IC:/CredaCash/depends/boost -O2 -Wall -Wextra -c -fmessage-length=0 -Wno-unused-parameter -Wstrict-overflow=4 -Werror=sign-compare -isystem C:/CredaCash/depends/boost -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+import-ccnode/dbconn-tempserials.o: C:/CredaCash/source/ccnode/src/dbconn-tempserials.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: Cross G++ Compiler'
+	g++ -std=c++0x -IC:/CredaCash/source -IC:/CredaCash/source/ccnode/src -IC:/CredaCash/source/cclib/src -IC:/CredaCash/source/cccommon/src -IC:/CredaCash/depends -IC:/CredaCash/depends/gmp -IC:/CredaCash/depends/boost -O2 -Wall -Wextra -c -fmessage-length=0 -Wno-unused-parameter -Wstrict-overflow=4 -Werror=sign-compare -isystem C:/CredaCash/depends/boost -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+import-ccnode/dbconn-validobjs.o: C:/CredaCash/source/ccnode/src/dbconn-validobjs.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: Cross G++ Compiler'
+	g++ -std=c++0x -IC:/CredaCash/source -IC:/CredaCash/source/ccnode/src -IC:/CredaCash/source/cclib/src -IC:/CredaCash/source/cccommon/src -IC:/CredaCash/depends -IC:/CredaCash/depends/gmp -IC:/CredaCash/depends/boost -O2 -Wall -Wextra -c -fmessage-length=0 -Wno-unused-parameter -Wstrict-overflow=4 -Werror=sign-compare -isystem C:/CredaCash/depends/boost -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+import-ccnode/dbconn-wal.o: C:/CredaCash/source/ccnode/src/dbconn-wal.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: Cross G++ Compiler'
+	g++ -std=c++0x -IC:/CredaCash/source -IC:/CredaCash/source/ccnode/src -IC:/CredaCash/source/cclib/src -IC:/CredaCash/source/cccommon/src -IC:/CredaCash/depends -IC:/CredaCash/depends/gmp -IC:/CredaCash/depends/boost -O2 -Wall -Wextra -c -fmessage-length=0 -Wno-unused-parameter -Wstrict-overflow=4 -Werror=sign-compare -isystem C:/CredaCash/depends/boost -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+import-ccnode/dbconn.o: C:/CredaCash/source/ccnode/src/dbconn.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: Cross G++ Compiler'
+	g++ -std=c++0x -IC:/CredaCash/source -IC:/CredaCash/source/ccnode/src -IC:/CredaCash/source/cclib/src -IC:/CredaCash/source/cccommon/src -IC:/CredaCash/depends -IC:/CredaCash/depends/gmp -IC:/CredaCash/depends/boost -O2 -Wall -Wextra -c -fmessage-length=0 -Wno-unused-parameter -Wstrict-overflow=4 -Werror=sign-compare -isystem C:/CredaCash/depends/boost -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+import-ccnode/expire.o: C:/CredaCash/source/ccnode/src/expire.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: Cross G++ Compiler'
+	g++ -std=c++0x -IC:/CredaCash/source -IC:/CredaCash/source/ccnode/src -IC:/CredaCash/source/cclib/src -IC:/CredaCash/source/cccommon/src -IC:/CredaCash/depends -IC:/CredaCash/depends/gmp -IC:/CredaCash/depends/boost -O2 -Wall -Wextra -c -fmessage-length=0 -Wno-unused-parameter -Wstrict-overflow=4 -Werror=sign-compare -isystem C:/CredaCash/depends/boost -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+import-ccnode/hostdir.o: C:/CredaCash/source/ccnode/src/hostdir.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: Cross G++ Compiler'
+	g++ -std=c++0x -IC:/CredaCash/source -IC:/CredaCash/source/ccnode/src -IC:/CredaCash/source/cclib/src -IC:/CredaCash/source/cccommon/src -IC:/CredaCash/depends -IC:/CredaCash/depends/gmp -IC:/CredaCash/depends/boost -O2 -Wall -Wextra -c -fmessage-length=0 -Wno-unused-parameter -Wstrict-overflow=4 -Werror=sign-compare -isystem C:/CredaCash/depends/boost -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+import-ccnode/metrics.o: C:/CredaCash/source/ccnode/src/metrics.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: Cross G++ Compiler'
+	g++ -std=c++0x -IC:/CredaCash/source -IC:/CredaCash/source/ccnode/src -IC:/CredaCash/source/cclib/src -IC:/CredaCash/source/cccommon/src -IC:/CredaCash/depends -IC:/CredaCash/depends/gmp -IC:/CredaCash/depends/boost -O2 -Wall -Wextra -c -fmessage-length=0 -Wno-unused-parameter -Wstrict-overflow=4 -Werror=sign-compare -isystem C:/CredaCash/depends/boost -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+import-ccnode/processblock.o: C:/CredaCash/source/ccnode/src/processblock.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: Cross G++ Compiler'
+	g++ -std=c++0x -IC:/CredaCash/source -IC:/CredaCash/source/ccnode/src -IC:/CredaCash/source/cclib/src -IC:/CredaCash/source/cccommon/src -IC:/CredaCash/depends -IC:/CredaCash/depends/gmp -IC:/CredaCash/depends/boost -O2 -Wall -Wextra -c -fmessage-length=0 -Wno-unused-parameter -Wstrict-overflow=4 -Werror=sign-compare -isystem C:/CredaCash/depends/boost -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+import-ccnode/processtx.o: C:/CredaCash/source/ccnode/src/processtx.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: Cross G++ Compiler'
+	g++ -std=c++0x -IC:/CredaCash/source -IC:/CredaCash/source/ccnode/src -IC:/CredaCash/source/cclib/src -IC:/CredaCash/source/cccommon/src -IC:/CredaCash/depends -IC:/CredaCash/depends/gmp -IC:/CredaCash/depends/boost -O2 -Wall -Wextra -c -fmessage-length=0 -Wno-unused-parameter -Wstrict-overflow=4 -Werror=sign-compare -isystem C:/CredaCash/depends/boost -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+import-ccnode/reindex.o: C:/CredaCash/source/ccnode/src/reindex.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: Cross G++ Compiler'
+	g++ -std=c++0x -IC:/CredaCash/source -IC:/CredaCash/source/ccnode/src -IC:/CredaCash/source/cclib/src -IC:/CredaCash/source/cccommon/src -IC:/CredaCash/depends -IC:/CredaCash/depends/gmp -IC:/CredaCash/depends/boost -O2 -Wall -Wextra -c -fmessage-length=0 -Wno-unused-parameter -Wstrict-overflow=4 -Werror=sign-compare -isystem C:/CredaCash/depends/boost -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+import-ccnode/relay.o: C:/CredaCash/source/ccnode/src/relay.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: Cross G++ Compiler'
+	g++ -std=c++0x -IC:/CredaCash/source -IC:/CredaCash/source/ccnode/src -IC:/CredaCash/source/cclib/src -IC:/CredaCash/source/cccommon/src -IC:/CredaCash/depends -IC:/CredaCash/depends/gmp -IC:/CredaCash/depends/boost -O2 -Wall -Wextra -c -fmessage-length=0 -Wno-unused-parameter -Wstrict-overflow=4 -Werror=sign-compare -isystem C:/CredaCash/depends/boost -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+import-ccnode/replycache.o: C:/CredaCash/source/ccnode/src/replycache.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: Cross G++ Compiler'
+	g++ -std=c++0x -IC:/CredaCash/source -IC:/CredaCash/source/ccnode/src -IC:/CredaCash/source/cclib/src -IC:/CredaCash/source/cccommon/src -IC:/CredaCash/depends -IC:/CredaCash/depends/gmp -IC:/CredaCash/depends/boost -O2 -Wall -Wextra -c -fmessage-length=0 -Wno-unused-parameter -Wstrict-overflow=4 -Werror=sign-compare -isystem C:/CredaCash/depends/boost -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+import-ccnode/service_base.o: C:/CredaCash/source/ccnode/src/service_base.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: Cross G++ Compiler'
+	g++ -std=c++0x -IC:/CredaCash/source -IC:/CredaCash/source/ccnode/src -IC:/CredaCash/source/cclib/src -IC:/CredaCash/source/cccommon/src -IC:/CredaCash/depends -IC:/CredaCash/depends/gmp -IC:/CredaCash/depends/boost -O2 -Wall -Wextra -c -fmessage-length=0 -Wno-unused-parameter -Wstrict-overflow=4 -Werror=sign-compare -isystem C:/CredaCash/depends/boost -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+import-ccnode/tor.o: C:/CredaCash/source/ccnode/src/tor.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: Cross G++ Compiler'
+	g++ -std=c++0x -IC:/CredaCash/source -IC:/CredaCash/source/ccnode/src -IC:/CredaCash/source/cclib/src -IC:/CredaCash/source/cccommon/src -IC:/CredaCash/depends -IC:/CredaCash/depends/gmp -IC:/CredaCash/depends/boost -O2 -Wall -Wextra -c -fmessage-length=0 -Wno-unused-parameter -Wstrict-overflow=4 -Werror=sign-compare -isystem C:/CredaCash/depends/boost -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+import-ccnode/torpool.o: C:/CredaCash/source/ccnode/src/torpool.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: Cross G++ Compiler'
+	g++ -std=c++0x -IC:/CredaCash/source -IC:/CredaCash/source/ccnode/src -IC:/CredaCash/source/cclib/src -IC:/CredaCash/source/cccommon/src -IC:/CredaCash/depends -IC:/CredaCash/depends/gmp -IC:/CredaCash/depends/boost -O2 -Wall -Wextra -c -fmessage-length=0 -Wno-unused-parameter -Wstrict-overflow=4 -Werror=sign-compare -isystem C:/CredaCash/depends/boost -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+import-ccnode/transact.o: C:/CredaCash/source/ccnode/src/transact.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: Cross G++ Compiler'
+	g++ -std=c++0x -IC:/CredaCash/source -IC:/CredaCash/source/ccnode/src -IC:/CredaCash/source/cclib/src -IC:/CredaCash/source/cccommon/src -IC:/CredaCash/depends -IC:/CredaCash/depends/gmp -IC:/CredaCash/depends/boost -O2 -Wall -Wextra -c -fmessage-length=0 -Wno-unused-parameter -Wstrict-overflow=4 -Werror=sign-compare -isystem C:/CredaCash/depends/boost -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+import-ccnode/util.o: C:/CredaCash/source/ccnode/src/util.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: Cross G++ Compiler'
+	g++ -std=c++0x -IC:/CredaCash/source -IC:/CredaCash/source/ccnode/src -IC:/CredaCash/source/cclib/src -IC:/CredaCash/source/cccommon/src -IC:/CredaCash/depends -IC:/CredaCash/depends/gmp -IC:/CredaCash/depends/boost -O2 -Wall -Wextra -c -fmessage-length=0 -Wno-unused-parameter -Wstrict-overflow=4 -Werror=sign-compare -isystem C:/CredaCash/depends/boost -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+import-ccnode/witness.o: C:/CredaCash/source/ccnode/src/witness.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: Cross G++ Compiler'
+	g++ -std=c++0x -IC:/CredaCash/source -IC:/CredaCash/source/ccnode/src -IC:/CredaCash/source/cclib/src -IC:/CredaCash/source/cccommon/src -IC:/CredaCash/depends -IC:/CredaCash/depends/gmp -IC:/CredaCash/depends/boost -O2 -Wall -Wextra -c -fmessage-length=0 -Wno-unused-parameter -Wstrict-overflow=4 -Werror=sign-compare -isystem C:/CredaCash/depends/boost -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
@@ -0,0 +1,1004 @@
+/*
+ * CredaCash (TM) cryptocurrency and blockchain
+ *
+ * Copyright (C) 2015-2016 Creda Software, Inc.
+ *
+ * ccbench.cpp
+*/
+
+/*
+
+Microbenchmarks for the cclib and node primitives on the transaction and block paths.
+
+Each benchmark runs a warmup sample followed by --samples timed samples of a fixed number of operations, and reports the
+median and minimum ns per operation over the timed samples. Operation counts are fixed (scaled by --scale) and all test data
+comes from a fixed seed, so two runs on the same machine do the same work and their results can be compared directly.
+
+The results are printed one per line as tab separated columns:
+	name	ops	ns_per_op	min_ns_per_op	ops_per_sec
+or with --json, as a single json object.
+
+The benchmark groups are:
+	tx			tx_to_wire and tx_from_wire of a 2 output, 2 input transaction
+	hash		the CCHash::Hash of a commitment, and of a Merkle tree leaf and node
+	work		tx_set_work, per nonce tried
+	blake2b		blake2b hash of a block body, per block size
+	ed25519		sign, verify, and batch verify of block signatures
+	smartbuf	SmartBuf allocate and free, per buffer size, and reference copies
+	db			each DbConn operation, run against new databases in the --datadir directory
+	proof		CCProof_VerifyProof per transaction shape (zero knowledge key), only when --proofs is given
+
+The db benchmarks time each sample of persistent DB writes inside a single BeginWrite/EndWrite, the way the node writes a
+block when it becomes indelible, so the time per write includes its share of the commit.
+
+*/
+
+#define DECLARE_EXTERN
+
+#include "CCdef.h"
+#include "dbconn.hpp"
+#include "util.h"
+
+#include <CCobjects.hpp>
+#include <CCproof.h>
+#include <jsonapi.h>
+#include <jsonutil.h>
+#include <transaction.h>
+#include <transaction.hpp>
+#include <SmartBuf.hpp>
+#include <dblog.h>
+
+#include <blake2/blake2b.h>
+#include <ed25519/ed25519.h>
+#include <sqlite/sqlite3.h>
+
+#include <boost/log/core.hpp>
+#include <boost/log/expressions.hpp>
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/parsers.hpp>
+#include <boost/filesystem/operations.hpp>
+
+#include <random>
+#include <iomanip>
+
+#define BENCH_SEED				0x43434243		// fixed seed for all test data
+#define BENCH_JSON_BUFSIZE		(256*1024)
+#define BENCH_PARAM_KEY			0x4243			// Parameters table key used by the db benchmarks; not used by the node
+#define BENCH_BLOCK_SIZE		4096			// size of the block objects inserted into the Blockchain table
+#define BENCH_ED25519_BATCH		64				// same as BLOCKSIGS_BATCH_MAX
+#define BENCH_SIG_DATA_SIZE		64
+
+static unsigned s_samples = 5;
+static double s_scale = 1;
+static string s_filter;
+
+static mt19937_64 s_rng(BENCH_SEED);
+
+static volatile uint64_t s_sink;	// results are accumulated here so the compiler can't discard the work being timed
+static unsigned s_errors;
+
+class BenchResults
+{
+	struct Result
+	{
+		string name;
+		uint64_t ops;
+		vector<double> nsec_per_op;
+	};
+
+	vector<Result> m_results;
+
+public:
+	void Add(const string& name, uint64_t ops, uint64_t nsec, unsigned sample)
+	{
+		if (!sample)
+			return;		// warmup
+
+		if (m_results.empty() || m_results.back().name != name)
+		{
+			for (auto& r : m_results)
+			{
+				if (r.name == name)
+				{
+					r.nsec_per_op.push_back((double)nsec / ops);
+
+					return;
+				}
+			}
+
+			m_results.push_back(Result());
+			m_results.back().name = name;
+			m_results.back().ops = ops;
+		}
+
+		m_results.back().nsec_per_op.push_back((double)nsec / ops);
+	}
+
+	void Print(bool json)
+	{
+		if (json)
+			cout << "{\"samples\":" << s_samples << ",\"results\":[" << endl;
+		else
+			cout << "name\tops\tns_per_op\tmin_ns_per_op\tops_per_sec" << endl;
+
+		cout << fixed << setprecision(1);
+
+		for (unsigned i = 0; i < m_results.size(); ++i)
+		{
+			auto& r = m_results[i];
+
+			auto v = r.nsec_per_op;
+			sort(v.begin(), v.end());
+
+			auto median = v[v.size() / 2];
+			if (!(v.size() & 1))
+				median = (v[v.size() / 2 - 1] + median) / 2;
+
+			auto rate = (median > 0 ? 1e9 / median : 0);
+
+			if (json)
+				cout << (i ? "," : "") << "{\"name\":\"" << r.name << "\",\"ops\":" << r.ops << ",\"ns_per_op\":" << median << ",\"min_ns_per_op\":" << v[0] << ",\"ops_per_sec\":" << rate << "}" << endl;
+			else
+				cout << r.name << "\t" << r.ops << "\t" << median << "\t" << v[0] << "\t" << rate << endl;
+		}
+
+		if (json)
+			cout << "]}" << endl;
+
+		cout << defaultfloat;
+	}
+};
+
+static BenchResults s_results;
+
+static uint64_t Elapsed(chrono::steady_clock::time_point t0)
+{
+	return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - t0).count();
+}
+
+static uint64_t Ops(uint64_t n)
+{
+	return max((uint64_t)1, (uint64_t)(n * s_scale));
+}
+
+static bool RunGroup(const char *group)
+{
+	if (s_filter.empty() || s_filter.find(group) != string::npos)
+	{
+		cerr << "ccbench running " << group << endl;
+
+		return true;
+	}
+
+	return false;
+}
+
+static void CheckRc(int rc, const char *name)
+{
+	if (rc && !s_errors++)
+		cerr << "ccbench error " << rc << " in " << name << endl;
+}
+
+// runs the warmup and timed samples; op is called with an index that is unique across all samples of the benchmark
+
+template <typename Op>
+static void Measure(const string& name, uint64_t ops, Op op)
+{
+	for (unsigned sample = 0; sample <= s_samples; ++sample)
+	{
+		auto t0 = chrono::steady_clock::now();
+
+		for (uint64_t i = 0; i < ops; ++i)
+			op(sample * ops + i);
+
+		s_results.Add(name, ops, Elapsed(t0), sample);
+	}
+}
+
+// fills a buffer with bytes that depend only on index, so the db benchmarks insert and look up keys spread across the table
+// like hashes, without the cost of computing a hash
+
+static void MakeKey(uint64_t index, void *buf, unsigned size)
+{
+	auto p = (uint8_t*)buf;
+	uint64_t x = index + BENCH_SEED;
+
+	for (unsigned i = 0; i < size; i += sizeof(uint64_t))
+	{
+		x += 0x9E3779B97F4A7C15ULL;
+		uint64_t z = x;
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		z ^= z >> 31;
+
+		memcpy(p + i, &z, min((unsigned)sizeof(z), size - i));
+	}
+}
+
+static void RandomBytes(void *buf, unsigned size)
+{
+	MakeKey(s_rng(), buf, size);
+}
+
+static bigint_t RandomField()
+{
+	bigint_t val;
+
+	RandomBytes(&val, sizeof(val));
+
+	return val * bigint_t(1UL);		// mod prime
+}
+
+static string RandomHex(unsigned nbits)
+{
+	ostringstream os;
+
+	os << "0x" << hex;
+
+	unsigned ndigits = (nbits + 3) / 4;
+
+	for (unsigned i = 0; i < ndigits; ++i)
+	{
+		unsigned bits = (i ? 4 : nbits - 4 * (ndigits - 1));
+
+		os << (unsigned)(s_rng() & ((1 << bits) - 1));
+	}
+
+	return os.str();
+}
+
+static string Hex(uint64_t val)
+{
+	ostringstream os;
+
+	os << "0x" << hex << val;
+
+	return os.str();
+}
+
+static char* JsonBuf()
+{
+	static vector<char> buf(BENCH_JSON_BUFSIZE);
+
+	return buf.data();
+}
+
+static bool JsonCmd(const string& json, string& result)
+{
+	auto output = JsonBuf();
+
+	auto rc = CCTx_JsonCmd(json.c_str(), output, BENCH_JSON_BUFSIZE);
+	if (rc)
+	{
+		cerr << "ccbench error " << rc << " from " << json.substr(0, json.find(':')) << ": " << output << endl;
+
+		return true;
+	}
+
+	result = output;
+
+	return false;
+}
+
+static bool Destination(const string& spend_secret, string& dest)
+{
+	string payspec, decoded;
+
+	if (JsonCmd("{\"payspec-encode\":{\"payspec\":{\"sequence-type\":\"0\",\"spend-secret\":\"" + spend_secret + "\"}}}", payspec))
+		return true;
+
+	if (JsonCmd("{\"payspec-decode\":\"" + payspec + "\"}", decoded))
+		return true;
+
+	Json::Reader reader;
+	Json::Value root;
+
+	if (!reader.parse(decoded, root) || !root["payspec"].isObject())
+		return true;
+
+	dest = root["payspec"]["destination"].asString();
+
+	return dest.empty();
+}
+
+// creates a transaction with test inputs through the json interface, and returns it in wire format, along with the
+// Merkle root of its inputs, which is not carried on the wire
+
+static bool MakeTestTx(unsigned nout, unsigned nin, bool proof, vector<char>& wire, bigint_t& merkle_root)
+{
+	static const uint64_t inval = 1000;
+	static const uint64_t outval = 500;
+
+	ostringstream inputs;
+
+	inputs << "{\"generate-test-inputs\":[";
+
+	for (unsigned i = 0; i < nin; ++i)
+	{
+		auto spend_secret = RandomHex(250);
+
+		string dest;
+		if (Destination(spend_secret, dest))
+			return true;
+
+		inputs << (i ? "," : "") << "{\"destination\":\"" << dest << "\",\"payment-number\":\"" << RandomHex(128) << "\",\"value\":\"" << Hex(inval) << "\",\"commitment-iv\":\"" << RandomHex(128) << "\",\"spend-secret\":\"" << spend_secret << "\"}";
+	}
+
+	inputs << "]}";
+
+	string fragment;
+	if (JsonCmd(inputs.str(), fragment))
+		return true;
+
+	Json::Reader reader;
+	Json::Value root;
+
+	if (!reader.parse("{" + fragment + "}", root))
+		return true;
+
+	bigint_t bigval;
+	if (parse_int_value("ccbench", "merkle-root", root["merkle-root"].asString(), 0, TX_INPUT_MAX, bigval, JsonBuf(), BENCH_JSON_BUFSIZE))
+		return true;
+
+	merkle_root = bigval;
+
+	ostringstream create;
+
+	create << "{\"tx-create\":{\"tx-pay\":{";
+	if (!proof)
+		create << "\"no-proof\":\"1\",";
+	create << "\"donation\":\"" << Hex(nin * inval - nout * outval) << "\"";
+	create << ",\"minimum-output-value\":\"0x0\",\"maximum-output-value\":\"0xffffffffffffffff\",\"maximum-input-value\":\"0xffffffffffffffff\"";
+	create << ",\"outputs\":[";
+
+	for (unsigned i = 0; i < nout; ++i)
+	{
+		string dest;
+		if (Destination(RandomHex(250), dest))
+			return true;
+
+		create << (i ? "," : "") << "{\"destination\":\"" << dest << "\",\"payment-number\":\"" << RandomHex(128) << "\",\"value\":\"" << Hex(outval) << "\"}";
+	}
+
+	create << "]," << fragment << "}}}";
+
+	string result;
+	if (JsonCmd(create.str(), result))
+		return true;
+
+	auto output = JsonBuf();
+
+	if (CCTx_JsonCmd("{\"tx-to-wire\":{}}", output, BENCH_JSON_BUFSIZE))
+		return true;
+
+	uint32_t size = *(uint32_t*)output;
+	if (size < sizeof(CCObject::Header) || size > BENCH_JSON_BUFSIZE)
+		return true;
+
+	wire.assign(output, output + size);
+
+	return false;
+}
+
+static void BenchTx()
+{
+	vector<char> wire;
+	bigint_t merkle_root;
+
+	if (MakeTestTx(2, 2, false, wire, merkle_root))
+		return CheckRc(-1, "MakeTestTx");
+
+	auto ptx = new TxPay;
+	vector<char> output(wire.size());
+
+	CheckRc(tx_from_wire(*ptx, wire.data(), wire.size()), "tx_from_wire");
+
+	Measure("tx.from_wire", Ops(20000), [&](uint64_t i)
+	{
+		CheckRc(tx_from_wire(*ptx, wire.data(), wire.size()), "tx_from_wire");
+	});
+
+	Measure("tx.to_wire", Ops(20000), [&](uint64_t i)
+	{
+		CheckRc(tx_to_wire(*ptx, output.data(), output.size()), "tx_to_wire");
+	});
+
+	if (memcmp(output.data(), wire.data(), wire.size()))
+		CheckRc(-1, "tx_to_wire output compare");
+
+	delete ptx;
+}
+
+static void BenchHash()
+{
+	auto dest = RandomField();
+	auto paynum = RandomField();
+	auto iv = RandomField();
+	bigint_t commitment;
+
+	Measure("hash.commitment", Ops(2000), [&](uint64_t i)
+	{
+		tx_commitment_hash(dest, paynum, i, iv, commitment);
+
+		dest = commitment;
+	});
+
+	auto val1 = RandomField();
+	auto val2 = RandomField();
+	bigint_t hash;
+
+	Measure("hash.merkle_leaf", Ops(2000), [&](uint64_t i)
+	{
+		tx_commit_tree_hash_leaf(val1, i, hash);
+
+		val1 = hash;
+	});
+
+	Measure("hash.merkle_node", Ops(2000), [&](uint64_t i)
+	{
+		tx_commit_tree_hash_node(val1, val2, hash);
+
+		val1 = hash;
+	});
+
+	s_sink += BIG64(dest) + BIG64(hash);
+}
+
+static void BenchWork()
+{
+	vector<char> wire(sizeof(CCObject::Header) + TX_POW_SIZE + 256);
+
+	ccoid_t txhash;
+	RandomBytes(&txhash, sizeof(txhash));
+
+	auto ops = Ops(1000000);
+
+	// with a proof_difficulty of 1, no nonce succeeds, so tx_set_work tries all iter_count nonces
+
+	for (unsigned sample = 0; sample <= s_samples; ++sample)
+	{
+		tx_reset_work(wire.data(), sample);
+
+		auto t0 = chrono::steady_clock::now();
+
+		auto rc = tx_set_work(wire.data(), &txhash, 0, 1, ops, 1);
+
+		s_results.Add("work.set_work", ops, Elapsed(t0), sample);
+
+		CheckRc(rc < 0, "tx_set_work");
+	}
+}
+
+static void BenchBlake2b()
+{
+	static const unsigned sizes[] = {256, 4096, 65536};
+
+	for (auto size : sizes)
+	{
+		vector<uint8_t> body(size);
+		RandomBytes(body.data(), size);
+
+		array<uint8_t, 64> hash;
+
+		Measure("blake2b." + to_string(size), Ops(64*1024*1024 / 16 / size), [&](uint64_t i)
+		{
+			body[0] = i;
+
+			CheckRc(blake2b(&hash, sizeof(hash), NULL, 0, body.data(), size), "blake2b");
+
+			s_sink += hash[0];
+		});
+	}
+}
+
+static void BenchEd25519()
+{
+	struct Sig
+	{
+		ed25519_secret_key secret_key;
+		ed25519_public_key public_key;
+		ed25519_signature signature;
+		uint8_t data[BENCH_SIG_DATA_SIZE];
+	};
+
+	vector<Sig> sigs(BENCH_ED25519_BATCH);
+
+	for (auto& sig : sigs)
+	{
+		RandomBytes(&sig.secret_key, sizeof(sig.secret_key));
+		RandomBytes(&sig.data, sizeof(sig.data));
+
+		ed25519_publickey(sig.secret_key, sig.public_key);
+		ed25519_sign(sig.data, sizeof(sig.data), sig.secret_key, sig.public_key, sig.signature);
+	}
+
+	Measure("ed25519.sign", Ops(2000), [&](uint64_t i)
+	{
+		auto& sig = sigs[i % sigs.size()];
+
+		ed25519_sign(sig.data, sizeof(sig.data), sig.secret_key, sig.public_key, sig.signature);
+	});
+
+	Measure("ed25519.verify", Ops(2000), [&](uint64_t i)
+	{
+		auto& sig = sigs[i % sigs.size()];
+
+		CheckRc(ed25519_sign_open(sig.data, sizeof(sig.data), sig.public_key, sig.signature), "ed25519_sign_open");
+	});
+
+	const unsigned char *m[BENCH_ED25519_BATCH];
+	size_t mlen[BENCH_ED25519_BATCH];
+	const unsigned char *pk[BENCH_ED25519_BATCH];
+	const unsigned char *rs[BENCH_ED25519_BATCH];
+	int valid[BENCH_ED25519_BATCH];
+
+	for (unsigned i = 0; i < BENCH_ED25519_BATCH; ++i)
+	{
+		m[i] = sigs[i].data;
+		mlen[i] = sizeof(sigs[i].data);
+		pk[i] = sigs[i].public_key;
+		rs[i] = sigs[i].signature;
+	}
+
+	auto nbatches = Ops(2000 / BENCH_ED25519_BATCH);
+
+	// reported per signature, to compare with ed25519.verify
+
+	for (unsigned sample = 0; sample <= s_samples; ++sample)
+	{
+		auto t0 = chrono::steady_clock::now();
+
+		for (uint64_t i = 0; i < nbatches; ++i)
+			CheckRc(ed25519_sign_open_batch(m, mlen, pk, rs, BENCH_ED25519_BATCH, valid), "ed25519_sign_open_batch");
+
+		s_results.Add("ed25519.verify_batch" + to_string(BENCH_ED25519_BATCH), nbatches * BENCH_ED25519_BATCH, Elapsed(t0), sample);
+	}
+}
+
+static void BenchSmartBuf()
+{
+	static const unsigned sizes[] = {64, 4096, 65536};
+
+	for (auto size : sizes)
+	{
+		Measure("smartbuf.alloc_free." + to_string(size), Ops(200000), [&](uint64_t i)
+		{
+			SmartBuf smartobj(size);
+
+			s_sink += (uintptr_t)smartobj.data();
+		});
+	}
+
+	SmartBuf smartobj(64);
+
+	Measure("smartbuf.copy", Ops(1000000), [&](uint64_t i)
+	{
+		SmartBuf copy(smartobj);
+
+		s_sink += (uintptr_t)copy.data();
+	});
+}
+
+// times each sample of persistent DB writes inside one write transaction
+
+template <typename Op>
+static void MeasureWrite(DbConn& dbconn, const string& name, uint64_t ops, Op op)
+{
+	for (unsigned sample = 0; sample <= s_samples; ++sample)
+	{
+		auto t0 = chrono::steady_clock::now();
+
+		CheckRc(dbconn.BeginWrite(), "BeginWrite");
+
+		for (uint64_t i = 0; i < ops; ++i)
+			op(sample * ops + i);
+
+		if (dbconn.EndWrite(true))
+			CheckRc(-1, "EndWrite");
+		else
+			dbconn.ReleaseMutex();
+
+		s_results.Add(name, ops, Elapsed(t0), sample);
+	}
+}
+
+static SmartBuf MakeObj(const vector<char>& wire)
+{
+	SmartBuf smartobj(sizeof(CCObject::Preamble) + wire.size());
+
+	memcpy(smartobj.data() + sizeof(CCObject::Preamble), wire.data(), wire.size());
+
+	auto obj = (CCObject*)smartobj.data();
+	obj->SetObjId();
+
+	return smartobj;
+}
+
+static void BenchDb(DbConn& dbconn)
+{
+	auto ops = Ops(2000);
+	auto nrows = (s_samples + 1) * ops;		// rows inserted by each insert benchmark, which the select benchmark that follows looks up
+
+	array<uint8_t, 32> key, data;
+	RandomBytes(&data, sizeof(data));
+
+	// Parameters
+
+	MeasureWrite(dbconn, "db.parameter_insert", ops, [&](uint64_t i)
+	{
+		CheckRc(dbconn.ParameterInsert(BENCH_PARAM_KEY, i, &i, sizeof(i)), "ParameterInsert");
+	});
+
+	Measure("db.parameter_select", ops, [&](uint64_t i)
+	{
+		uint64_t value;
+		CheckRc(dbconn.ParameterSelect(BENCH_PARAM_KEY, i % nrows, &value, sizeof(value)), "ParameterSelect");
+	});
+
+	// Blockchain
+
+	SmartBuf blockobj(sizeof(CCObject::Preamble) + BENCH_BLOCK_SIZE);
+	auto obj = (CCObject*)blockobj.data();
+	RandomBytes(obj->ObjPtr(), BENCH_BLOCK_SIZE);
+	obj->SetSize(BENCH_BLOCK_SIZE);
+	obj->SetTag(CC_TAG_BLOCK);
+
+	MeasureWrite(dbconn, "db.blockchain_insert", ops, [&](uint64_t i)
+	{
+		CheckRc(dbconn.BlockchainInsert(i, blockobj), "BlockchainInsert");
+	});
+
+	Measure("db.blockchain_select", ops, [&](uint64_t i)
+	{
+		SmartBuf retobj;
+		CheckRc(dbconn.BlockchainSelect(i % nrows, &retobj), "BlockchainSelect");
+	});
+
+	Measure("db.blockchain_select_max", ops, [&](uint64_t i)
+	{
+		uint64_t level;
+		CheckRc(dbconn.BlockchainSelectMax(level), "BlockchainSelectMax");
+	});
+
+	// Serialnums
+
+	MeasureWrite(dbconn, "db.serialnum_insert", ops, [&](uint64_t i)
+	{
+		MakeKey(i, &key, sizeof(key));
+		CheckRc(dbconn.SerialnumInsert(&key, sizeof(key)), "SerialnumInsert");
+	});
+
+	Measure("db.serialnum_check", ops, [&](uint64_t i)
+	{
+		MakeKey(i % nrows, &key, sizeof(key));
+		CheckRc(dbconn.SerialnumCheck(&key, sizeof(key)) != 1, "SerialnumCheck");
+	});
+
+	// Commit_Tree
+
+	MeasureWrite(dbconn, "db.commit_tree_insert", ops, [&](uint64_t i)
+	{
+		CheckRc(dbconn.CommitTreeInsert(0, i, &data, sizeof(data)), "CommitTreeInsert");
+	});
+
+	Measure("db.commit_tree_select", ops, [&](uint64_t i)
+	{
+		CheckRc(dbconn.CommitTreeSelect(0, i % nrows, &data, sizeof(data)), "CommitTreeSelect");
+	});
+
+	// Commit_Roots
+
+	MeasureWrite(dbconn, "db.commit_roots_insert", ops, [&](uint64_t i)
+	{
+		CheckRc(dbconn.CommitRootsInsert(i, i, &data, sizeof(data)), "CommitRootsInsert");
+	});
+
+	Measure("db.commit_roots_select", ops, [&](uint64_t i)
+	{
+		uint64_t timestamp;
+		CheckRc(dbconn.CommitRootsSelect(i % nrows, false, timestamp, &data, sizeof(data)), "CommitRootsSelect");
+	});
+
+	// Tx_Outputs (the select joins Commit_Roots on ParamLevel, so the outputs use parameter level 0)
+
+	MeasureWrite(dbconn, "db.tx_outputs_insert", ops, [&](uint64_t i)
+	{
+		MakeKey(i, &key, sizeof(key));
+		CheckRc(dbconn.TxOutputsInsert(&key, sizeof(key), i, 0, &data, sizeof(data), i), "TxOutputsInsert");
+	});
+
+	Measure("db.tx_outputs_select", ops, [&](uint64_t i)
+	{
+		array<uint8_t, 32> commitment_iv, commitment;
+		uint64_t value_enc, commitnum;
+
+		MakeKey(i % nrows, &key, sizeof(key));
+		CheckRc(dbconn.TxOutputsSelect(&key, sizeof(key), 0, INT64_MAX, &value_enc, (char*)&commitment_iv, sizeof(commitment_iv), (char*)&commitment, sizeof(commitment), &commitnum) != 1, "TxOutputsSelect");
+	});
+
+	// Temp_Serials
+
+	Measure("db.temp_serial_insert", ops, [&](uint64_t i)
+	{
+		MakeKey(i, &key, sizeof(key));
+		CheckRc(dbconn.TempSerialnumInsert(&key, sizeof(key), (void*)(uintptr_t)(1 + i / 64)), "TempSerialnumInsert");
+	});
+
+	Measure("db.temp_serial_select", ops, [&](uint64_t i)
+	{
+		void *blockp[8];
+
+		MakeKey(i % nrows, &key, sizeof(key));
+		CheckRc(dbconn.TempSerialnumSelect(&key, sizeof(key), NULL, blockp, sizeof(blockp)/sizeof(void*)) < 0, "TempSerialnumSelect");
+	});
+
+	// Relay_Objs
+
+	Measure("db.relay_objs_insert", ops, [&](uint64_t i)
+	{
+		relay_request_wire_params_t req_params;
+		memset(&req_params, 0, sizeof(req_params));
+
+		MakeKey(i, &req_params.oid, sizeof(req_params.oid));
+		req_params.size = 2000;
+		req_params.level = i;
+
+		dbconn.RelayObjsInsert(i & 7, CC_TAG_TX_WIRE, req_params, RELAY_STATUS_ANNOUNCED, RELAY_PEER_STATUS_READY);
+	});
+
+	// Process_Q and Valid_Objs use tx objects
+
+	vector<char> wire;
+	bigint_t merkle_root;
+
+	if (MakeTestTx(2, 2, false, wire, merkle_root))
+		return CheckRc(-1, "MakeTestTx");
+
+	auto txobj = MakeObj(wire);
+	auto tx = (CCObject*)txobj.data();
+
+	// each entry must have a unique ObjId, but Process_Q only binds the oid during the insert, so one buffer can be queued many times
+
+	Measure("db.processq_enqueue", ops, [&](uint64_t i)
+	{
+		MakeKey(i, tx->OidPtr(), sizeof(ccoid_t));
+		CheckRc(dbconn.ProcessQEnqueueValidate(PROCESS_Q_TYPE_TX, txobj, NULL, 0, PROCESS_Q_STATUS_PENDING, i, 0, 0), "ProcessQEnqueueValidate");
+	});
+
+	Measure("db.processq_get_next", ops, [&](uint64_t i)
+	{
+		SmartBuf retobj;
+		unsigned conn_index, callback_id;
+
+		CheckRc(dbconn.ProcessQGetNextValidateObj(PROCESS_Q_TYPE_TX, &retobj, conn_index, callback_id), "ProcessQGetNextValidateObj");
+	});
+
+	// Valid_Objs deletes by the oid in the object, so each sample inserts, gets and deletes its own set of objects
+
+	vector<SmartBuf> objs(ops);
+
+	for (unsigned sample = 0; sample <= s_samples; ++sample)
+	{
+		for (unsigned i = 0; i < ops; ++i)
+		{
+			objs[i] = MakeObj(wire);
+			MakeKey(sample * ops + i, ((CCObject*)objs[i].data())->OidPtr(), sizeof(ccoid_t));
+		}
+
+		auto t0 = chrono::steady_clock::now();
+
+		for (unsigned i = 0; i < ops; ++i)
+			CheckRc(dbconn.ValidObjsInsert(objs[i]), "ValidObjsInsert");
+
+		s_results.Add("db.valid_objs_insert", ops, Elapsed(t0), sample);
+
+		t0 = chrono::steady_clock::now();
+
+		for (unsigned i = 0; i < ops; ++i)
+		{
+			SmartBuf retobj;
+			CheckRc(dbconn.ValidObjsGetObj(*((CCObject*)objs[i].data())->OidPtr(), &retobj) || !retobj, "ValidObjsGetObj");
+		}
+
+		s_results.Add("db.valid_objs_get", ops, Elapsed(t0), sample);
+
+		t0 = chrono::steady_clock::now();
+
+		for (unsigned i = 0; i < ops; ++i)
+			CheckRc(dbconn.ValidObjsDeleteObj(objs[i]), "ValidObjsDeleteObj");
+
+		s_results.Add("db.valid_objs_delete", ops, Elapsed(t0), sample);
+	}
+}
+
+static void RunDbBenchmarks(const wstring& datadir)
+{
+	boost::system::error_code ec;
+	auto path = boost::filesystem::path(datadir);
+
+	boost::filesystem::remove_all(path, ec);
+
+	if (create_directory(datadir))
+	{
+		cerr << "ccbench error creating directory " << w2s(datadir) << endl;
+
+		return CheckRc(-1, "create_directory");
+	}
+
+	g_params.app_data_dir = datadir;
+
+	DbInit dbinit;
+	dbinit.CreateDBs();
+
+	{
+		DbConn dbconn;
+
+		BenchDb(dbconn);
+	}
+
+	dbinit.DeInit();
+
+	dblog(sqlite3_shutdown());
+
+	boost::filesystem::remove_all(path, ec);
+}
+
+// verifies proofs for transactions that use each zero knowledge key
+// the first verify of each key loads it, which is excluded from the results by the warmup sample
+
+static void BenchProofs()
+{
+	static const unsigned shapes[][2] = {{1, 1}, {2, 1}, {2, 2}, {4, 4}};	// {nout, nin}
+
+	CCProof_PreloadVerifyKeys();
+
+	auto ptx = new TxPay;
+	struct TxPay& tx = *ptx;
+
+	for (auto shape : shapes)
+	{
+		auto name = "proof.verify.o" + to_string(shape[0]) + "i" + to_string(shape[1]);
+
+		vector<char> wire;
+		bigint_t merkle_root;
+
+		cerr << "ccbench generating proof for " << name << endl;
+
+		if (MakeTestTx(shape[0], shape[1], true, wire, merkle_root) || tx_from_wire(tx, wire.data(), wire.size()))
+		{
+			cerr << "ccbench skipping " << name << "; unable to create a transaction with a proof" << endl;
+
+			continue;
+		}
+
+		auto zkkeyid = tx.zkkeyid;
+
+		Measure(name, Ops(4), [&](uint64_t i)
+		{
+			CheckRc(tx_from_wire(tx, wire.data(), wire.size()), "tx_from_wire");
+
+			tx.merkle_root = merkle_root;
+
+#if !TEST_EXTRA_ON_WIRE
+			tx.outvalmin = 0;
+			tx.outvalmax = UINT64_MAX;
+			tx.invalmax = UINT64_MAX;
+#endif
+
+			CheckRc(CCProof_VerifyProof(tx), "CCProof_VerifyProof");
+		});
+
+		cerr << "ccbench " << name << " uses zkkeyid " << zkkeyid << endl;
+	}
+
+	delete ptx;
+}
+
+static int process_options(int argc, char **argv, bool& json, bool& proofs, wstring& datadir)
+{
+	namespace po = boost::program_options;
+
+	string datadir_str;
+
+	po::options_description options("Options");
+	options.add_options()
+		("help", "Display this message")
+		("samples", po::value<unsigned>(&s_samples)->default_value(5), "Number of timed samples of each benchmark, after one warmup sample")
+		("scale", po::value<double>(&s_scale)->default_value(1), "Multiplier for the number of operations in each sample")
+		("filter", po::value<string>(&s_filter), "Run only the benchmark groups whose names are in this string (tx,hash,work,blake2b,ed25519,smartbuf,db,proof)")
+		("json", "Print the results as a json object")
+		("proofs", "Include the proof verification benchmarks; requires the zero knowledge keys")
+		("datadir", po::value<string>(&datadir_str), "Directory for the db benchmark databases, which is deleted before and after the benchmarks (default: ccbench-data in the program directory)")
+		;
+
+	po::variables_map vm;
+	po::store(po::parse_command_line(argc, argv, options), vm);
+	po::notify(vm);
+
+	if (vm.count("help"))
+	{
+		cout << options << endl;
+
+		return 1;
+	}
+
+	if (s_samples < 1 || s_scale <= 0)
+	{
+		cerr << "ERROR: samples must be at least 1 and scale must be greater than zero" << endl;
+
+		return -1;
+	}
+
+	json = vm.count("json");
+	proofs = vm.count("proofs");
+
+	if (datadir_str.length())
+		datadir = s2w(datadir_str);
+	else
+		datadir = g_params.process_dir + WIDE(PATH_DELIMITER) L"ccbench-data";
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	boost::log::core::get()->set_filter(boost::log::trivial::severity >= warning);
+
+	if (init_app_dir())
+		return -1;
+
+	bool json, proofs;
+	wstring datadir;
+
+	try
+	{
+		auto rc = process_options(argc, argv, json, proofs, datadir);
+		if (rc)
+			return rc < 0 ? -1 : 0;
+	}
+	catch (const exception& e)
+	{
+		cerr << "ERROR: " << e.what() << endl;
+
+		return -1;
+	}
+
+	cerr << "ccbench samples " << s_samples << " scale " << s_scale << endl;
+
+	CCProof_Init();
+
+	if (RunGroup("tx"))
+		BenchTx();
+
+	if (RunGroup("hash"))
+		BenchHash();
+
+	if (RunGroup("work"))
+		BenchWork();
+
+	if (RunGroup("blake2b"))
+		BenchBlake2b();
+
+	if (RunGroup("ed25519"))
+		BenchEd25519();
+
+	if (RunGroup("smartbuf"))
+		BenchSmartBuf();
+
+	if (RunGroup("db"))
+		RunDbBenchmarks(datadir);
+
+	if (proofs && RunGroup("proof"))
+		BenchProofs();
+
+	s_results.Print(json);
+
+	if (s_errors)
+	{
+		cerr << "ccbench " << s_errors << " operations returned errors" << endl;
+
+		return -1;
+	}
+
+	return 0;
+}
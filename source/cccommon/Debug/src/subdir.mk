@@ -6,30 +6,36 @@
 CPP_SRCS += \
 ../src/CCassert.cpp \
 ../src/CCcrypto.cpp \
+../src/CClog.cpp \
 ../src/CCobjects.cpp \
 ../src/CCticks.cpp \
 ../src/CCutil.cpp \
 ../src/SmartBuf.cpp \
+../src/SpinLock.cpp \
 ../src/dblog.cpp \
 ../src/socks.cpp 
 
 OBJS += \
 ./src/CCassert.o \
 ./src/CCcrypto.o \
+./src/CClog.o \
 ./src/CCobjects.o \
 ./src/CCticks.o \
 ./src/CCutil.o \
 ./src/SmartBuf.o \
+./src/SpinLock.o \
 ./src/dblog.o \
 ./src/socks.o 
 
 CPP_DEPS += \
 ./src/CCassert.d \
 ./src/CCcrypto.d \
+./src/CClog.d \
 ./src/CCobjects.d \
 ./src/CCticks.d \
 ./src/CCutil.d \
 ./src/SmartBuf.d \
+./src/SpinLock.d \
 ./src/dblog.d \
 ./src/socks.d 
 
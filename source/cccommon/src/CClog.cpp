@@ -0,0 +1,454 @@
+/*
+ * CredaCash (TM) cryptocurrency and blockchain
+ *
+ * Copyright (C) 2015-2016 Creda Software, Inc.
+ *
+ * CClog.cpp
+*/
+
+#include "CClog.hpp"
+#include "CCutil.h"
+#include "CCticks.hpp"
+
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/date_time/c_local_time_adjustor.hpp>
+
+using namespace std;
+
+#define CCLOG_WRITER_MS			20
+#define CCLOG_DROP_REPORT_SECS	10
+
+// the ccserver subsystems default to all levels, so that in programs that don't set them, only the global trace level applies
+
+CCLogSubsystem g_log_ccserver("ccserver", 6);
+CCLogSubsystem g_log_ccserver_rw("ccserver-rw", 6);
+
+struct CCLogEntry
+{
+	chrono::system_clock::time_point time;
+	const CCLogSubsystem *subsys;
+	boost::log::trivial::severity_level severity;
+	uint16_t len;
+	string *more;		// text past CCLOG_RECORD_SIZE, freed by the writer
+	char text[CCLOG_RECORD_SIZE];
+};
+
+// single producer (the owning thread), single consumer (the writer thread)
+
+struct CCLogRing
+{
+	atomic<uint32_t> head;		// next entry to be written by the producer
+	atomic<uint32_t> tail;		// next entry to be read by the writer
+	atomic<bool> dead;			// set when the owning thread exits
+	thread::id thread_id;
+	CCLogRing *next;
+
+	CCLogEntry entries[CCLOG_RING_RECORDS];
+
+	CCLogRing()
+	 :	head(0),
+		tail(0),
+		dead(false),
+		thread_id(this_thread::get_id()),
+		next(NULL)
+	{ }
+};
+
+static CCLogSubsystem *s_subsystems;		// zero initialized before any constructor runs
+static mutex s_subsystems_lock;
+
+// marks the thread's ring dead when the thread exits, so the writer can free it once it has been drained
+
+struct CCLogRingOwner
+{
+	CCLogRing *ring;
+
+	~CCLogRingOwner()
+	{
+		if (ring)
+			ring->dead.store(true, memory_order_release);
+
+		ring = NULL;
+	}
+};
+
+static atomic<CCLogRing*> s_rings;		// new rings are pushed at the front by their threads; only the writer unlinks them
+static thread_local CCLogRingOwner t_ring;
+
+static atomic<bool> s_running;
+static atomic<bool> s_stop;
+static thread *s_writer;
+
+static atomic<uint64_t> s_dropped;
+static atomic<unsigned> s_producers;	// records being formatted into a ring; CCLog::Stop waits for these before its last drain
+
+CCLogSubsystem::CCLogSubsystem(const char *name, int level, bool console)
+ :	m_name(name),
+	m_level(level),
+	m_console(console)
+{
+	lock_guard<mutex> lock(s_subsystems_lock);
+
+	m_next = s_subsystems;
+	s_subsystems = this;
+}
+
+int CCLogSubsystem::SetLevel(const string& name, int level)
+{
+	lock_guard<mutex> lock(s_subsystems_lock);
+
+	for (auto subsys = s_subsystems; subsys; subsys = subsys->m_next)
+	{
+		if (name == subsys->m_name)
+		{
+			subsys->SetLevel(level);
+
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+void CCLogSubsystem::DumpLevels(ostream& os)
+{
+	lock_guard<mutex> lock(s_subsystems_lock);
+
+	for (auto subsys = s_subsystems; subsys; subsys = subsys->m_next)
+		os << "   " << subsys->m_name << " = " << subsys->GetLevel() << endl;
+}
+
+static CCLogRing* GetThreadRing()
+{
+	if (!t_ring.ring)
+	{
+		auto ring = new CCLogRing;
+
+		auto head = s_rings.load();
+
+		do
+		{
+			ring->next = head;
+
+		} while (!s_rings.compare_exchange_weak(head, ring));
+
+		t_ring.ring = ring;
+	}
+
+	return t_ring.ring;
+}
+
+CCLogRecord::RecordBuf::int_type CCLogRecord::RecordBuf::overflow(int_type c)
+{
+	if (!traits_type::eq_int_type(c, traits_type::eof()))
+		m_more.push_back(traits_type::to_char_type(c));
+
+	return traits_type::not_eof(c);
+}
+
+streamsize CCLogRecord::RecordBuf::xsputn(const char *s, streamsize n)
+{
+	streamsize room = epptr() - pptr();
+
+	if (n <= room)
+	{
+		memcpy(pptr(), s, n);
+		pbump(n);
+
+		return n;
+	}
+
+	memcpy(pptr(), s, room);
+	pbump(room);
+
+	m_more.append(s + room, n - room);
+
+	return n;
+}
+
+CCLogRecord::CCLogRecord(const CCLogSubsystem& subsys, boost::log::trivial::severity_level severity)
+ :	m_subsys(subsys),
+	m_severity(severity),
+	m_ring(NULL),
+	m_entry(NULL),
+	m_stream(&m_buf)
+{
+	// s_producers is incremented before s_running is checked, and CCLog::Stop clears s_running before it waits for s_producers,
+	// so a record either sees the writer stopped and takes the synchronous path, or is drained by CCLog::Stop
+
+	s_producers.fetch_add(1);
+
+	if (!s_running.load())
+	{
+		s_producers.fetch_sub(1, memory_order_release);
+
+		m_buf.Set(m_syncbuf, sizeof(m_syncbuf));
+
+		return;
+	}
+
+	auto ring = GetThreadRing();
+
+	auto head = ring->head.load(memory_order_relaxed);
+	auto tail = ring->tail.load(memory_order_acquire);
+
+	if (head - tail >= CCLOG_RING_RECORDS)
+	{
+		s_producers.fetch_sub(1, memory_order_release);
+
+		m_buf.Set(m_syncbuf, sizeof(m_syncbuf));
+
+		// ring is full; write warnings and errors synchronously so a burst of trace output can't hide them, and format the rest into the scratch buffer and discard
+
+		if (severity < boost::log::trivial::warning)
+		{
+			m_ring = ring;
+
+			s_dropped.fetch_add(1, memory_order_relaxed);
+		}
+
+		return;
+	}
+
+	m_ring = ring;
+
+	m_entry = &m_ring->entries[head & (CCLOG_RING_RECORDS - 1)];
+
+	m_entry->time = chrono::system_clock::now();
+	m_entry->subsys = &subsys;
+	m_entry->severity = severity;
+	m_entry->more = NULL;
+
+	m_buf.Set(m_entry->text, sizeof(m_entry->text));
+}
+
+CCLogRecord::~CCLogRecord()
+{
+	if (m_entry)
+	{
+		m_entry->len = m_buf.Length();
+
+		if (m_buf.More().size())
+			m_entry->more = new string(move(m_buf.More()));
+
+		m_ring->head.fetch_add(1, memory_order_release);
+
+		s_producers.fetch_sub(1, memory_order_release);
+	}
+	else if (!m_ring)
+	{
+		string msg(m_syncbuf, m_buf.Length());
+		msg.append(m_buf.More());
+
+		if (m_subsys.IsConsole())
+		{
+			lock_guard<FastSpinLock> lock(g_cout_lock);
+			cerr << msg << endl;
+		}
+		else
+		{
+			BOOST_LOG_SEV(::boost::log::trivial::logger::get(), m_severity) << msg;
+		}
+	}
+}
+
+static void FormatTime(ostream& os, const chrono::system_clock::time_point& t)
+{
+	using namespace boost::posix_time;
+
+	auto usec = chrono::duration_cast<chrono::microseconds>(t.time_since_epoch()).count();
+
+	auto utc = from_time_t(usec / 1000000) + microseconds(usec % 1000000);
+	auto local = boost::date_time::c_local_adjustor<ptime>::utc_to_local(utc);
+
+	os << to_iso_extended_string(local).replace(10, 1, " ");
+}
+
+static void WriteText(ostream& os, CCLogEntry *entry)
+{
+	os.write(entry->text, entry->len);
+
+	if (entry->more)
+	{
+		os << *entry->more;
+
+		delete entry->more;
+		entry->more = NULL;
+	}
+}
+
+// frees the rings of threads that have exited, once they have been drained
+// the ring at the front of the list is left in place because threads push new rings onto it, and is freed after another ring is added in front of it
+
+static void FreeDeadRings()
+{
+	for (auto prev = s_rings.load(); prev; )
+	{
+		auto ring = prev->next;
+
+		if (ring && ring->dead.load(memory_order_acquire) && ring->tail.load(memory_order_relaxed) == ring->head.load(memory_order_acquire))
+		{
+			prev->next = ring->next;
+
+			delete ring;
+		}
+		else
+			prev = ring;
+	}
+}
+
+// drains all rings and writes the records in time order
+// returns the number of records written
+
+static unsigned DrainRings()
+{
+	static vector<pair<CCLogEntry*, CCLogRing*>> entries;
+	static vector<pair<CCLogRing*, uint32_t>> heads;
+
+	entries.clear();
+	heads.clear();
+
+	for (auto ring = s_rings.load(); ring; ring = ring->next)
+	{
+		auto head = ring->head.load(memory_order_acquire);
+
+		heads.push_back(make_pair(ring, head));
+
+		for (auto i = ring->tail.load(memory_order_relaxed); i != head; ++i)
+			entries.push_back(make_pair(&ring->entries[i & (CCLOG_RING_RECORDS - 1)], ring));
+	}
+
+	if (!entries.size())
+	{
+		FreeDeadRings();
+
+		return 0;
+	}
+
+	stable_sort(entries.begin(), entries.end(), [](const pair<CCLogEntry*, CCLogRing*>& a, const pair<CCLogEntry*, CCLogRing*>& b)
+	{
+		return a.first->time < b.first->time;
+	});
+
+	ostringstream log, console;
+
+	for (auto& e : entries)
+	{
+		auto entry = e.first;
+
+		if (entry->subsys->IsConsole())
+		{
+			WriteText(console, entry);
+			console << '\n';
+
+			continue;
+		}
+
+		// same layout as the default boost log sink
+
+		auto severity = boost::log::trivial::to_string(entry->severity);
+		auto pad = strlen(severity) < 8 ? 8 - strlen(severity) : 1;
+
+		log << "[";
+		FormatTime(log, entry->time);
+		log << "] [0x" << hex << setw(16) << setfill('0') << e.second->thread_id << dec << setfill(' ') << "] [" << severity << "]" << string(pad, ' ');
+		WriteText(log, entry);
+		log << '\n';
+	}
+
+	if (log.tellp() > 0)
+	{
+		clog << log.str();
+		clog.flush();
+	}
+
+	if (console.tellp() > 0)
+	{
+		lock_guard<FastSpinLock> lock(g_cout_lock);
+		cerr << console.str();
+		cerr.flush();
+	}
+
+	for (auto& h : heads)
+		h.first->tail.store(h.second, memory_order_release);
+
+	FreeDeadRings();
+
+	return entries.size();
+}
+
+static void WriterProc()
+{
+	uint64_t reported_dropped = 0;
+	auto last_report = ccticks();
+
+	while (!s_stop.load())
+	{
+		DrainRings();
+
+		auto dropped = s_dropped.load();
+
+		if (dropped != reported_dropped && ccticks_elapsed(last_report, ccticks()) > CCLOG_DROP_REPORT_SECS * CCTICKS_PER_SEC)
+		{
+			BOOST_LOG_TRIVIAL(warning) << "CCLog dropped " << dropped - reported_dropped << " records because a log ring buffer was full";
+
+			reported_dropped = dropped;
+			last_report = ccticks();
+		}
+
+		this_thread::sleep_for(chrono::milliseconds(CCLOG_WRITER_MS));
+	}
+}
+
+void CCLog::Start()
+{
+	if (s_writer)
+		return;
+
+	s_stop.store(false);
+
+	s_writer = new thread(WriterProc);
+
+	s_running.store(true, memory_order_release);
+}
+
+void CCLog::Stop()
+{
+	if (!s_writer)
+		return;
+
+	s_running.store(false);
+	s_stop.store(true);
+
+	s_writer->join();
+
+	delete s_writer;
+	s_writer = NULL;
+
+	// records that started before s_running was cleared may still be publishing to their rings
+
+	while (s_producers.load(memory_order_acquire))
+		this_thread::yield();
+
+	DrainRings();
+}
+
+bool CCLog::IsRunning()
+{
+	return s_running.load(memory_order_relaxed);
+}
+
+uint64_t CCLog::Dropped()
+{
+	return s_dropped.load();
+}
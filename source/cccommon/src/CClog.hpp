@@ -0,0 +1,145 @@
+/*
+ * CredaCash (TM) cryptocurrency and blockchain
+ *
+ * Copyright (C) 2015-2016 Creda Software, Inc.
+ *
+ * CClog.hpp
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <ostream>
+#include <streambuf>
+
+#include <boost/log/trivial.hpp>
+
+// Asynchronous logging for hot paths
+//
+// Usage:
+//
+//	CCLOG(g_log_relay, trace) << "message " << value;
+//
+// The arguments are only evaluated when the subsystem's level enables the severity.
+// Each record is formatted directly into a slot of a per-thread single-producer ring buffer;
+// a background writer thread drains all the rings and writes the records to std::clog in batches.
+// Text past CCLOG_RECORD_SIZE bytes spills into a heap string, so long records are still logged whole.
+// A thread's ring is freed by the writer after the thread exits and its records have been written.
+// When the writer is not running, records are passed synchronously to BOOST_LOG_TRIVIAL.
+// When a ring is full, warning and higher records are also passed synchronously, and lower records are dropped and counted.
+//
+// Subsystem levels use the same scale as the --trace option (0=none, 1=fatal ... 6=trace)
+// and can be changed at any time with CCLogSubsystem::SetLevel.
+
+#define CCLOG_RECORD_SIZE		256
+#define CCLOG_RING_RECORDS		256		// must be a power of 2
+
+#define CCLOG(subsys, sev) \
+	if (!(subsys).Enabled(boost::log::trivial::sev)) ; else CCLogRecord((subsys), boost::log::trivial::sev).stream()
+
+class CCLogSubsystem
+{
+	const char *m_name;
+	std::atomic<int> m_level;
+	bool m_console;
+	CCLogSubsystem *m_next;
+
+public:
+
+	// if console is true, records are written to std::cerr without a prefix instead of to the log
+	CCLogSubsystem(const char *name, int level = 0, bool console = false);
+
+	const char* Name() const
+	{
+		return m_name;
+	}
+
+	bool IsConsole() const
+	{
+		return m_console;
+	}
+
+	bool Enabled(boost::log::trivial::severity_level sev) const
+	{
+		return (int)sev + m_level.load(std::memory_order_relaxed) > (int)boost::log::trivial::fatal;
+	}
+
+	int GetLevel() const
+	{
+		return m_level.load(std::memory_order_relaxed);
+	}
+
+	void SetLevel(int level)
+	{
+		m_level.store(level, std::memory_order_relaxed);
+	}
+
+	// returns -1 if there is no subsystem with this name
+	static int SetLevel(const std::string& name, int level);
+
+	static void DumpLevels(std::ostream& os);
+};
+
+class CCLogRecord
+{
+	class RecordBuf : public std::streambuf
+	{
+		std::string m_more;		// text that didn't fit in the buffer
+
+	protected:
+		int_type overflow(int_type c) override;
+		std::streamsize xsputn(const char *s, std::streamsize n) override;
+
+	public:
+		void Set(char *buf, unsigned size)
+		{
+			setp(buf, buf + size);
+		}
+
+		unsigned Length() const
+		{
+			return pptr() - pbase();
+		}
+
+		std::string& More()
+		{
+			return m_more;
+		}
+	};
+
+	const CCLogSubsystem& m_subsys;
+	boost::log::trivial::severity_level m_severity;
+	struct CCLogRing *m_ring;
+	struct CCLogEntry *m_entry;
+
+	RecordBuf m_buf;
+	std::ostream m_stream;
+
+	char m_syncbuf[CCLOG_RECORD_SIZE];
+
+public:
+
+	CCLogRecord(const CCLogSubsystem& subsys, boost::log::trivial::severity_level severity);
+	~CCLogRecord();
+
+	std::ostream& stream()
+	{
+		return m_stream;
+	}
+};
+
+class CCLog
+{
+public:
+	static void Start();
+	static void Stop();
+
+	static bool IsRunning();
+
+	static std::uint64_t Dropped();
+};
+
+extern CCLogSubsystem g_log_ccserver;
+extern CCLogSubsystem g_log_ccserver_rw;
@@ -14,11 +14,15 @@
 // CC-Message
 #define CC_MSG_HAVE_BLOCK		0xCC4D0001
 #define CC_MSG_HAVE_TX			0xCC4D0002
+#define CC_MSG_HAVE_TX_SHORTIDS	0xCC4D0003
+#define CC_MSG_RELAY_FEATURES	0xCC4D0004
 
 // CC-Command
 #define CC_CMD_SEND_LEVELS		0xCC430001
 #define CC_CMD_SEND_BLOCK		0xCC430002
 #define CC_CMD_SEND_TX			0xCC430003
+#define CC_CMD_SEND_BLOCK_COMPACT	0xCC430004
+#define CC_CMD_SEND_HAVE_TX		0xCC430005
 
 // CC-Success
 #define CC_SUCCESS				0xCC530001
@@ -41,18 +45,28 @@
 #define CC_TAG_TX_STRUCT		0xCC020001
 #define CC_TAG_TX_WIRE			0xCC030001
 #define CC_TAG_TX_BLOCK			0xCC040001
+#define CC_TAG_BLOCK_COMPACT	0xCC050001
 
 // CC-Query
 #define CC_TAG_TX_QUERY_PARAMS	0xCC510001
 #define CC_TAG_TX_QUERY_ADDRESS	0xCC510002
 #define CC_TAG_TX_QUERY_INPUTS	0xCC510003
 #define CC_TAG_TX_QUERY_SERIAL	0xCC510004
+#define CC_TAG_TX_QUERY_ADDRESSES	0xCC510005
+#define CC_TAG_TX_QUERY_BINARY	0x00000100	// or'ed into a CC-Query tag to request a binary reply
+
+#define TX_QUERY_MAX_ADDRESSES	1000
+
+// CC-Session
+#define CC_TAG_TX_SESSION		0xCC520001	// header + request id + query or tx message
+#define CC_TAG_TX_SESSION_REPLY	0xCC520002	// header + request id + reply text
 
 
 #define CC_OID_SIZE				(128/8)
 typedef std::array<uint8_t, CC_OID_SIZE> ccoid_t;
 
 #define CC_MSG_HEADER_SIZE		(2*sizeof(uint32_t))
+#define TX_SESSION_HEADER_SIZE	(CC_MSG_HEADER_SIZE + sizeof(uint32_t))
 
 #if TEST_SMALL_BUFS
 #define CC_HAVE_MAX				5
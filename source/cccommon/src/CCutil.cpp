@@ -12,7 +12,8 @@
 
 using namespace std;
 
-FastSpinLock g_cout_lock;
+static CCLockSite s_cout_lock_site("cout");
+FastSpinLock g_cout_lock(s_cout_lock_site);
 const char* g_hex_digits = "0123456789abcdef";
 
 string s2hex(const string& str)
@@ -24,6 +24,7 @@
 std::atomic<unsigned> objcount(0);
 std::atomic<unsigned> maxobjcount(0);
 std::atomic<unsigned> maxrefcount(0);
+std::atomic<std::uint64_t> objbytes(0);
 
 #if TRACE_SMARTBUF
 SmartBuf::SmartBuf()
@@ -81,6 +82,8 @@ SmartBuf::SmartBuf(std::size_t bufsize)
 		if (!t0)
 			t0 = time(NULL);
 
+		objbytes.fetch_add(asize, std::memory_order_relaxed);
+
 		auto nobjs = objcount.fetch_add(1);
 		if (!(nobjs & (127)))
 		{
@@ -303,6 +306,8 @@ unsigned SmartBuf::DecRef()
 			}
 		}
 
+		objbytes.fetch_sub(alloc_size(), std::memory_order_relaxed);
+
 		free(bufp);
 
 		auto nobjs = objcount.fetch_sub(1);
@@ -313,6 +318,13 @@ unsigned SmartBuf::DecRef()
 	return refcount-1;
 }
 
+void SmartBuf::GetStats(unsigned& nobjs, unsigned& maxobjs, std::uint64_t& nbytes)
+{
+	nobjs = objcount.load();
+	maxobjs = maxobjcount.load();
+	nbytes = objbytes.load();
+}
+
 SmartBuf::~SmartBuf()
 {
 	auto bufp = buf.load(std::memory_order_acquire);
@@ -88,4 +88,7 @@ public:
 	{
 		return !(*this == s);
 	}
+
+	// Get the number of buffers and bytes currently allocated, and the sampled peak number of buffers
+	static void GetStats(unsigned& nobjs, unsigned& maxobjs, std::uint64_t& nbytes);
 };
@@ -0,0 +1,131 @@
+/*
+ * CredaCash (TM) cryptocurrency and blockchain
+ *
+ * Copyright (C) 2015-2016 Creda Software, Inc.
+ *
+ * SpinLock.cpp
+*/
+
+#include "SpinLock.hpp"
+
+#include <chrono>
+
+#include <boost/log/trivial.hpp>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+using namespace std;
+
+#define SPIN_TRIES			16		// tries before parking
+#define SPIN_MAX_PAUSES		64		// maximum backoff between tries, in cpu pauses
+
+atomic<bool> CCLockSite::s_enabled;
+
+static CCLockSite *s_sites;		// zero initialized before any constructor runs
+static mutex s_sites_lock;
+
+CCLockSite::CCLockSite(const char *name)
+ :	m_name(name),
+	acquisitions(0),
+	contended(0),
+	parked(0),
+	wait_usec(0)
+{
+	lock_guard<mutex> lock(s_sites_lock);
+
+	m_next = s_sites;
+	s_sites = this;
+}
+
+void CCLockSite::SetEnabled(bool enabled)
+{
+	s_enabled.store(enabled);
+}
+
+void CCLockSite::DumpAll()
+{
+	lock_guard<mutex> lock(s_sites_lock);
+
+	for (auto site = s_sites; site; site = site->m_next)
+	{
+		auto acquisitions = site->acquisitions.load();
+		auto contended = site->contended.load();
+
+		if (!acquisitions)
+			continue;
+
+		BOOST_LOG_TRIVIAL(info) << "lock " << site->m_name << " acquisitions " << acquisitions << " contended " << contended
+				<< " (" << (100.0 * contended / acquisitions) << "%) parked " << site->parked.load() << " wait ms " << site->wait_usec.load() / 1000;
+	}
+}
+
+static inline void cpu_pause()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+	asm volatile("yield");
+#endif
+}
+
+void FastSpinLock::LockSlow()
+{
+	bool profile = m_site && CCLockSite::IsEnabled();
+	bool parked = false;
+
+	chrono::steady_clock::time_point t0;
+
+	if (profile)
+		t0 = chrono::steady_clock::now();
+
+	unsigned pauses = 1;
+
+	for (unsigned i = 0; i < SPIN_TRIES; ++i)
+	{
+		for (unsigned j = 0; j < pauses; ++j)
+			cpu_pause();
+
+		if (pauses < SPIN_MAX_PAUSES)
+			pauses *= 2;
+
+		if (!m_state.load(memory_order_relaxed) && try_lock())
+			goto done;
+	}
+
+	// mark the lock as having waiters, and park until it is released
+
+	parked = true;
+
+	while (m_state.exchange(2, memory_order_acquire))
+	{
+#ifdef _WIN32
+		this_thread::yield();
+#else
+		syscall(SYS_futex, (int*)&m_state, FUTEX_WAIT_PRIVATE, 2, NULL, NULL, 0);
+#endif
+	}
+
+done:
+
+	if (profile)
+	{
+		auto t1 = chrono::steady_clock::now();
+
+		m_site->acquisitions.fetch_add(1, memory_order_relaxed);
+		m_site->contended.fetch_add(1, memory_order_relaxed);
+		if (parked)
+			m_site->parked.fetch_add(1, memory_order_relaxed);
+		m_site->wait_usec.fetch_add(chrono::duration_cast<chrono::microseconds>(t1 - t0).count(), memory_order_relaxed);
+	}
+}
+
+void FastSpinLock::Wake()
+{
+#ifndef _WIN32
+	syscall(SYS_futex, (int*)&m_state, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#endif
+}
@@ -16,30 +16,88 @@
 
 #include <CCassert.h>
 
+// Counters for all locks constructed with the same CCLockSite
+// Counting is off by default and is turned on for all sites with CCLockSite::SetEnabled
+
+class CCLockSite
+{
+	const char *m_name;
+	CCLockSite *m_next;
+
+	static std::atomic<bool> s_enabled;
+
+public:
+	std::atomic<std::uint64_t> acquisitions;
+	std::atomic<std::uint64_t> contended;		// acquisitions that did not get the lock on the first try
+	std::atomic<std::uint64_t> parked;			// contended acquisitions that stopped spinning and waited in the kernel
+	std::atomic<std::uint64_t> wait_usec;		// total time spent waiting in contended acquisitions
+
+	CCLockSite(const char *name);
+
+	const char* Name() const
+	{
+		return m_name;
+	}
+
+	static bool IsEnabled()
+	{
+		return s_enabled.load(std::memory_order_relaxed);
+	}
+
+	static void SetEnabled(bool enabled);
+
+	// logs the counters of all sites that have been acquired
+	static void DumpAll();
+};
+
+// Adaptive lock for short critical sections
+// lock() first tries once, then spins with a cpu pause and exponential backoff,
+// then parks the thread on a futex until the lock is released
+
 class FastSpinLock
 {
-	std::atomic_flag mutex;
+	std::atomic<std::uint32_t> m_state;		// 0 = unlocked, 1 = locked, 2 = locked and threads may be parked
+	CCLockSite *m_site;
+
+	void LockSlow();
+	void Wake();
 
 public:
 
 	FastSpinLock()
-	 :	mutex(ATOMIC_FLAG_INIT)
+	 :	m_state(0),
+		m_site(NULL)
+	{ }
+
+	explicit FastSpinLock(CCLockSite& site)
+	 :	m_state(0),
+		m_site(&site)
 	{ }
 
 	~FastSpinLock()
 	{
-		CCASSERTZ(mutex.test_and_set(std::memory_order_acquire));
+		CCASSERTZ(m_state.load(std::memory_order_acquire));
+	}
+
+	bool try_lock()
+	{
+		std::uint32_t expected = 0;
+
+		return m_state.compare_exchange_strong(expected, 1, std::memory_order_acquire, std::memory_order_relaxed);
 	}
 
 	void lock()
 	{
-		while (mutex.test_and_set(std::memory_order_acquire))
-			 ;;;
+		if (!try_lock())
+			LockSlow();
+		else if (m_site && CCLockSite::IsEnabled())
+			m_site->acquisitions.fetch_add(1, std::memory_order_relaxed);
 	}
 
 	void unlock()
 	{
-        mutex.clear(std::memory_order_release);
+		if (m_state.exchange(0, std::memory_order_release) == 2)
+			Wake();
 	}
 };
 
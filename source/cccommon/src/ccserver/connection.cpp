@@ -12,6 +12,7 @@
 #include "connection_registry.hpp"
 #include "socks.hpp"
 #include "CCutil.h"
+#include "CCticks.hpp"
 
 #include <iostream>
 #include <vector>
@@ -59,7 +60,7 @@ ConnectionFactory::ConnectionFactory(unsigned conn_nreadbuf, unsigned conn_nwrit
 	if (m_sock_nwritebuf > 8*4096)
 		m_sock_nwritebuf = 8*4096;
 
-	if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(trace) << "ConnectionFactory"
+	CCLOG(g_log_ccserver, trace) << "ConnectionFactory"
 		<< " m_conn_nreadbuf " << m_conn_nreadbuf
 		<< " m_conn_nwritebuf " << m_conn_nwritebuf
 		<< " m_sock_nreadbuf " << m_sock_nreadbuf
@@ -69,15 +70,24 @@ ConnectionFactory::ConnectionFactory(unsigned conn_nreadbuf, unsigned conn_nwrit
 		<< " m_register " << m_register;
 }
 
+CCLockSite Connection::s_conn_lock_site("connection");
+
 Connection::Connection(ConnectionManager& manager, boost::asio::io_service& io_service, const class ConnectionFactory& connfac)
 	:	m_connection_manager(manager),
 		m_conn_index(0),
 		m_is_free(0),
+		m_io_context(0),
 		m_use_count(0),
 		m_headersize(connfac.m_headersize),
 		m_noclose(connfac.m_noclose),
 		m_socket(io_service),
 		m_incoming(0),
+		m_connect_ticks(0),
+		m_connect_ms(-1),
+		m_warm_state(WARM_NONE),
+		m_warm_ticks(0),
+		m_request_ticks(0),
+		m_from_warm_pool(false),
 		m_readbuf(connfac.m_conn_nreadbuf),
 		m_writebuf(connfac.m_conn_nwritebuf),
 		m_pread(NULL),
@@ -85,6 +95,7 @@ Connection::Connection(ConnectionManager& manager, boost::asio::io_service& io_s
 		m_nred(0),
 		m_terminated(0),
 		m_timer(io_service),
+		m_conn_lock(s_conn_lock_site),
 		m_stopping(0),
 		m_ops_pending(0)
 {
@@ -109,24 +120,29 @@ const string& Connection::Name() const
 
 void Connection::InitNewConnection()
 {
-	if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " Connection::InitNewConnection use count " << m_use_count.load() << " pending ops " << m_ops_pending.load();
+	CCLOG(g_log_ccserver, trace) << Name() << " Conn-" << m_conn_index << " Connection::InitNewConnection use count " << m_use_count.load() << " pending ops " << m_ops_pending.load();
 
 	CCASSERTZ(m_ops_pending.load());
 
 	m_stopping.store(g_shutdown);
 	m_write_in_progress.clear();
+
+	m_tor_host.clear();
+	m_connect_ms = -1;
+	m_request_ticks = 0;
+	m_from_warm_pool = false;
 }
 
 void Connection::ConnectOutgoing(const string& host, unsigned port)
 {
-	if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " Connection::ConnectOutgoing host " << host << " port " << port;
+	CCLOG(g_log_ccserver, trace) << Name() << " Conn-" << m_conn_index << " Connection::ConnectOutgoing host " << host << " port " << port;
 
 	InitNewConnection();
 
 	auto op_pending = AcquireRef();
 	if (!op_pending)
 	{
-		if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(debug) << Name() << " Conn-" << m_conn_index << " Connection::ConnectOutgoing connection is closing";
+		CCLOG(g_log_ccserver, debug) << Name() << " Conn-" << m_conn_index << " Connection::ConnectOutgoing connection is closing";
 
 		return;
 	}
@@ -148,14 +164,18 @@ void Connection::ConnectOutgoing(const string& host, unsigned port)
 
 void Connection::ConnectOutgoingTor(const string& host, unsigned proxy_port)
 {
-	if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " Connection::ConnectOutgoingTor host " << host << " torproxy port " << proxy_port;
+	CCLOG(g_log_ccserver, trace) << Name() << " Conn-" << m_conn_index << " Connection::ConnectOutgoingTor host " << host << " torproxy port " << proxy_port;
 
 	InitNewConnection();
 
+	m_tor_host = host;
+	m_connect_ticks = ccticks();
+	m_request_ticks = m_connect_ticks;
+
 	auto op_pending = AcquireRef();
 	if (!op_pending)
 	{
-		if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(debug) << Name() << " Conn-" << m_conn_index << " Connection::ConnectOutgoingTor connection is closing";
+		CCLOG(g_log_ccserver, debug) << Name() << " Conn-" << m_conn_index << " Connection::ConnectOutgoingTor connection is closing";
 
 		return;
 	}
@@ -199,7 +219,7 @@ void Connection::ConnectOutgoingTor(const string& host, unsigned proxy_port)
 
 void Connection::HandleTorTimeout(const boost::system::error_code& e, AutoCount pending_op_counter)
 {
-	//if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " Connection::HandleTorTimeout e = " << e << " " << e.message();
+	//CCLOG(g_log_ccserver, trace) << Name() << " Conn-" << m_conn_index << " Connection::HandleTorTimeout e = " << e << " " << e.message();
 
 	if (e == boost::asio::error::operation_aborted)
 		return;
@@ -223,7 +243,7 @@ void Connection::HandleTorProxyWrite(const boost::system::error_code& e, SmartBu
 		return Stop();
 	}
 
-	if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " Connection::HandleTorProxyWrite ok";
+	CCLOG(g_log_ccserver, trace) << Name() << " Conn-" << m_conn_index << " Connection::HandleTorProxyWrite ok";
 
 	ReadAsync("Connection::HandleTorProxyWrite", boost::asio::buffer(msgbuf.data(), SOCK_REPLY_SIZE), boost::asio::transfer_exactly(SOCK_REPLY_SIZE),
 				boost::bind(&Connection::HandleTorProxyRead, this, boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred, msgbuf, AutoCount(this)));
@@ -259,7 +279,29 @@ void Connection::HandleTorProxyRead(const boost::system::error_code& e, size_t b
 		return Stop();
 	}
 
-	BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " Connection::HandleTorProxyRead ok";
+	m_connect_ms = ccticks_elapsed(m_connect_ticks, ccticks());
+
+	BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " Connection::HandleTorProxyRead ok in " << m_connect_ms << " ms";
+
+	// a pre-warmed connection waits without any pending operations until it is claimed
+
+	if (m_connection_manager.ParkWarmConnection(this))
+		return;
+
+	StartConnection();
+}
+
+void Connection::StartWarmConnection()
+{
+	CCLOG(g_log_ccserver, trace) << Name() << " Conn-" << m_conn_index << " Connection::StartWarmConnection";
+
+	auto op_pending = AcquireRef();
+	if (!op_pending)
+	{
+		CCLOG(g_log_ccserver, debug) << Name() << " Conn-" << m_conn_index << " Connection::StartWarmConnection connection is closing";
+
+		return;
+	}
 
 	StartConnection();
 }
@@ -267,14 +309,14 @@ void Connection::HandleTorProxyRead(const boost::system::error_code& e, size_t b
 void Connection::StartIncomingConnection()
 {
 	if (m_noclose) BOOST_LOG_TRIVIAL(debug) << Name() << " Conn-" << m_conn_index << " Connection::StartIncomingConnection";
-	if (TRACE_CCSERVER && !m_noclose) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " Connection::StartIncomingConnection";
+	if (!m_noclose) CCLOG(g_log_ccserver, trace) << Name() << " Conn-" << m_conn_index << " Connection::StartIncomingConnection";
 
 	InitNewConnection();
 
 	auto op_pending = AcquireRef();
 	if (!op_pending)
 	{
-		if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(debug) << Name() << " Conn-" << m_conn_index << " Connection::StartIncomingConnection connection is closing";
+		CCLOG(g_log_ccserver, debug) << Name() << " Conn-" << m_conn_index << " Connection::StartIncomingConnection connection is closing";
 
 		return;
 	}
@@ -284,14 +326,14 @@ void Connection::StartIncomingConnection()
 
 void Connection::StartConnection()
 {
-	if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " Connection::StartConnection";
+	CCLOG(g_log_ccserver, trace) << Name() << " Conn-" << m_conn_index << " Connection::StartConnection";
 
 	StartRead();
 }
 
 void Connection::StartRead()
 {
-	if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " Connection::StartRead";
+	CCLOG(g_log_ccserver, trace) << Name() << " Conn-" << m_conn_index << " Connection::StartRead";
 
 	m_pread = m_readbuf.data();
 	m_nred = 0;
@@ -318,14 +360,14 @@ void Connection::QueueRead(unsigned minbytes)
 
 	if (m_terminated)
 	{
-		//if (TRACE_CCSERVER_RW) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " Connection::QueueRead m_pread " << (uintptr_t)m_pread << " m_nred " << m_nred << " m_maxread " << m_maxread << " ReadAsync transfer_at_least " << minbytes;
+		//CCLOG(g_log_ccserver_rw, trace) << Name() << " Conn-" << m_conn_index << " Connection::QueueRead m_pread " << (uintptr_t)m_pread << " m_nred " << m_nred << " m_maxread " << m_maxread << " ReadAsync transfer_at_least " << minbytes;
 
 		ReadAsync("Connection::QueueRead", boost::asio::buffer(m_pread + m_nred, m_maxread - m_nred), boost::asio::transfer_at_least(minbytes),
 			boost::bind(&Connection::HandleReadCheck, this, boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred, AutoCount(this)));
 	}
 	else
 	{
-		//if (TRACE_CCSERVER_RW) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " Connection::QueueRead m_pread " << (uintptr_t)m_pread << " m_nred " << m_nred << " m_maxread " << m_maxread << " ReadAsync transfer_exactly " << minbytes;
+		//CCLOG(g_log_ccserver_rw, trace) << Name() << " Conn-" << m_conn_index << " Connection::QueueRead m_pread " << (uintptr_t)m_pread << " m_nred " << m_nred << " m_maxread " << m_maxread << " ReadAsync transfer_exactly " << minbytes;
 
 		ReadAsync("Connection::QueueRead", boost::asio::buffer(m_pread + m_nred, m_maxread - m_nred), boost::asio::transfer_exactly(minbytes),
 			boost::bind(&Connection::HandleReadCheck, this, boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred, AutoCount(this)));
@@ -348,7 +390,7 @@ void Connection::HandleReadCheck(const boost::system::error_code& e, size_t byte
 		return Stop();
 	}
 
-	if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " Connection::HandleReadCheck " << bytes_transferred << " of " << m_nred << " of " << m_maxread << " bytes";
+	CCLOG(g_log_ccserver, trace) << Name() << " Conn-" << m_conn_index << " Connection::HandleReadCheck " << bytes_transferred << " of " << m_nred << " of " << m_maxread << " bytes";
 
 	HandleRead(bytes_transferred);
 }
@@ -402,11 +444,11 @@ void Connection::HandleWrite(const boost::system::error_code& e, AutoCount pendi
 		return Stop();
 	}
 
-	if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " Connection::HandleWrite ok";
+	CCLOG(g_log_ccserver, trace) << Name() << " Conn-" << m_conn_index << " Connection::HandleWrite ok";
 
 	if (!m_noclose)
 	{
-		if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " Connection::HandleWrite closing connection";
+		CCLOG(g_log_ccserver, trace) << Name() << " Conn-" << m_conn_index << " Connection::HandleWrite closing connection";
 
 		{
 			lock_guard<FastSpinLock> lock(m_conn_lock);
@@ -435,7 +477,7 @@ void Connection::HandleValidateDone(unsigned callback_id, int64_t result)
 
 	if (result > PROCESS_RESULT_STOP_THRESHOLD)
 	{
-		if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " Connection::HandleValidateDone result " << result;
+		CCLOG(g_log_ccserver, trace) << Name() << " Conn-" << m_conn_index << " Connection::HandleValidateDone result " << result;
 
 		if ((TEST_RANDOM_VALIDATION_FAILURES & rand()) == 1)
 		{
@@ -446,7 +488,7 @@ void Connection::HandleValidateDone(unsigned callback_id, int64_t result)
 	}
 	else
 	{
-		if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " Connection::HandleValidateDone result " << result << " stopping connection";
+		CCLOG(g_log_ccserver, trace) << Name() << " Conn-" << m_conn_index << " Connection::HandleValidateDone result " << result << " stopping connection";
 
 		StopWithConnLock();
 	}
@@ -454,7 +496,7 @@ void Connection::HandleValidateDone(unsigned callback_id, int64_t result)
 
 void Connection::CancelTimer()
 {
-	if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " Connection::CancelTimer " << uintptr_t(this);
+	CCLOG(g_log_ccserver, trace) << Name() << " Conn-" << m_conn_index << " Connection::CancelTimer " << uintptr_t(this);
 
 	lock_guard<FastSpinLock> lock(m_conn_lock);
 
@@ -499,7 +541,7 @@ void Connection::DecRef()
 
 	if (ops == 1 && m_stopping.load())
 	{
-		if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " Connection::DecRef posting stop";
+		CCLOG(g_log_ccserver, trace) << Name() << " Conn-" << m_conn_index << " Connection::DecRef posting stop";
 
 		m_socket.get_io_service().post(boost::bind(&Connection::HandleStop, this));
 	}
@@ -520,7 +562,7 @@ void Connection::StopWithConnLock()
 
 	if (!already_stopping)
 	{
-		if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " Connection::Stop canceling async ops";
+		CCLOG(g_log_ccserver, trace) << Name() << " Conn-" << m_conn_index << " Connection::Stop canceling async ops";
 
 		boost::system::error_code e;
 		m_timer.cancel(e);
@@ -531,11 +573,11 @@ void Connection::StopWithConnLock()
 
 	if (pending_ops)
 	{
-		if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " Connection::Stop postponing stop for " << pending_ops << " pending ops";
+		CCLOG(g_log_ccserver, trace) << Name() << " Conn-" << m_conn_index << " Connection::Stop postponing stop for " << pending_ops << " pending ops";
 	}
 	else
 	{
-		if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " Connection::Stop posting stop";
+		CCLOG(g_log_ccserver, trace) << Name() << " Conn-" << m_conn_index << " Connection::Stop posting stop";
 
 		m_socket.get_io_service().post(boost::bind(&Connection::HandleStop, this));
 	}
@@ -543,7 +585,7 @@ void Connection::StopWithConnLock()
 
 void Connection::HandleStop()
 {
-	if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " Connection::HandleStop closing connection";
+	CCLOG(g_log_ccserver, trace) << Name() << " Conn-" << m_conn_index << " Connection::HandleStop closing connection";
 
 	CCASSERT(m_stopping.load());
 
@@ -565,7 +607,7 @@ void Connection::HandleStop()
 	m_use_count.fetch_add(1);		// ignore anymore callbacks with former m_use_count value
 
 	if (m_noclose) BOOST_LOG_TRIVIAL(debug) << Name() << " Conn-" << m_conn_index << " Connection::Stop done";
-	if (TRACE_CCSERVER && !m_noclose) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " Connection::Stop done";
+	if (!m_noclose) CCLOG(g_log_ccserver, trace) << Name() << " Conn-" << m_conn_index << " Connection::Stop done";
 
 	FinishConnection();
 
@@ -578,7 +620,7 @@ void Connection::HandleStop()
 
 void Connection::WaitForStop()
 {
-	if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " Connection::WaitForStop";
+	CCLOG(g_log_ccserver, trace) << Name() << " Conn-" << m_conn_index << " Connection::WaitForStop";
 
 	CCASSERT(m_stopping.load());
 
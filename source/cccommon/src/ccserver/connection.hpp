@@ -15,9 +15,7 @@
 #include <AutoCount.hpp>
 #include <SmartBuf.hpp>
 #include <SpinLock.hpp>
-
-#define TRACE_CCSERVER		1
-#define TRACE_CCSERVER_RW	1
+#include <CClog.hpp>
 
 //#define TEST_RANDOM_READ_ERRORS		127
 //#define TEST_RANDOM_WRITE_ERRORS	127
@@ -60,6 +58,17 @@ public:
 	/// Prepare to start the first asynchronous operation for any connection
 	virtual void StartConnection();
 
+	/// Start a pre-warmed outgoing connection when it is claimed
+	void StartWarmConnection();
+
+	/// Pre-warmed outgoing connections
+	enum WarmState
+	{
+		WARM_NONE,
+		WARM_CONNECTING,		// connecting for the warm pool
+		WARM_PARKED				// connected through the Tor proxy and waiting to be claimed
+	};
+
 	/// Make outgoing connection
 	void ConnectOutgoing(const string& host, unsigned port);
 	void ConnectOutgoingTor(const string& host, unsigned proxy_port);
@@ -121,12 +130,12 @@ public:
 	{
 		if (g_shutdown || m_stopping.load())
 		{
-			if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " " << function << " skipping ReadAsync because connection is closing";
+			CCLOG(g_log_ccserver, trace) << Name() << " Conn-" << m_conn_index << " " << function << " skipping ReadAsync because connection is closing";
 
 			return true;
 		}
 
-		if (TRACE_CCSERVER_RW) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " " << function << " starting ReadAsync buffer " << (uintptr_t)boost::asio::buffer_cast<const void*>(buffer) << " size " << boost::asio::buffer_size(buffer);
+		CCLOG(g_log_ccserver_rw, trace) << Name() << " Conn-" << m_conn_index << " " << function << " starting ReadAsync buffer " << (uintptr_t)boost::asio::buffer_cast<const void*>(buffer) << " size " << boost::asio::buffer_size(buffer);
 
 		//memset((void*)boost::asio::buffer_cast<const void*>(buffer), 0xA5, boost::asio::buffer_size(buffer));	// for testing
 
@@ -157,7 +166,7 @@ public:
 
 		if (g_shutdown || m_stopping.load())
 		{
-			if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " " << function << " skipping WriteAsync because connection is closing";
+			CCLOG(g_log_ccserver, trace) << Name() << " Conn-" << m_conn_index << " " << function << " skipping WriteAsync because connection is closing";
 
 			return true;
 		}
@@ -173,7 +182,7 @@ public:
 
 		// !!! add a fuzz test, but only if the buffer is writable
 
-		if (TRACE_CCSERVER_RW) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " " << function << " starting WriteAsync buffer " << (uintptr_t)boost::asio::buffer_cast<const void*>(buffer) << " size " << boost::asio::buffer_size(buffer);
+		CCLOG(g_log_ccserver_rw, trace) << Name() << " Conn-" << m_conn_index << " " << function << " starting WriteAsync buffer " << (uintptr_t)boost::asio::buffer_cast<const void*>(buffer) << " size " << boost::asio::buffer_size(buffer);
 
 		boost::asio::async_write(m_socket, buffer, handler);
 
@@ -185,7 +194,7 @@ public:
 	{
 		if (op_counter.AcquireRef(this))
 		{
-			if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " " << function << " skipping SetTimer because connection is closing";
+			CCLOG(g_log_ccserver, trace) << Name() << " Conn-" << m_conn_index << " " << function << " skipping SetTimer because connection is closing";
 
 			return true;
 		}
@@ -201,7 +210,7 @@ public:
 			return true;
 		}
 
-		if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " " << function << " starting async wait for " << ms << " ms";
+		CCLOG(g_log_ccserver, trace) << Name() << " Conn-" << m_conn_index << " " << function << " starting async wait for " << ms << " ms";
 
 		m_timer.async_wait(handler);
 
@@ -224,6 +233,9 @@ protected:
 	/// Flags if the connection is in the free list
 	bool m_is_free;
 
+	/// Index of the io_service this connection is pinned to
+	unsigned m_io_context;
+
 	/// Counter increments each time the connection is used
 	atomic<unsigned> m_use_count;
 
@@ -235,6 +247,19 @@ protected:
 	boost::asio::ip::tcp::socket m_socket;
 	bool m_incoming;					// flags incoming connection
 
+	/// Outgoing Tor connections: destination host, and time taken to connect through the proxy (-1 until connected)
+	string m_tor_host;
+	uint32_t m_connect_ticks;
+	int m_connect_ms;
+
+	/// Pre-warmed outgoing connections: WarmState and time parked, guarded by the ConnectionManager's lock
+	unsigned m_warm_state;
+	uint32_t m_warm_ticks;
+
+	/// Outgoing connections: time the connection was asked for, or claimed from the warm pool, for time-to-first-byte
+	uint32_t m_request_ticks;
+	bool m_from_warm_pool;
+
 	/// Local data buffers
 	vector<uint8_t> m_readbuf;
 	vector<uint8_t> m_writebuf;
@@ -250,6 +275,7 @@ protected:
 
 	// lock for m_socket and m_timer -- boost docs say socket is not thread safe (at minimum, close must be serialized)
 	FastSpinLock m_conn_lock;
+	static CCLockSite s_conn_lock_site;
 
 	atomic<int> m_stopping;				// don't queue more reads or writes if connection stopping
 	atomic<int> m_ops_pending;			// don't stop until all pending aync ops are done
@@ -10,6 +10,8 @@
 #include "connection_manager.hpp"
 #include "server.hpp"
 
+#include <CCticks.hpp>
+
 #include <algorithm>
 #include <iostream>
 #ifdef _WIN32
@@ -22,26 +24,40 @@ using namespace std;
 
 namespace CCServer {
 
+CCLockSite ConnectionManager::s_lock_site("connection-manager");
+
 ConnectionManager::~ConnectionManager()
 {
 	for (auto connection : m_connections)
 		delete connection;
 }
 
-void ConnectionManager::Init(unsigned maxconns, unsigned maxincoming, const class ConnectionFactory &connfac)
+void ConnectionManager::Init(unsigned maxconns, unsigned maxincoming, const class ConnectionFactory &connfac, const vector<boost::asio::io_service*>& io_services, bool least_loaded)
 {
 	CCASSERT(m_connections.empty());
 	CCASSERT(m_free_connections.empty());
+	CCASSERT(io_services.size());
+
+	unsigned ncontexts = io_services.size();
 
 	m_connections.reserve(maxconns);
-	m_free_connections.reserve(maxconns);
+	m_free_connections.resize(ncontexts);
+	m_inuse_count.resize(ncontexts);
+
+	for (auto& free_list : m_free_connections)
+		free_list.reserve((maxconns + ncontexts - 1) / ncontexts);
 
+	m_least_loaded = least_loaded;
 	m_maxincoming = maxincoming;
 
 	for (unsigned i = 0; i < maxconns; ++i)
 	{
-		pconnection_t connection = connfac.NewConnection(*this, m_io_service);
+		unsigned context = i % ncontexts;
+
+		pconnection_t connection = connfac.NewConnection(*this, *io_services[context]);
+		connection->m_io_context = context;
 		m_connections.push_back(connection);
+		++m_inuse_count[context];
 		FreeConnection(connection);
 	}
 }
@@ -51,7 +67,7 @@ void ConnectionManager::FreeConnection(pconnection_t connection)
 	if (g_shutdown)
 		return;
 
-	if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << connection->m_conn_index << " ConnectionManager::FreeConnection";
+	CCLOG(g_log_ccserver, trace) << Name() << " Conn-" << connection->m_conn_index << " ConnectionManager::FreeConnection context " << connection->m_io_context;
 
 	bool was_freed = false;
 
@@ -63,10 +79,14 @@ void ConnectionManager::FreeConnection(pconnection_t connection)
 			connection->m_is_free = true;
 			was_freed = true;
 
-			m_free_connections.push_back(connection);
+			m_free_connections[connection->m_io_context].push_back(connection);
+			--m_inuse_count[connection->m_io_context];
+			++m_nfree;
 
 			if (connection->m_incoming)
 				--m_incoming_count;
+
+			RemoveWarm(connection);
 		}
 	}
 
@@ -79,6 +99,48 @@ void ConnectionManager::SetFreeConnectionHandler(Server *p)
 	m_free_callback_obj = p;
 }
 
+// must be called with m_lock held
+
+int ConnectionManager::PickContext()
+{
+	unsigned ncontexts = m_free_connections.size();
+
+	if (!m_nfree)
+		return -1;
+
+	if (ncontexts == 1)
+		return 0;
+
+	if (m_least_loaded)
+	{
+		int best = -1;
+
+		for (unsigned i = 0; i < ncontexts; ++i)
+		{
+			unsigned context = (m_next_context + i) % ncontexts;	// start the search at a different context each time to break ties
+
+			if (m_free_connections[context].size() && (best < 0 || m_inuse_count[context] < m_inuse_count[best]))
+				best = context;
+		}
+
+		m_next_context = (m_next_context + 1) % ncontexts;
+
+		return best;
+	}
+
+	for (unsigned i = 0; i < ncontexts; ++i)
+	{
+		unsigned context = m_next_context;
+
+		m_next_context = (m_next_context + 1) % ncontexts;
+
+		if (m_free_connections[context].size())
+			return context;
+	}
+
+	return -1;
+}
+
 pconnection_t ConnectionManager::GetFreeConnection(bool incoming)
 {
 	pconnection_t connection;
@@ -86,19 +148,29 @@ pconnection_t ConnectionManager::GetFreeConnection(bool incoming)
 	{
 		lock_guard<FastSpinLock> lock(m_lock);
 
-		if (!m_free_connections.size())
+		if (!m_nfree)
 			return NULL;
 
 		if (incoming)
 		{
 			if (m_incoming_count >= m_maxincoming)
 				return NULL;
+		}
 
+		auto context = PickContext();
+		if (context < 0)
+			return NULL;
+
+		if (incoming)
 			++m_incoming_count;
-		}
 
-		connection = m_free_connections.back();
-		m_free_connections.pop_back();
+		auto& free_list = m_free_connections[context];
+
+		connection = free_list.back();
+		free_list.pop_back();
+
+		++m_inuse_count[context];
+		--m_nfree;
 
 		connection->m_is_free = false;
 	}
@@ -112,9 +184,139 @@ unsigned ConnectionManager::GetOutgoingConnectionCount()
 {
 	lock_guard<FastSpinLock> lock(m_lock);
 
-	//cerr << Name() << " m_connections.size() " << m_connections.size() << " m_free_connections.size() " << m_free_connections.size() << " m_incoming_count " << m_incoming_count << endl;
+	//cerr << Name() << " m_connections.size() " << m_connections.size() << " m_nfree " << m_nfree << " m_incoming_count " << m_incoming_count << endl;
+
+	return m_connections.size() - m_nfree - m_incoming_count - m_warming_count - m_warm_connections.size();
+}
+
+// must be called with m_lock held
+
+void ConnectionManager::RemoveWarm(pconnection_t connection)
+{
+	if (connection->m_warm_state == Connection::WARM_CONNECTING)
+		--m_warming_count;
+	else if (connection->m_warm_state == Connection::WARM_PARKED)
+	{
+		auto it = find(m_warm_connections.begin(), m_warm_connections.end(), connection);
+		CCASSERT(it != m_warm_connections.end());
+		m_warm_connections.erase(it);
+	}
+
+	connection->m_warm_state = Connection::WARM_NONE;
+}
+
+void ConnectionManager::SetWarming(pconnection_t connection)
+{
+	lock_guard<FastSpinLock> lock(m_lock);
+
+	CCASSERT(connection->m_warm_state == Connection::WARM_NONE);
+
+	connection->m_warm_state = Connection::WARM_CONNECTING;
+	++m_warming_count;
+}
+
+bool ConnectionManager::ParkWarmConnection(pconnection_t connection)
+{
+	lock_guard<FastSpinLock> lock(m_lock);
+
+	if (connection->m_warm_state != Connection::WARM_CONNECTING)
+		return false;
+
+	CCLOG(g_log_ccserver, trace) << Name() << " Conn-" << connection->m_conn_index << " ConnectionManager::ParkWarmConnection";
+
+	--m_warming_count;
+
+	connection->m_warm_state = Connection::WARM_PARKED;
+	connection->m_warm_ticks = ccticks();
+
+	m_warm_connections.push_back(connection);
+
+	return true;
+}
+
+// returns the most recently parked connection, or NULL if there isn't one younger than max_age_ms
+// the connection is then counted as an ordinary outgoing connection, and the caller must start it
+
+pconnection_t ConnectionManager::ClaimWarmConnection(uint32_t max_age_ms)
+{
+	lock_guard<FastSpinLock> lock(m_lock);
+
+	if (m_warm_connections.empty())
+		return NULL;
+
+	auto connection = m_warm_connections.back();
+
+	if ((uint32_t)ccticks_elapsed(connection->m_warm_ticks, ccticks()) > max_age_ms)
+		return NULL;
+
+	m_warm_connections.pop_back();
+
+	connection->m_warm_state = Connection::WARM_NONE;
+
+	return connection;
+}
+
+// stops the parked connections older than max_age_ms, which the peer may have closed; returns the number stopped
+
+unsigned ConnectionManager::ExpireWarmConnections(uint32_t max_age_ms)
+{
+	vector<Connection *> expired;
+
+	{
+		lock_guard<FastSpinLock> lock(m_lock);
+
+		auto now = ccticks();
+
+		while (m_warm_connections.size() && (uint32_t)ccticks_elapsed(m_warm_connections.front()->m_warm_ticks, now) >= max_age_ms)
+		{
+			auto connection = m_warm_connections.front();
+			m_warm_connections.erase(m_warm_connections.begin());
+
+			connection->m_warm_state = Connection::WARM_NONE;
+
+			expired.push_back(connection);
+		}
+	}
+
+	for (auto connection : expired)
+	{
+		CCLOG(g_log_ccserver, trace) << Name() << " Conn-" << connection->m_conn_index << " ConnectionManager::ExpireWarmConnections stopping";
+
+		connection->Stop();
+	}
+
+	return expired.size();
+}
+
+unsigned ConnectionManager::GetWarmConnectionCount()
+{
+	lock_guard<FastSpinLock> lock(m_lock);
+
+	return m_warming_count + m_warm_connections.size();
+}
+
+unsigned ConnectionManager::GetIncomingConnectionCount()
+{
+	lock_guard<FastSpinLock> lock(m_lock);
+
+	return m_incoming_count;
+}
+
+void ConnectionManager::DumpContextLoad()
+{
+	if (m_inuse_count.size() < 2)
+		return;
+
+	ostringstream out;
+
+	{
+		lock_guard<FastSpinLock> lock(m_lock);
+
+		for (unsigned i = 0; i < m_inuse_count.size(); ++i)
+			out << " " << m_inuse_count[i];
+	}
 
-	return m_connections.size() - m_free_connections.size() - m_incoming_count;
+	BOOST_LOG_TRIVIAL(info) << Name() << " connections in use by io context:" << out.str();
 }
 
 void ConnectionManager::StopAllConnections()
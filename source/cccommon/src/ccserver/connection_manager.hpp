@@ -34,17 +34,23 @@ public:
 		return m_name;
 	}
 
-	ConnectionManager(const string& name, boost::asio::io_service& io_service)
+	explicit ConnectionManager(const string& name)
 	 :	m_name(name),
-	 	m_io_service(io_service),
 		m_free_callback_obj(NULL),
+		m_least_loaded(false),
+		m_next_context(0),
+		m_nfree(0),
 		m_maxincoming(0),
-		m_incoming_count(0)
+		m_incoming_count(0),
+		m_warming_count(0),
+		m_lock(s_lock_site)
 	{ }
 
 	~ConnectionManager();
 
-	void Init(unsigned maxconns, unsigned maxincoming, const class ConnectionFactory &connfac);
+	/// Create the connection pool, assigning the connections to the io_services round-robin
+	/// Each connection stays pinned to its io_service for its lifetime
+	void Init(unsigned maxconns, unsigned maxincoming, const class ConnectionFactory &connfac, const vector<boost::asio::io_service*>& io_services, bool least_loaded);
 
 	/// Register Server object to receive notification when a Connection becomes free
 	void SetFreeConnectionHandler(Server *p);
@@ -53,15 +59,31 @@ public:
 
 	unsigned GetOutgoingConnectionCount();
 
+	unsigned GetIncomingConnectionCount();
+
 	/// Return Connection to free pool
 	void FreeConnection(pconnection_t connection);
 
+	/// Pre-warmed outgoing connections: a connection marked as warming is parked when its Tor proxy handshake completes,
+	/// and then waits until it is claimed or expired; warming and parked connections aren't counted by GetOutgoingConnectionCount
+	void SetWarming(pconnection_t connection);
+	bool ParkWarmConnection(pconnection_t connection);
+	pconnection_t ClaimWarmConnection(uint32_t max_age_ms);
+	unsigned ExpireWarmConnections(uint32_t max_age_ms);
+	unsigned GetWarmConnectionCount();
+
 	/// Stop all connections
 	void StopAllConnections();
 
+	/// Log the number of connections in use on each io_service
+	void DumpContextLoad();
+
 protected:
-	/// The io_service used to perform asynchronous operations.
-	boost::asio::io_service& m_io_service;
+	/// Pick the io_service for the next connection; returns -1 if no connection is free
+	int PickContext();
+
+	/// Take a connection out of the warm pool counts
+	void RemoveWarm(pconnection_t connection);
 
 	// Server object to notify on free connection
 	Server *m_free_callback_obj;
@@ -69,12 +91,25 @@ protected:
 	/// The managed connections.
 	vector<Connection *> m_connections;
 
-	/// Free connections
-	vector<Connection *> m_free_connections;
+	/// Free connections, by io_service
+	vector<vector<Connection *>> m_free_connections;
+
+	/// Connections in use, by io_service
+	vector<unsigned> m_inuse_count;
+
+	bool m_least_loaded;
+	unsigned m_next_context;
+	unsigned m_nfree;
 
 	unsigned m_maxincoming;
 	unsigned m_incoming_count;
+
+	/// Parked pre-warmed connections, oldest first
+	vector<Connection *> m_warm_connections;
+	unsigned m_warming_count;
+
 	FastSpinLock m_lock;
+	static CCLockSite s_lock_site;
 };
 
 void set_int_opt(int sockfd, int level, int optname, int opt);
@@ -13,6 +13,8 @@
 
 using namespace std;
 
+CCLockSite CCServer::ConnectionRegistry::s_lock_site("connection-registry");
+
 CCServer::ConnectionRegistry g_connregistry;
 
 namespace CCServer {
@@ -28,7 +30,7 @@ unsigned ConnectionRegistry::RegisterConn(Connection *conn)
 		m_connections.push_back(conn);
 	}
 
-	if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(trace) << "ConnectionRegistry::RegisterConn index " << index << " conn " << (uintptr_t)conn;
+	CCLOG(g_log_ccserver, trace) << "ConnectionRegistry::RegisterConn index " << index << " conn " << (uintptr_t)conn;
 
 	return index;
 }
@@ -25,6 +25,7 @@ class ConnectionRegistry
 
 public:
 	ConnectionRegistry()
+	 :	m_lock(s_lock_site)
 	{
 		m_connections.push_back(NULL);	// leave entry zero NULL to guard against bugs
 	}
@@ -37,6 +38,7 @@ protected:
 	vector<Connection *> m_connections;
 
 	FastSpinLock m_lock;
+	static CCLockSite s_lock_site;
 };
 
 } // namespace CCServer
@@ -9,6 +9,8 @@
 #include "CCdef.h"
 #include "server.hpp"
 
+#include <CCticks.hpp>
+
 #include <iostream>
 #include <boost/bind.hpp>
 #include <signal.h>
@@ -17,9 +19,33 @@ using namespace std;
 
 namespace CCServer {
 
-void Server::Init(const boost::asio::ip::tcp::endpoint& endpoint, unsigned maxconns, unsigned maxincoming, unsigned backlog, const class ConnectionFactory &connfac)
+CCLockSite Server::s_new_connection_lock_site("server-accept");
+
+Server::Server(const string& name, unsigned ncontexts)
+ :	m_name(name),
+	m_io_service(),
+	m_signals(m_io_service),
+	m_acceptor(m_io_service),
+	m_connection_manager(name),
+	m_new_connection(),
+	m_new_connection_lock(s_new_connection_lock_site)
 {
-	if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(trace) << Name() << " Server::Init maxconns " << maxconns << " maxincoming " << maxincoming << " port " << endpoint.port() << " backlog " << backlog;
+	if (ncontexts < 1)
+		ncontexts = 1;
+
+	m_io_services.push_back(&m_io_service);
+
+	for (unsigned i = 1; i < ncontexts; ++i)
+	{
+		m_extra_io_services.push_back(unique_ptr<boost::asio::io_service>(new boost::asio::io_service));
+		m_io_work.push_back(unique_ptr<boost::asio::io_service::work>(new boost::asio::io_service::work(*m_extra_io_services.back())));
+		m_io_services.push_back(m_extra_io_services.back().get());
+	}
+}
+
+void Server::Init(const boost::asio::ip::tcp::endpoint& endpoint, unsigned maxconns, unsigned maxincoming, unsigned backlog, const class ConnectionFactory &connfac, bool least_loaded)
+{
+	CCLOG(g_log_ccserver, trace) << Name() << " Server::Init maxconns " << maxconns << " maxincoming " << maxincoming << " port " << endpoint.port() << " backlog " << backlog << " io contexts " << m_io_services.size() << " least loaded " << least_loaded;
 
 	// Register to handle the signals that indicate when the CCServer should exit.
 	// It is safe to register for the same signal multiple times in a program,
@@ -31,7 +57,7 @@ void Server::Init(const boost::asio::ip::tcp::endpoint& endpoint, unsigned maxco
 	#endif
 	m_signals.async_wait(boost::bind(&Server::HandleStop, this));
 
-	m_connection_manager.Init(maxconns, maxincoming, connfac);
+	m_connection_manager.Init(maxconns, maxincoming, connfac, m_io_services, least_loaded);
 	m_connection_manager.SetFreeConnectionHandler(this);
 
 	if (!endpoint.port() || !maxincoming)
@@ -76,16 +102,18 @@ void Server::Init(const boost::asio::ip::tcp::endpoint& endpoint, unsigned maxco
 	StartAccept();
 }
 
-void Server::Run()
+void Server::Run(unsigned context)
 {
-	if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(trace) << Name() << " Server::Run";
+	CCLOG(g_log_ccserver, trace) << Name() << " Server::Run context " << context;
+
+	CCASSERT(context < m_io_services.size());
 
 	// The io_service::run() call will block until all asynchronous operations
 	// have finished. While the server is running, there is always at least one
 	// asynchronous operation outstanding: the asynchronous accept call waiting
-	// for new incoming connections.
+	// for new incoming connections on the first io_service, and a work object on the others.
 
-	m_io_service.run();
+	m_io_services[context]->run();
 }
 
 void Server::StartAccept(bool m_new_connection_has_been_used)
@@ -99,18 +127,18 @@ void Server::StartAccept(bool m_new_connection_has_been_used)
 		return;
 	}
 
-	if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(trace) << Name() << " Server::StartAccept last new connection " << m_new_connection << ", used = " << m_new_connection_has_been_used;
+	CCLOG(g_log_ccserver, trace) << Name() << " Server::StartAccept last new connection " << m_new_connection << ", used = " << m_new_connection_has_been_used;
 
 	if (m_new_connection && !m_new_connection_has_been_used)
 	{
-		if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(trace) << Name() << " Server::StartAccept already accepting";
+		CCLOG(g_log_ccserver, trace) << Name() << " Server::StartAccept already accepting";
 
 		return;
 	}
 
 	if (!m_new_connection || m_new_connection_has_been_used)
 	{
-		if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(trace) << Name() << " Server::StartAccept fetching new connection";
+		CCLOG(g_log_ccserver, trace) << Name() << " Server::StartAccept fetching new connection";
 
 		m_new_connection = m_connection_manager.GetFreeConnection(true);
 	}
@@ -131,12 +159,12 @@ void Server::StartAccept(bool m_new_connection_has_been_used)
 
 	m_acceptor.async_accept(m_new_connection->m_socket, boost::bind(&Server::HandleAccept, this, boost::asio::placeholders::error));
 
-	if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_new_connection->m_conn_index << " Server::StartAccept now accepting";
+	CCLOG(g_log_ccserver, trace) << Name() << " Conn-" << m_new_connection->m_conn_index << " Server::StartAccept now accepting";
 }
 
 void Server::HandleAccept(const boost::system::error_code& e)
 {
-	if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(trace) << Name() << " Server::HandleAccept";
+	CCLOG(g_log_ccserver, trace) << Name() << " Server::HandleAccept";
 
 	{
 		lock_guard<FastSpinLock> lock(m_new_connection_lock);
@@ -159,7 +187,7 @@ void Server::HandleAccept(const boost::system::error_code& e)
 	}
 	else
 	{
-		if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_new_connection->m_conn_index << " Server::HandleAccept starting connection";
+		CCLOG(g_log_ccserver, trace) << Name() << " Conn-" << m_new_connection->m_conn_index << " Server::HandleAccept starting connection";
 
 		m_new_connection->Post(boost::bind(&Connection::StartIncomingConnection, m_new_connection));
 
@@ -169,7 +197,7 @@ void Server::HandleAccept(const boost::system::error_code& e)
 
 void Server::HandleFreeConnection()
 {
-	if (TRACE_CCSERVER) BOOST_LOG_TRIVIAL(trace) << Name() << " Server::HandleFreeConnection";
+	CCLOG(g_log_ccserver, trace) << Name() << " Server::HandleFreeConnection";
 
 	StartAccept();
 }
@@ -192,7 +220,7 @@ pconnection_t Server::Connect(const string& host, unsigned port)
 	return connection;
 }
 
-pconnection_t Server::ConnectThruTor(const string& host, unsigned proxy_port)
+pconnection_t Server::ConnectThruTor(const string& host, unsigned proxy_port, bool prewarm)
 {
 	auto connection = m_connection_manager.GetFreeConnection(false);
 
@@ -203,13 +231,33 @@ pconnection_t Server::ConnectThruTor(const string& host, unsigned proxy_port)
 		return NULL;
 	}
 
-	BOOST_LOG_TRIVIAL(info) << Name() << " Conn-" << connection->m_conn_index << " Server::ConnectThruTor " << host;
+	BOOST_LOG_TRIVIAL(info) << Name() << " Conn-" << connection->m_conn_index << " Server::ConnectThruTor " << host << (prewarm ? " prewarm" : "");
+
+	if (prewarm)
+		m_connection_manager.SetWarming(connection);
 
 	connection->Post(boost::bind(&Connection::ConnectOutgoingTor, connection, host, proxy_port));
 
 	return connection;
 }
 
+pconnection_t Server::ClaimWarmConnection(uint32_t max_age_ms)
+{
+	auto connection = m_connection_manager.ClaimWarmConnection(max_age_ms);
+
+	if (!connection)
+		return NULL;
+
+	BOOST_LOG_TRIVIAL(info) << Name() << " Conn-" << connection->m_conn_index << " Server::ClaimWarmConnection " << connection->m_tor_host;
+
+	connection->m_request_ticks = ccticks();
+	connection->m_from_warm_pool = true;
+
+	connection->Post(boost::bind(&Connection::StartWarmConnection, connection));
+
+	return connection;
+}
+
 void Server::HandleStop()
 {
 	BOOST_LOG_TRIVIAL(info) << Name() << " Server::HandleStop shutting down...";
@@ -225,7 +273,13 @@ void Server::HandleStop()
 		m_acceptor.close();
 	}
 
+	m_connection_manager.DumpContextLoad();
+
 	m_connection_manager.StopAllConnections();
+
+	// let the additional io_services exit once their connections have stopped
+
+	m_io_work.clear();
 }
 
 } // namespace CCServer
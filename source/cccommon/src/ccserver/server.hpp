@@ -14,6 +14,8 @@
 #include <boost/noncopyable.hpp>
 
 #include <string>
+#include <vector>
+#include <memory>
 #include "../ccserver/connection.hpp"
 #include "../ccserver/connection_manager.hpp"
 
@@ -34,29 +36,31 @@ public:
 	}
 
 	/// Construct the Server
-	explicit Server(const string& name)
-	 :	m_name(name),
-		m_io_service(),
-		m_signals(m_io_service),
-		m_acceptor(m_io_service),
-		m_connection_manager(name, m_io_service),
-		m_new_connection()
-	{ }
+	/// The server runs ncontexts io_services; the acceptor and signal handler use the first one
+	Server(const string& name, unsigned ncontexts = 1);
 
 	// Setup server
-	void Init(const boost::asio::ip::tcp::endpoint& endpoint, unsigned maxconns, unsigned maxincoming, unsigned backlog, const class ConnectionFactory &connfac);
+	void Init(const boost::asio::ip::tcp::endpoint& endpoint, unsigned maxconns, unsigned maxincoming, unsigned backlog, const class ConnectionFactory &connfac, bool least_loaded = false);
 
 	ConnectionManager& GetConnectionManager()
 	{
 		return m_connection_manager;
 	}
 
-	/// Run the server's io_service loop.
-	void Run();
+	unsigned GetNContexts() const
+	{
+		return m_io_services.size();
+	}
+
+	/// Run one of the server's io_service loops.
+	void Run(unsigned context = 0);
 
 	/// Make outgoing connection
 	pconnection_t Connect(const string& host, unsigned port);
-	pconnection_t ConnectThruTor(const string& host, unsigned proxy_port);
+	pconnection_t ConnectThruTor(const string& host, unsigned proxy_port, bool prewarm = false);
+
+	/// Start a pre-warmed outgoing connection; returns NULL if none is available
+	pconnection_t ClaimWarmConnection(uint32_t max_age_ms);
 
 	/// Respond when a Connection becomes free
 	void HandleFreeConnection();
@@ -74,6 +78,15 @@ private:
 	/// The io_service used to perform asynchronous operations.
 	boost::asio::io_service m_io_service;
 
+	/// Additional io_services; these are declared before m_connection_manager so they outlive its connections
+	vector<unique_ptr<boost::asio::io_service>> m_extra_io_services;
+
+	/// Keeps the additional io_services running while they have no pending operations
+	vector<unique_ptr<boost::asio::io_service::work>> m_io_work;
+
+	/// All io_services, starting with m_io_service
+	vector<boost::asio::io_service*> m_io_services;
+
 	/// The signal_set is used to register for process termination notifications.
 	boost::asio::signal_set m_signals;
 
@@ -86,6 +99,7 @@ private:
 	/// The next Connection to be accepted.
 	pconnection_t m_new_connection;
 	FastSpinLock m_new_connection_lock;
+	static CCLockSite s_new_connection_lock_site;
 };
 
 } // namespace CCServer
@@ -17,6 +17,8 @@
 
 using namespace std;
 
+#define MIN_THREADS_PER_CONTEXT	4
+
 CCThreadFactory CCDefaultThreadFac;
 
 namespace CCServer {
@@ -36,6 +38,8 @@ void Service::Start(const boost::asio::ip::tcp::endpoint& endpoint, unsigned nth
 	// the problem is the OS can send all connections to a single server, so it is only useful if all servers have multiple threads and connections
 	// so for now, we just use one server
 
+	// instead, a single server can run several io_services, with the connections distributed among them
+
 	const unsigned nservers = 1;
 
 	unsigned threads_per_server = (nthreads + nservers - 1)/nservers;
@@ -48,27 +52,67 @@ void Service::Start(const boost::asio::ip::tcp::endpoint& endpoint, unsigned nth
 	if (connections_per_server < 1)
 		connections_per_server = 1;
 
+	unsigned ncontexts = m_ncontexts;
+
+	if (!ncontexts)
+		ncontexts = thread::hardware_concurrency();
+
+	if (ncontexts > connections_per_server)
+		ncontexts = connections_per_server;
+
+	if (ncontexts < 1)
+		ncontexts = 1;
+
+	// each io_service needs its own threads, with enough on each one to stop its connections during shutdown
+
+	unsigned threads_per_context = (threads_per_server + ncontexts - 1)/ncontexts;
+
+	if (ncontexts > 1 && threads_per_context < MIN_THREADS_PER_CONTEXT)
+		threads_per_context = MIN_THREADS_PER_CONTEXT;
+
+	BOOST_LOG_TRIVIAL(info) << Name() << " Service::Init io contexts " << ncontexts << " threads per context " << threads_per_context << (ncontexts > 1 && m_least_loaded ? " least loaded" : "");
+
 	m_servers.reserve(nservers);
-	m_threads.reserve(threads_per_server * nservers);
+	m_threads.reserve(threads_per_context * ncontexts * nservers);
 
 	for (unsigned i = 0; i < nservers; ++i)
 	{
-		auto s = new Server(Name());
+		auto s = new Server(Name(), ncontexts);
 		m_servers.push_back(s);
 
-		s->Init(endpoint, connections_per_server, incoming_connections_per_server, backlog, connfac);
+		s->Init(endpoint, connections_per_server, incoming_connections_per_server, backlog, connfac, m_least_loaded);
+
+		m_nstarted.store(i + 1);
 
-		for (unsigned j = 0; j < threads_per_server && !g_shutdown; ++j)
+		for (unsigned j = 0; j < threads_per_context * ncontexts && !g_shutdown; ++j)
 		{
 			auto t = threadfac.NewThread();
-			t->Run(boost::bind(&Server::Run, s));
+			t->Run(boost::bind(&Server::Run, s, j % ncontexts));
 			m_threads.push_back(t);
 		}
 	}
 }
 
+void Service::GetConnectionCounts(unsigned& nincoming, unsigned& noutgoing)
+{
+	nincoming = 0;
+	noutgoing = 0;
+
+	auto nservers = m_nstarted.load();
+
+	for (unsigned i = 0; i < nservers; ++i)
+	{
+		auto& manager = m_servers[i]->GetConnectionManager();
+
+		nincoming += manager.GetIncomingConnectionCount();
+		noutgoing += manager.GetOutgoingConnectionCount();
+	}
+}
+
 void Service::WaitForShutdown()
 {
+	m_nstarted.store(0);
+
 	for (auto t : m_threads)
 	{
 		t->join();
@@ -10,6 +10,7 @@
 
 #include <CCthread.hpp>
 
+#include <atomic>
 #include <vector>
 #include <boost/asio.hpp>
 #include <boost/noncopyable.hpp>
@@ -31,9 +32,22 @@ public:
 	}
 
 	Service(const string& name)
-	 : m_name(name)
+	 :	m_name(name),
+		m_ncontexts(1),
+		m_least_loaded(false),
+		m_nstarted(0)
 	{ }
 
+	// Set the number of io_services the server runs (call before Start)
+	// ncontexts = 1 runs all connections on a single shared io_service
+	// ncontexts = 0 runs one io_service per hardware core
+	// Connections are pinned to one io_service; new connections are assigned round-robin, or to the io_service with the fewest connections in use if least_loaded is true
+	void SetIoContexts(unsigned ncontexts, bool least_loaded = false)
+	{
+		m_ncontexts = ncontexts;
+		m_least_loaded = least_loaded;
+	}
+
 	// Start service
 	void Start(const boost::asio::ip::tcp::endpoint& endpoint, unsigned nthreads, unsigned maxconns, unsigned maxincoming, unsigned backlog, const class ConnectionFactory &connfac, const class CCThreadFactory &threadfac = CCDefaultThreadFac);
 
@@ -47,12 +61,21 @@ public:
 		return *m_servers[i];
 	}
 
+	// Get the number of incoming and outgoing connections in use
+	// Safe to call from any thread while the service is starting or running
+	void GetConnectionCounts(unsigned& nincoming, unsigned& noutgoing);
+
 	// Wait for service to shutdown
 	void WaitForShutdown();
 
 protected:
+	unsigned m_ncontexts;
+	bool m_least_loaded;
+
 	vector<class Server *> m_servers;
 	vector<class CCThread *> m_threads;
+
+	atomic<unsigned> m_nstarted;	// number of m_servers that have been initialized
 };
 
 } // namespace CCServer
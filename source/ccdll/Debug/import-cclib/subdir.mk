@@ -12,6 +12,7 @@ C:/CredaCash/source/cclib/src/jsoncmd.cpp \
 C:/CredaCash/source/cclib/src/jsonutil.cpp \
 C:/CredaCash/source/cclib/src/payspec.cpp \
 C:/CredaCash/source/cclib/src/transaction.cpp \
+C:/CredaCash/source/cclib/src/txapi.cpp \
 C:/CredaCash/source/cclib/src/txquery.cpp \
 C:/CredaCash/source/cclib/src/zkkeys.cpp 
 
@@ -22,6 +23,7 @@ OBJS += \
 ./import-cclib/jsonutil.o \
 ./import-cclib/payspec.o \
 ./import-cclib/transaction.o \
+./import-cclib/txapi.o \
 ./import-cclib/txquery.o \
 ./import-cclib/zkkeys.o 
 
@@ -34,6 +36,7 @@ CPP_DEPS += \
 ./import-cclib/jsonutil.d \
 ./import-cclib/payspec.d \
 ./import-cclib/transaction.d \
+./import-cclib/txapi.d \
 ./import-cclib/txquery.d \
 ./import-cclib/zkkeys.d 
 
@@ -81,6 +84,13 @@ import-cclib/transaction.o: C:/CredaCash/source/cclib/src/transaction.cpp
 	@echo 'Finished building: $<'
 	@echo ' '
 
+import-cclib/txapi.o: C:/CredaCash/source/cclib/src/txapi.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: Cross G++ Compiler'
+	g++ -std=c++0x -D_DEBUG -DCC_DLL_EXPORTS=1 -IC:/CredaCash/source -IC:/CredaCash/source/ccdll/src -IC:/CredaCash/source/cclib/src -IC:/CredaCash/source/cccommon/src -IC:/CredaCash/depends -IC:/CredaCash/depends/gmp -IC:/CredaCash/depends/boost -O0 -g3 -fno-omit-frame-pointer -fno-optimize-sibling-calls -Wall -Wextra -c -fmessage-length=0 -Wno-unused-parameter -Wstrict-overflow=4 -Werror=sign-compare -isystem C:/CredaCash/depends/boost -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
 import-cclib/txquery.o: C:/CredaCash/source/cclib/src/txquery.cpp
 	@echo 'Building file: $<'
 	@echo 'Invoking: Cross G++ Compiler'
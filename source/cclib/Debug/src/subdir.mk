@@ -12,6 +12,7 @@ CPP_SRCS += \
 ../src/jsonutil.cpp \
 ../src/payspec.cpp \
 ../src/transaction.cpp \
+../src/txapi.cpp \
 ../src/txquery.cpp \
 ../src/zkkeys.cpp 
 
@@ -22,6 +23,7 @@ OBJS += \
 ./src/jsonutil.o \
 ./src/payspec.o \
 ./src/transaction.o \
+./src/txapi.o \
 ./src/txquery.o \
 ./src/zkkeys.o 
 
@@ -34,6 +36,7 @@ CPP_DEPS += \
 ./src/jsonutil.d \
 ./src/payspec.d \
 ./src/transaction.d \
+./src/txapi.d \
 ./src/txquery.d \
 ./src/zkkeys.d 
 
@@ -20,6 +20,10 @@
 #include <CCticks.hpp>
 #include <CCutil.h>
 
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
 //#define TEST_SKIP_ZKPROOFS		1	// for testing
 
 #ifdef CC_DLL_EXPORTS
@@ -55,6 +59,81 @@ void constrain_zero(const AST_Var<T>& x) {
 
 static ZKKeyStore keystore;
 
+// Each proof in progress holds its circuit and witness in memory, so CCProof_GenProof limits the number that run at once.
+// The proving keys are shared by all of the proofs, and kept resident by the keystore.
+
+static mutex s_prover_lock;
+static condition_variable s_prover_cv;
+static unsigned s_prover_active;
+static unsigned s_prover_max;			// 0 = one per core
+
+static CCProofGenStats s_gen_stats;		// protected by s_prover_lock
+
+class ProverSlot
+{
+public:
+	uint32_t wait_ms;
+
+	ProverSlot()
+	{
+		auto t0 = ccticks();
+
+		unique_lock<mutex> lock(s_prover_lock);
+
+		unsigned nmax = s_prover_max;
+		if (!nmax)
+			nmax = thread::hardware_concurrency();
+		if (!nmax)
+			nmax = 1;
+
+		while (s_prover_active >= nmax)
+			s_prover_cv.wait(lock);
+
+		++s_prover_active;
+
+		wait_ms = ccticks_elapsed(t0, ccticks());
+	}
+
+	~ProverSlot()
+	{
+		lock_guard<mutex> lock(s_prover_lock);
+
+		--s_prover_active;
+
+		s_prover_cv.notify_one();
+	}
+};
+
+CCPROOF_API CCProof_SetProverLimits(unsigned max_concurrent, uint64_t key_cache_bytes)
+{
+	{
+		lock_guard<mutex> lock(s_prover_lock);
+
+		s_prover_max = max_concurrent;
+
+		s_prover_cv.notify_all();
+	}
+
+	keystore.SetProofKeyBudget(key_cache_bytes);
+
+	return 0;
+}
+
+CCPROOF_API CCProof_GetGenStats(struct CCProofGenStats& stats)
+{
+	{
+		lock_guard<mutex> lock(s_prover_lock);
+
+		stats = s_gen_stats;
+	}
+
+	uint64_t total_load_ms;		// includes preloads; stats.keyload_ms only counts loads done by proofs
+
+	keystore.GetProofKeyStats(stats.nkeyloads, stats.nkeyhits, total_load_ms, stats.key_bytes);
+
+	return 0;
+}
+
 CCPROOF_API CCProof_Init()
 {
 	static bool binit = false;
@@ -1004,13 +1083,15 @@ CCPROOF_API CCProof_GenProof(struct TxPay& tx)
 	}
 #endif
 
+	ProverSlot slot;
+
 	reset<ZKPAIRING>();
 
-	uint32_t t0;
 	ostringstream benchmark_text;
 
-	if (TEST_SHOW_GEN_BENCHMARKS)
-		t0 = ccticks();
+	ZKKeyStore::thread_load_ms = 0;
+
+	auto t0 = ccticks();
 
 	auto keyindex = CCProof_Compute(tx, -1, false, &benchmark_text);
 	if (keyindex == (unsigned)(-1))
@@ -1021,6 +1102,8 @@ CCPROOF_API CCProof_GenProof(struct TxPay& tx)
 
 	auto key = keystore.GetProofKey(keyindex);
 
+	auto t1 = ccticks();
+
 #if 0 // USE_TEST_CODE
 	key = testkey;
 #endif
@@ -1031,12 +1114,28 @@ CCPROOF_API CCProof_GenProof(struct TxPay& tx)
 
 	reset<ZKPAIRING>();	// free memory
 
+	auto t2 = ccticks();
+
+	uint32_t keyload_ms = ZKKeyStore::thread_load_ms;
+	uint32_t circuit_ms = ccticks_elapsed(t0, t1) - keyload_ms;
+	uint32_t prove_ms = ccticks_elapsed(t1, t2);
+
+	{
+		lock_guard<mutex> lock(s_prover_lock);
+
+		++s_gen_stats.nproofs;
+		s_gen_stats.wait_ms += slot.wait_ms;
+		s_gen_stats.keyload_ms += keyload_ms;
+		s_gen_stats.circuit_ms += circuit_ms;
+		s_gen_stats.prove_ms += prove_ms;
+	}
+
 	if (TEST_SHOW_GEN_BENCHMARKS)
 	{
-		auto t1 = ccticks();
-		auto elapsed = ccticks_elapsed(t0, t1);
+		auto elapsed = ccticks_elapsed(t0, t2);
 		lock_guard<FastSpinLock> lock(g_cout_lock);
-		cout << "Zero knowledge proof generated: " << benchmark_text.str() << "; keyindex " << keyindex << " elapsed time " << elapsed << " ms" << endl;
+		cout << "Zero knowledge proof generated: " << benchmark_text.str() << "; keyindex " << keyindex << " elapsed time " << elapsed << " ms"
+			<< " (slot wait " << slot.wait_ms << " key load " << keyload_ms << " circuit " << circuit_ms << " prove " << prove_ms << ")" << endl;
 	}
 
 	//for (unsigned i = 0; i < tx.zkproof.size(); ++i)
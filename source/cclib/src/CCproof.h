@@ -67,6 +67,25 @@ CCPROOF_API CCProof_Init();
 
 CCPROOF_API CCProof_GenProof(struct TxPay& tx);
 
+// max_concurrent limits the number of proofs generated at once, so memory use stays bounded when many threads call CCProof_GenProof
+//	(0 = one per core)
+// key_cache_bytes is the size of the proving key files kept resident between proofs
+CCPROOF_API CCProof_SetProverLimits(unsigned max_concurrent, uint64_t key_cache_bytes);
+
+struct CCProofGenStats
+{
+	uint64_t nproofs;			// proofs generated
+	uint64_t wait_ms;			// total time waiting for a prover slot
+	uint64_t keyload_ms;		// total time proofs spent loading proving keys from disk
+	uint64_t circuit_ms;		// total time building the circuit and witness, not including key loads
+	uint64_t prove_ms;			// total time computing the proof
+	uint64_t nkeyloads;			// proving keys loaded from disk
+	uint64_t nkeyhits;			// proving keys found resident
+	uint64_t key_bytes;			// size of the proving keys now resident
+};
+
+CCPROOF_API CCProof_GetGenStats(struct CCProofGenStats& stats);
+
 CCPROOF_API CCProof_PreloadVerifyKeys();
 
 CCPROOF_API CCProof_VerifyProof(struct TxPay& tx);
@@ -95,6 +95,12 @@ static CCRESULT json_cmd(const string& fn, const char *json, char *output, const
 	if (key == "tx-query-create")
 		return tx_query_from_json(key, root, output, bufsize);
 
+	if (key == "tx-query-reply-from-wire")
+	{
+		output[0] = firstbyte;
+		return tx_query_reply_from_wire(key, root, output, bufsize);
+	}
+
 	if (key == "work-reset")
 	{
 		output[0] = firstbyte;
@@ -456,6 +456,17 @@ CCRESULT hash_spend_secret(const string& fn, Json::Value& root, char *output, co
 	return copy_result_to_output(fn, os.str(), output, bufsize);
 }
 
+void compute_address(const bigint_t& dest, const bigint_t& paynum, bigint_t& address, uint64_t& value_xor)
+{
+	// M-address = zkhash(&dest, &paynum)
+
+	vector<CCHashInput> hashin(2);
+	hashin[0].SetValue(dest, TX_FIELD_BITS);
+	hashin[1].SetValue(paynum, TX_PAYNUM_BITS);
+	address = CCHash::Hash(hashin, HASH_BASES_ADDRESS, TX_FIELD_BITS);
+	value_xor = BIG64(CCHash::Hash(hashin, HASH_BASES_VALUEENC, TX_VALUE_BITS));
+}
+
 CCRESULT compute_address(const string& fn, Json::Value& root, char *output, const uint32_t bufsize)
 {
 	string key;
@@ -478,13 +489,10 @@ CCRESULT compute_address(const string& fn, Json::Value& root, char *output, cons
 	if (!root.empty())
 		return error_unexpected_key(fn, root.begin().name(), output, bufsize);
 
-	// M-address = zkhash(&dest, &paynum)
+	bigint_t address;
+	uint64_t value_xor;
 
-	vector<CCHashInput> hashin(2);
-	hashin[0].SetValue(dest, TX_FIELD_BITS);
-	hashin[1].SetValue(paynum, TX_PAYNUM_BITS);
-	auto address = CCHash::Hash(hashin, HASH_BASES_ADDRESS, TX_FIELD_BITS);
-	auto value_xor = BIG64(CCHash::Hash(hashin, HASH_BASES_VALUEENC, TX_VALUE_BITS));
+	compute_address(dest, paynum, address, value_xor);
 
 	//cerr << hex << "address " << address << dec << endl;
 	//cerr << hex << "value_xor " << value_xor << dec << endl;
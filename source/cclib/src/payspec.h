@@ -19,6 +19,7 @@ CCRESULT master_secret_to_json(const string& fn, Json::Value& root, char *output
 CCRESULT hash_spend_secret(const string& fn, Json::Value& root, char *output, const uint32_t bufsize);
 
 CCRESULT compute_address(const string& fn, Json::Value& root, char *output, const uint32_t bufsize);
+void compute_address(const bigint_t& dest, const bigint_t& paynum, bigint_t& address, uint64_t& value_xor);
 
 CCRESULT payspec_from_json(const string& fn, Json::Value& root, char *output, const uint32_t bufsize);
 
@@ -252,13 +252,8 @@ static CCRESULT txpay_precheck_input(const string& fn, unsigned index, const str
 	hashin[2].SetValue(secret_hashed, TX_FIELD_BITS);
 	auto dest = CCHash::Hash(hashin, HASH_BASES_DESTINATION, TX_FIELD_BITS);
 
-	hashin.clear();
-	hashin.resize(4);
-	hashin[0].SetValue(dest, TX_FIELD_BITS);
-	hashin[1].SetValue(tx.__paynum, TX_PAYNUM_BITS);
-	hashin[2].SetValue(tx.__value, TX_VALUE_BITS);
-	hashin[3].SetValue(tx.__M_commitment_iv, TX_COMMIT_IV_BITS);
-	auto commitment = CCHash::Hash(hashin, HASH_BASES_COMMITMENT, TX_FIELD_BITS);
+	bigint_t commitment;
+	tx_commitment_hash(dest, tx.__paynum, tx.__value, tx.__M_commitment_iv, commitment);
 	if (commitment != tx.__M_commitment)
 		return copy_error_to_output(fn + " error: inputs do not hash to the commitment for input " + to_string(index), output, bufsize);
 
@@ -396,17 +391,8 @@ static void set_output_dependents(const string& fn, struct TxPay& tx, char *outp
 			#endif
 		}
 
-		// M-commitment = zkhash(#dest, #paynum, #value, M-commitment_iv)
-		hashin.clear();
-		hashin.resize(4);
-		hashin[0].SetValue(tx.output[i].__dest, TX_FIELD_BITS);
-		hashin[1].SetValue(tx.output[i].__paynum, TX_PAYNUM_BITS);
-		hashin[2].SetValue(tx.output[i].__value, TX_VALUE_BITS);
-		hashin[3].SetValue(commitment_iv, TX_COMMIT_IV_BITS);
-		tx.output[i].M_commitment = CCHash::Hash(hashin, HASH_BASES_COMMITMENT, TX_FIELD_BITS);
+		tx_commitment_hash(tx.output[i].__dest, tx.output[i].__paynum, tx.output[i].__value, commitment_iv, tx.output[i].M_commitment);
 
-		//for (unsigned j = 0; j < hashin.size(); ++j)
-		//	hashin[j].Dump();
 		//cerr << "tx.output[i].M_commitment " << tx.output[i].M_commitment << endl;
 	}
 }
@@ -439,6 +425,34 @@ static CCRESULT check_proof(const string& fn, struct TxPay& tx, char *output, co
 	return 0;
 }
 
+// computes the dependent values and the proof of a TxPay whose inputs have been set
+
+static CCRESULT txpay_create(const string& fn, struct TxPay& tx, char *output, const uint32_t bufsize)
+{
+	if (tx.no_proof)
+		return 0;
+
+	if (!tx.no_precheck)
+	{
+		auto rc = txpay_precheck(fn, tx, output, bufsize);
+		if (rc) return rc;
+	}
+
+	set_output_dependents(fn, tx, output, bufsize);
+
+	set_input_dependents(fn, tx, output, bufsize);
+
+	if (!tx.no_proof)
+	{
+		set_proof(fn, tx, output, bufsize);
+
+		if (!tx.no_verify)
+			return check_proof(fn, tx, output, bufsize);
+	}
+
+	return 0;
+}
+
 static CCRESULT txpay_output_from_json(const string& fn, struct TxOut& tx, Json::Value& root, char *output, const uint32_t bufsize)
 {
 	bigint_t bigval;
@@ -733,28 +747,7 @@ static CCRESULT txpay_create_from_json(const string& fn, struct TxPay& tx, Json:
 	if (!root.empty())
 		return error_unexpected_key(fn, root.begin().name(), output, bufsize);
 
-	if (tx.no_proof)
-		return 0;
-
-	if (!tx.no_precheck)
-	{
-		rc = txpay_precheck(fn, tx, output, bufsize);
-		if (rc) return rc;
-	}
-
-	set_output_dependents(fn, tx, output, bufsize);
-
-	set_input_dependents(fn, tx, output, bufsize);
-
-	if (!tx.no_proof)
-	{
-		set_proof(fn, tx, output, bufsize);
-
-		if (!tx.no_verify)
-			return check_proof(fn, tx, output, bufsize);
-	}
-
-	return 0;
+	return txpay_create(fn, tx, output, bufsize);
 }
 
 CCRESULT json_tx_create(const string& fn, Json::Value& root, char *output, const uint32_t bufsize)
@@ -996,6 +989,14 @@ CCRESULT json_tx_to_wire(const string& fn, Json::Value& root, char *output, cons
 	return error_invalid_tx(fn, output, bufsize);
 }
 
+CCRESULT tx_to_wire(const struct TxPay& tx, char *output, const uint32_t bufsize)
+{
+	if (tx.tag != CC_TAG_TX_STRUCT || tx.type != TX_PAY)
+		return -1;
+
+	return txpay_to_wire("tx_to_wire", tx, output, bufsize);
+}
+
 CCRESULT tx_from_wire(struct TxPay& tx, const char *output, const uint32_t bufsize)
 {
 	tx_init(tx);
@@ -1184,18 +1185,69 @@ CCRESULT json_work_add(const string& fn, Json::Value& root, char *output, const
 	if (!root.empty())
 		return error_unexpected_key(fn, root.begin().name(), output, bufsize);
 
+	return tx_add_work(output, proof_index, iterations, proof_difficulty);
+}
+
+// non-json interface
+
+// the tx and its members must already be set as they would be by json tx-create, except for tag, type and the dependent values
+
+CCRESULT tx_create(struct TxPay& tx, char *output, const uint32_t bufsize)
+{
+	static const string fn("tx_create");
+
+	if (tx.nout > TX_MAXOUT || tx.nin > TX_MAXIN || tx.nin_with_path > TX_MAXINPATH || tx.nin_with_path > tx.nin)
+		return error_invalid_tx(fn, output, bufsize);
+
+	unsigned npaths = 0;
+	for (unsigned i = 0; i < tx.nin; ++i)
+	{
+		unsigned pathnum = tx.input[i].pathnum;
+		if (!pathnum)
+			continue;
+
+		if (pathnum != ++npaths)
+			return error_invalid_tx(fn, output, bufsize);
+	}
+
+	if (npaths != tx.nin_with_path)
+		return error_invalid_tx(fn, output, bufsize);
+
+	tx.zero = 0;
+	tx.tag = CC_TAG_TX_STRUCT;
+	tx.type = TX_PAY;
+
+	return txpay_create(fn, tx, output, bufsize);
+}
+
+CCRESULT tx_verify(struct TxPay& tx, char *output, const uint32_t bufsize)
+{
+	static const string fn("tx_verify");
+
+	if (tx.tag != CC_TAG_TX_STRUCT || tx.type != TX_PAY)
+		return error_invalid_tx(fn, output, bufsize);
+
+	return check_proof(fn, tx, output, bufsize);
+}
+
+CCRESULT tx_add_work(char *tx, unsigned proof_index, uint64_t iter_count, uint64_t proof_difficulty)
+{
+	auto pheader = (const CCObject::Header *)tx;
+	const unsigned data_offset = sizeof(CCObject::Header) + TX_POW_SIZE;
+
+	if (pheader->size < data_offset || proof_index >= TX_POW_NPROOFS)
+		return -1;
+
 	ccoid_t txhash;
 
-	rc = blake2b(&txhash, sizeof(txhash), NULL, 0, output + data_offset, pheader->size - data_offset);
+	auto rc = blake2b(&txhash, sizeof(txhash), NULL, 0, tx + data_offset, pheader->size - data_offset);
 	CCASSERTZ(rc);
 
-	//cerr << "json_work_add hashed " << pheader->size - data_offset << " bytes starting with " << hex << *(uint64_t*)(output + data_offset) << " result " << *(uint64_t*)(txhash) << dec << endl;
+	//cerr << "tx_add_work hashed " << pheader->size - data_offset << " bytes starting with " << hex << *(uint64_t*)(tx + data_offset) << " result " << *(uint64_t*)(txhash) << dec << endl;
 
-	return tx_set_work(output, &txhash, proof_index, 1, iterations, proof_difficulty);
+	return tx_set_work(tx, &txhash, proof_index, 1, iter_count, proof_difficulty);
 }
 
-// non-json interface
-
 CCRESULT tx_reset_work(const char *tx, uint64_t timestamp)
 {
 	auto ptime = (uint64_t*)(tx + sizeof(CCObject::Header));
@@ -1280,6 +1332,22 @@ CCRESULT tx_set_work(const char *tx, const void *txhash, unsigned proof_start, u
 	return result;
 }
 
+CCRESULT tx_commitment_hash(const bigint_t& dest, const bigint_t& paynum, const uint64_t& value, const bigint_t& commitment_iv, bigint_t& commitment)
+{
+	// M-commitment = zkhash(#dest, #paynum, #value, M-commitment_iv)
+
+	vector<CCHashInput> hashin(4);
+
+	hashin[0].SetValue(dest, TX_FIELD_BITS);
+	hashin[1].SetValue(paynum, TX_PAYNUM_BITS);
+	hashin[2].SetValue(value, TX_VALUE_BITS);
+	hashin[3].SetValue(commitment_iv, TX_COMMIT_IV_BITS);
+
+	commitment = CCHash::Hash(hashin, HASH_BASES_COMMITMENT, TX_FIELD_BITS);
+
+	return 0;
+}
+
 CCRESULT tx_commit_tree_hash_leaf(const bigint_t& commitment, const uint64_t& leafindex, bigint_t& hash)
 {
 	vector<CCHashInput> hashin(2);
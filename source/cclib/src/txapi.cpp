@@ -0,0 +1,377 @@
+/*
+ * CredaCash (TM) cryptocurrency and blockchain
+ *
+ * Copyright (C) 2015-2016 Creda Software, Inc.
+ *
+ * txapi.cpp
+*/
+
+#include "CCdef.h"
+#include "txapi.h"
+#include "transaction.h"
+#include "transaction.hpp"
+#include "payspec.h"
+#include "jsonutil.h"
+#include "CCproof.h"
+
+#include <CCobjects.hpp>
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+
+#define TXAPI_MAX_THREADS	256
+
+static once_flag s_init_flag;
+
+static void txapi_init()
+{
+	call_once(s_init_flag, []{ CCProof_Init(); });
+}
+
+static CCRESULT txapi_error(const string& fn, char *output, const uint32_t bufsize)
+{
+	if (!output || !bufsize)
+		return -1;
+
+	try
+	{
+		return copy_error_to_output(fn + ": assert error", output, bufsize);
+	}
+	catch (...)
+	{
+	}
+
+	return -1;
+}
+
+CCAPI CCTx_Create(struct TxPay *tx, char *output, const uint32_t bufsize)
+{
+	static const string fn("CCTx_Create");
+
+	try
+	{
+		CCASSERT(tx);
+		CCASSERT(output);
+
+		txapi_init();
+
+		return tx_create(*tx, output, bufsize);
+	}
+	catch (...)
+	{
+	}
+
+	return txapi_error(fn, output, bufsize);
+}
+
+CCAPI CCTx_ToWire(const struct TxPay *tx, char *output, const uint32_t bufsize)
+{
+	static const string fn("CCTx_ToWire");
+
+	try
+	{
+		CCASSERT(tx);
+		CCASSERT(output);
+
+		return tx_to_wire(*tx, output, bufsize);
+	}
+	catch (...)
+	{
+	}
+
+	return txapi_error(fn, output, bufsize);
+}
+
+CCAPI CCTx_FromWire(struct TxPay *tx, const char *input, const uint32_t bufsize)
+{
+	try
+	{
+		CCASSERT(tx);
+		CCASSERT(input);
+
+		if (bufsize < sizeof(CCObject::Header))
+			return -1;
+
+		return tx_from_wire(*tx, input, bufsize);
+	}
+	catch (...)
+	{
+	}
+
+	return -1;
+}
+
+CCAPI CCTx_Verify(struct TxPay *tx, char *output, const uint32_t bufsize)
+{
+	static const string fn("CCTx_Verify");
+
+	try
+	{
+		CCASSERT(tx);
+		CCASSERT(output);
+
+		txapi_init();
+
+		return tx_verify(*tx, output, bufsize);
+	}
+	catch (...)
+	{
+	}
+
+	return txapi_error(fn, output, bufsize);
+}
+
+CCAPI CCTx_ComputeAddress(const bigint_t *dest, const bigint_t *paynum, bigint_t *address, uint64_t *value_xor)
+{
+	try
+	{
+		CCASSERT(dest);
+		CCASSERT(paynum);
+		CCASSERT(address);
+		CCASSERT(value_xor);
+
+		txapi_init();
+
+		compute_address(*dest, *paynum, *address, *value_xor);
+
+		return 0;
+	}
+	catch (...)
+	{
+	}
+
+	return -1;
+}
+
+CCAPI CCTx_WorkAdd(char *tx, const uint32_t bufsize, const uint32_t index, const uint64_t iterations, const uint64_t difficulty)
+{
+	try
+	{
+		CCASSERT(tx);
+
+		if (bufsize < sizeof(CCObject::Header) || ((const CCObject::Header *)tx)->size > bufsize)
+			return -1;
+
+		return tx_add_work(tx, index, iterations, difficulty);
+	}
+	catch (...)
+	{
+	}
+
+	return -1;
+}
+
+CCAPI CCTx_SetProverLimits(const uint32_t max_concurrent, const uint64_t key_cache_bytes)
+{
+	try
+	{
+		return CCProof_SetProverLimits(max_concurrent, key_cache_bytes);
+	}
+	catch (...)
+	{
+	}
+
+	return -1;
+}
+
+CCAPI CCTx_GetProverStats(struct CCProofGenStats *stats)
+{
+	try
+	{
+		CCASSERT(stats);
+
+		return CCProof_GetGenStats(*stats);
+	}
+	catch (...)
+	{
+	}
+
+	return -1;
+}
+
+static CCRESULT run_batch_cmd(struct CCTxBatchCmd& cmd)
+{
+	switch (cmd.op)
+	{
+	case CCTX_OP_CREATE:
+		return CCTx_Create(cmd.tx, cmd.buf, cmd.bufsize);
+
+	case CCTX_OP_TO_WIRE:
+		return CCTx_ToWire(cmd.tx, cmd.buf, cmd.bufsize);
+
+	case CCTX_OP_FROM_WIRE:
+		return CCTx_FromWire(cmd.tx, cmd.buf, cmd.bufsize);
+
+	case CCTX_OP_VERIFY:
+		return CCTx_Verify(cmd.tx, cmd.buf, cmd.bufsize);
+
+	case CCTX_OP_COMPUTE_ADDRESS:
+		return CCTx_ComputeAddress(&cmd.dest, &cmd.paynum, &cmd.address, &cmd.value_xor);
+
+	case CCTX_OP_WORK_ADD:
+		return CCTx_WorkAdd(cmd.buf, cmd.bufsize, cmd.work_index, cmd.work_iterations, cmd.work_difficulty);
+
+	default:
+		return -1;
+	}
+}
+
+/*
+The pool threads are never stopped, because the proof code keeps a large per-thread work area that is never freed,
+so starting new threads for each batch would leak memory.
+*/
+
+class TxApiThreadPool
+{
+	mutex m_lock;
+	condition_variable m_cv;
+	deque<function<void()>> m_tasks;
+	unsigned m_nthreads;
+
+	void ThreadProc()
+	{
+		while (true)
+		{
+			function<void()> task;
+
+			{
+				unique_lock<mutex> lock(m_lock);
+
+				while (m_tasks.empty())
+					m_cv.wait(lock);
+
+				task = move(m_tasks.front());
+				m_tasks.pop_front();
+			}
+
+			task();
+		}
+	}
+
+public:
+	TxApiThreadPool()
+	 :	m_nthreads(0)
+	{ }
+
+	// returns the number of copies of the task queued, which can be less than ntasks if out of resources
+
+	unsigned Run(const function<void()>& task, unsigned ntasks)
+	{
+		lock_guard<mutex> lock(m_lock);
+
+		unsigned nqueued = 0;
+
+		try
+		{
+			while (m_nthreads < ntasks && m_nthreads < TXAPI_MAX_THREADS)
+			{
+				thread t(&TxApiThreadPool::ThreadProc, this);
+				t.detach();
+				++m_nthreads;
+			}
+		}
+		catch (...)
+		{
+		}
+
+		try
+		{
+			for (unsigned i = 0; i < ntasks && m_nthreads; ++i)
+			{
+				m_tasks.push_back(task);
+				++nqueued;
+			}
+		}
+		catch (...)
+		{
+		}
+
+		if (nqueued)
+			m_cv.notify_all();
+
+		return nqueued;
+	}
+};
+
+static TxApiThreadPool s_thread_pool;
+
+CCAPI CCTx_Batch(struct CCTxBatchCmd *cmds, const uint32_t ncmds, const uint32_t nthreads)
+{
+	if (!ncmds)
+		return 0;
+
+	if (!cmds)
+		return -1;
+
+	try
+	{
+		txapi_init();
+
+		unsigned nworkers = nthreads;
+		if (!nworkers)
+			nworkers = thread::hardware_concurrency();
+		if (nworkers > ncmds)
+			nworkers = ncmds;
+		if (nworkers > TXAPI_MAX_THREADS)
+			nworkers = TXAPI_MAX_THREADS;
+		if (nworkers < 1)
+			nworkers = 1;
+
+		// each worker, including the calling thread, takes the next command until none are left
+
+		atomic<unsigned> next(0);
+		atomic<unsigned> nfailed(0);
+
+		mutex done_lock;
+		condition_variable done_cv;
+		unsigned nrunning = nworkers;
+
+		auto work = [&]
+		{
+			while (true)
+			{
+				auto i = next.fetch_add(1);
+				if (i >= ncmds)
+					break;
+
+				auto& cmd = cmds[i];
+
+				cmd.result = run_batch_cmd(cmd);
+				if (cmd.result)
+					nfailed.fetch_add(1);
+			}
+
+			lock_guard<mutex> lock(done_lock);
+
+			if (--nrunning == 0)
+				done_cv.notify_all();
+		};
+
+		if (nworkers > 1)
+		{
+			auto nqueued = s_thread_pool.Run(work, nworkers - 1);
+
+			lock_guard<mutex> lock(done_lock);
+
+			nrunning -= nworkers - 1 - nqueued;
+		}
+
+		work();
+
+		unique_lock<mutex> lock(done_lock);
+
+		while (nrunning)
+			done_cv.wait(lock);
+
+		return nfailed.load();
+	}
+	catch (...)
+	{
+	}
+
+	return -1;
+}
@@ -0,0 +1,75 @@
+/*
+ * CredaCash (TM) cryptocurrency and blockchain
+ *
+ * Copyright (C) 2015-2016 Creda Software, Inc.
+ *
+ * txapi.h
+*/
+
+#pragma once
+
+#include "CCapi.h"
+
+/*
+Binary interface to the transaction functions, for wallet backends that create or verify many transactions.
+
+These functions work on caller-provided TxPay structs (see transaction.hpp) and wire buffers,
+so they skip the json parsing and hex formatting done by CCTx_JsonCmd, and they are safe to call from multiple threads.
+On error, they return nonzero and, when an output buffer is given, put an error message in it.
+
+CCTx_Create: the caller sets the TxPay members that json tx-create would set (parameter-level through nonfinancial,
+	nout and the outputs' destination, payment-number and value, nin, nin_with_path and the inputs' secrets, values, commitments
+	and pathnum, and the merkle paths); this function sets the tag and type, computes the dependent values and the proof.
+CCTx_FromWire: the TxPay values not on the wire (merkle_root, outvalmin, outvalmax, invalmax, outvals_public and nonfinancial)
+	are zeroed, and must be set by the caller before the tx is verified.
+CCTx_WorkAdd: adds proof of work to a wire buffer, like json work-add.
+
+CCTx_Batch runs an array of commands in parallel on a thread pool that is kept for the life of the process.
+It returns the number of commands that failed; the result of each command is returned in its result member.
+
+CCTx_SetProverLimits and CCTx_GetProverStats pass through to CCProof_SetProverLimits and CCProof_GetGenStats (see CCproof.h).
+Proofs are generated on the calling threads, so running a batch of creates is what puts multiple cores to work.
+*/
+
+enum CCTxBatchOp
+{
+	CCTX_OP_CREATE = 1,
+	CCTX_OP_TO_WIRE,
+	CCTX_OP_FROM_WIRE,
+	CCTX_OP_VERIFY,
+	CCTX_OP_COMPUTE_ADDRESS,
+	CCTX_OP_WORK_ADD
+};
+
+struct CCTxBatchCmd
+{
+	uint32_t op;				// CCTxBatchOp
+	CCRESULT result;			// set on return
+
+	struct TxPay *tx;			// create, to-wire, from-wire, verify
+
+	char *buf;					// wire buffer for to-wire, from-wire and work-add; error message buffer for create and verify
+	uint32_t bufsize;
+
+	snarkfront::bigint_t dest;	// compute-address
+	snarkfront::bigint_t paynum;
+	snarkfront::bigint_t address;	// set on return
+	uint64_t value_xor;			// set on return
+
+	uint32_t work_index;		// work-add
+	uint64_t work_iterations;
+	uint64_t work_difficulty;
+};
+
+CCAPI CCTx_Create(struct TxPay *tx, char *output, const uint32_t bufsize);
+CCAPI CCTx_ToWire(const struct TxPay *tx, char *output, const uint32_t bufsize);
+CCAPI CCTx_FromWire(struct TxPay *tx, const char *input, const uint32_t bufsize);
+CCAPI CCTx_Verify(struct TxPay *tx, char *output, const uint32_t bufsize);
+CCAPI CCTx_ComputeAddress(const snarkfront::bigint_t *dest, const snarkfront::bigint_t *paynum, snarkfront::bigint_t *address, uint64_t *value_xor);
+CCAPI CCTx_WorkAdd(char *tx, const uint32_t bufsize, const uint32_t index, const uint64_t iterations, const uint64_t difficulty);
+
+// nthreads = 0 uses one thread per core
+CCAPI CCTx_Batch(struct CCTxBatchCmd *cmds, const uint32_t ncmds, const uint32_t nthreads);
+
+CCAPI CCTx_SetProverLimits(const uint32_t max_concurrent, const uint64_t key_cache_bytes);
+CCAPI CCTx_GetProverStats(struct CCProofGenStats *stats);
@@ -16,6 +16,8 @@
 
 static const uint8_t zero_pow[TX_POW_SIZE] = {};
 
+#define MERKLE_HASH_BYTES	((TX_MERKLE_PATH_BITS + 7) / 8)		// same as COMMITMENT_HASH_BYTES in ccnode
+
 static CCRESULT tx_query_parameters_create(const string& fn, Json::Value& root, char *output, const uint32_t bufsize, const bool bhex = false)
 {
 	if (!root.empty())
@@ -88,13 +90,14 @@ static CCRESULT tx_query_address_create(const string& fn, Json::Value& root, cha
 	return 0;
 }
 
-static CCRESULT tx_query_input_create(const string& fn, Json::Value& root, char *output, const uint32_t bufsize, const bool bhex = false)
+// creates a query for a list of addresses and commitment number cursors; used for tx-input-query and tx-addresses-query
+
+static CCRESULT tx_query_address_list_create(const string& fn, Json::Value& root, uint32_t tag, unsigned maxobjs, char *output, const uint32_t bufsize, const bool bhex = false)
 {
 	uint32_t bufpos = 0;
 
 	copy_to_buf(&bufpos, sizeof(bufpos), bufpos, output, bufsize, bhex);  // save space for size word
 
-	uint32_t tag = CC_TAG_TX_QUERY_INPUTS;
 	copy_to_buf(&tag, sizeof(tag), bufpos, output, bufsize, bhex);
 
 	CCASSERT(bufpos == sizeof(CCObject::Header));
@@ -111,8 +114,8 @@ static CCRESULT tx_query_input_create(const string& fn, Json::Value& root, char
 	if (!root.isArray()) // no longer enforced: || root.size() < 1)
 		return error_not_array_objs(fn, key, output, bufsize);
 
-	if (root.size() > TX_MAXINPATH)
-		return error_too_many_objs(fn, key, TX_MAXINPATH, output, bufsize);
+	if (root.size() > maxobjs)
+		return error_too_many_objs(fn, key, maxobjs, output, bufsize);
 
 	for (unsigned i = 0; i < root.size(); ++i)
 	{
@@ -144,7 +147,7 @@ static CCRESULT tx_query_input_create(const string& fn, Json::Value& root, char
 	if (bufpos > bufsize)
 		return copy_error_to_output(fn + " error: output buffer overflow", output, bufsize);
 
-	//cerr << "tx_query_input_create nbytes " << bufpos << endl;
+	//cerr << "tx_query_address_list_create nbytes " << bufpos << endl;
 
 	memcpy(output, &bufpos, sizeof(bufpos));
 
@@ -191,18 +194,8 @@ static CCRESULT tx_query_serialnum_create(const string& fn, Json::Value& root, c
 	return 0;
 }
 
-CCRESULT tx_query_from_json(const string& fn, Json::Value& root, char *output, const uint32_t bufsize)
+static CCRESULT tx_query_create(const string& fn, const string& key, Json::Value& root, char *output, const uint32_t bufsize)
 {
-	if (root.size() != 1)
-		return copy_error_to_output(fn + ": json tx query must contain exactly one object", output, bufsize);
-
-	string key;
-	Json::Value value;
-
-	auto it = root.begin();
-	key = it.name();
-	root = *it;
-
 	if (key == "tx-parameters-query")
 		return tx_query_parameters_create(fn, root, output, bufsize);
 
@@ -210,10 +203,246 @@ CCRESULT tx_query_from_json(const string& fn, Json::Value& root, char *output, c
 		return tx_query_address_create(fn, root, output, bufsize);
 
 	if (key == "tx-input-query")
-		return tx_query_input_create(fn, root, output, bufsize);
+		return tx_query_address_list_create(fn, root, CC_TAG_TX_QUERY_INPUTS, TX_MAXINPATH, output, bufsize);
+
+	if (key == "tx-addresses-query")
+		return tx_query_address_list_create(fn, root, CC_TAG_TX_QUERY_ADDRESSES, TX_QUERY_MAX_ADDRESSES, output, bufsize);
 
 	if (key == "tx-serial-number-query")
 		return tx_query_serialnum_create(fn, root, output, bufsize);
 
 	return copy_error_to_output(fn + " error: unrecognized tx query type \"" + key + "\"", output, bufsize);
 }
+
+CCRESULT tx_query_from_json(const string& fn, Json::Value& root, char *output, const uint32_t bufsize)
+{
+	string key;
+	Json::Value value;
+
+	// "binary-reply":"1" asks the tx server for a binary reply, which can be converted back to json with tx-query-reply-from-wire
+	// the serial number query has no binary reply, so the flag is ignored for it
+
+	bigint_t binary = 0UL;
+
+	key = "binary-reply";
+	if (root.removeMember(key, &value))
+	{
+		auto rc = parse_int_value(fn, key, value.asString(), 1, 0UL, binary, output, bufsize);
+		if (rc) return rc;
+	}
+
+	if (root.size() != 1)
+		return copy_error_to_output(fn + ": json tx query must contain exactly one object", output, bufsize);
+
+	auto it = root.begin();
+	key = it.name();
+	root = *it;
+
+	auto rc = tx_query_create(fn, key, root, output, bufsize);
+	if (rc) return rc;
+
+	if (BIG64(binary) && key != "tx-serial-number-query")
+	{
+		uint32_t tag;
+		memcpy(&tag, output + sizeof(uint32_t), sizeof(tag));
+		tag |= CC_TAG_TX_QUERY_BINARY;
+		memcpy(output + sizeof(uint32_t), &tag, sizeof(tag));
+	}
+
+	return 0;
+}
+
+/*
+Converts a binary tx server query reply (see transact.cpp in ccnode) to the json reply the server would have sent.
+The binary reply is passed in the output buffer; text replies like "Not Found" or "ERROR:..." are not binary and are rejected.
+*/
+
+class BinaryReplyReader
+{
+	const char *m_input;
+	uint32_t m_size;
+	uint32_t m_bufpos;
+
+public:
+	BinaryReplyReader(const char *input, uint32_t size, uint32_t bufpos)
+	 :	m_input(input),
+		m_size(size),
+		m_bufpos(bufpos)
+	{ }
+
+	bool Overflow() const
+	{
+		return m_bufpos > m_size;
+	}
+
+	bool Done() const
+	{
+		return m_bufpos == m_size;
+	}
+
+	uint64_t Uint64()
+	{
+		uint64_t val = 0;
+		copy_from_buf(&val, sizeof(val), m_bufpos, m_input, m_size);
+		return val;
+	}
+
+	bigint_t Bigint(unsigned nbytes = sizeof(bigint_t))
+	{
+		bigint_t val = 0UL;
+		copy_from_buf(&val, nbytes, m_bufpos, m_input, m_size);
+		return val;
+	}
+};
+
+static void stream_net_params(BinaryReplyReader& in, ostream& os)
+{
+	os << " \"timestamp\":\"0x" << in.Uint64() << "\"" JSON_ENDL
+	os << ",\"query-work-difficulty\":\"0x" << in.Uint64() << "\"" JSON_ENDL
+	os << ",\"tx-work-difficulty\":\"0x" << in.Uint64() << "\"" JSON_ENDL
+	os << ",\"merkle-tree-oldest-commitment-number\":\"0x" << in.Uint64() << "\"" JSON_ENDL
+	os << ",\"merkle-tree-next-commitment-number\":\"0x" << in.Uint64() << "\"" JSON_ENDL
+}
+
+static void stream_donation_params(BinaryReplyReader& in, ostream& os)
+{
+	os << ",\"donation-per-transaction\":\"0x" << in.Uint64() << "\"" JSON_ENDL
+	os << ",\"donation-per-byte\":\"0x" << in.Uint64() << "\"" JSON_ENDL
+	os << ",\"donation-per-output\":\"0x" << in.Uint64() << "\"" JSON_ENDL
+	os << ",\"donation-per-input\":\"0x" << in.Uint64() << "\"" JSON_ENDL
+}
+
+static void stream_value_limits(BinaryReplyReader& in, ostream& os)
+{
+	os << ",\"minimum-output-value\":\"0x" << in.Uint64() << "\"" JSON_ENDL
+	os << ",\"maximum-output-value\":\"0x" << in.Uint64() << "\"" JSON_ENDL
+	os << ",\"maximum-input-value\":\"0x" << in.Uint64() << "\"" JSON_ENDL
+}
+
+// encrypted-value, commitment-iv, commitment, commitment-number; the address, if any, must already be streamed
+
+static void stream_output(BinaryReplyReader& in, ostream& os)
+{
+	os << ",\"encrypted-value\":\"0x" << in.Uint64() << "\"" JSON_ENDL
+	os << ",\"commitment-iv\":\"0x" << in.Bigint(TX_COMMIT_IV_BITS/8) << "\"" JSON_ENDL
+	os << ",\"commitment\":\"0x" << in.Bigint() << "\"" JSON_ENDL
+	os << ",\"commitment-number\":\"0x" << in.Uint64() << "\"" JSON_ENDL
+}
+
+CCRESULT tx_query_reply_from_wire(const string& fn, Json::Value& root, char *output, const uint32_t bufsize)
+{
+	if (!root.empty())
+		return error_unexpected_key(fn, root.begin().name(), output, bufsize);
+
+	uint32_t size, tag;
+
+	if (bufsize < sizeof(CCObject::Header))
+		return copy_error_to_output(fn + " error: input buffer too small", output, bufsize);
+
+	memcpy(&size, output, sizeof(size));
+	memcpy(&tag, output + sizeof(size), sizeof(tag));
+
+	if (!(tag & CC_TAG_TX_QUERY_BINARY) || size < sizeof(CCObject::Header) || size > bufsize)
+		return copy_error_to_output(fn + " error: not a binary tx query reply", output, bufsize);
+
+	vector<char> input(output, output + size);
+	BinaryReplyReader in(input.data(), size, sizeof(CCObject::Header));
+
+	ostringstream os;
+	os << hex;
+
+	switch (tag & ~CC_TAG_TX_QUERY_BINARY)
+	{
+	case CC_TAG_TX_QUERY_PARAMS:
+	{
+		os << "{\"tx-parameters-query-results\":{" JSON_ENDL
+		stream_net_params(in, os);
+		os << "}}";
+
+		break;
+	}
+
+	case CC_TAG_TX_QUERY_ADDRESS:
+	{
+		os << "{\"tx-address-query-report\":" JSON_ENDL
+		os << "{\"address\":\"0x" << in.Bigint() << "\"" JSON_ENDL
+		os << ",\"commitment-number-start\":\"0x" << in.Uint64() << "\"" JSON_ENDL
+		os << ",\"more-results-available\":\"0x" << in.Uint64() << "\"" JSON_ENDL
+		os << ",\"tx-address-query-results\":[" JSON_ENDL
+		auto nfound = in.Uint64();
+		for (uint64_t i = 0; i < nfound && !in.Overflow(); ++i)
+		{
+			if (i)
+				os << ",";
+			os << "{";
+			os << "\"encrypted-value\":\"0x" << in.Uint64() << "\"" JSON_ENDL
+			os << ",\"commitment-iv\":\"0x" << in.Bigint(TX_COMMIT_IV_BITS/8) << "\"" JSON_ENDL
+			os << ",\"commitment\":\"0x" << in.Bigint() << "\"" JSON_ENDL
+			os << ",\"commitment-number\":\"0x" << in.Uint64() << "\"" JSON_ENDL
+			os << "}" JSON_ENDL
+		}
+		os << "]}}";
+
+		break;
+	}
+
+	case CC_TAG_TX_QUERY_INPUTS:
+	{
+		os << "{\"tx-input-query-report\":{" JSON_ENDL
+		stream_net_params(in, os);
+		stream_donation_params(in, os);
+		os << ",\"tx-input-query-results\":" JSON_ENDL
+		os << "{\"parameter-level\":\"0x" << in.Uint64() << "\"" JSON_ENDL
+		os << ",\"merkle-root\":\"0x" << in.Bigint(MERKLE_HASH_BYTES) << "\"" JSON_ENDL
+		stream_value_limits(in, os);
+		os << ",\"inputs\":[" JSON_ENDL
+		auto nin = in.Uint64();
+		for (uint64_t i = 0; i < nin && !in.Overflow(); ++i)
+		{
+			if (i)
+				os << ",";
+			os << "{\"address\":\"0x" << in.Bigint() << "\"" JSON_ENDL
+			stream_output(in, os);
+			os << ",\"merkle-path\":[" JSON_ENDL
+			for (unsigned height = 0; height < TX_MERKLE_DEPTH; ++height)
+			{
+				if (height)
+					os << ",";
+				os << "\"0x" << in.Bigint(MERKLE_HASH_BYTES) << "\"" JSON_ENDL
+			}
+			os << "]}" JSON_ENDL
+		}
+		os << "]}}}";
+
+		break;
+	}
+
+	case CC_TAG_TX_QUERY_ADDRESSES:
+	{
+		os << "{\"tx-addresses-query-report\":" JSON_ENDL
+		os << "{\"tx-addresses-query-results\":[" JSON_ENDL
+		auto noutputs = in.Uint64();
+		for (uint64_t i = 0; i < noutputs && !in.Overflow(); ++i)
+		{
+			if (i)
+				os << ",";
+			os << "{\"address\":\"0x" << in.Bigint() << "\"" JSON_ENDL
+			stream_output(in, os);
+			os << "}" JSON_ENDL
+		}
+		os << "]" JSON_ENDL
+		os << ",\"more-results-available\":\"0x" << in.Uint64() << "\"" JSON_ENDL
+		os << "}}";
+
+		break;
+	}
+
+	default:
+		return copy_error_to_output(fn + " error: unrecognized binary tx query reply", output, bufsize);
+	}
+
+	if (!in.Done())
+		return copy_error_to_output(fn + " error: malformed binary tx query reply", output, bufsize);
+
+	return copy_result_to_output(fn, os.str(), output, bufsize);
+}
@@ -11,3 +11,4 @@
 #include <jsoncpp/json/json.h>
 
 CCRESULT tx_query_from_json(const string& fn, Json::Value& root, char *output, const uint32_t bufsize);
+CCRESULT tx_query_reply_from_wire(const string& fn, Json::Value& root, char *output, const uint32_t bufsize);
@@ -12,6 +12,10 @@
 
 #include "zkkeys.hpp"
 
+#include <CCticks.hpp>
+
+thread_local uint32_t ZKKeyStore::thread_load_ms;
+
 unsigned ZKKeyStore::GetKeyId(unsigned keyindex)
 {
 	if (keyindex == (unsigned)(-1))
@@ -23,6 +27,13 @@ unsigned ZKKeyStore::GetKeyId(unsigned keyindex)
 }
 
 void ZKKeyStore::Init(bool reset)
+{
+	lock_guard<mutex> lock(keylock);
+
+	DoInit(reset);
+}
+
+void ZKKeyStore::DoInit(bool reset)
 {
 	if (reset)
 	{
@@ -30,6 +41,8 @@ void ZKKeyStore::Init(bool reset)
 		verifykey.clear();
 		proofkey.resize(nproof);
 		verifykey.resize(nverify);
+		proofkey_bytes.assign(nproof, 0);
+		proofkey_total_bytes = 0;
 	}
 
 	if (nproof)
@@ -45,6 +58,11 @@ void ZKKeyStore::Init(bool reset)
 	keytable.resize(nproof);
 	workorder.resize(nproof);
 	proofkey.resize(nproof);
+	proofkey_bytes.resize(nproof);
+	proofkey_lastuse.resize(nproof);
+	proofkey_loadlock.resize(nproof);
+	for (auto& loadlock : proofkey_loadlock)
+		loadlock.reset(new mutex);
 
 	nverify = nproof;	// currently, they are the same
 	verifykey.resize(nverify);
@@ -124,11 +142,45 @@ const shared_ptr<ZKKeyStore::ProvingKey> ZKKeyStore::LoadProofKey(const unsigned
 {
 	CCASSERT(keyindex < nproof);
 
-	auto key = proofkey[keyindex];
-	if (key)
-		return key;
+	string name;
+
+	{
+		lock_guard<mutex> lock(keylock);
+
+		auto key = proofkey[keyindex];
+		if (key)
+		{
+			proofkey_lastuse[keyindex] = ++proofkey_usecount;
+			++nproofkey_hits;
+
+			return key;
+		}
+
+		name = GetKeyFileName(keyindex, false);
+	}
+
+	// the key file is read without holding keylock, so other proofs can proceed with their keys
+
+	lock_guard<mutex> loadlock(*proofkey_loadlock[keyindex]);
 
-	key = shared_ptr<ProvingKey>(new ProvingKey);
+	{
+		lock_guard<mutex> lock(keylock);
+
+		auto key = proofkey[keyindex];
+		if (key)
+		{
+			// another thread loaded it while this one was waiting for the load lock
+
+			proofkey_lastuse[keyindex] = ++proofkey_usecount;
+			++nproofkey_hits;
+
+			return key;
+		}
+	}
+
+	auto t0 = ccticks();
+
+	auto key = shared_ptr<ProvingKey>(new ProvingKey);
 	if (!key)
 	{
 		cerr << "*** error allocating proof key" << endl;
@@ -136,14 +188,16 @@ const shared_ptr<ZKKeyStore::ProvingKey> ZKKeyStore::LoadProofKey(const unsigned
 	}
 
 	ifstream fs;
-	string name = GetKeyFileName(keyindex, false);
-	fs.open(name, fstream::binary | fstream::in);
+	fs.open(name, fstream::binary | fstream::in | fstream::ate);
 	if (!fs.is_open())
 	{
 		//cerr << "LoadProofKey error opening file (file not found?) " << name << endl;
 		return NULL;
 	}
 
+	uint64_t nbytes = fs.tellg();
+	fs.seekg(0);
+
 	//key->m_pk.marshal_in(fs);
 	auto rc = key->marshal_in_rawspecial(fs);
 	fs.close();
@@ -153,14 +207,91 @@ const shared_ptr<ZKKeyStore::ProvingKey> ZKKeyStore::LoadProofKey(const unsigned
 		return NULL;
 	}
 
-	//@cerr << "loaded proof key index " << keyindex << " file " << name << endl;
+	auto elapsed = ccticks_elapsed(t0, ccticks());
+	thread_load_ms += elapsed;
+
+	//@cerr << "loaded proof key index " << keyindex << " file " << name << " bytes " << nbytes << " elapsed " << elapsed << " ms" << endl;
+
+	lock_guard<mutex> lock(keylock);
 
-	if (keyindex < nproofsave)
-		proofkey[keyindex] = key;
+	++nproofkey_loads;
+	proofkey_load_ms += elapsed;
+
+	CacheProofKey(keyindex, key, nbytes);
 
 	return key;
 }
 
+// keylock must be held
+
+void ZKKeyStore::CacheProofKey(const unsigned keyindex, const shared_ptr<ProvingKey>& key, uint64_t nbytes)
+{
+	if (nbytes > proofkey_budget)
+		return;
+
+	while (proofkey_total_bytes + nbytes > proofkey_budget)
+	{
+		unsigned lru = -1;
+
+		for (unsigned i = 0; i < nproof; ++i)
+		{
+			if (proofkey[i] && (lru == (unsigned)(-1) || proofkey_lastuse[i] < proofkey_lastuse[lru]))
+				lru = i;
+		}
+
+		if (lru == (unsigned)(-1))
+			break;
+
+		//@cerr << "unloading proof key index " << lru << " bytes " << proofkey_bytes[lru] << endl;
+
+		proofkey[lru] = NULL;
+		proofkey_total_bytes -= proofkey_bytes[lru];
+		proofkey_bytes[lru] = 0;
+	}
+
+	proofkey[keyindex] = key;
+	proofkey_bytes[keyindex] = nbytes;
+	proofkey_lastuse[keyindex] = ++proofkey_usecount;
+	proofkey_total_bytes += nbytes;
+}
+
+void ZKKeyStore::SetProofKeyBudget(uint64_t nbytes)
+{
+	lock_guard<mutex> lock(keylock);
+
+	proofkey_budget = nbytes;
+
+	// unload keys until within the new budget
+
+	for (unsigned i = 0; i < nproof && proofkey_total_bytes > proofkey_budget; ++i)
+	{
+		unsigned lru = -1;
+
+		for (unsigned j = 0; j < nproof; ++j)
+		{
+			if (proofkey[j] && (lru == (unsigned)(-1) || proofkey_lastuse[j] < proofkey_lastuse[lru]))
+				lru = j;
+		}
+
+		if (lru == (unsigned)(-1))
+			break;
+
+		proofkey[lru] = NULL;
+		proofkey_total_bytes -= proofkey_bytes[lru];
+		proofkey_bytes[lru] = 0;
+	}
+}
+
+void ZKKeyStore::GetProofKeyStats(uint64_t& nloads, uint64_t& nhits, uint64_t& load_ms, uint64_t& resident_bytes)
+{
+	lock_guard<mutex> lock(keylock);
+
+	nloads = nproofkey_loads;
+	nhits = nproofkey_hits;
+	load_ms = proofkey_load_ms;
+	resident_bytes = proofkey_total_bytes;
+}
+
 const shared_ptr<ZKKeyStore::ProvingKey> ZKKeyStore::GetProofKey(const unsigned keyindex)
 {
 	return LoadProofKey(keyindex);
@@ -168,11 +299,17 @@ const shared_ptr<ZKKeyStore::ProvingKey> ZKKeyStore::GetProofKey(const unsigned
 
 void ZKKeyStore::UnloadProofKey(const unsigned keyindex)
 {
+	lock_guard<mutex> lock(keylock);
+
 	CCASSERT(keyindex < nproof);
 
 	proofkey[keyindex] = NULL;
+	proofkey_total_bytes -= proofkey_bytes[keyindex];
+	proofkey_bytes[keyindex] = 0;
 }
 
+// keylock must be held
+
 bool ZKKeyStore::LoadVerifyKey(const unsigned keyid)
 {
 	CCASSERT(keyid < nverify);
@@ -215,6 +352,8 @@ void ZKKeyStore::PreLoadProofKeys()
 
 void ZKKeyStore::PreLoadVerifyKeys()
 {
+	lock_guard<mutex> lock(keylock);
+
 	unsigned nloaded = 0;
 
 	for (unsigned i = 0; i < nverify; ++i)
@@ -251,6 +390,8 @@ bool ZKKeyStore::TestKeyFit(const unsigned keyindex, const unsigned nout, const
 	return nout <= keytable[keyindex].nout && nin <= keytable[keyindex].nin && nin_with_path <= keytable[keyindex].nin_with_path;
 }
 
+// note: the key is loaded to make sure it is available, and stays resident if it fits in the budget, so GetProofKey usually won't need to load it again
+
 unsigned ZKKeyStore::GetKeyIndex(uint16_t& nout, uint16_t& nin, uint16_t& nin_with_path, const bool test_largerkey)
 {
 	Init();
@@ -293,6 +434,8 @@ unsigned ZKKeyStore::GetKeyIndex(uint16_t& nout, uint16_t& nin, uint16_t& nin_wi
 
 const snarklib::PPZK_PrecompVerificationKey<ZKPAIRING> ZKKeyStore::GetVerifyKey(const unsigned keyid)
 {
+	lock_guard<mutex> lock(keylock);
+
 	LoadVerifyKey(keyid);
 
 	CCASSERT(verifykey[keyid]);
@@ -11,6 +11,10 @@
 #include "CCproof.h"
 #include "CCproof.hpp"
 
+#include <mutex>
+
+#define ZK_PROOFKEY_BUDGET_DEFAULT	((uint64_t)2 << 30)	// bytes of proving key files kept resident
+
 struct key_table_entry
 {
 	unsigned keyid;
@@ -20,31 +24,65 @@ struct key_table_entry
 	unsigned work;
 };
 
+// The proving keys stay resident between proofs, up to a budget measured by the size of their key files,
+// and the least recently used keys are unloaded to stay within it. A key in use by a proof stays in memory until the proof is done.
+// The key tables are locked, so proofs and verifications can run on multiple threads.
+
 class ZKKeyStore
 {
 	//typedef Keypair<ZKPAIRING> ProvingKey;
 	typedef snarklib::PPZK_ProvingKey<ZKPAIRING> ProvingKey;
 
+	mutex keylock;				// protects everything below except the load locks
 	unsigned nproof;
 	vector<key_table_entry> keytable;
 	vector<unsigned> workorder;
-	unsigned nproofsave;
+	unsigned nproofsave;		// number of keys loaded by PreLoadProofKeys
 	vector<shared_ptr<ProvingKey>> proofkey;
+	vector<uint64_t> proofkey_bytes;
+	vector<uint64_t> proofkey_lastuse;
+	vector<unique_ptr<mutex>> proofkey_loadlock;	// so concurrent proofs that need the same key share one load
+	uint64_t proofkey_usecount;
+	uint64_t proofkey_total_bytes;
+	uint64_t proofkey_budget;
+	uint64_t nproofkey_loads;
+	uint64_t nproofkey_hits;
+	uint64_t proofkey_load_ms;
 
 	unsigned nverify;
 	vector<unique_ptr<snarklib::PPZK_PrecompVerificationKey<ZKPAIRING>>> verifykey;
 
+	void DoInit(bool reset);
+
 	string GetKeyFileName(const unsigned keyindex, bool verifykey);
 
 	bool TestKeyFit(const unsigned keyindex, const unsigned nout, const unsigned nin, const unsigned nin_with_path);
 
 	const shared_ptr<ZKKeyStore::ProvingKey> LoadProofKey(const unsigned keyindex);
+	void CacheProofKey(const unsigned keyindex, const shared_ptr<ProvingKey>& key, uint64_t nbytes);
 
 	bool LoadVerifyKey(const unsigned keyid);
 
 public:
+	static thread_local uint32_t thread_load_ms;	// time this thread has spent loading proving keys
+
+	ZKKeyStore()
+	 :	nproof(0),
+		nproofsave(0),
+		proofkey_usecount(0),
+		proofkey_total_bytes(0),
+		proofkey_budget(ZK_PROOFKEY_BUDGET_DEFAULT),
+		nproofkey_loads(0),
+		nproofkey_hits(0),
+		proofkey_load_ms(0),
+		nverify(0)
+	{ }
+
 	void Init(bool reset = false);
 
+	void SetProofKeyBudget(uint64_t nbytes);
+	void GetProofKeyStats(uint64_t& nloads, uint64_t& nhits, uint64_t& load_ms, uint64_t& resident_bytes);
+
 	unsigned GetNKeys()
 	{
 		return nproof;
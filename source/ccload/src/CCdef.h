@@ -0,0 +1,56 @@
+/*
+ * CredaCash (TM) cryptocurrency and blockchain
+ *
+ * Copyright (C) 2015-2016 Creda Software, Inc.
+ *
+ * CCdef.h
+*/
+
+#pragma once
+
+#define CCVERSION "0.90"
+
+#define _LARGEFILE64_SOURCE
+
+#ifdef _WIN32
+
+#define WIN32_LEAN_AND_MEAN
+
+#define WINVER		 0x0502
+#define _WIN32_WINNT 0x0502
+#define _WIN32_IE	 0x0500
+
+#define _UNICODE
+
+#include <windows.h>
+
+#endif
+
+#include <cstdlib>
+#include <limits>
+#include <cstdint>
+#include <climits>
+#include <string>
+#include <array>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+
+#include <unistd.h>
+
+#include <boost/system/error_code.hpp>
+#include <boost/log/trivial.hpp>
+
+#include <CCassert.h>
+#include <CCticks.hpp>
+
+using namespace std;
+using namespace boost::log::trivial;
@@ -0,0 +1,1713 @@
+/*
+ * CredaCash (TM) cryptocurrency and blockchain
+ *
+ * Copyright (C) 2015-2016 Creda Software, Inc.
+ *
+ * ccload.cpp
+*/
+
+/*
+
+Load generator for a local node or test network.
+
+ccload first builds a corpus of transactions, then replays it against a node at a controlled rate, and reports how the node
+kept up. Unlike test/wallet-sim.py and test/burn-tx.py, all proofs are generated up front on all cores (through CCTx_Batch),
+so the replay rate is limited only by the node.
+
+Corpus:
+	Each valid tx has no inputs and 1 to --max-outputs outputs to random destinations, with a negative donation that balances
+	the outputs, which the node accepts because it doesn't check donations yet. The parameter level, Merkle root and value
+	limits come from the node's tx server, so the corpus must be replayed within 48 hours, before the parameter level expires.
+	--invalid gives the percent of txs that are copies of a valid tx with one bit flipped after the tx's parameter level, so they
+	fail proof verification.
+	--duplicate gives the percent of txs that are resends of a valid tx earlier in the corpus. Since the valid txs have no
+	inputs, this is how the load exercises the node's rejection of txs it has already seen.
+	The corpus can be saved with --corpus-out and replayed later with --corpus-in.
+
+Replay:
+	Tx number n in the corpus is due at n / --rate seconds after the start, and is sent by the first of the --conns
+	connections that is free. Proof of work is added to each tx when it is sent, so the timestamp is current. If the
+	connections can't keep up, the txs are sent late, and the largest lag is reported.
+
+	In tx mode (the default), txs are sent to the node's tx server. With --session-txs > 0, each connection is a tx server
+	session with up to that many txs in flight; with --session-txs 0, each tx is sent on its own connection. The tx server's
+	replies are counted as ok, invalid or error for each kind of tx.
+
+	In relay mode (--relay), each connection is a relay peer that announces the txs with CC_MSG_HAVE_TX and sends them when
+	the node asks for them. Relay peers don't get a reply for each tx, so in this mode the results come from the node's
+	processtx metrics and from clearing.
+
+	The connections are direct to --host, or go through the Tor proxy at --tor-proxy to the node's hidden services
+	--tor-tx-host or --tor-relay-host.
+
+Clearing:
+	Every --clear-poll milliseconds, the addresses of the first output of the valid txs sent so far are looked up with a
+	binary tx-addresses-query, and a tx counts as cleared when its output is found in the node's Merkle tree.
+	The end-to-end latency is from sending the tx (or announcing it, in relay mode) to the poll that finds it.
+	After the last tx is sent, ccload waits up to --clear-wait seconds for the rest to clear.
+
+Reports:
+	Every --interval seconds, a line of tab separated columns is printed:
+		secs	sent	ok	invalid	error	requested	cleared	uncleared	lag_ms	node_queued	node_valid	node_invalid
+	where node_queued is the node's processtx.queued gauge, and node_valid and node_invalid are the increases of its
+	processtx.valid and processtx.invalid counters since the start, read from the node's control port (unless --no-metrics).
+	At the end, the totals for each kind of tx are printed, with the reply and clear latency percentiles.
+
+Generating the corpus requires the zero knowledge proving keys, just like the wallet.
+
+*/
+
+#include "CCdef.h"
+
+#include <CCobjects.hpp>
+#include <CCcrypto.hpp>
+#include <CCutil.h>
+#include <socks.hpp>
+#include <transaction.hpp>
+#include <transaction.h>
+#include <txapi.h>
+
+#include <boost/asio.hpp>
+#include <boost/log/core.hpp>
+#include <boost/log/expressions.hpp>
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/parsers.hpp>
+#include <boost/program_options/variables_map.hpp>
+
+#include <random>
+#include <iomanip>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+
+#define TRANSACT_PORT			0		// offsets from the node's baseport
+#define RELAY_PORT				1
+#define CONTROL_PORT			4
+
+#define CORPUS_BATCH			64			// txs per CCTx_Batch call
+#define CORPUS_FILE_TAG			0xCC4C4401	// first word of a corpus file
+#define TX_WIRE_BUFSIZE			16000
+#define TX_PARAM_LEVEL_OFFSET	(CC_MSG_HEADER_SIZE + TX_POW_SIZE)		// tx_to_wire puts the param_level first after the proof of work
+#define MERKLE_HASH_BYTES		((TX_MERKLE_PATH_BITS + 7) / 8)		// same as COMMITMENT_HASH_BYTES in ccnode
+#define TX_OUTVAL_RANGE			((uint64_t)1 << 32)
+#define TX_POW_ITERATIONS		((uint64_t)1 << 32)
+#define REPLY_MAX_SIZE			(256*1024)
+#define RELAY_MSG_MAX_SIZE		(4*1024*1024)
+#define RELAY_REQUEST_WAIT		30			// secs to wait after the last announcement for the node to request the tx's
+#define ERRORS_SHOWN			10			// number of unexpected replies printed
+#define CLEAR_OUTPUT_SIZE		(sizeof(bigint_t) + sizeof(uint64_t) + (TX_COMMIT_IV_BITS)/8 + sizeof(bigint_t) + sizeof(uint64_t))
+
+typedef chrono::steady_clock::time_point time_point_t;
+
+static string s_host;
+static unsigned s_baseport;
+static unsigned s_tor_proxy;
+static string s_tor_tx_host;
+static string s_tor_relay_host;
+static bool s_relay;
+static unsigned s_ntxs;
+static unsigned s_max_outputs;
+static double s_invalid_pct;
+static double s_duplicate_pct;
+static unsigned s_threads;
+static string s_corpus_in;
+static string s_corpus_out;
+static bool s_generate_only;
+static double s_rate;
+static unsigned s_conns;
+static unsigned s_session_txs;
+static unsigned s_interval;
+static unsigned s_clear_poll_ms;
+static unsigned s_clear_wait;
+static bool s_metrics;
+
+static uint64_t ElapsedUsec(const time_point_t& t0)
+{
+	return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - t0).count();
+}
+
+enum CorpusKind
+{
+	CORPUS_VALID = 0,
+	CORPUS_INVALID,			// a valid tx with one bit flipped
+	CORPUS_DUPLICATE,		// a resend of a valid tx earlier in the corpus
+	CORPUS_NKINDS
+};
+
+static const char *s_kind_names[CORPUS_NKINDS] = {"valid", "invalid", "duplicate"};
+
+struct CorpusTx
+{
+	uint32_t kind;
+	bigint_t address;		// address of the first output, which is looked up to check clearing
+	vector<char> wire;		// without proof of work
+	ccoid_t oid;
+	uint64_t param_level;
+};
+
+static vector<CorpusTx> s_corpus;
+static unordered_map<string, unsigned> s_corpus_oids;	// relay mode: oid -> index of the first tx with that oid
+
+struct NetParams
+{
+	int64_t clock_diff;			// node's clock - our clock
+	uint64_t query_work_difficulty;
+	uint64_t tx_work_difficulty;
+	uint64_t next_commitnum;
+	uint64_t param_level;
+	bigint_t merkle_root;
+	uint64_t outvalmin;
+	uint64_t outvalmax;
+	uint64_t invalmax;
+};
+
+static NetParams s_netparams;
+
+struct KindCounts
+{
+	atomic<unsigned> sent;
+	atomic<unsigned> ok;
+	atomic<unsigned> invalid;
+	atomic<unsigned> error;
+	atomic<unsigned> requested;		// relay mode
+};
+
+static array<KindCounts, CORPUS_NKINDS> s_counts;
+
+static atomic<unsigned> s_next_tx;
+static atomic<uint32_t> s_max_lag_ms;
+static atomic<unsigned> s_nerrors_shown;
+static time_point_t s_start_time;
+static vector<time_point_t> s_send_time;		// when each tx was sent or announced
+
+static atomic<bool> s_stop;
+
+class LatencyStats
+{
+	mutex m_lock;
+	vector<uint64_t> m_usec;
+
+public:
+	void Add(uint64_t usec)
+	{
+		lock_guard<mutex> lock(m_lock);
+
+		m_usec.push_back(usec);
+	}
+
+	void Print(const char *name)
+	{
+		lock_guard<mutex> lock(m_lock);
+
+		cout << name << "\tcount " << m_usec.size();
+
+		if (m_usec.size())
+		{
+			sort(m_usec.begin(), m_usec.end());
+
+			static const array<double, 3> pcts = {{0.50, 0.90, 0.99}};
+
+			for (auto p : pcts)
+				cout << "\tp" << (unsigned)(p * 100 + 0.5) << " " << Percentile(p) << " ms";
+
+			cout << "\tmax " << Percentile(1) << " ms";
+		}
+
+		cout << endl;
+	}
+
+private:
+	double Percentile(double p)
+	{
+		size_t i = p * m_usec.size();
+		if (i >= m_usec.size())
+			i = m_usec.size() - 1;
+
+		return m_usec[i] / 1000.0;
+	}
+};
+
+static LatencyStats s_reply_latency;	// send to tx server reply, or announcement to relay request
+static LatencyStats s_clear_latency;	// send or announcement to clearing
+
+class ReplyCounts
+{
+	mutex m_lock;
+	map<string, unsigned> m_counts;
+
+public:
+	void Add(const string& reply)
+	{
+		lock_guard<mutex> lock(m_lock);
+
+		++m_counts[reply];
+	}
+
+	void Print()
+	{
+		lock_guard<mutex> lock(m_lock);
+
+		for (auto& it : m_counts)
+			cout << "reply\t" << it.second << "\t" << it.first << endl;
+	}
+};
+
+static ReplyCounts s_reply_counts;		// rejection reasons
+
+static void ShowError(const string& msg)
+{
+	if (s_nerrors_shown.fetch_add(1) < ERRORS_SHOWN)
+		cerr << msg << endl;
+}
+
+// Synchronous connection to one of the node's ports, direct or through the Tor proxy
+
+class NodeConnection
+{
+	boost::asio::io_service m_io_service;
+	boost::asio::ip::tcp::socket m_socket;
+
+public:
+	NodeConnection()
+	 :	m_socket(m_io_service)
+	{ }
+
+	// all functions return true on error
+
+	bool Connect(unsigned port_offset, const string& tor_host, bool direct = false);
+	bool Write(const void *data, size_t nbytes);
+	bool Read(void *data, size_t nbytes);
+	bool ReadToEnd(vector<char>& reply);
+	void Shutdown();
+};
+
+bool NodeConnection::Connect(unsigned port_offset, const string& tor_host, bool direct)
+{
+	boost::system::error_code e;
+
+	if (s_tor_proxy && !direct)
+	{
+		m_socket.connect(Socks::ConnectPoint(s_tor_proxy), e);
+		if (e)
+		{
+			ShowError(string("ERROR: Tor proxy connect failed: ") + e.message());
+
+			return true;
+		}
+
+		auto request = Socks::ConnectString(tor_host);
+		if (Write(request.data(), request.size()))
+			return true;
+
+		array<uint8_t, SOCK_REPLY_SIZE> reply;
+		if (Read(reply.data(), reply.size()))
+			return true;
+
+		if (reply[1] != 90)
+		{
+			ShowError("ERROR: Tor proxy returned " + to_string((unsigned)reply[1]) + " connecting to " + tor_host);
+
+			return true;
+		}
+
+		return false;
+	}
+
+	auto address = boost::asio::ip::address::from_string(s_host, e);
+	if (e)
+	{
+		ShowError("ERROR: invalid host address " + s_host);
+
+		return true;
+	}
+
+	m_socket.connect(boost::asio::ip::tcp::endpoint(address, s_baseport + port_offset), e);
+	if (e)
+	{
+		ShowError("ERROR: connect to " + s_host + ":" + to_string(s_baseport + port_offset) + " failed: " + e.message());
+
+		return true;
+	}
+
+	boost::asio::ip::tcp::no_delay option(true);
+	m_socket.set_option(option, e);
+
+	return false;
+}
+
+bool NodeConnection::Write(const void *data, size_t nbytes)
+{
+	boost::system::error_code e;
+
+	boost::asio::write(m_socket, boost::asio::buffer(data, nbytes), e);
+
+	return e.value() != 0;
+}
+
+bool NodeConnection::Read(void *data, size_t nbytes)
+{
+	boost::system::error_code e;
+
+	boost::asio::read(m_socket, boost::asio::buffer(data, nbytes), boost::asio::transfer_exactly(nbytes), e);
+
+	return e.value() != 0;
+}
+
+bool NodeConnection::ReadToEnd(vector<char>& reply)
+{
+	boost::system::error_code e;
+	size_t ntotal = 0;
+
+	reply.resize(REPLY_MAX_SIZE);
+
+	while (ntotal < reply.size())
+	{
+		ntotal += m_socket.read_some(boost::asio::buffer(&reply[ntotal], reply.size() - ntotal), e);
+
+		if (e == boost::asio::error::eof)
+			break;
+
+		if (e)
+		{
+			reply.resize(ntotal);
+
+			return true;
+		}
+	}
+
+	reply.resize(ntotal);
+
+	return false;
+}
+
+// unblocks a read in another thread
+
+void NodeConnection::Shutdown()
+{
+	boost::system::error_code e;
+
+	m_socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, e);
+}
+
+static void Append(vector<char>& msg, const void *data, size_t nbytes)
+{
+	auto p = (const char*)data;
+
+	msg.insert(msg.end(), p, p + nbytes);
+}
+
+static void SetHeader(vector<char>& msg, uint32_t tag)
+{
+	CCASSERT(msg.size() >= CC_MSG_HEADER_SIZE);
+
+	uint32_t size = msg.size();
+
+	memcpy(msg.data(), &size, sizeof(size));
+	memcpy(msg.data() + sizeof(size), &tag, sizeof(tag));
+}
+
+// sets the timestamp and adds proof of work to a tx or query message, which must start with a header and TX_POW_SIZE bytes
+
+static bool StampWork(vector<char>& msg, uint64_t difficulty)
+{
+	tx_reset_work(msg.data(), _time64(NULL) + s_netparams.clock_diff);
+
+	for (unsigned i = 0; i < TX_POW_NPROOFS; ++i)
+	{
+		while (true)
+		{
+			auto rc = tx_add_work(msg.data(), i, TX_POW_ITERATIONS, difficulty);
+			if (!rc)
+				break;
+
+			if (rc < 0)
+				return true;
+		}
+	}
+
+	return false;
+}
+
+// sends a query to the tx server and returns the reply; the payload is appended to a header and proof of work
+
+static bool TxServerQuery(uint32_t tag, const vector<char>& payload, vector<char>& reply)
+{
+	vector<char> msg(CC_MSG_HEADER_SIZE + TX_POW_SIZE, 0);
+	msg.insert(msg.end(), payload.begin(), payload.end());
+	SetHeader(msg, tag);
+
+	if (StampWork(msg, s_netparams.query_work_difficulty))
+		return true;
+
+	NodeConnection conn;
+
+	if (conn.Connect(TRANSACT_PORT, s_tor_tx_host) || conn.Write(msg.data(), msg.size()) || conn.ReadToEnd(reply))
+		return true;
+
+	return false;
+}
+
+// returns true if the reply is a binary reply to a query with this tag; otherwise shows the reply as an error
+
+static bool CheckBinaryReply(const vector<char>& reply, uint32_t tag, const char *query)
+{
+	uint32_t size = 0, reply_tag = 0;
+
+	if (reply.size() >= CC_MSG_HEADER_SIZE)
+	{
+		memcpy(&size, reply.data(), sizeof(size));
+		memcpy(&reply_tag, reply.data() + sizeof(size), sizeof(reply_tag));
+	}
+
+	if (size == reply.size() && reply_tag == (tag | CC_TAG_TX_QUERY_BINARY))
+		return true;
+
+	ShowError(string("ERROR: ") + query + " reply: " + string(reply.data(), min(reply.size(), (size_t)200)));
+
+	return false;
+}
+
+class ReplyReader
+{
+	const vector<char>& m_reply;
+	uint32_t m_bufpos;
+
+public:
+	ReplyReader(const vector<char>& reply)
+	 :	m_reply(reply),
+		m_bufpos(CC_MSG_HEADER_SIZE)
+	{ }
+
+	void Read(void *data, size_t nbytes)
+	{
+		copy_from_buf(data, nbytes, m_bufpos, m_reply.data(), m_reply.size());
+	}
+
+	uint64_t Uint64()
+	{
+		uint64_t val = 0;
+
+		Read(&val, sizeof(val));
+
+		return val;
+	}
+
+	bool Overflow() const
+	{
+		return m_bufpos > m_reply.size();
+	}
+};
+
+static bool QueryNetParams()
+{
+	vector<char> reply;
+
+	memset(&s_netparams, 0, sizeof(s_netparams));
+
+	// the params query gives the node's clock and work difficulties; the inputs query with no inputs gives the rest
+
+	if (TxServerQuery(CC_TAG_TX_QUERY_PARAMS | CC_TAG_TX_QUERY_BINARY, vector<char>(), reply)
+			|| !CheckBinaryReply(reply, CC_TAG_TX_QUERY_PARAMS, "tx-parameters-query"))
+		return true;
+
+	{
+		ReplyReader reader(reply);
+
+		s_netparams.clock_diff = reader.Uint64() - _time64(NULL);
+		s_netparams.query_work_difficulty = reader.Uint64();
+		s_netparams.tx_work_difficulty = reader.Uint64();
+
+		if (reader.Overflow())
+			return true;
+	}
+
+	if (TxServerQuery(CC_TAG_TX_QUERY_INPUTS | CC_TAG_TX_QUERY_BINARY, vector<char>(), reply)
+			|| !CheckBinaryReply(reply, CC_TAG_TX_QUERY_INPUTS, "tx-input-query"))
+		return true;
+
+	ReplyReader reader(reply);
+
+	reader.Uint64();		// timestamp
+	reader.Uint64();		// query_work_difficulty
+	reader.Uint64();		// tx_work_difficulty
+	reader.Uint64();		// oldest commitnum
+	s_netparams.next_commitnum = reader.Uint64();
+
+	for (unsigned i = 0; i < 4; ++i)
+		reader.Uint64();	// donation params
+
+	s_netparams.param_level = reader.Uint64();
+	reader.Read(&s_netparams.merkle_root, MERKLE_HASH_BYTES);
+	s_netparams.outvalmin = reader.Uint64();
+	s_netparams.outvalmax = reader.Uint64();
+	s_netparams.invalmax = reader.Uint64();
+
+	if (reader.Overflow())
+	{
+		cerr << "ERROR: tx-input-query reply too short" << endl;
+
+		return true;
+	}
+
+	if (!s_netparams.param_level)
+	{
+		cerr << "ERROR: the node's Merkle tree is empty" << endl;
+
+		return true;
+	}
+
+	cerr << "ccload node clock diff " << s_netparams.clock_diff << " query difficulty " << hex << s_netparams.query_work_difficulty
+		<< " tx difficulty " << s_netparams.tx_work_difficulty << dec << " param level " << s_netparams.param_level
+		<< " next commitnum " << s_netparams.next_commitnum << " output values " << s_netparams.outvalmin << " to " << s_netparams.outvalmax << endl;
+
+	return false;
+}
+
+static void QueryMetrics(map<string, int64_t>& metrics)
+{
+	metrics.clear();
+
+	if (!s_metrics)
+		return;
+
+	static const string cmd = "text\n";
+
+	NodeConnection conn;
+	vector<char> reply;
+
+	if (conn.Connect(CONTROL_PORT, string(), true) || conn.Write(cmd.data(), cmd.size()) || conn.ReadToEnd(reply))
+		return;
+
+	istringstream is(string(reply.data(), reply.size()));
+	string line;
+
+	while (getline(is, line))
+	{
+		istringstream ls(line);
+		string name;
+		int64_t value;
+
+		if (ls >> name >> value)
+			metrics[name] = value;
+	}
+}
+
+static void SetTxIds(CorpusTx& tx)
+{
+	vector<uint8_t> buf(sizeof(CCObject::Preamble) + tx.wire.size());
+	auto obj = (CCObject*)buf.data();
+
+	memcpy(obj->ObjPtr(), tx.wire.data(), tx.wire.size());
+	obj->SetObjId();
+
+	tx.oid = *obj->OidPtr();
+
+	memcpy(&tx.param_level, tx.wire.data() + TX_PARAM_LEVEL_OFFSET, sizeof(tx.param_level));
+}
+
+static bool GenerateValidTxs(vector<CorpusTx>& txs, unsigned ntxs)
+{
+	mt19937_64 rng;
+	{
+		uint64_t seed;
+		CCRandom(&seed, sizeof(seed));
+		rng.seed(seed);
+	}
+
+	uint64_t outval_range = s_netparams.outvalmax - s_netparams.outvalmin;
+	if (outval_range > TX_OUTVAL_RANGE)
+		outval_range = TX_OUTVAL_RANGE;
+
+	unique_ptr<TxPay[]> batch(new TxPay[CORPUS_BATCH]);
+	vector<CCTxBatchCmd> cmds(CORPUS_BATCH);
+	vector<vector<char>> bufs(CORPUS_BATCH, vector<char>(TX_WIRE_BUFSIZE));
+
+	txs.resize(ntxs);
+
+	auto t0 = chrono::steady_clock::now();
+
+	for (unsigned start = 0; start < ntxs; start += CORPUS_BATCH)
+	{
+		unsigned n = min(ntxs - start, (unsigned)CORPUS_BATCH);
+
+		for (unsigned i = 0; i < n; ++i)
+		{
+			auto& tx = batch[i];
+
+			memset(&tx, 0, sizeof(TxPay));
+
+			tx.param_level = s_netparams.param_level;
+			tx.merkle_root = s_netparams.merkle_root;
+			tx.outvalmin = s_netparams.outvalmin;
+			tx.outvalmax = s_netparams.outvalmax;
+			tx.invalmax = s_netparams.invalmax;
+			tx.nout = 1 + rng() % s_max_outputs;
+
+			int64_t total = 0;
+
+			for (unsigned j = 0; j < tx.nout; ++j)
+			{
+				auto& output = tx.output[j];
+
+				CCRandom(&output.__dest, sizeof(output.__dest));
+				output.__dest = output.__dest * bigint_t(1UL);		// mod prime
+
+				CCRandom(&output.__paynum, TX_PAYNUM_BITS/8);
+
+				output.__value = s_netparams.outvalmin + (outval_range ? rng() % (outval_range + 1) : 0);
+
+				total += output.__value;
+			}
+
+			tx.donation = -total;	// the node doesn't check the donation amount yet
+
+			memset(&cmds[i], 0, sizeof(CCTxBatchCmd));
+			cmds[i].op = CCTX_OP_CREATE;
+			cmds[i].tx = &tx;
+			cmds[i].buf = bufs[i].data();
+			cmds[i].bufsize = bufs[i].size();
+		}
+
+		auto nfailed = CCTx_Batch(cmds.data(), n, s_threads);
+
+		for (unsigned i = 0; i < n && nfailed; ++i)
+		{
+			if (cmds[i].result)
+			{
+				cerr << "ERROR: tx create failed: " << bufs[i].data() << endl;
+
+				return true;
+			}
+		}
+
+		if (nfailed)
+			return true;
+
+		for (unsigned i = 0; i < n; ++i)
+			cmds[i].op = CCTX_OP_TO_WIRE;
+
+		if (CCTx_Batch(cmds.data(), n, s_threads))
+		{
+			cerr << "ERROR: tx to wire failed" << endl;
+
+			return true;
+		}
+
+		for (unsigned i = 0; i < n; ++i)
+		{
+			auto& entry = txs[start + i];
+			uint32_t size;
+
+			memcpy(&size, bufs[i].data(), sizeof(size));
+			CCASSERT(size <= bufs[i].size());
+
+			entry.kind = CORPUS_VALID;
+			entry.address = batch[i].output[0].M_address;
+			entry.wire.assign(bufs[i].data(), bufs[i].data() + size);
+		}
+
+		auto secs = ElapsedUsec(t0) / 1000000.0;
+
+		cerr << "ccload generated " << start + n << " of " << ntxs << " valid txs in " << fixed << setprecision(1) << secs << " secs ("
+			<< (start + n) / secs << " tx/s)" << defaultfloat << endl;
+	}
+
+	return false;
+}
+
+static bool GenerateCorpus()
+{
+	mt19937_64 rng;
+	{
+		uint64_t seed;
+		CCRandom(&seed, sizeof(seed));
+		rng.seed(seed);
+	}
+
+	uniform_real_distribution<double> pct(0, 100);
+
+	// pick the kinds first; the first tx is always valid, so there is something to copy
+
+	vector<uint32_t> kinds(s_ntxs);
+	unsigned nvalid = 0;
+
+	for (auto& kind : kinds)
+	{
+		auto r = pct(rng);
+
+		if (!nvalid || r >= s_invalid_pct + s_duplicate_pct)
+			kind = CORPUS_VALID;
+		else if (r < s_invalid_pct)
+			kind = CORPUS_INVALID;
+		else
+			kind = CORPUS_DUPLICATE;
+
+		if (kind == CORPUS_VALID)
+			++nvalid;
+	}
+
+	cerr << "ccload generating " << s_ntxs << " txs (" << nvalid << " valid) with up to " << s_max_outputs << " outputs" << endl;
+
+	vector<CorpusTx> valid;
+
+	if (GenerateValidTxs(valid, nvalid))
+		return true;
+
+	s_corpus.clear();
+	s_corpus.reserve(s_ntxs);
+
+	vector<unsigned> placed;	// indexes in s_corpus of the valid txs placed so far
+	unsigned nextvalid = 0;
+
+	for (auto kind : kinds)
+	{
+		if (kind == CORPUS_VALID)
+		{
+			placed.push_back(s_corpus.size());
+			s_corpus.push_back(move(valid[nextvalid++]));
+		}
+		else if (kind == CORPUS_DUPLICATE)
+		{
+			CCASSERT(placed.size());
+
+			s_corpus.push_back(s_corpus[placed[rng() % placed.size()]]);
+			s_corpus.back().kind = CORPUS_DUPLICATE;
+		}
+		else
+		{
+			CCASSERT(placed.size());
+
+			s_corpus.push_back(s_corpus[placed[rng() % placed.size()]]);
+
+			auto& tx = s_corpus.back();
+			tx.kind = CORPUS_INVALID;
+
+			unsigned start = TX_PARAM_LEVEL_OFFSET + sizeof(uint64_t);
+			unsigned pos = start + rng() % (tx.wire.size() - start);
+			tx.wire[pos] ^= 1 << (rng() % 8);
+		}
+	}
+
+	CCASSERT(nextvalid == valid.size());
+
+	return false;
+}
+
+static bool SaveCorpus()
+{
+	ofstream fs(s_corpus_out, ios::binary | ios::trunc);
+
+	uint32_t tag = CORPUS_FILE_TAG;
+	uint32_t count = s_corpus.size();
+
+	fs.write((const char*)&tag, sizeof(tag));
+	fs.write((const char*)&count, sizeof(count));
+
+	for (auto& tx : s_corpus)
+	{
+		fs.write((const char*)&tx.kind, sizeof(tx.kind));
+		fs.write((const char*)&tx.address, sizeof(tx.address));
+		fs.write(tx.wire.data(), tx.wire.size());
+	}
+
+	fs.close();
+
+	if (!fs)
+	{
+		cerr << "ERROR: error writing corpus file " << s_corpus_out << endl;
+
+		return true;
+	}
+
+	cerr << "ccload saved " << count << " txs to " << s_corpus_out << endl;
+
+	return false;
+}
+
+static bool LoadCorpus()
+{
+	ifstream fs(s_corpus_in, ios::binary);
+
+	uint32_t tag = 0, count = 0;
+
+	fs.read((char*)&tag, sizeof(tag));
+	fs.read((char*)&count, sizeof(count));
+
+	if (!fs || tag != CORPUS_FILE_TAG)
+	{
+		cerr << "ERROR: " << s_corpus_in << " is not a ccload corpus file" << endl;
+
+		return true;
+	}
+
+	s_corpus.clear();
+	s_corpus.resize(count);
+
+	for (auto& tx : s_corpus)
+	{
+		uint32_t size = 0;
+
+		fs.read((char*)&tx.kind, sizeof(tx.kind));
+		fs.read((char*)&tx.address, sizeof(tx.address));
+		fs.read((char*)&size, sizeof(size));
+
+		if (!fs || tx.kind >= CORPUS_NKINDS || size < TX_PARAM_LEVEL_OFFSET + sizeof(uint64_t) || size > TX_WIRE_BUFSIZE)
+		{
+			cerr << "ERROR: corpus file " << s_corpus_in << " is invalid" << endl;
+
+			return true;
+		}
+
+		tx.wire.resize(size);
+		memcpy(tx.wire.data(), &size, sizeof(size));
+		fs.read(tx.wire.data() + sizeof(size), size - sizeof(size));
+	}
+
+	if (!fs)
+	{
+		cerr << "ERROR: corpus file " << s_corpus_in << " is truncated" << endl;
+
+		return true;
+	}
+
+	cerr << "ccload loaded " << count << " txs from " << s_corpus_in << endl;
+
+	return false;
+}
+
+static void IndexCorpus()
+{
+	s_corpus_oids.clear();
+
+	for (unsigned i = 0; i < s_corpus.size(); ++i)
+	{
+		auto& tx = s_corpus[i];
+
+		SetTxIds(tx);
+
+		if (tx.param_level != s_netparams.param_level && tx.kind != CORPUS_INVALID && !s_generate_only)
+			ShowError("WARNING: tx " + to_string(i) + " has param level " + to_string(tx.param_level) + "; the node is at level " + to_string(s_netparams.param_level));
+
+		string oid((const char*)&tx.oid, sizeof(tx.oid));
+
+		if (!s_corpus_oids.count(oid))
+			s_corpus_oids[oid] = i;
+	}
+}
+
+// Tracks the valid txs sent until they clear
+
+class ClearTracker
+{
+	struct Pending
+	{
+		bigint_t address;
+		uint64_t commitstart;
+		time_point_t sent;
+	};
+
+	mutex m_lock;
+	vector<Pending> m_pending;
+	atomic<unsigned> m_ncleared;
+
+	void Poll();
+
+public:
+	ClearTracker()
+	 :	m_ncleared(0)
+	{ }
+
+	void Add(const bigint_t& address, uint64_t commitstart, const time_point_t& sent)
+	{
+		lock_guard<mutex> lock(m_lock);
+
+		m_pending.push_back({address, commitstart, sent});
+	}
+
+	unsigned Cleared() const
+	{
+		return m_ncleared.load();
+	}
+
+	unsigned Uncleared()
+	{
+		lock_guard<mutex> lock(m_lock);
+
+		return m_pending.size();
+	}
+
+	void ThreadProc();
+};
+
+static ClearTracker s_clear_tracker;
+
+void ClearTracker::ThreadProc()
+{
+	while (!s_stop.load())
+	{
+		auto t0 = chrono::steady_clock::now();
+
+		Poll();
+
+		auto due = t0 + chrono::milliseconds(s_clear_poll_ms);
+
+		while (!s_stop.load() && chrono::steady_clock::now() < due)
+			this_thread::sleep_for(chrono::milliseconds(min(s_clear_poll_ms, 100U)));
+	}
+}
+
+void ClearTracker::Poll()
+{
+	vector<Pending> pending;
+
+	{
+		lock_guard<mutex> lock(m_lock);
+
+		pending = m_pending;
+	}
+
+	unordered_set<string> found;
+	vector<char> payload, reply;
+
+	for (unsigned start = 0; start < pending.size() && !s_stop.load(); start += TX_QUERY_MAX_ADDRESSES)
+	{
+		unsigned n = min((unsigned)pending.size() - start, (unsigned)TX_QUERY_MAX_ADDRESSES);
+
+		payload.clear();
+
+		for (unsigned i = start; i < start + n; ++i)
+		{
+			Append(payload, &pending[i].address, sizeof(bigint_t));
+			Append(payload, &pending[i].commitstart, sizeof(uint64_t));
+		}
+
+		if (TxServerQuery(CC_TAG_TX_QUERY_ADDRESSES | CC_TAG_TX_QUERY_BINARY, payload, reply)
+				|| !CheckBinaryReply(reply, CC_TAG_TX_QUERY_ADDRESSES, "tx-addresses-query"))
+			return;
+
+		// a page can be cut short (more-results-available); the remaining addresses are looked up again on the next poll
+
+		ReplyReader reader(reply);
+
+		auto count = reader.Uint64();
+
+		for (unsigned i = 0; i < count && !reader.Overflow(); ++i)
+		{
+			array<char, CLEAR_OUTPUT_SIZE> output;
+
+			reader.Read(output.data(), output.size());
+
+			if (!reader.Overflow())
+				found.insert(string(output.data(), sizeof(bigint_t)));
+		}
+	}
+
+	if (found.empty())
+		return;
+
+	lock_guard<mutex> lock(m_lock);
+
+	auto it = remove_if(m_pending.begin(), m_pending.end(), [&found](const Pending& p)
+	{
+		if (!found.count(string((const char*)&p.address, sizeof(bigint_t))))
+			return false;
+
+		s_clear_latency.Add(ElapsedUsec(p.sent));
+
+		return true;
+	});
+
+	m_ncleared.fetch_add(m_pending.end() - it);
+
+	m_pending.erase(it, m_pending.end());
+}
+
+// returns the index of the next tx to send, after waiting until it is due, or -1 when all have been sent
+
+static int NextTx()
+{
+	unsigned index = s_next_tx.fetch_add(1);
+
+	if (index >= s_corpus.size())
+		return -1;
+
+	if (s_rate > 0)
+	{
+		auto due = s_start_time + chrono::microseconds((uint64_t)(index * 1000000.0 / s_rate));
+		auto now = chrono::steady_clock::now();
+
+		if (due > now)
+			this_thread::sleep_until(due);
+		else
+		{
+			uint32_t lag = chrono::duration_cast<chrono::milliseconds>(now - due).count();
+			auto max_lag = s_max_lag_ms.load();
+
+			while (lag > max_lag && !s_max_lag_ms.compare_exchange_weak(max_lag, lag)) {}
+		}
+	}
+
+	return index;
+}
+
+static bool PrepareTx(unsigned index, vector<char>& msg)
+{
+	msg = s_corpus[index].wire;
+
+	if (StampWork(msg, s_netparams.tx_work_difficulty))
+	{
+		ShowError("ERROR: proof of work failed for tx " + to_string(index));
+
+		return true;
+	}
+
+	return false;
+}
+
+static void HandleTxReply(unsigned index, const string& reply, const time_point_t& sent)
+{
+	auto& tx = s_corpus[index];
+	auto& counts = s_counts[tx.kind];
+
+	if (!reply.compare(0, 3, "OK:"))
+	{
+		++counts.ok;
+
+		s_reply_latency.Add(ElapsedUsec(sent));
+
+		if (tx.kind == CORPUS_VALID)
+			s_clear_tracker.Add(tx.address, strtoull(reply.c_str() + 3, NULL, 10), sent);
+
+		return;
+	}
+
+	s_reply_counts.Add(string(s_kind_names[tx.kind]) + "\t" + reply);
+
+	if (!reply.compare(0, 8, "INVALID:"))
+	{
+		++counts.invalid;
+
+		s_reply_latency.Add(ElapsedUsec(sent));
+	}
+	else
+	{
+		++counts.error;
+
+		if (tx.kind == CORPUS_VALID)
+			ShowError("tx " + to_string(index) + " reply: " + reply);
+	}
+}
+
+// tx mode with --session-txs 0: each tx is sent on its own connection
+
+static void TxSendThread()
+{
+	vector<char> msg, reply;
+
+	while (true)
+	{
+		auto index = NextTx();
+		if (index < 0)
+			break;
+
+		if (PrepareTx(index, msg))
+		{
+			HandleTxReply(index, "ERROR:proof of work failed", chrono::steady_clock::now());
+
+			continue;
+		}
+
+		auto sent = chrono::steady_clock::now();
+		s_send_time[index] = sent;
+
+		++s_counts[s_corpus[index].kind].sent;
+
+		NodeConnection conn;
+
+		if (conn.Connect(TRANSACT_PORT, s_tor_tx_host) || conn.Write(msg.data(), msg.size()) || conn.ReadToEnd(reply))
+			HandleTxReply(index, "ERROR:connection failed", sent);
+		else
+			HandleTxReply(index, string(reply.data(), reply.size()), sent);
+	}
+}
+
+// tx mode with --session-txs > 0: one tx server session with up to --session-txs txs in flight
+
+class TxSession
+{
+	NodeConnection m_conn;
+	mutex m_lock;
+	condition_variable m_cv;
+	unordered_map<uint32_t, unsigned> m_pending;	// request id -> corpus index
+	bool m_failed;
+
+	void ReadThread();
+	void SetFailed();
+
+public:
+	TxSession()
+	 :	m_failed(false)
+	{ }
+
+	void Run();
+};
+
+void TxSession::SetFailed()
+{
+	lock_guard<mutex> lock(m_lock);
+
+	m_failed = true;
+
+	m_cv.notify_all();
+}
+
+void TxSession::Run()
+{
+	if (m_conn.Connect(TRANSACT_PORT, s_tor_tx_host))
+		return;
+
+	thread reader(&TxSession::ReadThread, this);
+
+	vector<char> msg, frame;
+	uint32_t request_id = 0;
+
+	while (true)
+	{
+		{
+			unique_lock<mutex> lock(m_lock);
+
+			while (m_pending.size() >= s_session_txs && !m_failed)
+				m_cv.wait(lock);
+
+			if (m_failed)
+				break;
+		}
+
+		auto index = NextTx();
+		if (index < 0)
+			break;
+
+		if (PrepareTx(index, msg))
+		{
+			HandleTxReply(index, "ERROR:proof of work failed", chrono::steady_clock::now());
+
+			continue;
+		}
+
+		++request_id;
+
+		frame.resize(CC_MSG_HEADER_SIZE);
+		Append(frame, &request_id, sizeof(request_id));
+		frame.insert(frame.end(), msg.begin(), msg.end());
+		SetHeader(frame, CC_TAG_TX_SESSION);
+
+		s_send_time[index] = chrono::steady_clock::now();
+
+		{
+			lock_guard<mutex> lock(m_lock);
+
+			m_pending[request_id] = index;
+		}
+
+		++s_counts[s_corpus[index].kind].sent;
+
+		if (m_conn.Write(frame.data(), frame.size()))
+		{
+			ShowError("ERROR: tx session write failed");
+
+			SetFailed();
+
+			break;
+		}
+	}
+
+	{
+		unique_lock<mutex> lock(m_lock);
+
+		while (m_pending.size() && !m_failed)
+			m_cv.wait(lock);
+	}
+
+	m_conn.Shutdown();
+
+	reader.join();
+
+	for (auto& it : m_pending)
+		HandleTxReply(it.second, "ERROR:connection lost", s_send_time[it.second]);
+}
+
+void TxSession::ReadThread()
+{
+	vector<char> body;
+
+	while (true)
+	{
+		array<uint32_t, 2> header;
+
+		if (m_conn.Read(header.data(), CC_MSG_HEADER_SIZE))
+			return SetFailed();
+
+		auto size = header[0];
+		auto tag = header[1];
+
+		if (tag != CC_TAG_TX_SESSION_REPLY || size < TX_SESSION_HEADER_SIZE || size > REPLY_MAX_SIZE)
+		{
+			// not a session reply, so probably a text error, e.g., "ERROR:sessions not enabled"
+
+			vector<char> rest;
+			m_conn.ReadToEnd(rest);
+
+			string text((const char*)header.data(), CC_MSG_HEADER_SIZE);
+			text.append(rest.data(), rest.size());
+
+			ShowError("ERROR: tx session reply: " + text.substr(0, 200));
+
+			return SetFailed();
+		}
+
+		body.resize(size - CC_MSG_HEADER_SIZE);
+
+		if (m_conn.Read(body.data(), body.size()))
+			return SetFailed();
+
+		uint32_t request_id;
+		memcpy(&request_id, body.data(), sizeof(request_id));
+
+		string reply(body.data() + sizeof(request_id), body.size() - sizeof(request_id));
+
+		unsigned index;
+
+		{
+			lock_guard<mutex> lock(m_lock);
+
+			auto it = m_pending.find(request_id);
+			if (it == m_pending.end())
+			{
+				ShowError("ERROR: tx session reply to unknown request " + to_string(request_id));
+
+				continue;
+			}
+
+			index = it->second;
+
+			m_pending.erase(it);
+
+			m_cv.notify_all();
+		}
+
+		HandleTxReply(index, reply, s_send_time[index]);
+	}
+}
+
+// relay mode: a relay peer that announces the txs and sends them on request
+
+class RelaySession
+{
+	NodeConnection m_conn;
+	mutex m_write_lock;
+	atomic<bool> m_failed;
+
+	// shared by all sessions, since the node requests each tx from only one of the peers that announced it
+	static atomic<unsigned> s_nannounced;	// distinct oids announced; a duplicate has the oid of an earlier tx and isn't counted
+	static atomic<unsigned> s_nrequested;
+
+	void ReadThread();
+	bool Write(const vector<char>& msg);
+
+public:
+	RelaySession()
+	 :	m_failed(false)
+	{ }
+
+	void Run();
+};
+
+atomic<unsigned> RelaySession::s_nannounced;
+atomic<unsigned> RelaySession::s_nrequested;
+
+bool RelaySession::Write(const vector<char>& msg)
+{
+	lock_guard<mutex> lock(m_write_lock);
+
+	if (m_conn.Write(msg.data(), msg.size()))
+	{
+		m_failed.store(true);
+
+		return true;
+	}
+
+	return false;
+}
+
+void RelaySession::Run()
+{
+	if (m_conn.Connect(RELAY_PORT, s_tor_relay_host))
+		return;
+
+	thread reader(&RelaySession::ReadThread, this);
+
+	vector<char> msg;
+
+	while (!m_failed.load())
+	{
+		auto index = NextTx();
+		if (index < 0)
+			break;
+
+		auto& tx = s_corpus[index];
+		uint32_t size = tx.wire.size();
+
+		msg.resize(CC_MSG_HEADER_SIZE);
+		Append(msg, &tx.oid, sizeof(tx.oid));
+		Append(msg, &size, sizeof(size));
+		Append(msg, &tx.param_level, sizeof(tx.param_level));
+		SetHeader(msg, CC_MSG_HAVE_TX);
+
+		auto sent = chrono::steady_clock::now();
+		s_send_time[index] = sent;
+
+		++s_counts[tx.kind].sent;
+
+		if (tx.kind == CORPUS_VALID)
+			s_clear_tracker.Add(tx.address, s_netparams.next_commitnum, sent);
+
+		if (Write(msg))
+		{
+			ShowError("ERROR: relay write failed");
+
+			break;
+		}
+
+		if (tx.kind != CORPUS_DUPLICATE)
+			++s_nannounced;
+	}
+
+	// give the node time to request what it wants; it won't request duplicates of tx's it already has
+
+	auto t0 = chrono::steady_clock::now();
+
+	while (!m_failed.load() && s_nrequested.load() < s_nannounced.load() && ElapsedUsec(t0) < RELAY_REQUEST_WAIT * 1000000ULL)
+		this_thread::sleep_for(chrono::milliseconds(100));
+
+	m_conn.Shutdown();
+
+	reader.join();
+}
+
+void RelaySession::ReadThread()
+{
+	vector<char> body, msg;
+
+	while (true)
+	{
+		array<uint32_t, 2> header;
+
+		if (m_conn.Read(header.data(), CC_MSG_HEADER_SIZE))
+			break;
+
+		auto size = header[0];
+		auto tag = header[1];
+
+		if (size < CC_MSG_HEADER_SIZE || size > RELAY_MSG_MAX_SIZE)
+		{
+			ShowError("ERROR: relay message size " + to_string(size));
+
+			break;
+		}
+
+		body.resize(size - CC_MSG_HEADER_SIZE);
+
+		if (m_conn.Read(body.data(), body.size()))
+			break;
+
+		if (tag != CC_CMD_SEND_TX)
+			continue;	// the node's announcements and other messages are ignored
+
+		for (unsigned pos = 0; pos + sizeof(ccoid_t) <= body.size(); pos += sizeof(ccoid_t))
+		{
+			auto it = s_corpus_oids.find(string(&body[pos], sizeof(ccoid_t)));
+			if (it == s_corpus_oids.end())
+				continue;
+
+			auto index = it->second;
+
+			++s_nrequested;
+			++s_counts[s_corpus[index].kind].requested;
+
+			s_reply_latency.Add(ElapsedUsec(s_send_time[index]));
+
+			if (PrepareTx(index, msg) || Write(msg))
+				break;
+		}
+	}
+
+	m_failed.store(true);
+}
+
+static unsigned TotalCount(atomic<unsigned> KindCounts::*member)
+{
+	unsigned total = 0;
+
+	for (auto& counts : s_counts)
+		total += (counts.*member).load();
+
+	return total;
+}
+
+static int64_t MetricDelta(const map<string, int64_t>& metrics, const map<string, int64_t>& base, const string& name)
+{
+	auto it = metrics.find(name);
+	if (it == metrics.end())
+		return -1;
+
+	auto bit = base.find(name);
+
+	return it->second - (bit == base.end() ? 0 : bit->second);
+}
+
+static void PrintMetric(int64_t value)
+{
+	if (value < 0)
+		cout << "\t-";
+	else
+		cout << "\t" << value;
+}
+
+static map<string, int64_t> s_base_metrics;
+
+static void PrintInterval()
+{
+	map<string, int64_t> metrics;
+
+	QueryMetrics(metrics);
+
+	cout << fixed << setprecision(1) << ElapsedUsec(s_start_time) / 1000000.0 << defaultfloat;
+	cout << "\t" << TotalCount(&KindCounts::sent);
+	cout << "\t" << TotalCount(&KindCounts::ok);
+	cout << "\t" << TotalCount(&KindCounts::invalid);
+	cout << "\t" << TotalCount(&KindCounts::error);
+	cout << "\t" << TotalCount(&KindCounts::requested);
+	cout << "\t" << s_clear_tracker.Cleared();
+	cout << "\t" << s_clear_tracker.Uncleared();
+	cout << "\t" << s_max_lag_ms.exchange(0);
+
+	auto it = metrics.find("processtx.queued");
+	PrintMetric(it == metrics.end() ? -1 : it->second);
+	PrintMetric(MetricDelta(metrics, s_base_metrics, "processtx.valid"));
+	PrintMetric(MetricDelta(metrics, s_base_metrics, "processtx.invalid"));
+
+	cout << endl;
+}
+
+static void MonitorThread()
+{
+	cout << "secs\tsent\tok\tinvalid\terror\trequested\tcleared\tuncleared\tlag_ms\tnode_queued\tnode_valid\tnode_invalid" << endl;
+
+	auto due = s_start_time;
+
+	while (!s_stop.load())
+	{
+		due += chrono::seconds(s_interval);
+
+		while (!s_stop.load() && chrono::steady_clock::now() < due)
+			this_thread::sleep_for(chrono::milliseconds(100));
+
+		PrintInterval();
+	}
+}
+
+static void Replay()
+{
+	cerr << "ccload replaying " << s_corpus.size() << " txs to " << (s_tor_proxy ? (s_relay ? s_tor_relay_host : s_tor_tx_host) : s_host)
+		<< " " << (s_relay ? "relay" : "tx server") << " on " << s_conns << " connections at " << s_rate << " tx/s" << endl;
+
+	QueryMetrics(s_base_metrics);
+
+	s_send_time.resize(s_corpus.size());
+
+	s_start_time = chrono::steady_clock::now();
+
+	thread monitor(MonitorThread);
+	thread tracker(&ClearTracker::ThreadProc, &s_clear_tracker);
+
+	vector<thread> senders;
+
+	for (unsigned i = 0; i < s_conns; ++i)
+	{
+		if (s_relay)
+			senders.emplace_back([]{ RelaySession session; session.Run(); });
+		else if (s_session_txs)
+			senders.emplace_back([]{ TxSession session; session.Run(); });
+		else
+			senders.emplace_back(TxSendThread);
+	}
+
+	for (auto& t : senders)
+		t.join();
+
+	auto send_secs = ElapsedUsec(s_start_time) / 1000000.0;
+
+	auto t0 = chrono::steady_clock::now();
+
+	while (s_clear_tracker.Uncleared() && ElapsedUsec(t0) < s_clear_wait * 1000000ULL)
+		this_thread::sleep_for(chrono::milliseconds(100));
+
+	s_stop.store(true);
+
+	tracker.join();
+	monitor.join();
+
+	auto nsent = TotalCount(&KindCounts::sent);
+
+	cout << endl;
+	cout << "sent " << nsent << " of " << s_corpus.size() << " txs in " << fixed << setprecision(1) << send_secs << " secs = "
+		<< nsent / send_secs << " tx/s" << defaultfloat << endl;
+	cout << "kind\tsent\tok\tinvalid\terror\trequested" << endl;
+
+	for (unsigned i = 0; i < CORPUS_NKINDS; ++i)
+	{
+		auto& counts = s_counts[i];
+
+		cout << s_kind_names[i] << "\t" << counts.sent.load() << "\t" << counts.ok.load() << "\t" << counts.invalid.load() << "\t" << counts.error.load() << "\t" << counts.requested.load() << endl;
+	}
+
+	cout << "cleared " << s_clear_tracker.Cleared() << " uncleared " << s_clear_tracker.Uncleared() << endl;
+
+	s_reply_latency.Print(s_relay ? "request_latency" : "reply_latency");
+	s_clear_latency.Print("clear_latency");
+
+	s_reply_counts.Print();
+}
+
+static int process_options(int argc, char **argv)
+{
+	namespace po = boost::program_options;
+
+	po::options_description options("Options");
+	options.add_options()
+		("help", "Display this message")
+		("host", po::value<string>(&s_host)->default_value("127.0.0.1"), "Node IP address, for direct connections and the control port")
+		("baseport", po::value<unsigned>(&s_baseport)->default_value(9223), "Node's base port; the tx server is at baseport, the relay at baseport+1, and the control port at baseport+4")
+		("tor-proxy", po::value<unsigned>(&s_tor_proxy)->default_value(0), "Connect through the Tor SOCKS proxy at this localhost port, instead of directly")
+		("tor-tx-host", po::value<string>(&s_tor_tx_host), "Node's tx server hidden service hostname, without the .onion")
+		("tor-relay-host", po::value<string>(&s_tor_relay_host), "Node's relay hidden service hostname, without the .onion")
+		("relay", "Send the txs to the relay port as a relay peer, instead of to the tx server")
+		("txs", po::value<unsigned>(&s_ntxs)->default_value(1000), "Number of txs in the corpus")
+		("max-outputs", po::value<unsigned>(&s_max_outputs)->default_value(2), "Maximum number of outputs per tx")
+		("invalid", po::value<double>(&s_invalid_pct)->default_value(0), "Percent of the txs that are invalid")
+		("duplicate", po::value<double>(&s_duplicate_pct)->default_value(0), "Percent of the txs that are duplicates of earlier txs")
+		("threads", po::value<unsigned>(&s_threads)->default_value(0), "Number of threads used to generate the corpus (0 = one per core)")
+		("corpus-in", po::value<string>(&s_corpus_in), "Replay the corpus in this file, instead of generating one")
+		("corpus-out", po::value<string>(&s_corpus_out), "Save the generated corpus to this file")
+		("generate-only", "Generate the corpus and exit")
+		("rate", po::value<double>(&s_rate)->default_value(10), "Txs per second (0 = as fast as possible)")
+		("conns", po::value<unsigned>(&s_conns)->default_value(4), "Number of connections")
+		("session-txs", po::value<unsigned>(&s_session_txs)->default_value(16), "Txs in flight on each tx server session (0 = one connection per tx)")
+		("interval", po::value<unsigned>(&s_interval)->default_value(5), "Seconds between reports")
+		("clear-poll", po::value<unsigned>(&s_clear_poll_ms)->default_value(500), "Milliseconds between polls for cleared txs")
+		("clear-wait", po::value<unsigned>(&s_clear_wait)->default_value(120), "Seconds to wait after sending for the txs to clear")
+		("no-metrics", "Don't read the node's metrics from its control port")
+		;
+
+	po::variables_map vm;
+	po::store(po::parse_command_line(argc, argv, options), vm);
+	po::notify(vm);
+
+	if (vm.count("help"))
+	{
+		cout << options << endl;
+
+		return 1;
+	}
+
+	s_relay = vm.count("relay");
+	s_generate_only = vm.count("generate-only");
+	s_metrics = !vm.count("no-metrics");
+
+	if (s_max_outputs < 1 || s_max_outputs > TX_MAXOUT)
+	{
+		cerr << "ERROR: max-outputs must be from 1 to " << TX_MAXOUT << endl;
+
+		return -1;
+	}
+
+	if (s_invalid_pct < 0 || s_duplicate_pct < 0 || s_invalid_pct + s_duplicate_pct >= 100)
+	{
+		cerr << "ERROR: invalid and duplicate must not be negative, and their sum must be less than 100" << endl;
+
+		return -1;
+	}
+
+	if (!s_ntxs || s_rate < 0 || !s_conns || !s_interval || !s_clear_poll_ms)
+	{
+		cerr << "ERROR: txs, conns, interval and clear-poll must be greater than zero, and rate must not be negative" << endl;
+
+		return -1;
+	}
+
+	if (s_generate_only && (s_corpus_out.empty() || s_corpus_in.length()))
+	{
+		cerr << "ERROR: generate-only requires corpus-out and can't be used with corpus-in" << endl;
+
+		return -1;
+	}
+
+	if (s_tor_proxy && (s_tor_tx_host.empty() || (s_relay && s_tor_relay_host.empty())))
+	{
+		cerr << "ERROR: tor-proxy requires tor-tx-host, and tor-relay-host for relay mode" << endl;
+
+		return -1;
+	}
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	boost::log::core::get()->set_filter(boost::log::trivial::severity >= warning);
+
+	try
+	{
+		auto rc = process_options(argc, argv);
+		if (rc)
+			return rc < 0 ? -1 : 0;
+	}
+	catch (const exception& e)
+	{
+		cerr << "ERROR: " << e.what() << endl;
+
+		return -1;
+	}
+
+	// the params are needed to build the corpus, and to replay it (clock, work difficulty and the starting commitnum for clearing)
+
+	if (QueryNetParams())
+	{
+		cerr << "ERROR: unable to get the parameters from the node's tx server" << endl;
+
+		return -1;
+	}
+
+	if (s_corpus_in.length())
+	{
+		if (LoadCorpus())
+			return -1;
+	}
+	else
+	{
+		if (GenerateCorpus())
+			return -1;
+	}
+
+	IndexCorpus();
+
+	if (s_corpus_out.length() && SaveCorpus())
+		return -1;
+
+	if (s_generate_only)
+		return 0;
+
+	Replay();
+
+	return 0;
+}
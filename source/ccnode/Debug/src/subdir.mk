@@ -7,23 +7,31 @@ CPP_SRCS += \
 ../src/block.cpp \
 ../src/blockchain.cpp \
 ../src/blockserve.cpp \
+../src/blocksigs.cpp \
 ../src/blocksync.cpp \
+../src/blocktree.cpp \
 ../src/ccnode.cpp \
 ../src/commitments.cpp \
+../src/control.cpp \
 ../src/dbconn-persistent.cpp \
 ../src/dbconn-processq.cpp \
 ../src/dbconn-relay.cpp \
+../src/dbconn-snapshot.cpp \
 ../src/dbconn-tempserials.cpp \
 ../src/dbconn-validobjs.cpp \
 ../src/dbconn-wal.cpp \
 ../src/dbconn.cpp \
 ../src/expire.cpp \
 ../src/hostdir.cpp \
+../src/metrics.cpp \
 ../src/processblock.cpp \
 ../src/processtx.cpp \
+../src/reindex.cpp \
 ../src/relay.cpp \
+../src/replycache.cpp \
 ../src/service_base.cpp \
 ../src/tor.cpp \
+../src/torpool.cpp \
 ../src/transact.cpp \
 ../src/util.cpp \
 ../src/witness.cpp 
@@ -32,23 +40,31 @@ OBJS += \
 ./src/block.o \
 ./src/blockchain.o \
 ./src/blockserve.o \
+./src/blocksigs.o \
 ./src/blocksync.o \
+./src/blocktree.o \
 ./src/ccnode.o \
 ./src/commitments.o \
+./src/control.o \
 ./src/dbconn-persistent.o \
 ./src/dbconn-processq.o \
 ./src/dbconn-relay.o \
+./src/dbconn-snapshot.o \
 ./src/dbconn-tempserials.o \
 ./src/dbconn-validobjs.o \
 ./src/dbconn-wal.o \
 ./src/dbconn.o \
 ./src/expire.o \
 ./src/hostdir.o \
+./src/metrics.o \
 ./src/processblock.o \
 ./src/processtx.o \
+./src/reindex.o \
 ./src/relay.o \
+./src/replycache.o \
 ./src/service_base.o \
 ./src/tor.o \
+./src/torpool.o \
 ./src/transact.o \
 ./src/util.o \
 ./src/witness.o 
@@ -57,23 +73,31 @@ CPP_DEPS += \
 ./src/block.d \
 ./src/blockchain.d \
 ./src/blockserve.d \
+./src/blocksigs.d \
 ./src/blocksync.d \
+./src/blocktree.d \
 ./src/ccnode.d \
 ./src/commitments.d \
+./src/control.d \
 ./src/dbconn-persistent.d \
 ./src/dbconn-processq.d \
 ./src/dbconn-relay.d \
+./src/dbconn-snapshot.d \
 ./src/dbconn-tempserials.d \
 ./src/dbconn-validobjs.d \
 ./src/dbconn-wal.d \
 ./src/dbconn.d \
 ./src/expire.d \
 ./src/hostdir.d \
+./src/metrics.d \
 ./src/processblock.d \
 ./src/processtx.d \
+./src/reindex.d \
 ./src/relay.d \
+./src/replycache.d \
 ./src/service_base.d \
 ./src/tor.d \
+./src/torpool.d \
 ./src/transact.d \
 ./src/util.d \
 ./src/witness.d 
@@ -78,6 +78,7 @@
 
 #include <CCassert.h>
 #include <CCticks.hpp>
+#include <CClog.hpp>
 
 #include "CCutil.h"
 
@@ -114,6 +115,20 @@ DECLARE_EXTERN struct global_params_struct
 	uint64_t tx_work_difficulty;
 
 	int		tx_validation_threads;
+	int		block_sig_threads;
+
+	wstring	snapshot_export_file;
+	wstring	snapshot_import_file;
+	string	snapshot_oid;
+
+	wstring	reindex_source;
+	wstring	export_blocks_file;
+	int		reindex_proof_threads;
+
+	string	io_balance;
+
+	bool	relay_compact_blocks;
+	bool	relay_tx_reconcile;
 
 	int		trace_level;
 	bool	trace_tx_server;
@@ -136,10 +151,22 @@ DECLARE_EXTERN struct global_params_struct
 	bool	trace_validobj_db;
 	bool	trace_expire;
 
+	int		lock_profile_secs;
+
 } g_params;
 
 #ifdef DECLARING_EXTERN
 
+// declare the global log subsystems; levels are set from the trace options by process_options
+
+CCLogSubsystem g_log_tx_server("tx-server");
+CCLogSubsystem g_log_relay("relay");
+CCLogSubsystem g_log_block_serve("block-serve");
+CCLogSubsystem g_log_block_sync("block-sync");
+CCLogSubsystem g_log_tx_validation("tx-validation");
+CCLogSubsystem g_log_block_validation("block-validation");
+CCLogSubsystem g_log_block_console("block-console", 4, true);
+
 // declare global the singletons
 
 #include "service_base.hpp"
@@ -148,6 +175,7 @@ DECLARE_EXTERN struct global_params_struct
 #include "blockserve.hpp"
 #include "blocksync.hpp"
 #include "hostdir.hpp"
+#include "control.hpp"
 
 #define TOR_TRANSACT_SUBDIR		TOR_HOSTNAMES_SUBDIR PATH_DELIMITER "transact"
 #define TOR_RELAY_SUBDIR		TOR_HOSTNAMES_SUBDIR PATH_DELIMITER "relay"
@@ -167,6 +195,14 @@ class HostDir g_hostdir;
 
 #else
 
+DECLARE_EXTERN CCLogSubsystem g_log_tx_server;
+DECLARE_EXTERN CCLogSubsystem g_log_relay;
+DECLARE_EXTERN CCLogSubsystem g_log_block_serve;
+DECLARE_EXTERN CCLogSubsystem g_log_block_sync;
+DECLARE_EXTERN CCLogSubsystem g_log_tx_validation;
+DECLARE_EXTERN CCLogSubsystem g_log_block_validation;
+DECLARE_EXTERN CCLogSubsystem g_log_block_console;
+
 DECLARE_EXTERN class TransactService g_transact_service;
 DECLARE_EXTERN class RelayService g_relay_service;
 DECLARE_EXTERN class RelayService g_privrelay_service;
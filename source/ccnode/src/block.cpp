@@ -526,6 +526,13 @@ bool Block::SignOrVerify(bool verify)
 		return true;
 	}
 
+	if (verify && auxp->sig_verified)
+	{
+		if (TRACE_SIGNING || TRACE_BLOCK) BOOST_LOG_TRIVIAL(debug) << "Block::SignOrVerify signature already verified in batch";
+
+		return false;
+	}
+
 	if (verify)
 	{
 		//*(uint8_t*)&data ^= 0xff;	// for testing
@@ -67,6 +67,7 @@ public:
 	uint32_t announce_time;
 	uint16_t skip;
 	bool marked_for_indelible;
+	bool sig_verified;		// signature already checked by BlockSigVerifier
 
 	struct
 	{
@@ -9,10 +9,12 @@
 #include "CCdef.h"
 #include "blockchain.hpp"
 #include "block.hpp"
+#include "blocktree.hpp"
 #include "witness.hpp"
 #include "commitments.hpp"
 #include "processblock.hpp"
 #include "dbparamkeys.h"
+#include "metrics.hpp"
 #include "util.h"
 
 #include <CCobjects.hpp>
@@ -44,6 +46,10 @@ static const uint32_t genesis_file_tag = 0x00474343;	// BBG\0 in little endian f
 
 BlockChain g_blockchain;
 
+MetricHistogram g_blockchain_index_txs_usec("blockchain.index_txs_usec");
+MetricHistogram g_blockchain_commit_tree_usec("blockchain.commit_tree_usec");
+MetricHistogram g_blockchain_db_commit_usec("blockchain.db_commit_usec");
+
 static DbConn *Wal_dbconn = NULL;
 
 void BlockChain::Init()
@@ -449,6 +455,8 @@ void BlockChain::RestoreLastBlocks(DbConn *dbconn, uint64_t last_indelible_level
 
 					return g_blockchain.SetFatalError(msg);
 				}
+
+				g_blocktree.Add(smartobj);
 			}
 		}
 	}
@@ -531,20 +539,31 @@ bool BlockChain::DoConfirmationLoop(DbConn *dbconn, SmartBuf newobj, struct TxPa
 	if (!have_new)
 		return true;
 
+	return CommitNewlyIndelibleBlocks(dbconn, fullcheckpoint);
+}
+
+// commits the write transaction opened by SetNewlyIndelibleBlock and makes m_new_indelible_block the last indelible block
+
+bool BlockChain::CommitNewlyIndelibleBlocks(DbConn *dbconn, bool fullcheckpoint)
+{
 	CCASSERT(m_new_indelible_block);
 
-	auto rc = dbconn->EndWrite(true);
-	if (rc)
 	{
-		const char *msg = "FATAL ERROR BlockChain::DoConfirmations error committing db write";
+		MetricTimer timer(g_blockchain_db_commit_usec);
 
-		g_blockchain.SetFatalError(msg);
+		auto rc = dbconn->EndWrite(true);
+		if (rc)
+		{
+			const char *msg = "FATAL ERROR BlockChain::DoConfirmations error committing db write";
 
-		return true;
+			g_blockchain.SetFatalError(msg);
+
+			return true;
+		}
 	}
 
-	block = (Block*)m_new_indelible_block.data();
-	wire = block->WireData();
+	auto block = (Block*)m_new_indelible_block.data();
+	auto wire = block->WireData();
 
 	// careful when using these: m_last_indelible_block and m_last_indelible_level may appear momentarily out-of-sync
 	m_last_indelible_block = m_new_indelible_block;
@@ -715,11 +734,25 @@ bool BlockChain::SetNewlyIndelibleBlock(DbConn *dbconn, SmartBuf smartobj, struc
 		}
 	}
 
-	auto rc1 = IndexTxs(dbconn, smartobj, txbuf);
+	bool rc1;
+
+	{
+		MetricTimer timer(g_blockchain_index_txs_usec);
+
+		rc1 = IndexTxs(dbconn, smartobj, txbuf);
+	}
+
 	if (rc1)
 		return true;
 
-	auto rc2 = g_commitments.UpdateCommitTree(dbconn, smartobj, timestamp);
+	int rc2;
+
+	{
+		MetricTimer timer(g_blockchain_commit_tree_usec);
+
+		rc2 = g_commitments.UpdateCommitTree(dbconn, smartobj, timestamp);
+	}
+
 	if (rc2)
 	{
 		const char *msg = "FATAL ERROR BlockChain::SetNewlyIndelibleBlock error updating CommitTree";
@@ -758,6 +791,23 @@ bool BlockChain::SetNewlyIndelibleBlock(DbConn *dbconn, SmartBuf smartobj, struc
 	return false;
 }
 
+// for an offline reindex, where every block replayed from an existing blockchain is already known to be indelible
+// the block must be chained to the last indelible block and validated
+
+bool BlockChain::ReplayIndelibleBlock(DbConn *dbconn, SmartBuf smartobj, struct TxPay &txbuf)
+{
+	if (m_have_fatal_error.load())
+		return true;
+
+	auto rc = SetNewlyIndelibleBlock(dbconn, smartobj, txbuf);
+	if (!rc)
+		rc = CommitNewlyIndelibleBlocks(dbconn, true);
+
+	dbconn->EndWrite();
+
+	return rc || m_have_fatal_error.load();
+}
+
 bool BlockChain::IndexTxs(DbConn *dbconn, SmartBuf smartobj, struct TxPay &txbuf)
 {
 	auto bufp = smartobj.BasePtr();
@@ -32,6 +32,7 @@ class BlockChain
 	atomic<bool> m_have_fatal_error;
 
 	bool DoConfirmOne(DbConn *dbconn, SmartBuf newobj, struct TxPay &txbuf);
+	bool CommitNewlyIndelibleBlocks(DbConn *dbconn, bool fullcheckpoint);
 
 public:
 
@@ -91,6 +92,7 @@ public:
 
 	bool DoConfirmations(DbConn *dbconn, SmartBuf newobj, struct TxPay &txbuf);
 	bool DoConfirmationLoop(DbConn *dbconn, SmartBuf newobj, struct TxPay &txbuf);
+	bool ReplayIndelibleBlock(DbConn *dbconn, SmartBuf smartobj, struct TxPay &txbuf);
 
 	typedef int (*SerialnumInsertFunction)(DbConn *dbconn, const void *serial, unsigned size, const void* blockp, uint64_t level);
 
@@ -105,3 +107,9 @@ public:
 };
 
 extern BlockChain g_blockchain;
+
+// time spent in the steps of making a block indelible; these are also read by the offline reindex
+
+extern class MetricHistogram g_blockchain_index_txs_usec;
+extern class MetricHistogram g_blockchain_commit_tree_usec;
+extern class MetricHistogram g_blockchain_db_commit_usec;
@@ -26,12 +26,9 @@
 
 #include <utility>
 
-#define TRACE_BLOCKSERVE		(g_params.trace_block_serve)
-
 #define BLOCKSERVE_DIR_REFRESH	(20*60)
 //#define BLOCKSERVE_DIR_REFRESH	10		// for testing
 
-#define BLOCKSERVE_TIMEOUT			15
 #define BLOCKSERVE_BYTES_PER_SEC	500
 
 #define BLOCKSERVE_MSG_SIZE		(CC_MSG_HEADER_SIZE + 8 + 2)	// incoming size: level + nblocks
@@ -46,7 +43,7 @@ thread_local DbConn *blockserve_dbconn;
 
 void BlockServeConnection::StartConnection()
 {
-	if (TRACE_BLOCKSERVE) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " BlockServeConnection::StartConnection";
+	CCLOG(g_log_block_serve, trace) << Name() << " Conn-" << m_conn_index << " BlockServeConnection::StartConnection";
 
 	m_nreqlevels.store(0);
 
@@ -70,7 +67,7 @@ void BlockServeConnection::HandleReadComplete()
 	unsigned size = *(uint32_t*)m_pread;
 	unsigned tag = *(uint32_t*)(m_pread + 4);
 
-	if (TRACE_BLOCKSERVE) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " BlockServeConnection::HandleReadComplete read " << m_nred << " bytes msg size " << size << " tag " << tag;
+	CCLOG(g_log_block_serve, trace) << Name() << " Conn-" << m_conn_index << " BlockServeConnection::HandleReadComplete read " << m_nred << " bytes msg size " << size << " tag " << tag;
 
 	if (size != BLOCKSERVE_MSG_SIZE)
 	{
@@ -89,7 +86,7 @@ void BlockServeConnection::HandleReadComplete()
 	uint64_t reqlevel = *(uint64_t*)(m_pread + 8);
 	uint16_t reqlevels = *(uint16_t*)(m_pread + 8 + 8);
 
-	if (TRACE_BLOCKSERVE) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " BlockServeConnection::HandleReadComplete reqlevel " << reqlevel << " reqlevels " << reqlevels;
+	CCLOG(g_log_block_serve, trace) << Name() << " Conn-" << m_conn_index << " BlockServeConnection::HandleReadComplete reqlevel " << reqlevel << " reqlevels " << reqlevels;
 
 	if (!reqlevel)
 	{
@@ -122,7 +119,7 @@ void BlockServeConnection::HandleReadComplete()
 
 void BlockServeConnection::DoSend()
 {
-	if (TRACE_BLOCKSERVE) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " BlockServeConnection::DoSend m_reqlevel " << m_reqlevel.load() << " m_nreqlevels " << m_nreqlevels.load();
+	CCLOG(g_log_block_serve, trace) << Name() << " Conn-" << m_conn_index << " BlockServeConnection::DoSend m_reqlevel " << m_reqlevel.load() << " m_nreqlevels " << m_nreqlevels.load();
 
 	if (!m_nreqlevels.fetch_sub(1))
 	{
@@ -182,7 +179,7 @@ void BlockServeConnection::DoSend()
 		return Stop();
 	}
 
-	if (TRACE_BLOCKSERVE) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " BlockServeConnection::DoSend level " << level << " size " << obj->ObjSize() << " tag " << obj->ObjTag();
+	CCLOG(g_log_block_serve, trace) << Name() << " Conn-" << m_conn_index << " BlockServeConnection::DoSend level " << level << " size " << obj->ObjSize() << " tag " << obj->ObjTag();
 
 	WriteAsync("BlockServeConnection::DoSend", boost::asio::buffer(obj->ObjPtr(), size),
 			boost::bind(&BlockServeConnection::HandleBlockWrite, this, boost::asio::placeholders::error, smartobj, AutoCount(this)));
@@ -208,14 +205,14 @@ void BlockServeConnection::HandleBlockWrite(const boost::system::error_code& e,
 		return Stop();
 	}
 
-	if (TRACE_BLOCKSERVE) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " BlockServeConnection::HandleBlockWrite ok";
+	CCLOG(g_log_block_serve, trace) << Name() << " Conn-" << m_conn_index << " BlockServeConnection::HandleBlockWrite ok";
 
 	DoSend();
 }
 
 bool BlockServeConnection::SetTimer(unsigned sec)
 {
-	//if (TRACE_BLOCKSERVE) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " BlockServeConnection::SetTimer " << sec;
+	//CCLOG(g_log_block_serve, trace) << Name() << " Conn-" << m_conn_index << " BlockServeConnection::SetTimer " << sec;
 
 	auto op_counter = AutoCount();
 	return AsyncTimerWait("BlockServeConnection::SetTimer", sec*1000, boost::bind(&BlockServeConnection::HandleTimeout, this, boost::asio::placeholders::error, op_counter), op_counter);
@@ -225,7 +222,7 @@ void BlockServeConnection::HandleTimeout(const boost::system::error_code& e, Aut
 {
 	if (e == boost::asio::error::operation_aborted)
 	{
-		//if (TRACE_BLOCKSERVE) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " BlockServeConnection::HandleTimeout " << uintptr_t(this) << " e = " << e << " " << e.message();
+		//CCLOG(g_log_block_serve, trace) << Name() << " Conn-" << m_conn_index << " BlockServeConnection::HandleTimeout " << uintptr_t(this) << " e = " << e << " " << e.message();
 
 		return;
 	}
@@ -233,7 +230,7 @@ void BlockServeConnection::HandleTimeout(const boost::system::error_code& e, Aut
 	if (g_shutdown)
 		return;
 
-	if (TRACE_BLOCKSERVE) BOOST_LOG_TRIVIAL(info) << Name() << " Conn-" << m_conn_index << " BlockServeConnection::HandleTimeout " << uintptr_t(this) << " e = " << e << " " << e.message();
+	CCLOG(g_log_block_serve, info) << Name() << " Conn-" << m_conn_index << " BlockServeConnection::HandleTimeout " << uintptr_t(this) << " e = " << e << " " << e.message();
 
 	Stop();
 }
@@ -245,7 +242,7 @@ void BlockService::Start()
 
 	g_hostdir.Init();
 
-	if (TRACE_BLOCKSERVE) BOOST_LOG_TRIVIAL(trace) << Name() << " BlockService port " << port;
+	CCLOG(g_log_block_serve, trace) << Name() << " BlockService port " << port;
 
 	// unsigned conn_nreadbuf, unsigned conn_nwritebuf, unsigned sock_nreadbuf, unsigned sock_nwritebuf, unsigned headersize, bool noclose, bool bregister
 	CCServer::ConnectionFactoryInstantiation<BlockServeConnection> connfac(BLOCKSERVE_MSG_SIZE, 0, -1, -1, BLOCKSERVE_MSG_SIZE, 0, 0);
@@ -273,7 +270,7 @@ void BlockService::ConnMonitorProc()
 
 	while (!g_shutdown)
 	{
-		if (TRACE_BLOCKSERVE) BOOST_LOG_TRIVIAL(info) << Name() << " BlockService::ConnMonitorProc refreshing peer directory entry...";
+		CCLOG(g_log_block_serve, info) << Name() << " BlockService::ConnMonitorProc refreshing peer directory entry...";
 
 		g_hostdir.GetHostName((HostDir::HostType)(-1));
 
@@ -304,11 +301,11 @@ void BlockServeThread::ThreadProc(boost::function<void()> threadproc)
 {
 	blockserve_dbconn = new DbConn;
 
-	if (TRACE_BLOCKSERVE) BOOST_LOG_TRIVIAL(trace) << "BlockServeThread::ThreadProc start " << (uintptr_t)this << " dbconn " << (uintptr_t)blockserve_dbconn;
+	CCLOG(g_log_block_serve, trace) << "BlockServeThread::ThreadProc start " << (uintptr_t)this << " dbconn " << (uintptr_t)blockserve_dbconn;
 
 	threadproc();
 
-	if (TRACE_BLOCKSERVE) BOOST_LOG_TRIVIAL(trace) << "BlockServeThread::ThreadProc end " << (uintptr_t)this << " dbconn " << (uintptr_t)blockserve_dbconn;
+	CCLOG(g_log_block_serve, trace) << "BlockServeThread::ThreadProc end " << (uintptr_t)this << " dbconn " << (uintptr_t)blockserve_dbconn;
 
 	delete blockserve_dbconn;
 }
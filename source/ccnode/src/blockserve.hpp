@@ -15,6 +15,8 @@
 
 #include <CCobjdefs.h>
 
+#define BLOCKSERVE_TIMEOUT		15		// secs; a blocksync client's pre-warmed connections must be used before this
+
 class BlockServeConnection : public CCServer::Connection
 {
 public:
@@ -67,6 +69,11 @@ public:
 	void Start();
 
 	void WaitForShutdown();
+
+	void GetConnectionCounts(unsigned& nincoming, unsigned& noutgoing)
+	{
+		m_service.GetConnectionCounts(nincoming, noutgoing);
+	}
 };
 
 class BlockServeThread : public CCThread
@@ -0,0 +1,244 @@
+/*
+ * CredaCash (TM) cryptocurrency and blockchain
+ *
+ * Copyright (C) 2015-2016 Creda Software, Inc.
+ *
+ * blocksigs.cpp
+*/
+
+#include "CCdef.h"
+#include "blocksigs.hpp"
+#include "blockchain.hpp"
+#include "metrics.hpp"
+
+#include <ed25519/ed25519.h>
+
+#define BLOCKSIGS_BATCH_MAX		64		// ed25519_sign_open_batch combines at most this many signatures at a time
+#define BLOCKSIGS_BATCH_MIN		16		// don't hand a worker fewer than this; below it, the queue handoff costs more than it saves
+
+BlockSigVerifier g_blocksigs;
+
+static MetricCounter s_batch_verified("blocksigs.verified");
+static MetricCounter s_batch_failed("blocksigs.failed");
+static MetricCounter s_batch_skipped("blocksigs.skipped");
+static MetricHistogram s_batch_usec("blocksigs.batch_usec");
+
+void BlockSigVerifier::Init()
+{
+	if (g_params.block_sig_threads <= 0)
+		return;
+
+	m_threads.reserve(g_params.block_sig_threads);
+
+	for (int i = 0; i < g_params.block_sig_threads && !g_shutdown; ++i)
+	{
+		auto t = new thread(&BlockSigVerifier::ThreadProc, this);
+		m_threads.push_back(t);
+	}
+}
+
+void BlockSigVerifier::DeInit()
+{
+	CCLOG(g_log_block_validation, trace) << "BlockSigVerifier::DeInit";
+
+	{
+		lock_guard<mutex> lock(m_mutex);
+
+		m_stop = true;
+	}
+
+	m_work_cv.notify_all();
+
+	for (auto t : m_threads)
+	{
+		t->join();
+		delete t;
+	}
+
+	m_threads.clear();
+
+	CCLOG(g_log_block_validation, trace) << "BlockSigVerifier::DeInit done";
+}
+
+void BlockSigVerifier::ThreadProc()
+{
+	CCLOG(g_log_block_validation, trace) << "BlockSigVerifier::ThreadProc start";
+
+	unique_lock<mutex> lock(m_mutex);
+
+	while (true)
+	{
+		while (m_queue.empty() && !m_stop)
+			m_work_cv.wait(lock);
+
+		if (m_stop)
+			break;
+
+		RunChunk(lock);
+	}
+
+	CCLOG(g_log_block_validation, trace) << "BlockSigVerifier::ThreadProc end";
+}
+
+// takes the next chunk off the queue and verifies it with m_mutex released
+
+void BlockSigVerifier::RunChunk(unique_lock<mutex>& lock)
+{
+	auto chunk = m_queue.front();
+	m_queue.pop_front();
+
+	lock.unlock();
+
+	VerifyChunk(chunk);
+
+	lock.lock();
+
+	if (!--chunk.batch->npending)
+		m_done_cv.notify_all();
+}
+
+void BlockSigVerifier::VerifyChunk(const Chunk& chunk)
+{
+	auto n = chunk.end - chunk.begin;
+
+	const unsigned char *m[BLOCKSIGS_BATCH_MAX];
+	size_t mlen[BLOCKSIGS_BATCH_MAX];
+	const unsigned char *pk[BLOCKSIGS_BATCH_MAX];
+	const unsigned char *rs[BLOCKSIGS_BATCH_MAX];
+	int valid[BLOCKSIGS_BATCH_MAX];
+
+	CCASSERT(n <= BLOCKSIGS_BATCH_MAX);
+
+	for (unsigned i = 0; i < n; ++i)
+	{
+		auto& entry = chunk.batch->entries[chunk.begin + i];
+
+		m[i] = (const unsigned char*)&entry.data;
+		mlen[i] = sizeof(entry.data);
+		pk[i] = entry.pubkey;
+		rs[i] = entry.signature;
+	}
+
+	// when the batch as a whole doesn't verify, ed25519_sign_open_batch checks each signature individually to fill in valid[]
+
+	ed25519_sign_open_batch(m, mlen, pk, rs, n, valid);
+
+	unsigned nvalid = 0;
+
+	for (unsigned i = 0; i < n; ++i)
+	{
+		if (valid[i])
+		{
+			chunk.batch->entries[chunk.begin + i].auxp->sig_verified = true;
+			++nvalid;
+		}
+	}
+
+	s_batch_verified.Add(nvalid);
+	s_batch_failed.Add(n - nvalid);
+}
+
+// blocks must be in chain order, each with SetupAuxBuf and SetOrVerifyOid(true) already done
+// priorobj is the block that precedes blocks[0], or a null SmartBuf if it isn't at hand
+// a block is only checked if the block before it is known, since its prior block hash is part of the signed data
+// returns the number of blocks marked sig_verified
+
+unsigned BlockSigVerifier::VerifyBlocks(SmartBuf priorobj, const vector<SmartBuf>& blocks)
+{
+#if ROTATE_BLOCK_SIGNING_KEYS
+	// the signing keys would have to be taken from each prior block, which hasn't been validated yet
+
+	return 0;
+#endif
+
+	if (blocks.empty())
+		return 0;
+
+	MetricTimer timer(s_batch_usec);
+
+	// without key rotation, every block carries the signing keys copied forward from the genesis block
+
+	auto keysobj = g_blockchain.GetLastIndelibleBlock();
+	if (!keysobj)
+		return 0;
+
+	auto keys_auxp = ((Block*)keysobj.data())->AuxPtr();
+
+	Batch batch;
+	batch.entries.reserve(blocks.size());
+
+	auto prior = priorobj ? (Block*)priorobj.data() : NULL;
+
+	for (auto& smartobj : blocks)
+	{
+		auto block = (Block*)smartobj.data();
+		auto wire = block->WireData();
+		auto auxp = block->AuxPtr();
+
+		if (prior && !memcmp(&wire->prior_oid, prior->OidPtr(), sizeof(ccoid_t)) && wire->witness < MAX_NWITNESSES)
+		{
+			batch.entries.emplace_back();
+			auto& entry = batch.entries.back();
+
+			memcpy(&entry.data.prior_block_hash, &prior->AuxPtr()->block_hash, sizeof(entry.data.prior_block_hash));
+			memcpy(&entry.data.block_hash, &auxp->block_hash, sizeof(entry.data.block_hash));
+			entry.data.block_size = block->BodySize();
+			entry.data.witness = wire->witness;
+
+			entry.pubkey = &keys_auxp->blockchain_params.signing_keys[wire->witness][0];
+			entry.signature = &wire->signature[0];
+			entry.auxp = auxp;
+		}
+		else
+			s_batch_skipped.Add();
+
+		prior = block;
+	}
+
+	unsigned n = batch.entries.size();
+	if (!n)
+		return 0;
+
+	// split the batch so the worker threads and this thread each get a share
+
+	unsigned chunk_size = (n + m_threads.size()) / (m_threads.size() + 1);
+
+	if (chunk_size < BLOCKSIGS_BATCH_MIN)
+		chunk_size = BLOCKSIGS_BATCH_MIN;
+	if (chunk_size > BLOCKSIGS_BATCH_MAX)
+		chunk_size = BLOCKSIGS_BATCH_MAX;
+
+	unique_lock<mutex> lock(m_mutex);
+
+	batch.npending = 0;
+
+	for (unsigned begin = 0; begin < n; begin += chunk_size)
+	{
+		m_queue.push_back(Chunk{&batch, begin, min(begin + chunk_size, n)});
+		++batch.npending;
+	}
+
+	if (batch.npending > 1)
+		m_work_cv.notify_all();
+
+	// this thread works the queue too until its own chunks are done; it may end up running another caller's chunk
+
+	while (batch.npending)
+	{
+		if (!m_queue.empty())
+			RunChunk(lock);
+		else
+			m_done_cv.wait(lock);
+	}
+
+	lock.unlock();
+
+	unsigned nverified = 0;
+
+	for (auto& entry : batch.entries)
+		nverified += entry.auxp->sig_verified;
+
+	CCLOG(g_log_block_validation, debug) << "BlockSigVerifier::VerifyBlocks nblocks " << blocks.size() << " checked " << n << " verified " << nverified;
+
+	return nverified;
+}
@@ -0,0 +1,69 @@
+/*
+ * CredaCash (TM) cryptocurrency and blockchain
+ *
+ * Copyright (C) 2015-2016 Creda Software, Inc.
+ *
+ * blocksigs.hpp
+*/
+
+#pragma once
+
+#include "block.hpp"
+
+#include <SmartBuf.hpp>
+
+#include <thread>
+#include <condition_variable>
+
+// Verifies the witness signatures of a run of consecutive blocks with ed25519 batch verification,
+// spread across a pool of worker threads.  Each block whose signature checks out is marked sig_verified
+// so Block::SignOrVerify can skip the check when ProcessBlock gets to it; a block that fails the batch
+// check is simply left unmarked, so ProcessBlock verifies it individually and rejects it as usual.
+
+class BlockSigVerifier
+{
+	struct Entry
+	{
+		BlockSignedData data;
+		const uint8_t *pubkey;
+		const uint8_t *signature;
+		BlockAux *auxp;
+	};
+
+	struct Batch
+	{
+		vector<Entry> entries;
+		unsigned npending;		// chunks not yet verified; guarded by m_mutex
+	};
+
+	struct Chunk
+	{
+		Batch *batch;
+		unsigned begin;
+		unsigned end;
+	};
+
+	vector<thread *> m_threads;
+
+	mutex m_mutex;
+	condition_variable m_work_cv;
+	condition_variable m_done_cv;
+	deque<Chunk> m_queue;
+	bool m_stop;
+
+	void ThreadProc();
+	void RunChunk(unique_lock<mutex>& lock);
+	static void VerifyChunk(const Chunk& chunk);
+
+public:
+	BlockSigVerifier()
+	 :	m_stop(false)
+	{ }
+
+	void Init();
+	void DeInit();
+
+	unsigned VerifyBlocks(SmartBuf priorobj, const vector<SmartBuf>& blocks);
+};
+
+extern BlockSigVerifier g_blocksigs;
@@ -11,10 +11,12 @@
 #include "block.hpp"
 #include "blockchain.hpp"
 #include "processblock.hpp"
+#include "blocksigs.hpp"
 #include "transact.hpp"
 #include "hostdir.hpp"
 #include "expire.hpp"
 #include "dbconn.hpp"
+#include "metrics.hpp"
 #include "util.h"
 
 #include <CCobjects.hpp>
@@ -27,30 +29,53 @@
 
 #include <utility>
 
-#define TRACE_BLOCKSYNC		(g_params.trace_block_sync)
-
 #define BLOCKSYNC_TIMEOUT			20
 #define BLOCKSYNC_BYTES_PER_SEC		500
 
 #define BLOCKSYNC_LOST_SECS			120
 #define BLOCKSYNC_FINISH_CONNS		5
 
-#define BLOCKSYNC_NLEVELS_PER_REQ	10
+// each request is also a batch for block signature verification
+
+#define BLOCKSYNC_FIRST_LEVELS_PER_REQ	16	// request size before a connection's throughput is known
+#define BLOCKSYNC_MIN_LEVELS_PER_REQ	4
+#define BLOCKSYNC_MAX_LEVELS_PER_REQ	128
+#define BLOCKSYNC_REQ_TARGET_SECS		8	// requests are sized to take about this long at the connection's measured throughput
+#define BLOCKSYNC_STALL_SECS			5	// the lowest missing level is re-requested from another peer when its peer sends nothing for this long
+#define BLOCKSYNC_SLOW_RATIO			2	// a free connection steals from a peer it is this many times faster than
+#define BLOCKSYNC_STEAL_WINDOW			(2*BLOCKSYNC_MAX_LEVELS_PER_REQ)	// only ranges this close to the lowest missing level are stolen
+#define BLOCKSYNC_SMOOTHING				0.5f
+
+static MetricCounter s_levels_duplicated("blocksync.levels_duplicated");
+static MetricCounter s_levels_stolen("blocksync.levels_stolen");
+static MetricCounter s_levels_requeued("blocksync.levels_requeued");
+static MetricCounter s_blocks_dropped("blocksync.blocks_dropped");
 
 thread_local DbConn *blocksync_dbconn;
 
+CCLockSite BlockSyncList::s_lock_site("block-sync-list");
+
 void BlockSyncConnection::StartConnection()
 {
-	if (TRACE_BLOCKSYNC) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " BlockSyncConnection::StartConnection";
+	CCLOG(g_log_block_sync, trace) << Name() << " Conn-" << m_conn_index << " BlockSyncConnection::StartConnection";
 
 	req_msg.entry.nlevels = 0;
 
+	m_received_blocks.clear();
+	m_last_queued_block.ClearRef();
+
+	m_session_bytes = 0;
+	m_levels_per_sec = 0;
+
+	if (m_tor_host.length())
+		g_hostdir.ReportConnected(HostDir::Blockserve, m_tor_host, m_connect_ms);
+
 	SendReq();
 }
 
 void BlockSyncConnection::SendReq()
 {
-	if (TRACE_BLOCKSYNC) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " BlockSyncConnection::SendReq";
+	CCLOG(g_log_block_sync, trace) << Name() << " Conn-" << m_conn_index << " BlockSyncConnection::SendReq";
 
 	if (req_msg.entry.nlevels)
 	{
@@ -59,9 +84,12 @@ void BlockSyncConnection::SendReq()
 		return Stop();
 	}
 
-	req_msg.entry = g_blocksync_client.m_sync_list.GetNextEntry();
+	req_msg.entry = g_blocksync_client.m_sync_list.GetNextEntry(m_conn_index, m_levels_per_sec);
+
+	m_req_nlevels = req_msg.entry.nlevels;
+	m_req_ticks = ccticks();
 
-	if (TRACE_BLOCKSYNC) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " BlockSyncConnection::SendReq requesting level " << req_msg.entry.level << " nlevels " << req_msg.entry.nlevels;
+	CCLOG(g_log_block_sync, trace) << Name() << " Conn-" << m_conn_index << " BlockSyncConnection::SendReq requesting level " << req_msg.entry.level << " nlevels " << req_msg.entry.nlevels;
 
 	WriteAsync("BlockSyncConnection::SendReq", boost::asio::buffer(&req_msg, sizeof(req_msg)),
 			boost::bind(&BlockSyncConnection::HandleSendMsgWrite, this, boost::asio::placeholders::error, AutoCount(this)));
@@ -85,7 +113,7 @@ void BlockSyncConnection::HandleSendMsgWrite(const boost::system::error_code& e,
 		return Stop();
 	}
 
-	if (TRACE_BLOCKSYNC) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " BlockSyncConnection::HandleSendMsgWrite ok";
+	CCLOG(g_log_block_sync, trace) << Name() << " Conn-" << m_conn_index << " BlockSyncConnection::HandleSendMsgWrite ok";
 
 	StartRead();
 
@@ -104,7 +132,15 @@ void BlockSyncConnection::HandleReadComplete()
 	unsigned size = *(uint32_t*)m_pread;
 	unsigned tag = *(uint32_t*)(m_pread + 4);
 
-	if (TRACE_BLOCKSYNC) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " BlockSyncConnection::HandleReadComplete read " << m_nred << " bytes msg size " << size << " tag " << tag;
+	CCLOG(g_log_block_sync, trace) << Name() << " Conn-" << m_conn_index << " BlockSyncConnection::HandleReadComplete read " << m_nred << " bytes msg size " << size << " tag " << tag;
+
+	if (m_request_ticks)
+	{
+		if (m_tor_host.length())
+			g_blocksync_client.m_torpool.RecordFirstByte(m_from_warm_pool, m_request_ticks);
+
+		m_request_ticks = 0;
+	}
 
 	if (size < CC_MSG_HEADER_SIZE || size > CC_BLOCK_MAX_SIZE)
 	{
@@ -151,7 +187,7 @@ void BlockSyncConnection::HandleReadComplete()
 
 	if (m_maxread > m_nred)
 	{
-		if (TRACE_BLOCKSYNC) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " BlockSyncConnection::HandleReadComplete queueing read size " << m_maxread - m_nred;
+		CCLOG(g_log_block_sync, trace) << Name() << " Conn-" << m_conn_index << " BlockSyncConnection::HandleReadComplete queueing read size " << m_maxread - m_nred;
 
 		ReadAsync("BlockSyncConnection::HandleReadComplete", boost::asio::buffer(m_pread + m_nred, m_maxread - m_nred), boost::asio::transfer_exactly(m_maxread - m_nred),
 				boost::bind(&BlockSyncConnection::HandleObjReadComplete, this, boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred, smartobj, AutoCount(this)));
@@ -196,12 +232,11 @@ void BlockSyncConnection::HandleObjReadComplete(const boost::system::error_code&
 		return Stop();
 	}
 
-	if (TRACE_BLOCKSYNC) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " BlockSyncConnection::HandleObjReadComplete read " << m_nred << " bytes msg size " << msgsize;
+	CCLOG(g_log_block_sync, trace) << Name() << " Conn-" << m_conn_index << " BlockSyncConnection::HandleObjReadComplete read " << m_nred << " bytes msg size " << msgsize;
 
-	CCASSERT(msgsize >= CC_MSG_HEADER_SIZE);
+	m_session_bytes += msgsize;
 
-	ccoid_t *prior_oid = NULL;
-	int64_t level = 0;
+	CCASSERT(msgsize >= CC_MSG_HEADER_SIZE);
 
 	auto obj = (CCObject*)smartobj.data();
 
@@ -248,14 +283,16 @@ void BlockSyncConnection::HandleObjReadComplete(const boost::system::error_code&
 
 	block->SetOrVerifyOid(true);
 
-	int64_t priority = 0;
-
-	prior_oid = &wire->prior_oid;
-	level = wire->level;
-
 	BOOST_LOG_TRIVIAL(debug) << Name() << " Conn-" << m_conn_index << " BlockSyncConnection::HandleObjReadComplete received obj bufp " << (uintptr_t)smartobj.BasePtr() << " tag " << obj->ObjTag() << " size " << obj->ObjSize() << " oid " << buf2hex(obj->OidPtr(), sizeof(ccoid_t));
 
-	blocksync_dbconn->ProcessQEnqueueValidate(PROCESS_Q_TYPE_BLOCK, smartobj, prior_oid, level, PROCESS_Q_STATUS_PENDING, priority, m_conn_index, m_use_count.load());
+	if (g_blocksync_client.m_sync_list.BlockReceived(m_conn_index, wire->level))
+		m_received_blocks.push_back(smartobj);
+	else
+	{
+		CCLOG(g_log_block_sync, debug) << Name() << " Conn-" << m_conn_index << " BlockSyncConnection::HandleObjReadComplete dropping block level " << wire->level << " already received from another peer";
+
+		s_blocks_dropped.Add();
+	}
 
 	++req_msg.entry.level;
 	--req_msg.entry.nlevels;
@@ -267,12 +304,47 @@ void BlockSyncConnection::HandleObjReadComplete(const boost::system::error_code&
 		SetTimer(BLOCKSYNC_TIMEOUT);
 	}
 	else
+	{
+		float levels_per_sec = m_req_nlevels * (float)CCTICKS_PER_SEC / max(ccticks_elapsed(m_req_ticks, ccticks()), 1);
+
+		if (!m_levels_per_sec)
+			m_levels_per_sec = levels_per_sec;
+		else
+			m_levels_per_sec += BLOCKSYNC_SMOOTHING * (levels_per_sec - m_levels_per_sec);
+
+		CCLOG(g_log_block_sync, trace) << Name() << " Conn-" << m_conn_index << " BlockSyncConnection::HandleObjReadComplete request of " << m_req_nlevels << " levels done at " << levels_per_sec << " levels/sec; smoothed " << m_levels_per_sec;
+
+		QueueReceivedBlocks(m_use_count.load());
+
 		SendReq();
+	}
+}
+
+// the blocks in a request are held until the request is complete, so their signatures can be checked
+// together in one batch; ProcessBlock then skips the signature check for each block that passed
+
+void BlockSyncConnection::QueueReceivedBlocks(unsigned callback_id)
+{
+	if (m_received_blocks.empty())
+		return;
+
+	g_blocksigs.VerifyBlocks(m_last_queued_block, m_received_blocks);
+
+	for (auto& smartobj : m_received_blocks)
+	{
+		auto wire = ((Block*)smartobj.data())->WireData();
+		int64_t priority = 0;
+
+		blocksync_dbconn->ProcessQEnqueueValidate(PROCESS_Q_TYPE_BLOCK, smartobj, &wire->prior_oid, wire->level, PROCESS_Q_STATUS_PENDING, priority, m_conn_index, callback_id);
+	}
+
+	m_last_queued_block = m_received_blocks.back();
+	m_received_blocks.clear();
 }
 
 bool BlockSyncConnection::SetTimer(unsigned sec)
 {
-	//if (TRACE_BLOCKSYNC) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " BlockSyncConnection::SetTimer " << sec;
+	//CCLOG(g_log_block_sync, trace) << Name() << " Conn-" << m_conn_index << " BlockSyncConnection::SetTimer " << sec;
 
 	auto op_counter = AutoCount();
 	return AsyncTimerWait("BlockSyncConnection::SetTimer", sec*1000, boost::bind(&BlockSyncConnection::HandleTimeout, this, boost::asio::placeholders::error, op_counter), op_counter);
@@ -282,7 +354,7 @@ void BlockSyncConnection::HandleTimeout(const boost::system::error_code& e, Auto
 {
 	if (e == boost::asio::error::operation_aborted)
 	{
-		//if (TRACE_BLOCKSYNC) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " BlockSyncConnection::HandleTimeout " << uintptr_t(this) << " e = " << e << " " << e.message();
+		//CCLOG(g_log_block_sync, trace) << Name() << " Conn-" << m_conn_index << " BlockSyncConnection::HandleTimeout " << uintptr_t(this) << " e = " << e << " " << e.message();
 
 		return;
 	}
@@ -290,21 +362,30 @@ void BlockSyncConnection::HandleTimeout(const boost::system::error_code& e, Auto
 	if (g_shutdown)
 		return;
 
-	if (TRACE_BLOCKSYNC) BOOST_LOG_TRIVIAL(info) << Name() << " Conn-" << m_conn_index << " BlockSyncConnection::HandleTimeout " << uintptr_t(this) << " e = " << e << " " << e.message();
+	CCLOG(g_log_block_sync, info) << Name() << " Conn-" << m_conn_index << " BlockSyncConnection::HandleTimeout " << uintptr_t(this) << " e = " << e << " " << e.message();
 
 	Stop();
 }
 
 void BlockSyncConnection::FinishConnection()
 {
-	if (TRACE_BLOCKSYNC) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " BlockSyncConnection::FinishConnection";
+	CCLOG(g_log_block_sync, trace) << Name() << " Conn-" << m_conn_index << " BlockSyncConnection::FinishConnection";
 
-	if (req_msg.entry.nlevels)
-	{
-		g_blocksync_client.m_sync_list.RequeueEntry(req_msg.entry);
+	// the server stops sending partway through a request when it runs out of indelible blocks, so queue what was received
+	// m_use_count has already been incremented, so the prior value is passed to have the validation callbacks ignored
 
-		req_msg.entry.nlevels = 0;
-	}
+	if (!g_shutdown)
+		QueueReceivedBlocks(m_use_count.load() - 1);
+
+	m_received_blocks.clear();
+	m_last_queued_block.ClearRef();
+
+	g_blocksync_client.m_sync_list.RequeueEntry(m_conn_index);
+
+	req_msg.entry.nlevels = 0;
+
+	if (m_tor_host.length())
+		g_hostdir.ReportSession(HostDir::Blockserve, m_tor_host, m_connect_ms, m_session_bytes, m_connect_ms < 0 ? 0 : ccticks_elapsed(m_connect_ticks, ccticks()) - m_connect_ms);
 }
 
 void BlockSyncClient::Start()
@@ -314,13 +395,13 @@ void BlockSyncClient::Start()
 
 	g_hostdir.Init();
 
-	if (TRACE_BLOCKSYNC) BOOST_LOG_TRIVIAL(trace) << Name() << " BlockSyncClient port " << port;
+	CCLOG(g_log_block_sync, trace) << Name() << " BlockSyncClient port " << port;
 
 	// unsigned conn_nreadbuf, unsigned conn_nwritebuf, unsigned sock_nreadbuf, unsigned sock_nwritebuf, unsigned headersize, bool noclose, bool bregister
 	CCServer::ConnectionFactoryInstantiation<BlockSyncConnection> connfac(CC_MAX_MSG_SIZE + 2, 0, -1, -1, CC_MSG_HEADER_SIZE, 1, 1);
 	CCThreadFactoryInstantiation<BlockSyncThread> threadfac;
 
-	unsigned maxconns = (unsigned)(max_inconns + max_outconns);
+	unsigned maxconns = (unsigned)(max_inconns + max_outconns + warm_conns);
 	unsigned nthreads = maxconns * threads_per_conn;
 
 	// unsigned nthreads, unsigned maxconns, unsigned maxincoming, unsigned backlog
@@ -366,39 +447,231 @@ uint64_t BlockSyncList::Init()
 	lock_guard<FastSpinLock> lock(m_lock);
 
 	m_list.clear();
+	m_assigned.clear();
+	m_received.clear();
 	m_next_level = g_blockchain.GetLastIndelibleLevel() + 1;
+	m_base = m_next_level;
 
 	return m_next_level;
 }
 
-class BlockSyncEntry BlockSyncList::GetNextEntry()
+bool BlockSyncList::IsReceived(uint64_t level) const
+{
+	return level < m_base || m_received.count(level);
+}
+
+bool BlockSyncList::IsAssigned(uint64_t level, unsigned except_conn) const
+{
+	for (auto& a : m_assigned)
+	{
+		if (a.conn_index != except_conn && level >= a.next && level < a.end)
+			return true;
+	}
+
+	return false;
+}
+
+// removes a connection's assignment, and requeues the levels in it that haven't been received and aren't assigned to another connection
+
+void BlockSyncList::Release(unsigned conn_index)
+{
+	for (unsigned i = 0; i < m_assigned.size(); ++i)
+	{
+		auto& a = m_assigned[i];
+
+		if (a.conn_index != conn_index)
+			continue;
+
+		for (auto level = a.next; level < a.end; )
+		{
+			if (IsReceived(level) || IsAssigned(level, conn_index))
+			{
+				++level;
+				continue;
+			}
+
+			auto start = level;
+
+			while (level < a.end && level - start < BLOCKSYNC_MAX_LEVELS_PER_REQ && !IsReceived(level) && !IsAssigned(level, conn_index))
+				++level;
+
+			CCLOG(g_log_block_sync, trace) << "BlockSyncList::Release Conn-" << conn_index << " requeueing level " << start << " nlevels " << level - start;
+
+			m_list.push_back(BlockSyncEntry(start, level - start));
+
+			s_levels_requeued.Add(level - start);
+		}
+
+		m_assigned[i] = m_assigned.back();
+		m_assigned.pop_back();
+
+		return;
+	}
+}
+
+class BlockSyncEntry BlockSyncList::Assign(unsigned conn_index, float levels_per_sec, uint64_t level, unsigned nlevels)
+{
+	Assignment a;
+
+	a.conn_index = conn_index;
+	a.next = level;
+	a.end = level + nlevels;
+	a.levels_per_sec = levels_per_sec;
+	a.last_ticks = ccticks();
+
+	m_assigned.push_back(a);
+
+	return BlockSyncEntry(level, nlevels);
+}
+
+class BlockSyncEntry BlockSyncList::GetNextEntry(unsigned conn_index, float levels_per_sec)
 {
 	lock_guard<FastSpinLock> lock(m_lock);
 
-	if (!m_list.empty())
+	Release(conn_index);
+
+	unsigned nlevels = BLOCKSYNC_FIRST_LEVELS_PER_REQ;
+
+	if (levels_per_sec)
+		nlevels = max(BLOCKSYNC_MIN_LEVELS_PER_REQ, min(BLOCKSYNC_MAX_LEVELS_PER_REQ, (int)(levels_per_sec * BLOCKSYNC_REQ_TARGET_SECS)));
+
+	auto now = ccticks();
+
+	// if the peer holding the lowest missing level has stalled, or this connection is much faster, request it again here
+
+	for (auto& a : m_assigned)
 	{
-		auto rv = m_list.front();
-		m_list.pop_front();
+		if (m_base < a.next || m_base >= a.end)
+			continue;
+
+		bool stalled = ccticks_elapsed(a.last_ticks, now) > BLOCKSYNC_STALL_SECS * CCTICKS_PER_SEC;
+		bool slower = (levels_per_sec && a.levels_per_sec && levels_per_sec > BLOCKSYNC_SLOW_RATIO * a.levels_per_sec);
+
+		if (!stalled && !slower)
+			break;
+
+		bool covered = false;
+
+		for (auto& b : m_assigned)
+		{
+			if (&b != &a && m_base >= b.next && m_base < b.end)
+				covered = true;
+		}
+
+		if (covered)
+			break;
+
+		unsigned n = 0;
+		while (n < nlevels && m_base + n < a.end && !IsReceived(m_base + n))
+			++n;
 
-		return rv;
+		CCLOG(g_log_block_sync, debug) << "BlockSyncList::GetNextEntry Conn-" << conn_index << " re-requesting level " << m_base << " nlevels " << n << " from Conn-" << a.conn_index << (stalled ? " stalled" : " slower");
+
+		s_levels_duplicated.Add(n);
+
+		return Assign(conn_index, levels_per_sec, m_base, n);
+	}
+
+	// next, the lowest range requeued after a connection failed
+
+	while (!m_list.empty())
+	{
+		auto it = m_list.begin();
+		for (auto jt = m_list.begin(); jt != m_list.end(); ++jt)
+		{
+			if (jt->level < it->level)
+				it = jt;
+		}
+
+		auto entry = *it;
+		m_list.erase(it);
+
+		while (entry.nlevels && (IsReceived(entry.level) || IsAssigned(entry.level, conn_index)))
+		{
+			++entry.level;
+			--entry.nlevels;
+		}
+
+		if (!entry.nlevels)
+			continue;
+
+		if (entry.nlevels > nlevels)
+		{
+			m_list.push_back(BlockSyncEntry(entry.level + nlevels, entry.nlevels - nlevels));
+			entry.nlevels = nlevels;
+		}
+
+		return Assign(conn_index, levels_per_sec, entry.level, entry.nlevels);
+	}
+
+	// next, the unfinished tail of the lowest range held by a stalled or much slower peer
+
+	for (auto& a : m_assigned)
+	{
+		if (a.next >= m_base + BLOCKSYNC_STEAL_WINDOW || a.end < a.next + 2 * BLOCKSYNC_MIN_LEVELS_PER_REQ)
+			continue;
+
+		bool stalled = ccticks_elapsed(a.last_ticks, now) > BLOCKSYNC_STALL_SECS * CCTICKS_PER_SEC;
+		bool slower = (levels_per_sec && a.levels_per_sec && levels_per_sec > BLOCKSYNC_SLOW_RATIO * a.levels_per_sec);
+
+		if (!stalled && !slower)
+			continue;
+
+		// a stalled peer loses the larger part of its range, a slower one half
+
+		auto split = a.next + (a.end - a.next) / (stalled ? 4 : 2);
+		split = max(split, a.end - nlevels);
+
+		CCLOG(g_log_block_sync, debug) << "BlockSyncList::GetNextEntry Conn-" << conn_index << " stealing level " << split << " nlevels " << a.end - split << " from Conn-" << a.conn_index << (stalled ? " stalled" : " slower");
+
+		s_levels_stolen.Add(a.end - split);
+
+		auto end = a.end;
+		a.end = split;
+
+		return Assign(conn_index, levels_per_sec, split, end - split);
 	}
 
 	//--m_next_level;	// for testing
 
-	auto rv = BlockSyncEntry(m_next_level, BLOCKSYNC_NLEVELS_PER_REQ);
-	m_next_level += BLOCKSYNC_NLEVELS_PER_REQ;
+	auto level = m_next_level;
+	m_next_level += nlevels;
 
-	return rv;
+	return Assign(conn_index, levels_per_sec, level, nlevels);
 }
 
-void BlockSyncList::RequeueEntry(class BlockSyncEntry& entry)
+// returns true if this is the first time the level was received
+
+bool BlockSyncList::BlockReceived(unsigned conn_index, uint64_t level)
 {
-	if (entry.nlevels)
-	{
-		lock_guard<FastSpinLock> lock(m_lock);
+	lock_guard<FastSpinLock> lock(m_lock);
 
-		m_list.push_back(entry);
+	for (auto& a : m_assigned)
+	{
+		if (a.conn_index == conn_index)
+		{
+			a.next = max(a.next, level + 1);
+			a.last_ticks = ccticks();
+			break;
+		}
 	}
+
+	if (IsReceived(level))
+		return false;
+
+	m_received.insert(level);
+
+	while (m_received.count(m_base))
+		m_received.erase(m_base++);
+
+	return true;
+}
+
+void BlockSyncList::RequeueEntry(unsigned conn_index)
+{
+	lock_guard<FastSpinLock> lock(m_lock);
+
+	Release(conn_index);
 }
 
 void BlockSyncClient::DoSync()
@@ -417,26 +690,30 @@ void BlockSyncClient::DoSync()
 	{
 		unsigned outcount = m_service.GetServer(si).GetConnectionManager().GetOutgoingConnectionCount();
 
-		if (TRACE_BLOCKSYNC) BOOST_LOG_TRIVIAL(trace) << Name() << " BlockSyncClient::DoSync currently " << outcount << " outgoing connections";
+		CCLOG(g_log_block_sync, trace) << Name() << " BlockSyncClient::DoSync currently " << outcount << " outgoing connections";
 
 		if ((int)outcount < max_outconns)
 			ConnectOutgoing();
 
+		m_torpool.Maintain(m_service.GetServer(si), warm_conns, warm_conn_secs);
+
 		ccsleep(4);
 
 		auto finished = m_conns_finished.load();
 
-		if (TRACE_BLOCKSYNC) BOOST_LOG_TRIVIAL(trace) << Name() << " BlockSyncClient::DoSync currently " << finished << " connections finished";
+		CCLOG(g_log_block_sync, trace) << Name() << " BlockSyncClient::DoSync currently " << finished << " connections finished";
 
 		if (finished >= BLOCKSYNC_FINISH_CONNS)
 			break;
 	}
 
+	m_service.GetServer(si).GetConnectionManager().ExpireWarmConnections(0);	// the pool is only kept during a sync
+
 	while (!g_shutdown)
 	{
 		unsigned outcount = m_service.GetServer(si).GetConnectionManager().GetOutgoingConnectionCount();
 
-		if (TRACE_BLOCKSYNC) BOOST_LOG_TRIVIAL(trace) << Name() << " BlockSyncClient::DoSync finishing sync currently " << outcount << " outgoing connections";
+		CCLOG(g_log_block_sync, trace) << Name() << " BlockSyncClient::DoSync finishing sync currently " << outcount << " outgoing connections";
 
 		if (!outcount)
 			break;
@@ -451,20 +728,9 @@ void BlockSyncClient::DoSync()
 
 void BlockSyncClient::ConnectOutgoing()
 {
-	if (TRACE_BLOCKSYNC) BOOST_LOG_TRIVIAL(info) << Name() << " BlockSyncClient::ConnectOutgoing calling GetHostName()";
-
-	auto peer = g_hostdir.GetHostName(HostDir::Blockserve);
-
-	if (!peer.size())
-	{
-		BOOST_LOG_TRIVIAL(info) << Name() << " BlockSyncClient::ConnectOutgoing no blockchain servers found";
-
-		return;
-	}
-
-	if (TRACE_BLOCKSYNC) BOOST_LOG_TRIVIAL(info) << Name() << " BlockSyncClient::ConnectOutgoing connecting to " << peer;
+	CCLOG(g_log_block_sync, info) << Name() << " BlockSyncClient::ConnectOutgoing";
 
-	m_service.GetServer(0).ConnectThruTor(peer, g_params.torproxy_port);
+	m_torpool.Connect(m_service.GetServer(0), warm_conn_secs, Name());
 }
 
 void BlockSyncClient::WaitForShutdown()
@@ -482,11 +748,11 @@ void BlockSyncThread::ThreadProc(boost::function<void()> threadproc)
 {
 	blocksync_dbconn = new DbConn;
 
-	if (TRACE_BLOCKSYNC) BOOST_LOG_TRIVIAL(trace) << "BlockSyncThread::ThreadProc start " << (uintptr_t)this << " dbconn " << (uintptr_t)blocksync_dbconn;
+	CCLOG(g_log_block_sync, trace) << "BlockSyncThread::ThreadProc start " << (uintptr_t)this << " dbconn " << (uintptr_t)blocksync_dbconn;
 
 	threadproc();
 
-	if (TRACE_BLOCKSYNC) BOOST_LOG_TRIVIAL(trace) << "BlockSyncThread::ThreadProc end " << (uintptr_t)this << " dbconn " << (uintptr_t)blocksync_dbconn;
+	CCLOG(g_log_block_sync, trace) << "BlockSyncThread::ThreadProc end " << (uintptr_t)this << " dbconn " << (uintptr_t)blocksync_dbconn;
 
 	delete blocksync_dbconn;
 }
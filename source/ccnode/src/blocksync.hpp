@@ -12,9 +12,12 @@
 #include <ccserver/connection.hpp>
 
 #include "service_base.hpp"
+#include "torpool.hpp"
 
 #include <CCobjdefs.h>
 
+#include <set>
+
 #pragma pack(push, 1)
 
 class BlockSyncEntry
@@ -45,18 +48,50 @@ public:
 
 #pragma pack(pop)
 
+// Hands out the ranges of levels requested by the block sync connections.
+// Each connection reports its throughput, and the size of its next range is set from it.
+// A connection that becomes free first re-requests the lowest missing level if the peer it was assigned to has stalled,
+// then takes a range that was requeued when a connection failed, then steals the unfinished tail of a slow peer's range,
+// and only then starts a new range, so the sync rate follows the fastest peers.
+// A peer can't be told to stop partway through a request, so BlockReceived drops the blocks that another peer delivered first.
+
 class BlockSyncList
 {
-	deque<BlockSyncEntry> m_list;
-	uint64_t m_next_level;
+	struct Assignment
+	{
+		unsigned conn_index;
+		uint64_t next;				// next level expected from this connection
+		uint64_t end;				// one past the last level wanted from this connection; reduced when the tail is stolen
+		float levels_per_sec;		// connection throughput measured on its prior requests, 0 = unknown
+		uint32_t last_ticks;		// time of the request or the last block received
+	};
+
+	deque<BlockSyncEntry> m_list;	// ranges requeued after a connection failed
+	vector<Assignment> m_assigned;
+	set<uint64_t> m_received;		// levels received above m_base
+	uint64_t m_base;				// lowest level not yet received
+	uint64_t m_next_level;			// lowest level not yet assigned
 
 	FastSpinLock m_lock;
+	static CCLockSite s_lock_site;
+
+	bool IsReceived(uint64_t level) const;
+	bool IsAssigned(uint64_t level, unsigned except_conn) const;
+	void Release(unsigned conn_index);
+	class BlockSyncEntry Assign(unsigned conn_index, float levels_per_sec, uint64_t level, unsigned nlevels);
 
 public:
+	BlockSyncList()
+	 :	m_base(0),
+		m_next_level(0),
+		m_lock(s_lock_site)
+	{ }
+
 	uint64_t Init();
 
-	class BlockSyncEntry GetNextEntry();
-	void RequeueEntry(class BlockSyncEntry& entry);
+	class BlockSyncEntry GetNextEntry(unsigned conn_index, float levels_per_sec);
+	bool BlockReceived(unsigned conn_index, uint64_t level);
+	void RequeueEntry(unsigned conn_index);
 };
 
 
@@ -64,12 +99,24 @@ class BlockSyncConnection : public CCServer::Connection
 {
 public:
 	BlockSyncConnection(class CCServer::ConnectionManager& manager, boost::asio::io_service& io_service, const class CCServer::ConnectionFactory& connfac)
-	 :	CCServer::Connection(manager, io_service, connfac)
+	 :	CCServer::Connection(manager, io_service, connfac),
+		m_session_bytes(0),
+		m_req_nlevels(0),
+		m_req_ticks(0),
+		m_levels_per_sec(0)
 	{ }
 
 private:
 
+	uint64_t m_session_bytes;			// bytes received this session, reported to g_hostdir
+
 	class BlockSyncMsg req_msg;
+	uint16_t m_req_nlevels;				// size of the current request
+	uint32_t m_req_ticks;				// time the current request was sent
+	float m_levels_per_sec;				// smoothed throughput of this session, 0 until the first request completes
+
+	vector<SmartBuf> m_received_blocks;	// blocks read for the current request that haven't been queued for validation yet
+	SmartBuf m_last_queued_block;		// last block queued, which is the prior of m_received_blocks[0] when ranges run consecutively
 
 	void StartConnection();
 
@@ -79,6 +126,7 @@ private:
 	void HandleReadComplete();
 
 	void HandleObjReadComplete(const boost::system::error_code& e, size_t bytes_transferred, SmartBuf smartobj, AutoCount pending_op_counter);
+	void QueueReceivedBlocks(unsigned callback_id);
 
 	bool SetTimer(unsigned sec);
 	void HandleTimeout(const boost::system::error_code& e, AutoCount pending_op_counter);
@@ -104,7 +152,8 @@ public:
 	BlockSyncClient(string n, string s)
 	 :	ServiceBase(n, s),
 		m_service(n),
-		m_conns_finished(0)
+		m_conns_finished(0),
+		m_torpool(HostDir::Blockserve)
 	{ }
 
 	void ConfigPreset()
@@ -122,6 +171,13 @@ public:
 
 	void WaitForShutdown();
 
+	void GetConnectionCounts(unsigned& nincoming, unsigned& noutgoing)
+	{
+		m_service.GetConnectionCounts(nincoming, noutgoing);
+	}
+
+	TorPool m_torpool;
+
 	class BlockSyncList m_sync_list;
 };
 
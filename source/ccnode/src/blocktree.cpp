@@ -0,0 +1,231 @@
+/*
+ * CredaCash (TM) cryptocurrency and blockchain
+ *
+ * Copyright (C) 2015-2016 Creda Software, Inc.
+ *
+ * blocktree.cpp
+*/
+
+#include "CCdef.h"
+#include "blocktree.hpp"
+
+#include <algorithm>
+
+#define TRACE_BLOCKTREE	(g_params.trace_witness)
+
+BlockTree g_blocktree;
+
+void BlockTree::Add(SmartBuf smartobj)
+{
+	auto block = (Block*)smartobj.data();
+	auto wire = block->WireData();
+	auto auxp = block->AuxPtr();
+
+	CCASSERT(wire->witness < MAX_NWITNESSES);
+
+	lock_guard<mutex> lock(m_mutex);
+
+	if (m_by_oid.count(auxp->oid))
+		return;
+
+	auto node = new Node(smartobj);
+	auto key = make_pair(wire->level, auxp->oid);
+
+	m_by_oid[auxp->oid] = node;
+	m_by_level[key] = node;
+	m_by_witness[wire->witness][key] = node;
+
+	++m_ntips;
+
+	auto it = m_by_oid.find(wire->prior_oid);
+
+	if (it != m_by_oid.end())
+	{
+		node->prior = it->second;
+
+		if (node->prior->children.empty())
+			--m_ntips;
+
+		node->prior->children.push_back(node);
+	}
+
+	if (TRACE_BLOCKTREE) BOOST_LOG_TRIVIAL(trace) << "BlockTree::Add level " << wire->level << " witness " << (unsigned)wire->witness << " oid " << buf2hex(&auxp->oid, sizeof(ccoid_t)) << " prior " << (node->prior ? "linked" : "not in tree") << " nblocks " << m_by_oid.size() << " ntips " << m_ntips;
+}
+
+void BlockTree::Remove(Node *node)
+{
+	auto block = (Block*)node->smartobj.data();
+	auto wire = block->WireData();
+	auto auxp = block->AuxPtr();
+
+	auto key = make_pair(wire->level, auxp->oid);
+
+	m_by_oid.erase(auxp->oid);
+	m_by_level.erase(key);
+	m_by_witness[wire->witness].erase(key);
+
+	if (node->children.empty())
+		--m_ntips;
+
+	for (auto child : node->children)
+		child->prior = NULL;
+
+	if (node->prior)
+	{
+		auto& siblings = node->prior->children;
+
+		siblings.erase(remove(siblings.begin(), siblings.end(), node), siblings.end());
+
+		if (siblings.empty())
+			++m_ntips;
+	}
+
+	delete node;
+}
+
+// removes all blocks with level < level, matching ProcessQPruneLevel and ProcessQDone
+
+void BlockTree::Prune(uint64_t level)
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	unsigned count = 0;
+
+	while (!m_by_level.empty())
+	{
+		auto it = m_by_level.end();
+		--it;
+
+		if (it->first.first >= level)
+			break;
+
+		Remove(it->second);
+
+		++count;
+	}
+
+	if (TRACE_BLOCKTREE && count) BOOST_LOG_TRIVIAL(trace) << "BlockTree::Prune level " << level << " removed " << count << " nblocks " << m_by_oid.size() << " ntips " << m_ntips;
+}
+
+void BlockTree::Clear()
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	for (auto& entry : m_by_oid)
+		delete entry.second;
+
+	m_by_oid.clear();
+	m_by_level.clear();
+
+	for (auto& by_witness : m_by_witness)
+		by_witness.clear();
+
+	m_ntips = 0;
+}
+
+void BlockTree::GetStats(uint64_t& nblocks, uint64_t& ntips)
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	nblocks = m_by_oid.size();
+	ntips = m_ntips;
+}
+
+uint64_t BlockTree::OwnScore(Node *node, SmartBuf last_indelible_block, uint16_t genstamp)
+{
+	if (!genstamp || node->score_genstamp != genstamp)
+	{
+		node->score_genstamp = genstamp;
+		node->build_witness = -1;
+
+		auto block = (Block*)node->smartobj.data();
+
+		node->own_score = block->CalcSkipScore(-1, last_indelible_block, genstamp, false);
+	}
+
+	return node->own_score;
+}
+
+uint64_t BlockTree::BuildScore(Node *node, int witness_index, SmartBuf last_indelible_block, uint16_t genstamp)
+{
+	if (!genstamp || node->score_genstamp != genstamp)
+		OwnScore(node, last_indelible_block, genstamp);
+
+	if (node->build_witness != witness_index)
+	{
+		auto block = (Block*)node->smartobj.data();
+
+		node->build_score = block->CalcSkipScore(witness_index, last_indelible_block, genstamp, false);
+		node->build_witness = witness_index;
+	}
+
+	return node->build_score;
+}
+
+bool BlockTree::BadSigOrder(Node *node, int witness_index)
+{
+	// depends only on the block and its priors, which never change
+
+	if (node->bad_sig_order_witness != witness_index)
+	{
+		auto block = (Block*)node->smartobj.data();
+
+		node->bad_sig_order = block->CheckBadSigOrder(witness_index);
+		node->bad_sig_order_witness = witness_index;
+	}
+
+	return node->bad_sig_order;
+}
+
+uint64_t BlockTree::FindBestOwnScore(int witness_index, SmartBuf last_indelible_block, uint16_t genstamp)
+{
+	CCASSERT(witness_index >= 0 && witness_index < MAX_NWITNESSES);
+
+	lock_guard<mutex> lock(m_mutex);
+
+	uint64_t bestscore = 0;
+
+	for (auto& entry : m_by_witness[witness_index])
+	{
+		auto score = OwnScore(entry.second, last_indelible_block, genstamp);
+		if (score > bestscore)
+			bestscore = score;
+	}
+
+	return bestscore;
+}
+
+// returns the valid block with level >= min_level that gives witness_index the highest score above bestscore
+
+SmartBuf BlockTree::FindBestBuildingBlock(int witness_index, SmartBuf last_indelible_block, uint16_t genstamp, uint64_t min_level, uint64_t& bestscore)
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	SmartBuf bestobj;
+	unsigned nscanned = 0;
+
+	for (auto& entry : m_by_level)
+	{
+		if (entry.first.first < min_level)
+			break;
+
+		++nscanned;
+
+		auto node = entry.second;
+
+		if (BadSigOrder(node, witness_index))
+			continue;
+
+		auto score = BuildScore(node, witness_index, last_indelible_block, genstamp);
+
+		if (score > bestscore)
+		{
+			bestobj = node->smartobj;
+			bestscore = score;
+		}
+	}
+
+	if (TRACE_BLOCKTREE) BOOST_LOG_TRIVIAL(trace) << "BlockTree::FindBestBuildingBlock witness " << witness_index << " min level " << min_level << " scanned " << nscanned << " of " << m_by_level.size() << " blocks, ntips " << m_ntips;
+
+	return bestobj;
+}
@@ -0,0 +1,100 @@
+/*
+ * CredaCash (TM) cryptocurrency and blockchain
+ *
+ * Copyright (C) 2015-2016 Creda Software, Inc.
+ *
+ * blocktree.hpp
+*/
+
+#pragma once
+
+#include "block.hpp"
+
+#include <SmartBuf.hpp>
+
+#include <map>
+
+// In-memory index of the valid delible blocks that the witness can build on.
+// It mirrors the blocks with status PROCESS_Q_STATUS_VALID in the block Process_Q:
+// blocks are added when they become valid and removed when the Process_Q is pruned by level.
+// Each node links to its prior block and to its children, and caches its skip scores
+// for the current score genstamp, so that choosing a building block does not have to
+// page through the Process_Q or recompute scores for blocks that have not changed.
+
+class BlockTree
+{
+	struct Node
+	{
+		SmartBuf smartobj;
+		Node *prior;
+		vector<Node*> children;
+
+		uint16_t score_genstamp;
+		uint64_t own_score;			// CalcSkipScore with no top witness
+		uint64_t build_score;		// CalcSkipScore with this node's witness as top witness
+		int build_witness;
+		int bad_sig_order_witness;
+		bool bad_sig_order;
+
+		Node(SmartBuf obj)
+		 :	smartobj(obj),
+			prior(NULL),
+			score_genstamp(0),
+			own_score(0),
+			build_score(0),
+			build_witness(-1),
+			bad_sig_order_witness(-1),
+			bad_sig_order(false)
+		{ }
+	};
+
+	// ordered by level descending, then oid, which is the order the Process_Q select returns valid blocks
+
+	struct KeyCompare
+	{
+		bool operator()(const pair<uint64_t, ccoid_t>& a, const pair<uint64_t, ccoid_t>& b) const
+		{
+			if (a.first != b.first)
+				return a.first > b.first;
+
+			return a.second < b.second;
+		}
+	};
+
+	typedef map<pair<uint64_t, ccoid_t>, Node*, KeyCompare> level_map_t;
+
+	mutex m_mutex;
+
+	map<ccoid_t, Node*> m_by_oid;
+	level_map_t m_by_level;
+	array<level_map_t, MAX_NWITNESSES> m_by_witness;
+
+	uint64_t m_ntips;
+
+	uint64_t OwnScore(Node *node, SmartBuf last_indelible_block, uint16_t genstamp);
+	uint64_t BuildScore(Node *node, int witness_index, SmartBuf last_indelible_block, uint16_t genstamp);
+	bool BadSigOrder(Node *node, int witness_index);
+
+	void Remove(Node *node);
+
+public:
+	BlockTree()
+	 :	m_ntips(0)
+	{ }
+
+	~BlockTree()
+	{
+		Clear();
+	}
+
+	void Add(SmartBuf smartobj);
+	void Prune(uint64_t level);
+	void Clear();
+
+	uint64_t FindBestOwnScore(int witness_index, SmartBuf last_indelible_block, uint16_t genstamp);
+	SmartBuf FindBestBuildingBlock(int witness_index, SmartBuf last_indelible_block, uint16_t genstamp, uint64_t min_level, uint64_t& bestscore);
+
+	void GetStats(uint64_t& nblocks, uint64_t& ntips);
+};
+
+extern BlockTree g_blocktree;
@@ -13,6 +13,8 @@
 #include "blockchain.hpp"
 #include "processblock.hpp"
 #include "processtx.hpp"
+#include "blocksigs.hpp"
+#include "reindex.hpp"
 #include "witness.hpp"
 #include "expire.hpp"
 #include "util.h"
@@ -30,7 +32,9 @@
 #include <boost/program_options/options_description.hpp>
 #include <boost/program_options/parsers.hpp>
 #include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
 #include <boost/algorithm/string.hpp>
+#include <boost/function.hpp>
 
 #define DEFAULT_TRACE_LEVEL				4
 #define DEFAULT_TX_VALIDATION_THREADS	16
@@ -42,6 +46,9 @@
 #define DEFAULT_GENESIS_DATA_FILE		 "genesis.dat"
 #define DEFAULT_PRIVATE_RELAY_HOSTS_FILE "private_relay_hosts.lis"
 
+#define TRACE_LEVELS_FILE				"trace_levels.conf"
+#define TRACE_LEVELS_CHECK_SECS			5
+
 static void handle_signal(int)
 {
 	g_shutdown = true;
@@ -71,6 +78,62 @@ static void set_trace_level(int level)
     boost::log::core::get()->set_filter(boost::log::trivial::severity > (((int)(fatal)) - level));
 }
 
+static void set_log_levels()
+{
+	auto level = g_params.trace_level;
+
+	g_log_ccserver.SetLevel(level);
+	g_log_ccserver_rw.SetLevel(level);
+
+	g_log_tx_server.SetLevel(g_params.trace_tx_server ? level : 0);
+	g_log_relay.SetLevel(g_params.trace_relay ? level : 0);
+	g_log_block_serve.SetLevel(g_params.trace_block_serve ? level : 0);
+	g_log_block_sync.SetLevel(g_params.trace_block_sync ? level : 0);
+	g_log_tx_validation.SetLevel(g_params.trace_tx_validation ? level : 0);
+	g_log_block_validation.SetLevel(g_params.trace_block_validation ? level : 0);
+}
+
+// the trace levels file allows the log subsystem levels to be changed while the node is running
+// each line contains a subsystem name and a level, for example "relay 6"
+
+static void check_trace_levels_file()
+{
+	static time_t last_write_time;
+
+	boost::filesystem::path path(g_params.app_data_dir + s2w(PATH_DELIMITER TRACE_LEVELS_FILE));
+
+	boost::system::error_code ec;
+	auto write_time = boost::filesystem::last_write_time(path, ec);
+	if (ec || write_time == last_write_time)
+		return;
+
+	last_write_time = write_time;
+
+	boost::filesystem::ifstream fs(path);
+	string line;
+
+	while (getline(fs, line))
+	{
+		istringstream ss(line);
+		string name;
+		int level;
+
+		if (!(ss >> name) || name[0] == '#')
+			continue;
+
+		if (!(ss >> level) || level < 0 || level > 6)
+		{
+			BOOST_LOG_TRIVIAL(warning) << "Invalid level for \"" << name << "\" in " << TRACE_LEVELS_FILE;
+			continue;
+		}
+
+		if (CCLogSubsystem::SetLevel(name, level))
+			BOOST_LOG_TRIVIAL(warning) << "Unknown log subsystem \"" << name << "\" in " << TRACE_LEVELS_FILE;
+		else
+			BOOST_LOG_TRIVIAL(info) << "Log subsystem " << name << " level set to " << level;
+	}
+}
+
 #if 0 // not yet used
 static void set_storage()
 {
@@ -133,11 +196,22 @@ static void do_show_config()
 	cout << "   path to tor config file = " << w2s(g_params.tor_config) << endl;
 	cout << "   rendezvous servers file = " << w2s(g_params.directory_servers_file) << endl;
 	cout << "   genesis block data file = " << w2s(g_params.genesis_data_file) << endl;
+	if (g_params.snapshot_import_file.length())
+		cout << "   snapshot import file = " << w2s(g_params.snapshot_import_file) << endl;
+	if (g_params.reindex_source.length())
+	{
+		cout << "   reindex source = " << w2s(g_params.reindex_source) << endl;
+		cout << "   reindex proof threads = " << g_params.reindex_proof_threads << endl;
+	}
 	//cout << "   store blocks = " << yesno(g_store_blocks) << endl;
 	//cout << "   store created bills = " << yesno(g_store_created) << endl;
 	//cout << "   store spent bills = " << yesno(g_store_spent) << endl;
 	cout << "   base port = " << g_params.base_port << endl;
 	cout << "   tx validation threads = " << g_params.tx_validation_threads << endl;
+	cout << "   block signature threads = " << g_params.block_sig_threads << endl;
+	cout << "   io context balancing = " << g_params.io_balance << endl;
+	cout << "   relay compact blocks = " << yesno(g_params.relay_compact_blocks) << endl;
+	cout << "   relay tx reconciliation = " << yesno(g_params.relay_tx_reconcile) << endl;
 	cout << endl;
 
 	g_transact_service.DumpConfig();
@@ -158,7 +232,7 @@ static void do_show_config()
 	cout << endl;
 	}
 
-	//g_control_service.DumpConfig();
+	g_control_service.DumpConfig();
 	g_tor_control_service.DumpConfig();
 
 	cout << "Trace output settings:" << endl;
@@ -182,6 +256,11 @@ static void do_show_config()
 	cout << "   trace validation queue DB = " << yesno(g_params.trace_validation_q_db) << endl;
 	cout << "   trace valid object DB = " << yesno(g_params.trace_validobj_db) << endl;
 	cout << "   trace object expiration = " << yesno(g_params.trace_expire) << endl;
+	cout << "   lock profile seconds = " << g_params.lock_profile_secs << endl;
+	cout << endl;
+
+	cout << "Log subsystem levels (can be changed while running in " TRACE_LEVELS_FILE "):" << endl;
+	CCLogSubsystem::DumpLevels(cout);
 	cout << endl;
 }
 
@@ -199,12 +278,38 @@ static int check_config_values()
 		return -1;
 	}
 
+	if (g_params.lock_profile_secs < 0 || g_params.lock_profile_secs > 24*60*60)
+	{
+		BOOST_LOG_TRIVIAL(fatal) << "FATAL ERROR: lock profile interval not in valid range";
+		return -1;
+	}
+
+	// the snapshot file can't vouch for itself, so an import must be anchored to a block oid obtained from a trusted source
+
+	if (g_params.snapshot_import_file.length() && g_params.snapshot_oid.length() != 2 * sizeof(ccoid_t))
+	{
+		BOOST_LOG_TRIVIAL(fatal) << "FATAL ERROR: snapshot-import requires snapshot-oid, the " << 2 * sizeof(ccoid_t) << " digit hex oid of the block at the snapshot level, obtained from a trusted source";
+		return -1;
+	}
+
 	if (g_params.tx_validation_threads < 1 || g_params.tx_validation_threads > 2000)
 	{
 		BOOST_LOG_TRIVIAL(fatal) << "FATAL ERROR: tx validation threads value not in valid range";
 		return -1;
 	}
 
+	if (g_params.block_sig_threads < 0 || g_params.block_sig_threads > 2000)
+	{
+		BOOST_LOG_TRIVIAL(fatal) << "FATAL ERROR: block signature threads value not in valid range";
+		return -1;
+	}
+
+	if (g_params.reindex_proof_threads < 0 || g_params.reindex_proof_threads > 2000)
+	{
+		BOOST_LOG_TRIVIAL(fatal) << "FATAL ERROR: reindex proof threads value not in valid range";
+		return -1;
+	}
+
 	if (g_params.base_port < 1 || g_params.base_port > 0xFFFF - atoi(TOR_PORT))
 	{
 		BOOST_LOG_TRIVIAL(fatal) << "FATAL ERROR: baseport value not in valid range";
@@ -223,6 +328,66 @@ static int check_config_values()
 		return -1;
 	}
 
+	if (g_transact_service.io_contexts < 0 || g_transact_service.io_contexts > 1000)
+	{
+		BOOST_LOG_TRIVIAL(fatal) << "FATAL ERROR: io contexts for transaction support service not in valid range";
+		return -1;
+	}
+
+	if (g_transact_service.session_max_txs < 0 || g_transact_service.session_max_txs > 10000)
+	{
+		BOOST_LOG_TRIVIAL(fatal) << "FATAL ERROR: max transactions per session for transaction support service not in valid range";
+		return -1;
+	}
+
+	if (g_transact_service.cache_mb < 0 || g_transact_service.cache_mb > 64000)
+	{
+		BOOST_LOG_TRIVIAL(fatal) << "FATAL ERROR: query cache size for transaction support service not in valid range";
+		return -1;
+	}
+
+	if (g_transact_service.cache_secs < 1 || g_transact_service.cache_secs > 3600)
+	{
+		BOOST_LOG_TRIVIAL(fatal) << "FATAL ERROR: query cache max age for transaction support service not in valid range";
+		return -1;
+	}
+
+	if (g_relay_service.io_contexts < 0 || g_relay_service.io_contexts > 1000)
+	{
+		BOOST_LOG_TRIVIAL(fatal) << "FATAL ERROR: io contexts for relay service not in valid range";
+		return -1;
+	}
+
+	if (g_relay_service.warm_conns < 0 || g_relay_service.warm_conns > 100)
+	{
+		BOOST_LOG_TRIVIAL(fatal) << "FATAL ERROR: pre-warmed connections for relay service not in valid range";
+		return -1;
+	}
+
+	if (g_relay_service.warm_conn_secs < 1 || g_relay_service.warm_conn_secs > 3600)
+	{
+		BOOST_LOG_TRIVIAL(fatal) << "FATAL ERROR: pre-warmed connection max seconds for relay service not in valid range";
+		return -1;
+	}
+
+	if (g_blocksync_client.warm_conns < 0 || g_blocksync_client.warm_conns > 100)
+	{
+		BOOST_LOG_TRIVIAL(fatal) << "FATAL ERROR: pre-warmed connections for blockchain synchonization not in valid range";
+		return -1;
+	}
+
+	if (g_blocksync_client.warm_conn_secs < 1 || g_blocksync_client.warm_conn_secs >= BLOCKSERVE_TIMEOUT)
+	{
+		BOOST_LOG_TRIVIAL(fatal) << "FATAL ERROR: pre-warmed connection max seconds for blockchain synchonization must be from 1 to " << BLOCKSERVE_TIMEOUT - 1;
+		return -1;
+	}
+
+	if (g_params.io_balance != "round-robin" && g_params.io_balance != "least-loaded")
+	{
+		BOOST_LOG_TRIVIAL(fatal) << "FATAL ERROR: io balance value must be round-robin or least-loaded";
+		return -1;
+	}
+
 	#if 1	// this can be disabled for testing
 
 	if (g_relay_service.max_outconns < 4)
@@ -275,7 +440,21 @@ static int process_options(int argc, char **argv)
 		("genesis-generate", "Generate new genesis block data files.")
 		("genesis-nwitnesses", po::value<int>(&g_params.genesis_nwitnesses)->default_value(3), "Initial # of witnesses generating new genesis block data files.")
 		("genesis-maxmal", po::value<int>(&g_params.genesis_maxmal)->default_value(0), "Initial allowance for malicious witnesses when generating new genesis block data files.")
+		("snapshot-export", po::wvalue<wstring>(&g_params.snapshot_export_file), "Write a snapshot of the blockchain state at the last indelible level to this file, then exit.")
+		("snapshot-import", po::wvalue<wstring>(&g_params.snapshot_import_file), "Load the blockchain state from this snapshot file into a new data directory,\n"
+			"then sync only the blocks after it.")
+		("snapshot-oid", po::value<string>(&g_params.snapshot_oid), "Block oid (in hex) the imported snapshot must be anchored to (required with snapshot-import);\n"
+			"this must come from a trusted source, since the snapshot file is otherwise trusted completely.")
+		("export-blocks", po::wvalue<wstring>(&g_params.export_blocks_file), "Write every block in the blockchain to this block file, then exit.")
+		("reindex", po::wvalue<wstring>(&g_params.reindex_source), "Rebuild the blockchain state in a new data directory by replaying the blocks in this file\n"
+			"(a block file or another node's persistent database) without networking,\n"
+			"then report the throughput of each stage and exit.")
+		("reindex-proof-threads", po::value<int>(&g_params.reindex_proof_threads)->default_value(0), "Threads that verify the transaction proofs during a reindex\n"
+			"(0 = don't verify proofs, -1 = auto config).")
 		("tx-validation-threads", po::value<int>(&g_params.tx_validation_threads)->default_value(-1), "Transaction validation threads (-1 = auto config).")
+		("block-sig-threads", po::value<int>(&g_params.block_sig_threads)->default_value(-1), "Threads that batch verify block signatures during block sync,\n"
+			"in addition to the block sync thread (-1 = auto config).")
+		("io-balance", po::value<string>(&g_params.io_balance)->default_value("round-robin"), "How new connections are assigned to the io contexts of a service (round-robin or least-loaded).")
 		("baseport", po::value<int>(&g_params.base_port)->default_value(9223), "Base port for node interfaces\n"
 			"(node software uses ports baseport through baseport+" TOR_PORT ").")
 		//("store-blocks", po::value<int>(), "Store entire blockchain;\ndefaults to 0 if micronode=1 or mininode=1.")
@@ -289,7 +468,14 @@ static int process_options(int argc, char **argv)
 		("transact-tor", po::value<bool>(&g_transact_service.tor_service)->default_value(0), "Make the transaction support service available as a Tor hidden service.")
 		("transact-tor-auth", po::value<string>(&g_transact_service.tor_auth_string)->default_value("basic"), "Tor hidden service authentication method (none, basic or stealth).")
 		("transact-conns", po::value<int>(&g_transact_service.max_inconns)->default_value(20), "Maximum number of incoming connections for transaction support service.")
+		("transact-session-txs", po::value<int>(&g_transact_service.session_max_txs)->default_value(16), "Maximum number of transactions a wallet session can have validating at once\n"
+				"(0 = wallets can't open sessions that keep the connection open for multiple requests).")
+		("transact-cache-mb", po::value<int>(&g_transact_service.cache_mb)->default_value(16), "Megabytes of memory used to cache replies to repeated address and input queries (0 = no cache);\n"
+				"cached replies are dropped when the Merkle tree advances to a new block.")
+		("transact-cache-secs", po::value<int>(&g_transact_service.cache_secs)->default_value(10), "Maximum age in seconds of a cached query reply, which limits how stale the timestamp in a cached reply can be.")
 		("transact-threads", po::value<float>(&g_transact_service.threads_per_conn)->default_value(1), "Threads per connection for transaction support service.")	// !!! change this?
+		("transact-io-contexts", po::value<int>(&g_transact_service.io_contexts)->default_value(1), "Number of io contexts for transaction support service;\n"
+				"1 runs all connections on a single shared context, 0 uses one context per core.")
 		("relay", po::value<bool>(&g_relay_service.enabled)->default_value(1), "Fetch and relay blocks and transactions (at port baseport+" RELAY_PORT ");\n"
 				"if no relay is enabled, this node will receive no updates and will only use data previously stored.")
 		("relay-addr", po::value<string>(&g_relay_service.address_string)->default_value(LOCALHOST), "Network address for relay service;\n"
@@ -297,6 +483,16 @@ static int process_options(int argc, char **argv)
 				"this setting can be used to bind to another address for direct access via the local network or internet.")
 		("relay-out", po::value<int>(&g_relay_service.max_outconns)->default_value(8), "Target number of outgoing relay connections (must be at least 4).")
 		("relay-in", po::value<int>(&g_relay_service.max_inconns)->default_value(16), "Maximum number of incoming relay connections (must be at least 1.5 * relay-out).")
+		("relay-warm-conns", po::value<int>(&g_relay_service.warm_conns)->default_value(0), "Number of outgoing relay connections to keep connected through Tor in advance, to replace a peer that disconnects;\n"
+				"the pool opens new Tor circuits every relay-warm-secs for as long as the node runs.")
+		("relay-warm-secs", po::value<int>(&g_relay_service.warm_conn_secs)->default_value(60), "Max seconds to keep a pre-warmed relay connection before it is used.")
+		("relay-io-contexts", po::value<int>(&g_relay_service.io_contexts)->default_value(1), "Number of io contexts for relay service;\n"
+				"1 runs all connections on a single shared context, 0 uses one context per core.")
+		("relay-compact-blocks", po::value<bool>(&g_params.relay_compact_blocks)->default_value(0), "Request new blocks from relay peers as a list of transaction id's,\n"
+				"and rebuild them from transactions already received, fetching only the missing transactions;\n"
+				"only used with peers that also enable this.")
+		("relay-tx-reconcile", po::value<bool>(&g_params.relay_tx_reconcile)->default_value(0), "Announce new transactions to relay peers as sets of short id's, so each peer requests full announcements\n"
+				"only for the transactions it doesn't already have; only used with peers that also enable this.")
 		("privrelay", po::value<bool>(&g_privrelay_service.enabled)->default_value(0), "Fetch and relay blocks and transactions (at port baseport+" PRIVRELAY_PORT ");\n"
 				"if no relay is enabled, this node will receive no updates and will only use data previously stored.")
 		("privrelay-file", po::wvalue<wstring>(&g_privrelay_service.priv_hosts_file), "Path to file containing a list of private relay hostnames (default: \"" DEFAULT_PRIVATE_RELAY_HOSTS_FILE "\").")
@@ -319,19 +515,24 @@ static int process_options(int argc, char **argv)
 		("blockserve-tor-auth", po::value<string>(&g_blockserve_service.tor_auth_string)->default_value("none"), "Tor hidden service authentication method (none, basic or stealth).")
 		("blockserve-conns", po::value<int>(&g_blockserve_service.max_inconns)->default_value(1), "Maximum number of incoming connections for blockchain service.")
 		("blocksync-conns", po::value<int>(&g_blocksync_client.max_outconns)->default_value(10), "Maximum number of outgoing connections for blockchain synchonization.")
+		("blocksync-warm-conns", po::value<int>(&g_blocksync_client.warm_conns)->default_value(0), "Number of outgoing blockchain synchonization connections to keep connected through Tor in advance during a sync;\n"
+				"each one holds one of a blockchain server's few connection slots while it waits.")
+		("blocksync-warm-secs", po::value<int>(&g_blocksync_client.warm_conn_secs)->default_value(10), "Max seconds to keep a pre-warmed blockchain synchonization connection before it is used (must be less than the blockchain server timeout).")
 		("witness-index", po::value<int>(&g_witness.witness_index)->default_value(-1), "Witness index (-1 = disable).")
 		("witness-block-ms", po::value<int>(&g_witness.block_time_ms)->default_value(2000), "Nominal milliseconds between blocks.")
 		("witness-block-min-work-ms", po::value<int>(&g_witness.block_min_work_ms)->default_value(200), "Minimum milliseconds to work assembling a block.")
 		("witness-block-idle-sec", po::value<int>(&g_witness.block_max_time)->default_value(20), "Seconds between blocks when there are no transactions to witness.")
 		("witness-test-block-random-ms", po::value<int>(&g_witness.test_block_random_ms)->default_value(-1), "Test randomly generating blocks, with this average milliseconds between blocks (-1 = diabled).")
 		("witness-test-mal", po::value<bool>(&g_witness.test_mal)->default_value(0), "Act as a malicious witness.")
-		//("control", po::value<bool>(&g_control_service.enabled)->default_value(0), "Allow other programs to control node operation (at port baseport+" NODE_CONTROL_PORT ").")
-		//("control-addr", po::value<string>(&g_control_service.address_string)->default_value(LOCALHOST), "Network address for node control service;\n"
-		//		"by default, this service is available from the localhost only;\n"
-		//		"this setting can be used to bind to another address for access via the local network or internet.")
+		("control", po::value<bool>(&g_control_service.enabled)->default_value(0), "Allow other programs to query node metrics (at port baseport+" NODE_CONTROL_PORT ");\n"
+				"send \"text\" or \"json\" followed by a newline, or an HTTP GET for a path containing \"json\" for JSON output.")
+		("control-addr", po::value<string>(&g_control_service.address_string)->default_value(LOCALHOST), "Network address for node control service;\n"
+				"by default, this service is available from the localhost only;\n"
+				"this setting can be used to bind to another address for access via the local network or internet.")
 		//("control-password", po::value<string>(&g_control_service.password_string), "SHA1 hash of password to access node control service (default: no password required).")
-		//("control-tor", po::value<bool>(&g_control_service.tor_service)->default_value(0), "Make the node control port available through a Tor hidden service.")
-		//("control-tor-auth", po::value<string>(&g_control_service.tor_auth_string)->default_value("basic"), "Tor hidden service authentication method (none, basic or stealth).")
+		("control-tor", po::value<bool>(&g_control_service.tor_service)->default_value(0), "Make the node control port available through a Tor hidden service.")
+		("control-tor-auth", po::value<string>(&g_control_service.tor_auth_string)->default_value("basic"), "Tor hidden service authentication method (none, basic or stealth).")
+		("control-conns", po::value<int>(&g_control_service.max_inconns)->default_value(2), "Maximum number of incoming connections for node control service.")
 		("tor-control", po::value<bool>(&g_tor_control_service.enabled)->default_value(0), "Allow other programs to control Tor (at port baseport+" TOR_CONTROL_PORT ").")
 		("tor-control-addr", po::value<string>(&g_tor_control_service.address_string)->default_value(LOCALHOST), "Network address for node control service;\n"
 				"by default, this service is available from the localhost only;\n"
@@ -359,6 +560,7 @@ static int process_options(int argc, char **argv)
 		("trace-validation-q-db", po::value<bool>(&g_params.trace_validation_q_db)->default_value(0), "Trace validation queue DB")
 		("trace-valid-obj-db", po::value<bool>(&g_params.trace_validobj_db)->default_value(0), "Trace valid object DB")
 		("trace-expire", po::value<bool>(&g_params.trace_expire)->default_value(0), "Trace object expiration")
+		("lock-profile", po::value<int>(&g_params.lock_profile_secs)->default_value(0), "Count lock acquisitions, contention and wait time, and log the counts at this interval in seconds (0 = disabled).")
 	;
 
 	po::options_description all;
@@ -397,6 +599,7 @@ static int process_options(int argc, char **argv)
 	po::notify(g_params.config_options);
 
 	set_trace_level(g_params.trace_level);
+	set_log_levels();
 
 	//for (auto v : g_params.config_options)
 	//	cout << "config option: " << v.first << endl;
@@ -439,6 +642,12 @@ static int process_options(int argc, char **argv)
 		BOOST_LOG_TRIVIAL(warning) << "std::thread::hardware_concurrency is indeterminant; using program default value " << DEFAULT_TX_VALIDATION_THREADS;
 	}
 
+	if (g_params.block_sig_threads < 0)
+		g_params.block_sig_threads = max((int)thread::hardware_concurrency() - 1, 0);
+
+	if (g_params.reindex_proof_threads < 0)
+		g_params.reindex_proof_threads = max((int)thread::hardware_concurrency(), 1);
+
 	set_service_configs();
 
 	if (g_params.config_options.count("show-config"))
@@ -450,6 +659,209 @@ static int process_options(int argc, char **argv)
 	return 0;
 }
 
+// one node of the startup dependency graph
+// each stage runs on its own thread once all of its dependencies have finished
+// a stage whose proc returns false, or whose dependencies failed, is marked failed and its dependents are skipped
+
+class StartupStage
+{
+	const char *m_name;
+	boost::function<bool()> m_proc;
+	vector<StartupStage*> m_deps;
+
+	thread *m_thread;
+
+	mutex m_mutex;
+	condition_variable m_condition_variable;
+	bool m_done;
+	bool m_ok;
+
+	static uint32_t m_t0;
+
+	void ThreadProc()
+	{
+		auto t0 = ccticks();
+
+		bool deps_ok = true;
+
+		for (auto dep : m_deps)
+			deps_ok &= dep->Wait();
+
+		auto t1 = ccticks();
+
+		bool ok = false;
+
+		if (deps_ok)
+		{
+			if (g_params.trace_level >= 5) BOOST_LOG_TRIVIAL(debug) << "Startup stage " << m_name << " starting at " << ccticks_elapsed(m_t0, t1) << " ms";
+
+			// a service that can't bind its port throws, which would otherwise terminate the process from this thread
+
+			try
+			{
+				ok = m_proc();
+			}
+			catch (const exception& e)
+			{
+				BOOST_LOG_TRIVIAL(error) << "Startup stage " << m_name << " exception: " << e.what();
+			}
+		}
+
+		auto t2 = ccticks();
+
+		if (!deps_ok)
+			BOOST_LOG_TRIVIAL(warning) << "Startup stage " << m_name << " skipped due to failed dependency";
+		else if (!ok)
+			BOOST_LOG_TRIVIAL(error) << "Startup stage " << m_name << " failed after " << ccticks_elapsed(t1, t2) << " ms";
+		else
+			BOOST_LOG_TRIVIAL(info) << "Startup stage " << m_name << " done in " << ccticks_elapsed(t1, t2) << " ms (waited " << ccticks_elapsed(t0, t1) << " ms for dependencies; " << ccticks_elapsed(m_t0, t2) << " ms since startup)";
+
+		lock_guard<mutex> lock(m_mutex);
+
+		m_ok = ok;
+		m_done = true;
+
+		m_condition_variable.notify_all();
+	}
+
+public:
+	StartupStage(const char *name, boost::function<bool()> proc)
+	 :	m_name(name),
+		m_proc(proc),
+		m_thread(NULL),
+		m_done(false),
+		m_ok(false)
+	{ }
+
+	~StartupStage()
+	{
+		Join();
+	}
+
+	static void SetStartTime()
+	{
+		m_t0 = ccticks();
+	}
+
+	StartupStage& After(StartupStage& dep)
+	{
+		CCASSERT(!m_thread);
+
+		m_deps.push_back(&dep);
+
+		return *this;
+	}
+
+	void Start()
+	{
+		m_thread = new thread(&StartupStage::ThreadProc, this);
+	}
+
+	bool Wait()
+	{
+		unique_lock<mutex> lock(m_mutex);
+
+		while (!m_done)
+			m_condition_variable.wait(lock);
+
+		return m_ok;
+	}
+
+	void Join()
+	{
+		if (m_thread)
+		{
+			m_thread->join();
+
+			delete m_thread;
+
+			m_thread = NULL;
+		}
+	}
+};
+
+uint32_t StartupStage::m_t0;
+
+// writes a snapshot and exits, without starting any services
+
+static int snapshot_export()
+{
+	DbInit dbinit;
+	dbinit.CreateDBs();
+
+	int rc;
+
+	{
+		DbConn dbconn;
+
+		rc = dbconn.SnapshotExport(g_params.snapshot_export_file);
+	}
+
+	dbinit.DeInit();
+
+	dblog(sqlite3_shutdown());
+
+	CCLog::Stop();
+
+	if (rc)
+	{
+		cerr << "Error writing snapshot file" << endl;
+
+		return -1;
+	}
+
+	return 1;
+}
+
+// writes the blocks to a block file, or replays a block file or another node's blockchain into a new data directory, and exits
+
+static int reindex()
+{
+	DbInit dbinit;
+	dbinit.CreateDBs();
+
+	int rc;
+
+	if (g_params.export_blocks_file.length())
+		rc = Reindex::ExportBlocks(g_params.export_blocks_file);
+	else
+	{
+		Reindex reindex;
+
+		rc = reindex.Run(g_params.reindex_source, g_params.reindex_proof_threads);
+
+		g_shutdown = true;
+		g_blockchain.DeInit();
+	}
+
+	dbinit.DeInit();
+
+	dblog(sqlite3_shutdown());
+
+	CCLog::Stop();
+
+	if (rc)
+	{
+		cerr << (g_params.export_blocks_file.length() ? "Error writing block file" : "Reindex failed") << endl;
+
+		return -1;
+	}
+
+	return 1;
+}
+
+// loads a snapshot into a new data directory before the blockchain is restored from it
+
+static bool snapshot_import()
+{
+	if (!g_params.snapshot_import_file.length())
+		return true;
+
+	DbConn dbconn;
+
+	return !dbconn.SnapshotImport(g_params.snapshot_import_file, g_params.snapshot_oid);
+}
+
 int main(int argc, char **argv)
 {
 	signal(SIGINT, handle_signal);
@@ -501,30 +913,79 @@ int main(int argc, char **argv)
 		return 1;
 	}
 
-	thread tor_thread(tor_start);
+	auto startup_t0 = ccticks();
+
+	CCLog::Start();
+
+	CCLockSite::SetEnabled(g_params.lock_profile_secs > 0);
 
-	CCProof_Init();
-	CCProof_PreloadVerifyKeys();
+	if (g_params.snapshot_export_file.length())
+		return snapshot_export();
+
+	if (g_params.export_blocks_file.length() || g_params.reindex_source.length())
+		return reindex();
+
+	StartupStage::SetStartTime();
+
+	thread tor_thread(tor_start);
 
 	DbInit dbinit;
-	dbinit.CreateDBs();
+
+	// startup runs as a dependency graph so that loading the verify keys overlaps opening the DB's and restoring the blockchain
+	// the blockserve stage also starts block sync and the tracker (HostDir) queries, none of which need the verify keys,
+	// so these services come up while the keys are still loading
+	// the control service has no dependencies, so the metrics can be queried while the node is starting
+
+	StartupStage proof_init("proof-init", []{ CCProof_Init(); return true; });
+	StartupStage verify_keys("verify-keys", []{ CCProof_PreloadVerifyKeys(); return true; });
+	StartupStage create_dbs("create-dbs", [&dbinit]{ dbinit.CreateDBs(); return true; });
+	StartupStage snapshot("snapshot", snapshot_import);
+	StartupStage blockchain("blockchain", []{ g_blockchain.Init(); return !g_blockchain.HasFatalError(); });
+	StartupStage expire("expire", []{ g_expire.Init(); return true; });
+	StartupStage blockserve("blockserve", []{ g_blocksigs.Init(); g_blockserve_service.Start(); g_blocksync_client.Start(); return true; });
+	StartupStage processors("processors", []{ g_processtx.Init(); g_processblock.Init(); return true; });
+	StartupStage relay("relay", []{ g_relay_service.Start(); g_privrelay_service.Start(); g_transact_service.Start(); return true; });
+	StartupStage witness("witness", []{ g_witness.Init(); return true; });
+	StartupStage control("control", []{ g_control_service.Start(); return true; });
+
+	verify_keys.After(proof_init);
+	snapshot.After(create_dbs);
+	blockchain.After(proof_init).After(create_dbs).After(snapshot);
+	expire.After(blockchain);
+	blockserve.After(blockchain);
+	processors.After(blockchain).After(verify_keys);
+	relay.After(processors).After(blockserve);
+	witness.After(relay);
 
 	//DbConnPersistData::TestConcurrency();	// for testing
 
-	g_blockchain.Init();
-	if (g_blockchain.HasFatalError())
-		goto do_fatal;
+	auto stages = {&control, &proof_init, &verify_keys, &create_dbs, &snapshot, &blockchain, &expire, &blockserve, &processors, &relay, &witness};
+
+	for (auto stage : stages)
+		stage->Start();
+
+	bool startup_ok = true;
+
+	for (auto stage : stages)
+	{
+		stage->Join();
+
+		startup_ok &= stage->Wait();
+	}
 
-	g_processtx.Init();
-	g_processblock.Init();
+	if (startup_ok)
+		BOOST_LOG_TRIVIAL(info) << "Startup complete in " << ccticks_elapsed(startup_t0, ccticks()) << " ms";
+	else
+	{
+		// stop the services that did start, then run the same shutdown as a normal exit; every DeInit and WaitForShutdown
+		// below is safe to call for a component whose stage failed or was skipped
 
-	g_expire.Init();
-	g_blockserve_service.Start();
-	g_blocksync_client.Start();
-	g_relay_service.Start();
-	g_privrelay_service.Start();
-	g_transact_service.Start();
-	g_witness.Init();
+		BOOST_LOG_TRIVIAL(fatal) << "Startup failed; shutting down";
+		cerr << "ERROR: startup failed" << endl;
+
+		g_shutdown = true;
+		raise(SIGTERM);
+	}
 
 #if 0 // !!! must be 0 for gdb breakpoints to work
 	string in;
@@ -536,26 +997,35 @@ int main(int argc, char **argv)
 	raise(SIGTERM);
 #endif
 
-	while (!g_shutdown)
+	for (unsigned secs = 0; !g_shutdown; ++secs)
+	{
+		if (secs % TRACE_LEVELS_CHECK_SECS == 0)
+			check_trace_levels_file();
+
+		if (g_params.lock_profile_secs && secs && secs % g_params.lock_profile_secs == 0)
+			CCLockSite::DumpAll();
+
 		sleep(1);
+	}
 
 	cerr << "Shutting down..." << endl;
 	BOOST_LOG_TRIVIAL(info) << "Shutting down...";
 
+	g_control_service.WaitForShutdown();
 	g_witness.DeInit();
 	g_transact_service.WaitForShutdown();
 	g_privrelay_service.WaitForShutdown();
 	g_relay_service.WaitForShutdown();
 	g_blocksync_client.WaitForShutdown();
+	g_blocksigs.DeInit();
 	g_blockserve_service.WaitForShutdown();
 	g_processblock.DeInit();
 
 	g_processtx.DeInit();
 	g_expire.DeInit();
 
-do_fatal:
-
 	g_shutdown = true;
+	g_hostdir.DeInit();
 	g_blockchain.DeInit();
 
 	dbinit.DeInit();
@@ -564,6 +1034,11 @@ do_fatal:
 
 	tor_thread.join();
 
+	if (g_params.lock_profile_secs)
+		CCLockSite::DumpAll();
+
+	CCLog::Stop();
+
 	BOOST_LOG_TRIVIAL(info) << "ccnode done";
 	cerr << "ccnode done" << endl;
 
@@ -11,6 +11,7 @@
 #include "blockchain.hpp"
 #include "block.hpp"
 #include "dbparamkeys.h"
+#include "replycache.hpp"
 
 using namespace snarkfront;
 
@@ -82,6 +83,8 @@ bool Commitments::UpdateCommitTree(DbConn *dbconn, SmartBuf newobj, uint64_t tim
 		auto rc = dbconn->ParameterInsert(DB_KEY_COMMIT_BLOCK_LEVEL, 0, &wire->level, sizeof(wire->level));
 		if (rc)
 			return true;
+
+		g_reply_cache.SetLevel(wire->level);	// cached tx query replies from prior levels are now stale
 	}
 
 	bigint_t hash1, hash2, hash, nullhash;
@@ -0,0 +1,193 @@
+/*
+ * CredaCash (TM) cryptocurrency and blockchain
+ *
+ * Copyright (C) 2015-2016 Creda Software, Inc.
+ *
+ * control.cpp
+*/
+
+#include "CCdef.h"
+#include "control.hpp"
+#include "transact.hpp"
+#include "relay.hpp"
+#include "blockserve.hpp"
+#include "blocksync.hpp"
+#include "metrics.hpp"
+
+#include <SmartBuf.hpp>
+
+#include <boost/bind.hpp>
+
+#define CONTROL_TIMEOUT				10
+#define CONTROL_MAX_REQUEST_SIZE	1024
+
+// connection counts for each service
+
+class ServiceConnMetric : public Metric
+{
+	ServiceBase& m_service;
+
+public:
+	ServiceConnMetric(const string& name, ServiceBase& service)
+	 :	Metric(name),
+		m_service(service)
+	{ }
+
+	void Write(MetricWriter& writer)
+	{
+		unsigned nincoming, noutgoing;
+
+		m_service.GetConnectionCounts(nincoming, noutgoing);
+
+		writer.Value(Name() + ".conns_in", nincoming);
+		writer.Value(Name() + ".conns_out", noutgoing);
+	}
+};
+
+static ServiceConnMetric s_tx_server_conns("tx_server", g_transact_service);
+static ServiceConnMetric s_relay_conns("relay", g_relay_service);
+static ServiceConnMetric s_privrelay_conns("privrelay", g_privrelay_service);
+static ServiceConnMetric s_blockserve_conns("blockserve", g_blockserve_service);
+static ServiceConnMetric s_blocksync_conns("blocksync", g_blocksync_client);
+
+// SmartBuf buffers in use; the peak is sampled by SmartBuf every 128 allocations
+
+class SmartBufMetric : public Metric
+{
+public:
+	SmartBufMetric()
+	 :	Metric("smartbuf")
+	{ }
+
+	void Write(MetricWriter& writer)
+	{
+		unsigned nobjs, maxobjs;
+		uint64_t nbytes;
+
+		SmartBuf::GetStats(nobjs, maxobjs, nbytes);
+
+		writer.Value(Name() + ".buffers", nobjs);
+		writer.Value(Name() + ".buffers_peak", maxobjs);
+		writer.Value(Name() + ".bytes", nbytes);
+	}
+};
+
+static SmartBufMetric s_smartbuf;
+
+void ControlConnection::StartConnection()
+{
+	BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " ControlConnection::StartConnection";
+
+	auto op_counter = AutoCount();
+	if (AsyncTimerWait("ControlConnection::StartConnection", CONTROL_TIMEOUT*1000, boost::bind(&ControlConnection::HandleTimeout, this, boost::asio::placeholders::error, op_counter), op_counter))
+		return;
+
+	Connection::StartConnection();
+}
+
+void ControlConnection::HandleTimeout(const boost::system::error_code& e, AutoCount pending_op_counter)
+{
+	if (e == boost::asio::error::operation_aborted)
+		return;
+
+	if (g_shutdown)
+		return;
+
+	BOOST_LOG_TRIVIAL(debug) << Name() << " Conn-" << m_conn_index << " ControlConnection::HandleTimeout e = " << e << " " << e.message();
+
+	Stop();
+}
+
+void ControlConnection::HandleRead(size_t bytes_transferred)
+{
+	// a request is terminated by a newline as well as by a nul, so it can be sent with a line-oriented tool or an HTTP client
+
+	for (unsigned i = m_nred - bytes_transferred; i < m_nred; ++i)
+	{
+		if (m_pread[i] == '\n')
+			return HandleReadComplete();
+	}
+
+	Connection::HandleRead(bytes_transferred);
+}
+
+void ControlConnection::HandleReadComplete()
+{
+	CancelTimer();
+
+	unsigned size = 0;
+	while (size < m_nred && m_pread[size] && m_pread[size] != '\n')
+		++size;
+
+	string request((char*)m_pread, size);
+
+	if (!request.empty() && request.back() == '\r')
+		request.pop_back();
+
+	BOOST_LOG_TRIVIAL(debug) << Name() << " Conn-" << m_conn_index << " ControlConnection::HandleReadComplete request " << request;
+
+	bool http = (request.compare(0, 4, "GET ") == 0);
+	bool json = false;
+
+	if (http)
+	{
+		auto end = request.find(' ', 4);
+		auto path = request.substr(4, end == string::npos ? string::npos : end - 4);
+
+		json = (path.find("json") != string::npos);
+	}
+	else if (request == "json")
+		json = true;
+	else if (!request.empty() && request != "text")
+	{
+		if (request.find(" HTTP/") != string::npos)
+			m_reply = "HTTP/1.0 400 Bad Request\r\nContent-Length: 0\r\n\r\n";
+		else
+			m_reply = "ERROR:unrecognized request\n";
+
+		BOOST_LOG_TRIVIAL(debug) << Name() << " Conn-" << m_conn_index << " ControlConnection::HandleReadComplete unrecognized request";
+
+		WriteAsync("ControlConnection::HandleReadComplete", boost::asio::buffer(m_reply),
+				boost::bind(&Connection::HandleWrite, this, boost::asio::placeholders::error, AutoCount(this)));
+
+		return;
+	}
+
+	auto snapshot = Metric::Snapshot(json);
+
+	if (http)
+	{
+		m_reply = "HTTP/1.0 200 OK\r\nContent-Type: ";
+		m_reply += (json ? "application/json" : "text/plain");
+		m_reply += "\r\nContent-Length: " + to_string(snapshot.size()) + "\r\nConnection: close\r\n\r\n";
+		m_reply += snapshot;
+	}
+	else
+		m_reply.swap(snapshot);
+
+	WriteAsync("ControlConnection::HandleReadComplete", boost::asio::buffer(m_reply),
+			boost::bind(&Connection::HandleWrite, this, boost::asio::placeholders::error, AutoCount(this)));
+}
+
+void ControlService::Start()
+{
+	if (!enabled)
+		return;
+
+	BOOST_LOG_TRIVIAL(trace) << Name() << " ControlService port " << port;
+
+	// unsigned conn_nreadbuf, unsigned conn_nwritebuf, unsigned sock_nreadbuf, unsigned sock_nwritebuf, unsigned headersize, bool noclose, bool bregister
+	CCServer::ConnectionFactoryInstantiation<ControlConnection> connfac(CONTROL_MAX_REQUEST_SIZE, 0, 0, 0, 0, 0, 0);
+
+	unsigned maxconns = (unsigned)(max_inconns + max_outconns);
+	unsigned nthreads = maxconns * threads_per_conn;
+
+	// unsigned nthreads, unsigned maxconns, unsigned maxincoming, unsigned backlog
+	m_service.Start(boost::asio::ip::tcp::endpoint(address, port),
+			nthreads, maxconns, max_inconns, 0, connfac);
+}
+
+void ControlService::WaitForShutdown()
+{
+	m_service.WaitForShutdown();
+}
@@ -0,0 +1,61 @@
+/*
+ * CredaCash (TM) cryptocurrency and blockchain
+ *
+ * Copyright (C) 2015-2016 Creda Software, Inc.
+ *
+ * control.hpp
+*/
+
+#pragma once
+
+#include <ccserver/service.hpp>
+#include <ccserver/connection.hpp>
+
+#include "service_base.hpp"
+
+// The node control service currently serves a snapshot of the node metrics.
+// A request is a single line terminated by a newline or nul:
+//		"text" or an empty line returns "name value" lines
+//		"json" returns a flat JSON object
+//		"GET <path> HTTP/1.x" returns the same as an HTTP/1.0 reply, in JSON if the path contains "json"
+// The connection is closed after the reply is sent.
+
+class ControlConnection : public CCServer::Connection
+{
+	string m_reply;
+
+public:
+	ControlConnection(class CCServer::ConnectionManager& manager, boost::asio::io_service& io_service, const class CCServer::ConnectionFactory& connfac)
+	 :	CCServer::Connection(manager, io_service, connfac)
+	{ }
+
+private:
+
+	void StartConnection();
+
+	void HandleRead(size_t bytes_transferred);
+	void HandleReadComplete();
+
+	void HandleTimeout(const boost::system::error_code& e, AutoCount pending_op_counter);
+};
+
+
+class ControlService : public ServiceBase
+{
+	CCServer::Service m_service;
+
+public:
+	ControlService(string n, string s)
+	 :	ServiceBase(n, s),
+		m_service(n)
+	{ }
+
+	void ConfigPostset()
+	{
+		tor_advertise = false;
+	}
+
+	void Start();
+
+	void WaitForShutdown();
+};
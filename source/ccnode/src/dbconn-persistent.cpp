@@ -11,6 +11,7 @@
 #include "block.hpp"
 #include "util.h"
 #include "dbparamkeys.h"
+#include "metrics.hpp"
 
 #include <dblog.h>
 #include <CCobjects.hpp>
@@ -25,6 +26,8 @@
 #define TEST_FOR_TIMING_ERROR	0	// don't test
 #endif
 
+static MetricHistogram s_serialnum_check_usec("serialnum.check_usec");
+
 static mutex Persistent_db_write_mutex;		// since db is in WAL mode, this mutex is used only as a write-lock
 static atomic<uint8_t> write_pending;
 static atomic<ccthreadid_t> write_thread_id;
@@ -591,6 +594,8 @@ int DbConnPersistData::SerialnumInsert(const void *serial, unsigned size)
 
 int DbConnPersistData::SerialnumCheck(const void *serial, unsigned size)
 {
+	MetricTimer timer(s_serialnum_check_usec);
+
 	Finally finally(boost::bind(&DbConnPersistData::DoPersistentDataFinish, this));
 
 	if (TRACE_DBCONN) BOOST_LOG_TRIVIAL(trace) << "DbConnPersistData::SerialnumCheck serialnum " << buf2hex(serial, size);
@@ -914,76 +919,87 @@ int DbConnPersistData::TxOutputsSelect(const void *addr, unsigned addrsize, uint
 	if (dblog(sqlite3_bind_int64(Tx_Outputs_select, 3, commitnum_end))) return -1;
 	if (dblog(sqlite3_bind_int(Tx_Outputs_select, 4, limit < 2 ? limit : limit + 1))) return -1;
 
-	if (dblog(rc = sqlite3_step(Tx_Outputs_select), DB_STMT_SELECT)) return -1;
-
-	if ((TEST_RANDOM_DB_ERRORS & rand()) == 1) // for testing
+	while (true)
 	{
-		BOOST_LOG_TRIVIAL(info) << "DbConnPersistData::TxOutputsSelect simulating database error post-select";
+		if (dblog(rc = sqlite3_step(Tx_Outputs_select), DB_STMT_SELECT)) return -1;
 
-		return -1;
-	}
+		if ((TEST_RANDOM_DB_ERRORS & rand()) == 1) // for testing
+		{
+			BOOST_LOG_TRIVIAL(info) << "DbConnPersistData::TxOutputsSelect simulating database error post-select";
 
-	if (rc == SQLITE_DONE)
-	{
-		BOOST_LOG_TRIVIAL(trace) << "DbConnPersistData::TxOutputsSelect not found";
+			return -1;
+		}
 
-		return nfound;
-	}
+		if (rc == SQLITE_DONE)
+			break;
 
-	if (rc != SQLITE_ROW)
-	{
-		BOOST_LOG_TRIVIAL(error) << "DbConnPersistData::TxOutputsSelect select returned " << rc;
+		if (rc != SQLITE_ROW)
+		{
+			BOOST_LOG_TRIVIAL(error) << "DbConnPersistData::TxOutputsSelect select returned " << rc;
 
-		return -1;
-	}
+			return -1;
+		}
 
-	// ValueEnc, MerkleRoot, Commitment, Commitnum
-	value_enc[nfound] = sqlite3_column_int64(Tx_Outputs_select, 0);
-	auto merkleroot_blob = sqlite3_column_blob(Tx_Outputs_select, 1);
-	auto commit_blob = sqlite3_column_blob(Tx_Outputs_select, 2);
-	commitnums[nfound] = sqlite3_column_int64(Tx_Outputs_select, 3);
+		if (nfound >= limit)
+		{
+			// the select fetches one extra row when limit > 1, to see if there are more
 
-	if (!merkleroot_blob)
-	{
-		BOOST_LOG_TRIVIAL(error) << "DbConnPersistData::TxOutputsSelect MerkleRoot is null";
+			if (have_more) *have_more = true;
 
-		return -1;
-	}
-	else if (sqlite3_column_bytes(Tx_Outputs_select, 1) != (int)commitment_ivsize)
-	{
-		BOOST_LOG_TRIVIAL(error) << "DbConnPersistData::TxOutputsSelect MerkleRoot Data size " << sqlite3_column_bytes(Tx_Outputs_select, 1) << " != " << commitment_ivsize;
+			break;
+		}
 
-		return -1;
-	}
+		// ValueEnc, MerkleRoot, Commitment, Commitnum
+		value_enc[nfound] = sqlite3_column_int64(Tx_Outputs_select, 0);
+		auto merkleroot_blob = sqlite3_column_blob(Tx_Outputs_select, 1);
+		auto commit_blob = sqlite3_column_blob(Tx_Outputs_select, 2);
+		commitnums[nfound] = sqlite3_column_int64(Tx_Outputs_select, 3);
 
-	if (!commit_blob)
-	{
-		BOOST_LOG_TRIVIAL(error) << "DbConnPersistData::TxOutputsSelect Commitment is null";
+		if (!merkleroot_blob)
+		{
+			BOOST_LOG_TRIVIAL(error) << "DbConnPersistData::TxOutputsSelect MerkleRoot is null";
 
-		return -1;
-	}
-	else if (sqlite3_column_bytes(Tx_Outputs_select, 2) != (int)commitsize)
-	{
-		BOOST_LOG_TRIVIAL(error) << "DbConnPersistData::TxOutputsSelect Commitment Data size " << sqlite3_column_bytes(Tx_Outputs_select, 2) << " != " << commitsize;
+			return -1;
+		}
+		else if (sqlite3_column_bytes(Tx_Outputs_select, 1) != (int)commitment_ivsize)
+		{
+			BOOST_LOG_TRIVIAL(error) << "DbConnPersistData::TxOutputsSelect MerkleRoot Data size " << sqlite3_column_bytes(Tx_Outputs_select, 1) << " != " << commitment_ivsize;
 
-		return -1;
-	}
+			return -1;
+		}
 
-	memcpy(commitment_iv + nfound * commitment_ivsize, merkleroot_blob, commitment_ivsize);
-	memcpy(commitment + nfound * commitsize, commit_blob, commitsize);
+		if (!commit_blob)
+		{
+			BOOST_LOG_TRIVIAL(error) << "DbConnPersistData::TxOutputsSelect Commitment is null";
 
-	if (dblog(sqlite3_extended_errcode(Persistent_db), DB_STMT_SELECT)) return -1;	// check if error retrieving results
+			return -1;
+		}
+		else if (sqlite3_column_bytes(Tx_Outputs_select, 2) != (int)commitsize)
+		{
+			BOOST_LOG_TRIVIAL(error) << "DbConnPersistData::TxOutputsSelect Commitment Data size " << sqlite3_column_bytes(Tx_Outputs_select, 2) << " != " << commitsize;
 
-	if ((TEST_RANDOM_DB_ERRORS & rand()) == 1) // for testing
-	{
-		BOOST_LOG_TRIVIAL(info) << "DbConnPersistData::TxOutputsSelect simulating database error post-error check";
+			return -1;
+		}
 
-		return -1;
-	}
+		memcpy(commitment_iv + nfound * commitment_ivsize, merkleroot_blob, commitment_ivsize);
+		memcpy(commitment + nfound * commitsize, commit_blob, commitsize);
+
+		if (dblog(sqlite3_extended_errcode(Persistent_db), DB_STMT_SELECT)) return -1;	// check if error retrieving results
+
+		if ((TEST_RANDOM_DB_ERRORS & rand()) == 1) // for testing
+		{
+			BOOST_LOG_TRIVIAL(info) << "DbConnPersistData::TxOutputsSelect simulating database error post-error check";
 
-	if (TRACE_DBCONN) BOOST_LOG_TRIVIAL(trace) << "DbConnPersistData::TxOutputsSelect address " << buf2hex(addr, addrsize) << " value_enc " << value_enc[nfound] << " commitment_iv " << buf2hex(commitment_iv + nfound * commitment_ivsize, commitment_ivsize) << " commitment " << buf2hex(commitment + nfound * commitsize, commitsize) << " commitnum " << commitnums[nfound];
+			return -1;
+		}
 
-	nfound++;
+		if (TRACE_DBCONN) BOOST_LOG_TRIVIAL(trace) << "DbConnPersistData::TxOutputsSelect address " << buf2hex(addr, addrsize) << " value_enc " << value_enc[nfound] << " commitment_iv " << buf2hex(commitment_iv + nfound * commitment_ivsize, commitment_ivsize) << " commitment " << buf2hex(commitment + nfound * commitsize, commitsize) << " commitnum " << commitnums[nfound];
+
+		nfound++;
+	}
+
+	if (!nfound)
+		BOOST_LOG_TRIVIAL(trace) << "DbConnPersistData::TxOutputsSelect not found";
 
 	return nfound;
 }
@@ -164,6 +164,21 @@ void DbConnProcessQ::StopQueuedWork(unsigned type)
 	work_queue_condition_variable[type].notify_all();
 }
 
+// returns the approximate number of objects waiting to be processed
+// waiting threads briefly decrement queued_work, so the count is clamped at zero
+
+int DbConnProcessQ::QueuedWork(unsigned type)
+{
+	CCASSERT(type < PROCESS_Q_N);
+
+	auto work = queued_work[type].load();
+
+	if (work < 0 || work >= INT_MAX / 4)	// StopQueuedWork sets queued_work to INT_MAX / 2
+		return 0;
+
+	return work;
+}
+
 void DbConnProcessQ::WaitForQueuedWork(unsigned type)
 {
 	CCASSERT(type < PROCESS_Q_N);
@@ -449,6 +449,7 @@ int DbConnRelayObjs::RelayObjsFindDownloads(unsigned conn_index, uint64_t tx_lev
 		req_params[nfound].level = level;
 		req_params[nfound].witness = witness;
 		req_params[nfound].announce_time = announce_time;
+		req_params[nfound].compact_fill = 0;
 		++nfound;
 
 		if (timeout >= RELAY_DOWNLOAD_TIME_MAX)
@@ -0,0 +1,772 @@
+/*
+ * CredaCash (TM) cryptocurrency and blockchain
+ *
+ * Copyright (C) 2015-2016 Creda Software, Inc.
+ *
+ * dbconn-snapshot.cpp
+*/
+
+#include "CCdef.h"
+#include "dbconn.hpp"
+#include "block.hpp"
+#include "commitments.hpp"
+#include "util.h"
+
+#include <dblog.h>
+#include <CCobjects.hpp>
+#include <Finally.hpp>
+#include <blake2/blake2s.h>
+
+#include <boost/algorithm/string/predicate.hpp>
+
+/*
+
+A snapshot holds the persistent tables as of the last indelible block, so a new node can load it and then sync only the blocks after it.
+
+File layout:
+	SnapshotHeader
+	checksum of the header
+	for each table in s_snapshot_tables:
+		SnapshotTableHeader
+		for each row, in primary key order:
+			uint32 size of the row data that follows
+			for each column: uint8 type, then an int64 for SQLITE_INTEGER, or a uint32 size and the bytes for SQLITE_BLOB, or nothing for SQLITE_NULL
+		uint32 0
+		uint64 number of rows
+		checksum of the table section, from the start of its SnapshotTableHeader through the row count
+
+Checksums are 32 byte blake2s hashes.
+
+The snapshot is read in a single read transaction, so the tables are consistent with each other.  Since the tables only hold the
+current state, a snapshot can only be taken at the current last indelible level.  Only the trailing SNAPSHOT_TRAILING_BLOCKS blocks
+of the blockchain are included, so a node bootstrapped from a snapshot can't serve the blocks before those to other nodes.
+
+The header anchors the snapshot to the block hash and oid of the block at the snapshot level, and to the latest Commit_Roots Merkle root.
+An import checks these against the imported tables, and against the expected oid, before it commits.  The expected oid is required,
+since without it the anchors would only be checked against the file itself.
+
+*/
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+#define SNAPSHOT_FILE_TAG			0x50534343	// CCSP in little endian format
+#define SNAPSHOT_VERSION			1
+
+#define SNAPSHOT_TRAILING_BLOCKS	64			// enough for RestoreLastBlocks and covers every DB_KEY_BLOCK_AUX subkey (level & 63)
+#define SNAPSHOT_BUFSIZE			(1 << 20)
+#define SNAPSHOT_MAX_COLUMNS		8
+#define SNAPSHOT_CHECKSUM_BYTES		32
+
+#pragma pack(push, 1)
+
+struct SnapshotHeader
+{
+	uint32_t tag;
+	uint32_t version;
+	uint64_t level;
+	ccoid_t oid;
+	block_hash_t block_hash;
+	uint64_t commit_root_level;
+	uint32_t commit_root_size;
+	array<uint8_t, 64> commit_root;
+	uint32_t ntables;
+};
+
+struct SnapshotTableHeader
+{
+	char name[16];
+	uint32_t ncolumns;
+};
+
+#pragma pack(pop)
+
+typedef array<uint8_t, SNAPSHOT_CHECKSUM_BYTES> snapshot_checksum_t;
+
+static const struct
+{
+	const char *name;
+	const char *columns;
+	const char *order;
+	unsigned ncolumns;
+}
+s_snapshot_tables[] =
+{
+	{ "Parameters",		"Key, Subkey, Value",									"Key, Subkey",			3 },
+	{ "Blockchain",		"Level, Block",											"Level",				2 },
+	{ "Serialnums",		"Serialnum",											"Serialnum",			1 },
+	{ "Commit_Tree",	"Height, Offset, Data",									"Height, Offset",		3 },
+	{ "Commit_Roots",	"Level, Timestamp, MerkleRoot",							"Level",				3 },
+	{ "Tx_Outputs",		"Address, ValueEnc, ParamLevel, Commitment, Commitnum",	"Address, Commitnum",	5 },
+};
+
+#define SNAPSHOT_NTABLES	(sizeof(s_snapshot_tables)/sizeof(s_snapshot_tables[0]))
+
+// buffered file that keeps a running checksum of everything written or read
+
+class SnapshotFile
+{
+	int m_fd;
+	bool m_write;
+	vector<uint8_t> m_buf;
+	unsigned m_pos;
+	unsigned m_end;
+	blake2s_ctx m_ctx;
+
+public:
+	uint64_t nbytes;
+
+	SnapshotFile()
+	 :	m_fd(-1),
+		m_write(false),
+		m_pos(0),
+		m_end(0),
+		nbytes(0)
+	{ }
+
+	~SnapshotFile()
+	{
+		if (m_fd >= 0)
+			close(m_fd);
+	}
+
+	bool Open(const wstring& path, bool write)
+	{
+		m_write = write;
+		m_buf.resize(SNAPSHOT_BUFSIZE);
+
+		if (write)
+			m_fd = open_file(path, O_BINARY | O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+		else
+			m_fd = open_file(path, O_BINARY | O_RDONLY);
+
+		if (m_fd < 0)
+		{
+			BOOST_LOG_TRIVIAL(error) << "SnapshotFile::Open error opening file \"" << w2s(path) << "\"; " << strerror(errno);
+
+			return true;
+		}
+
+		StartChecksum();
+
+		return false;
+	}
+
+	void StartChecksum()
+	{
+		CCASSERTZ(blake2s_init(&m_ctx, SNAPSHOT_CHECKSUM_BYTES, NULL, 0));
+	}
+
+	void FinishChecksum(snapshot_checksum_t& checksum)
+	{
+		blake2s_final(&m_ctx, &checksum);
+	}
+
+	bool Flush()
+	{
+		for (unsigned done = 0; done < m_pos; )
+		{
+			auto rc = write(m_fd, m_buf.data() + done, m_pos - done);
+			if (rc <= 0)
+			{
+				BOOST_LOG_TRIVIAL(error) << "SnapshotFile::Flush write failed; " << strerror(errno);
+
+				return true;
+			}
+
+			done += rc;
+		}
+
+		m_pos = 0;
+
+		return false;
+	}
+
+	bool Write(const void *data, unsigned size)
+	{
+		blake2s_update(&m_ctx, data, size);
+
+		return WriteRaw(data, size);
+	}
+
+	bool Read(void *data, unsigned size)
+	{
+		if (ReadRaw(data, size))
+			return true;
+
+		blake2s_update(&m_ctx, data, size);
+
+		return false;
+	}
+
+	// writes or checks the checksum of everything since the last checksum, then starts a new one
+
+	bool PutChecksum()
+	{
+		snapshot_checksum_t checksum;
+		FinishChecksum(checksum);
+		StartChecksum();
+
+		return WriteRaw(&checksum, sizeof(checksum));
+	}
+
+	bool CheckChecksum()
+	{
+		snapshot_checksum_t checksum, stored;
+		FinishChecksum(checksum);
+		StartChecksum();
+
+		if (ReadRaw(&stored, sizeof(stored)))
+			return true;
+
+		if (memcmp(&checksum, &stored, sizeof(checksum)))
+		{
+			BOOST_LOG_TRIVIAL(error) << "SnapshotFile::CheckChecksum checksum mismatch at offset " << nbytes;
+
+			return true;
+		}
+
+		return false;
+	}
+
+private:
+
+	bool WriteRaw(const void *data, unsigned size)
+	{
+		CCASSERT(m_write);
+
+		nbytes += size;
+
+		while (size)
+		{
+			if (m_pos >= m_buf.size() && Flush())
+				return true;
+
+			unsigned n = min(size, (unsigned)m_buf.size() - m_pos);
+
+			memcpy(m_buf.data() + m_pos, data, n);
+
+			m_pos += n;
+			data = (const uint8_t*)data + n;
+			size -= n;
+		}
+
+		return false;
+	}
+
+	bool ReadRaw(void *data, unsigned size)
+	{
+		CCASSERT(!m_write);
+
+		auto out = (uint8_t*)data;
+		unsigned remaining = size;
+
+		while (remaining)
+		{
+			if (m_pos >= m_end)
+			{
+				auto rc = read(m_fd, m_buf.data(), m_buf.size());
+				if (rc <= 0)
+				{
+					BOOST_LOG_TRIVIAL(error) << "SnapshotFile::Read unexpected end of file after " << nbytes << " bytes";
+
+					return true;
+				}
+
+				m_pos = 0;
+				m_end = rc;
+			}
+
+			unsigned n = min(remaining, m_end - m_pos);
+
+			memcpy(out, m_buf.data() + m_pos, n);
+
+			m_pos += n;
+			out += n;
+			remaining -= n;
+		}
+
+		nbytes += size;
+
+		return false;
+	}
+};
+
+static bool SetupBlock(SmartBuf smartobj)
+{
+	auto block = (Block*)smartobj.data();
+
+	if (!block->SetupAuxBuf(smartobj))
+		return true;
+
+	block->SetOrVerifyOid(true);
+
+	return false;
+}
+
+int DbConnPersistData::SnapshotSelectLastRoot(uint64_t& level, void *hash, unsigned bufsize, unsigned& hashsize)
+{
+	sqlite3_stmt *stmt = NULL;
+	Finally finally([&stmt]{ sqlite3_finalize(stmt); });
+
+	level = 0;
+	hashsize = 0;
+
+	if (dblog(sqlite3_prepare_v2(Persistent_db, "select Level, MerkleRoot from Commit_Roots order by Level desc limit 1;", -1, &stmt, NULL))) return -1;
+
+	int rc;
+	if (dblog(rc = sqlite3_step(stmt), DB_STMT_SELECT)) return -1;
+
+	if (rc == SQLITE_DONE)
+		return 1;
+
+	if (rc != SQLITE_ROW)
+		return -1;
+
+	level = sqlite3_column_int64(stmt, 0);
+
+	auto data_blob = sqlite3_column_blob(stmt, 1);
+	auto datasize = sqlite3_column_bytes(stmt, 1);
+
+	if (dblog(sqlite3_extended_errcode(Persistent_db), DB_STMT_SELECT)) return -1;	// check if error retrieving results
+
+	if (!data_blob || datasize > (int)bufsize)
+	{
+		BOOST_LOG_TRIVIAL(error) << "DbConnPersistData::SnapshotSelectLastRoot MerkleRoot size " << datasize;
+
+		return -1;
+	}
+
+	memcpy(hash, data_blob, datasize);
+	hashsize = datasize;
+
+	return 0;
+}
+
+int DbConnPersistData::SnapshotExport(const wstring& path)
+{
+	BOOST_LOG_TRIVIAL(info) << "DbConnPersistData::SnapshotExport writing snapshot to \"" << w2s(path) << "\"";
+
+	auto t0 = ccticks();
+
+	SnapshotFile file;
+	if (file.Open(path, true))
+		return -1;
+
+	if (BeginRead())
+		return -1;
+
+	Finally finally(boost::bind(&DbConnPersistData::EndRead, this));
+
+	SnapshotHeader header;
+	memset(&header, 0, sizeof(header));
+
+	header.tag = SNAPSHOT_FILE_TAG;
+	header.version = SNAPSHOT_VERSION;
+	header.ntables = SNAPSHOT_NTABLES;
+
+	if (BlockchainSelectMax(header.level))
+	{
+		BOOST_LOG_TRIVIAL(error) << "DbConnPersistData::SnapshotExport no blockchain to export";
+
+		return -1;
+	}
+
+	SmartBuf smartobj;
+
+	if (BlockchainSelect(header.level, &smartobj) || SetupBlock(smartobj))
+	{
+		BOOST_LOG_TRIVIAL(error) << "DbConnPersistData::SnapshotExport error retrieving block at level " << header.level;
+
+		return -1;
+	}
+
+	auto auxp = ((Block*)smartobj.data())->AuxPtr();
+
+	memcpy(&header.oid, &auxp->oid, sizeof(header.oid));
+	memcpy(&header.block_hash, &auxp->block_hash, sizeof(header.block_hash));
+
+	if (SnapshotSelectLastRoot(header.commit_root_level, &header.commit_root, sizeof(header.commit_root), header.commit_root_size) < 0)
+		return -1;
+
+	if (file.Write(&header, sizeof(header)) || file.PutChecksum())
+		return -1;
+
+	uint64_t min_block_level = 0;
+	if (header.level >= SNAPSHOT_TRAILING_BLOCKS)
+		min_block_level = header.level - SNAPSHOT_TRAILING_BLOCKS + 1;
+
+	for (auto& table : s_snapshot_tables)
+	{
+		string sql = string("select ") + table.columns + " from " + table.name;
+
+		if (!strcmp(table.name, "Blockchain"))
+			sql += " where Level >= " + to_string(min_block_level);
+
+		sql += string(" order by ") + table.order + ";";
+
+		sqlite3_stmt *stmt = NULL;
+		Finally finalize_stmt([&stmt]{ sqlite3_finalize(stmt); });
+
+		if (dblog(sqlite3_prepare_v2(Persistent_db, sql.c_str(), -1, &stmt, NULL))) return -1;
+
+		SnapshotTableHeader table_header;
+		memset(&table_header, 0, sizeof(table_header));
+
+		strncpy(table_header.name, table.name, sizeof(table_header.name) - 1);
+		table_header.ncolumns = table.ncolumns;
+
+		if (file.Write(&table_header, sizeof(table_header)))
+			return -1;
+
+		uint64_t nrows = 0;
+		vector<uint8_t> row;
+
+		while (true)
+		{
+			int rc;
+			if (dblog(rc = sqlite3_step(stmt), DB_STMT_SELECT)) return -1;
+
+			if (rc == SQLITE_DONE)
+				break;
+
+			if (rc != SQLITE_ROW)
+			{
+				BOOST_LOG_TRIVIAL(error) << "DbConnPersistData::SnapshotExport select from " << table.name << " returned " << rc;
+
+				return -1;
+			}
+
+			row.clear();
+
+			for (unsigned i = 0; i < table.ncolumns; ++i)
+			{
+				uint8_t type = sqlite3_column_type(stmt, i);
+
+				row.push_back(type);
+
+				if (type == SQLITE_INTEGER)
+				{
+					int64_t val = sqlite3_column_int64(stmt, i);
+
+					row.insert(row.end(), (uint8_t*)&val, (uint8_t*)&val + sizeof(val));
+				}
+				else if (type == SQLITE_BLOB)
+				{
+					auto data = (const uint8_t*)sqlite3_column_blob(stmt, i);
+					uint32_t size = sqlite3_column_bytes(stmt, i);
+
+					row.insert(row.end(), (uint8_t*)&size, (uint8_t*)&size + sizeof(size));
+					row.insert(row.end(), data, data + size);
+				}
+				else if (type != SQLITE_NULL)
+				{
+					BOOST_LOG_TRIVIAL(error) << "DbConnPersistData::SnapshotExport unexpected column type " << (unsigned)type << " in " << table.name;
+
+					return -1;
+				}
+			}
+
+			if (dblog(sqlite3_extended_errcode(Persistent_db), DB_STMT_SELECT)) return -1;	// check if error retrieving results
+
+			uint32_t size = row.size();
+
+			if (file.Write(&size, sizeof(size)) || file.Write(row.data(), size))
+				return -1;
+
+			++nrows;
+		}
+
+		uint32_t end = 0;
+
+		if (file.Write(&end, sizeof(end)) || file.Write(&nrows, sizeof(nrows)) || file.PutChecksum())
+			return -1;
+
+		BOOST_LOG_TRIVIAL(info) << "DbConnPersistData::SnapshotExport " << table.name << " " << nrows << " rows";
+	}
+
+	if (file.Flush())
+		return -1;
+
+	BOOST_LOG_TRIVIAL(info) << "DbConnPersistData::SnapshotExport wrote " << file.nbytes << " bytes at level " << header.level << " block oid " << buf2hex(&header.oid, sizeof(header.oid)) << " commit root " << buf2hex(&header.commit_root, header.commit_root_size) << " in " << ccticks_elapsed(t0, ccticks()) << " ms";
+
+	return 0;
+}
+
+int DbConnPersistData::SnapshotImport(const wstring& path, const string& expected_oid)
+{
+	BOOST_LOG_TRIVIAL(info) << "DbConnPersistData::SnapshotImport loading snapshot from \"" << w2s(path) << "\"";
+
+	auto t0 = ccticks();
+
+	uint64_t level;
+
+	auto rc = BlockchainSelectMax(level);
+	if (rc < 0)
+		return -1;
+
+	if (!rc)
+	{
+		BOOST_LOG_TRIVIAL(error) << "DbConnPersistData::SnapshotImport the database already has a blockchain; a snapshot can only be loaded into a new data directory";
+
+		return -1;
+	}
+
+	SnapshotFile file;
+	if (file.Open(path, false))
+		return -1;
+
+	SnapshotHeader header;
+
+	if (file.Read(&header, sizeof(header)) || file.CheckChecksum())
+		return -1;
+
+	if (header.tag != SNAPSHOT_FILE_TAG || header.version != SNAPSHOT_VERSION || header.ntables != SNAPSHOT_NTABLES || header.commit_root_size > sizeof(header.commit_root))
+	{
+		BOOST_LOG_TRIVIAL(error) << "DbConnPersistData::SnapshotImport not a valid snapshot file, or snapshot version " << header.version << " not supported";
+
+		return -1;
+	}
+
+	if (!expected_oid.length())
+	{
+		BOOST_LOG_TRIVIAL(error) << "DbConnPersistData::SnapshotImport no expected block oid; refusing to trust the snapshot file";
+
+		return -1;
+	}
+
+	if (!boost::iequals(expected_oid, buf2hex(&header.oid, sizeof(header.oid))))
+	{
+		BOOST_LOG_TRIVIAL(error) << "DbConnPersistData::SnapshotImport snapshot block oid " << buf2hex(&header.oid, sizeof(header.oid)) << " does not match the expected oid " << expected_oid;
+
+		return -1;
+	}
+
+	if (BeginWrite())
+		return -1;
+
+	Finally finally(boost::bind(&DbConnPersistData::EndWrite, this, false));	// rolls back unless the import is committed
+
+	for (auto& table : s_snapshot_tables)
+	{
+		SnapshotTableHeader table_header;
+
+		if (file.Read(&table_header, sizeof(table_header)))
+			return -1;
+
+		if (strncmp(table_header.name, table.name, sizeof(table_header.name)) || table_header.ncolumns != table.ncolumns)
+		{
+			BOOST_LOG_TRIVIAL(error) << "DbConnPersistData::SnapshotImport expected table " << table.name;
+
+			return -1;
+		}
+
+		string sql = string("insert into ") + table.name + " (" + table.columns + ") values (?1";
+		for (unsigned i = 1; i < table.ncolumns; ++i)
+			sql += ", ?" + to_string(i + 1);
+		sql += ");";
+
+		sqlite3_stmt *stmt = NULL;
+		Finally finalize_stmt([&stmt]{ sqlite3_finalize(stmt); });
+
+		if (dblog(sqlite3_prepare_v2(Persistent_db, sql.c_str(), -1, &stmt, NULL))) return -1;
+
+		uint64_t nrows = 0;
+		vector<uint8_t> row;
+
+		while (true)
+		{
+			uint32_t size;
+
+			if (file.Read(&size, sizeof(size)))
+				return -1;
+
+			if (!size)
+				break;
+
+			if (size > CC_BLOCK_MAX_SIZE + SNAPSHOT_MAX_COLUMNS * 16)
+			{
+				BOOST_LOG_TRIVIAL(error) << "DbConnPersistData::SnapshotImport row size " << size << " too large in " << table.name;
+
+				return -1;
+			}
+
+			row.resize(size);
+
+			if (file.Read(row.data(), size))
+				return -1;
+
+			unsigned pos = 0;
+
+			for (unsigned i = 0; i < table.ncolumns; ++i)
+			{
+				if (pos >= size)
+					goto bad_row;
+
+				auto type = row[pos++];
+
+				if (type == SQLITE_INTEGER)
+				{
+					if (pos + sizeof(int64_t) > size)
+						goto bad_row;
+
+					if (dblog(sqlite3_bind_int64(stmt, i + 1, *(int64_t*)(row.data() + pos)))) return -1;
+
+					pos += sizeof(int64_t);
+				}
+				else if (type == SQLITE_BLOB)
+				{
+					if (pos + sizeof(uint32_t) > size)
+						goto bad_row;
+
+					auto blobsize = *(uint32_t*)(row.data() + pos);
+					pos += sizeof(uint32_t);
+
+					if (blobsize > size - pos)
+						goto bad_row;
+
+					if (dblog(sqlite3_bind_blob(stmt, i + 1, row.data() + pos, blobsize, SQLITE_STATIC))) return -1;
+
+					pos += blobsize;
+				}
+				else if (type == SQLITE_NULL)
+				{
+					if (dblog(sqlite3_bind_null(stmt, i + 1))) return -1;
+				}
+				else
+					goto bad_row;
+			}
+
+			if (pos != size)
+				goto bad_row;
+
+			if (dblog(sqlite3_step(stmt), DB_STMT_STEP)) return -1;
+
+			if (sqlite3_changes(Persistent_db) != 1)
+			{
+				BOOST_LOG_TRIVIAL(error) << "DbConnPersistData::SnapshotImport insert into " << table.name << " failed";
+
+				return -1;
+			}
+
+			sqlite3_reset(stmt);
+
+			++nrows;
+		}
+
+		uint64_t stored_nrows;
+
+		if (file.Read(&stored_nrows, sizeof(stored_nrows)) || file.CheckChecksum())
+			return -1;
+
+		if (stored_nrows != nrows)
+		{
+			BOOST_LOG_TRIVIAL(error) << "DbConnPersistData::SnapshotImport " << table.name << " row count " << nrows << " != " << stored_nrows;
+
+			return -1;
+		}
+
+		BOOST_LOG_TRIVIAL(info) << "DbConnPersistData::SnapshotImport " << table.name << " " << nrows << " rows";
+
+		continue;
+
+	bad_row:
+
+		BOOST_LOG_TRIVIAL(error) << "DbConnPersistData::SnapshotImport malformed row " << nrows << " in " << table.name;
+
+		return -1;
+	}
+
+	// check the anchors against what was loaded
+
+	if (BlockchainSelectMax(level) || level != header.level)
+	{
+		BOOST_LOG_TRIVIAL(error) << "DbConnPersistData::SnapshotImport the snapshot blockchain does not end at the snapshot level " << header.level;
+
+		return -1;
+	}
+
+	SmartBuf priorobj;
+
+	for (uint64_t blevel = (level >= SNAPSHOT_TRAILING_BLOCKS ? level - SNAPSHOT_TRAILING_BLOCKS + 1 : 0); blevel <= level; ++blevel)
+	{
+		SmartBuf smartobj;
+
+		if (BlockchainSelect(blevel, &smartobj) || SetupBlock(smartobj))
+		{
+			BOOST_LOG_TRIVIAL(error) << "DbConnPersistData::SnapshotImport snapshot is missing the block at level " << blevel;
+
+			return -1;
+		}
+
+		auto block = (Block*)smartobj.data();
+
+		if (priorobj && memcmp(&block->WireData()->prior_oid, &((Block*)priorobj.data())->AuxPtr()->oid, sizeof(ccoid_t)))
+		{
+			BOOST_LOG_TRIVIAL(error) << "DbConnPersistData::SnapshotImport the block at level " << blevel << " does not chain to the block before it";
+
+			return -1;
+		}
+
+		priorobj = smartobj;
+	}
+
+	auto auxp = ((Block*)priorobj.data())->AuxPtr();
+
+	if (memcmp(&auxp->oid, &header.oid, sizeof(header.oid)) || memcmp(&auxp->block_hash, &header.block_hash, sizeof(header.block_hash)))
+	{
+		BOOST_LOG_TRIVIAL(error) << "DbConnPersistData::SnapshotImport the block at level " << level << " oid " << buf2hex(&auxp->oid, sizeof(auxp->oid)) << " does not match the snapshot anchor " << buf2hex(&header.oid, sizeof(header.oid));
+
+		return -1;
+	}
+
+	uint64_t root_level;
+	array<uint8_t, 64> root;
+	unsigned root_size;
+
+	rc = SnapshotSelectLastRoot(root_level, &root, sizeof(root), root_size);
+	if (rc < 0)
+		return -1;
+
+	if (root_level != header.commit_root_level || root_size != header.commit_root_size || memcmp(&root, &header.commit_root, root_size))
+	{
+		BOOST_LOG_TRIVIAL(error) << "DbConnPersistData::SnapshotImport the last Commit_Roots entry does not match the snapshot anchor";
+
+		return -1;
+	}
+
+	if (root_size == COMMITMENT_HASH_BYTES)
+	{
+		array<uint8_t, COMMITMENT_HASH_BYTES> tree_root;
+
+		rc = CommitTreeSelect(TX_MERKLE_DEPTH, 0, &tree_root, COMMITMENT_HASH_BYTES);
+		if (rc < 0)
+			return -1;
+
+		if (rc)
+		{
+			BOOST_LOG_TRIVIAL(error) << "DbConnPersistData::SnapshotImport the snapshot is missing the Commit_Tree root";
+
+			return -1;
+		}
+
+		if (memcmp(&tree_root, &root, root_size))
+		{
+			BOOST_LOG_TRIVIAL(error) << "DbConnPersistData::SnapshotImport the Commit_Tree root does not match the snapshot anchor";
+
+			return -1;
+		}
+	}
+
+	finally.Clear();
+
+	if (EndWrite(true))
+		return -1;
+
+	ReleaseMutex();
+
+	BOOST_LOG_TRIVIAL(info) << "DbConnPersistData::SnapshotImport loaded " << file.nbytes << " bytes at level " << header.level << " block oid " << buf2hex(&header.oid, sizeof(header.oid)) << " commit root " << buf2hex(&header.commit_root, header.commit_root_size) << " in " << ccticks_elapsed(t0, ccticks()) << " ms";
+
+	return 0;
+}
@@ -10,6 +10,7 @@
 #include "dbconn.hpp"
 #include "block.hpp"
 #include "blockchain.hpp"
+#include "metrics.hpp"
 
 #include <dblog.h>
 #include <CCobjects.hpp>
@@ -26,6 +27,9 @@ static const uint32_t g_full_checkpoint_time = 20;	// !!! make this configurable
 #define TEST_FREERUN_CHECKPOINTS	0	// don't test
 #endif
 
+static MetricHistogram s_passive_checkpoint_usec("wal.passive_checkpoint_usec");
+static MetricHistogram s_full_checkpoint_usec("wal.full_checkpoint_usec");
+
 void WalDB::WalStartCheckpoint(bool full)
 {
 	full_checkpoint_pending |= full;
@@ -101,7 +105,11 @@ void WalDB::WalCheckpoint(sqlite3 *db)
 	{
 		if (TRACE_DBCONN) BOOST_LOG_TRIVIAL(debug) << "WalDB::WalCheckpoint " << dbname << " passive";
 
-		dblog(sqlite3_wal_checkpoint_v2(db, NULL, SQLITE_CHECKPOINT_PASSIVE, NULL, NULL));	// note: this can return SQLITE_BUSY if sqlite3_busy_timeout is enabled
+		{
+			MetricTimer timer(s_passive_checkpoint_usec);
+
+			dblog(sqlite3_wal_checkpoint_v2(db, NULL, SQLITE_CHECKPOINT_PASSIVE, NULL, NULL));	// note: this can return SQLITE_BUSY if sqlite3_busy_timeout is enabled
+		}
 
 		checkpoint_needed.store(false);
 	}
@@ -115,7 +123,11 @@ void WalDB::WalCheckpoint(sqlite3 *db)
 
 		if (TRACE_DBCONN) BOOST_LOG_TRIVIAL(debug) << "WalDB::WalCheckpoint " << dbname << " truncate";
 
-		dblog(sqlite3_wal_checkpoint_v2(db, NULL, SQLITE_CHECKPOINT_TRUNCATE, NULL, NULL));	// note: this can return SQLITE_BUSY if sqlite3_busy_timeout is enabled
+		{
+			MetricTimer timer(s_full_checkpoint_usec);
+
+			dblog(sqlite3_wal_checkpoint_v2(db, NULL, SQLITE_CHECKPOINT_TRUNCATE, NULL, NULL));	// note: this can return SQLITE_BUSY if sqlite3_busy_timeout is enabled
+		}
 
 		checkpoint_needed.store(false);
 
@@ -242,6 +242,10 @@ public:
 
 	static void TestConcurrency();
 
+	int SnapshotSelectLastRoot(uint64_t& level, void *hash, unsigned bufsize, unsigned& hashsize);
+	int SnapshotExport(const wstring& path);
+	int SnapshotImport(const wstring& path, const string& expected_oid);
+
 	// PersistentData_StartCheckpointing needs to be called on a DbConn object that is not being used for anything else
 	// in order to avoid conflicts on the Persistent_db handle
 	void PersistentData_StartCheckpointing()
@@ -344,6 +348,7 @@ public:
 	static void IncrementQueuedWork(unsigned type, unsigned changes = 1);
 	static void WaitForQueuedWork(unsigned type);
 	static void StopQueuedWork(unsigned type);
+	static int QueuedWork(unsigned type);
 
 	int ProcessQEnqueueValidate(unsigned type, SmartBuf smartobj, const ccoid_t *prior_oid, int64_t level, unsigned status, int64_t priority, unsigned conn_index, uint64_t callback_id);
 	int ProcessQGetNextValidateObj(unsigned type, SmartBuf *retobj, unsigned& conn_index, unsigned& callback_id);
@@ -12,8 +12,10 @@
 #include "service_base.hpp"
 #include "relay.hpp"
 #include "blockserve.hpp"
+#include "metrics.hpp"
 
 #include <CCcrypto.hpp>
+#include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
 #include <boost/algorithm/string.hpp>
 
@@ -21,20 +23,76 @@
 #define MAX_REPLY_HOSTS		(20+10)
 #define MAX_DIR_REPLY_SIZE	((16 + 3)*MAX_REPLY_HOSTS + 200)
 
+#define HOSTDIR_CACHE_FILE			"hostdir.dat"
+
+#define HOSTDIR_PREFETCH_LOW		8			// query a directory server in the background when fewer hosts than this are available
+#define HOSTDIR_QUERY_INTERVAL		60			// min seconds between background queries that weren't requested
+#define HOSTDIR_WAIT_SECS			60			// max seconds GetHostName waits for a query when no hosts are available
+#define HOSTDIR_LEASE_SECS			150			// a host isn't returned again until its connection reports back or this time passes; must be > TOR_TIMEOUT
+#define HOSTDIR_RETRY_SECS			60			// wait before retrying a host that failed to connect, doubled for each consecutive failure up to 32x
+#define HOSTDIR_MAX_FAILURES		6			// a host is dropped after this many consecutive failures
+#define HOSTDIR_EXPIRE_SECS			(7*24*3600)	// a host is dropped when it hasn't been seen for this long
+#define HOSTDIR_SAVE_SECS			60
+#define HOSTDIR_MIN_SESSION_MS		5000		// shorter sessions aren't used to measure throughput
+#define HOSTDIR_UNKNOWN_CONNECT_MS	6000		// connect latency assumed for a host that has never connected
+#define HOSTDIR_REF_BYTES_PER_SEC	10000.0f	// a host with this throughput ranks as though its connect latency were half
+#define HOSTDIR_SMOOTHING			0.25f
+
 #define TRACE_HOSTDIR	(g_params.trace_host_dir)
 
+static MetricCounter s_queries("hostdir.queries");
+static MetricCounter s_query_failures("hostdir.query_failures");
+static MetricCounter s_waits("hostdir.waits");
+static MetricCounter s_connects("hostdir.connects");
+static MetricCounter s_connect_failures("hostdir.connect_failures");
+static MetricHistogram s_connect_usec("hostdir.connect_usec");
+
 // .onion addresses are 16 characters in base32 = 10 bytes
 
 bool HostDir::Init()
 {
-	if (m_directory_servers.size())
+	lock_guard<mutex> lock(classlock);
+
+	// Init is called by each service that makes outgoing connections
+
+	if (m_query_thread.joinable())
 	{
 		BOOST_LOG_TRIVIAL(trace) << " HostDir::Init already initialized";
 
 		return false;
 	}
 
-	BOOST_LOG_TRIVIAL(trace) << " HostDir::Init file \"" << g_params.directory_servers_file << "\"";
+	auto rc = ReadServersFile();
+
+	LoadCache();
+
+	BOOST_LOG_TRIVIAL(trace) << " HostDir::Init creating thread for QueryProc";
+	thread worker(&HostDir::QueryProc, this);
+	m_query_thread.swap(worker);
+
+	return rc;
+}
+
+void HostDir::DeInit()
+{
+	{
+		lock_guard<mutex> lock(classlock);
+
+		m_query_cv.notify_all();
+	}
+
+	if (m_query_thread.joinable())
+		m_query_thread.join();
+
+	lock_guard<mutex> lock(classlock);
+
+	if (m_save_needed)
+		SaveCache();
+}
+
+bool HostDir::ReadServersFile()
+{
+	BOOST_LOG_TRIVIAL(trace) << " HostDir::ReadServersFile file \"" << g_params.directory_servers_file << "\"";
 
 	CCASSERT(g_params.directory_servers_file.length());
 
@@ -42,7 +100,7 @@ bool HostDir::Init()
 	fs.open(g_params.directory_servers_file, fstream::in);
 	if(!fs.is_open())
 	{
-		BOOST_LOG_TRIVIAL(error) << " HostDir::Init error opening private relay hosts file \"" << g_params.directory_servers_file << "\"";
+		BOOST_LOG_TRIVIAL(error) << " HostDir::ReadServersFile error opening private relay hosts file \"" << g_params.directory_servers_file << "\"";
 
 		return true;
 	}
@@ -55,7 +113,7 @@ bool HostDir::Init()
 
 		if (fs.fail() && !fs.eof())
 		{
-			BOOST_LOG_TRIVIAL(error) << " HostDir::Init error reading private relay hosts file \"" << g_params.directory_servers_file << "\"";
+			BOOST_LOG_TRIVIAL(error) << " HostDir::ReadServersFile error reading private relay hosts file \"" << g_params.directory_servers_file << "\"";
 
 			return true;
 		}
@@ -74,7 +132,7 @@ bool HostDir::Init()
 
 		if (line.length() > 0)
 		{
-			BOOST_LOG_TRIVIAL(trace) << " HostDir::Init read hostname \"" << line << "\"";
+			BOOST_LOG_TRIVIAL(trace) << " HostDir::ReadServersFile read hostname \"" << line << "\"";
 
 			m_directory_servers.push_back(line);
 		}
@@ -83,36 +141,252 @@ bool HostDir::Init()
 			break;
 	}
 
-	BOOST_LOG_TRIVIAL(debug) << " HostDir::Init loaded " << m_directory_servers.size() << " private directory hostnames";
+	BOOST_LOG_TRIVIAL(debug) << " HostDir::ReadServersFile loaded " << m_directory_servers.size() << " private directory hostnames";
 
 	return false;
 }
 
-string HostDir::GetHostName(HostType type)
+static unsigned RetrySecs(unsigned nfailures)
 {
-	lock_guard<mutex> lock(classlock);
+	return HOSTDIR_RETRY_SECS << min(nfailures - 1, 5U);
+}
+
+bool HostDir::IsAvailable(const HostEntry& host, uint32_t now) const
+{
+	if (host.connected)
+		return false;
+
+	if (host.leased && ccticks_elapsed(host.lease_ticks, now) < HOSTDIR_LEASE_SECS * CCTICKS_PER_SEC)
+		return false;
 
-	if (type < 0 || type >= N_HostTypes || hostnames[type].empty())
-		QueryServer();
+	if (host.nfailures && ccticks_elapsed(host.fail_ticks, now) < (int32_t)RetrySecs(host.nfailures) * CCTICKS_PER_SEC)
+		return false;
+
+	return true;
+}
+
+unsigned HostDir::CountAvailable(HostType type, uint32_t now) const
+{
+	unsigned count = 0;
+
+	for (auto& it : m_hosts[type])
+	{
+		if (IsAvailable(it.second, now))
+			++count;
+	}
+
+	return count;
+}
+
+// lower is better
+// the cost is the expected connect latency, discounted by the throughput measured in past sessions
+
+float HostDir::Cost(const HostEntry& host)
+{
+	float cost = (host.nsessions ? host.connect_ms : HOSTDIR_UNKNOWN_CONNECT_MS);
+
+	cost *= HOSTDIR_REF_BYTES_PER_SEC / (HOSTDIR_REF_BYTES_PER_SEC + host.bytes_per_sec);
+
+	cost += host.nfailures * HOSTDIR_UNKNOWN_CONNECT_MS;
+
+	return cost;
+}
+
+string HostDir::GetHostName(HostType type, bool wait)
+{
+	unique_lock<mutex> lock(classlock);
+
+	if (type < 0 || type >= N_HostTypes)
+	{
+		++m_queries_requested;
+		m_query_cv.notify_all();
 
-	if (type < 0 || type >= N_HostTypes || hostnames[type].empty())
 		return string();
-	else
+	}
+
+	for (bool waited = false; ; waited = true)
 	{
-		auto name = hostnames[type].front();
-		hostnames[type].pop_front();
+		auto now = ccticks();
+
+		HostMap::iterator best = m_hosts[type].end();
+		float best_cost = 0;
+
+		for (auto it = m_hosts[type].begin(); it != m_hosts[type].end(); ++it)
+		{
+			if (!IsAvailable(it->second, now))
+				continue;
+
+			auto cost = Cost(it->second);
 
-		if (TRACE_HOSTDIR) BOOST_LOG_TRIVIAL(trace) << "HostDir::GetHostName returning " << name;
+			if (best == m_hosts[type].end() || cost < best_cost)
+			{
+				best = it;
+				best_cost = cost;
+			}
+		}
+
+		if (best != m_hosts[type].end())
+		{
+			best->second.leased = true;
+			best->second.lease_ticks = now;
+
+			if (TRACE_HOSTDIR) BOOST_LOG_TRIVIAL(trace) << "HostDir::GetHostName returning " << best->first << " sessions " << best->second.nsessions << " connect ms " << best->second.connect_ms << " bytes/sec " << best->second.bytes_per_sec;
+
+			// wake the query thread so it can check if the cache is running low
+
+			m_query_cv.notify_all();
+
+			return best->first;
+		}
+
+		if (!wait || waited || g_shutdown || !m_query_thread.joinable() || !m_directory_servers.size())
+			return string();	// when !wait, the query thread will refill the cache on its own since it's running low
+
+		// nothing available, so wait for the next query to finish; this only happens when the cache is cold
+
+		if (TRACE_HOSTDIR) BOOST_LOG_TRIVIAL(trace) << "HostDir::GetHostName no hosts available; waiting for directory query";
 
-		return name;
+		s_waits.Add();
+
+		auto done = m_queries_done;
+		++m_queries_requested;
+		m_query_cv.notify_all();
+
+		m_query_cv.wait_for(lock, chrono::seconds(HOSTDIR_WAIT_SECS), [this, done]{ return g_shutdown || m_queries_done != done; });
 	}
 }
 
-void HostDir::QueryServer()
+void HostDir::ReportConnected(HostType type, const string& name, int connect_ms)
+{
+	if (type < 0 || type >= N_HostTypes || name.empty())
+		return;
+
+	s_connect_usec.Record((uint64_t)connect_ms * 1000);
+
+	lock_guard<mutex> lock(classlock);
+
+	auto it = m_hosts[type].find(name);
+	if (it == m_hosts[type].end())
+		return;		// not from a directory server, or pruned while connecting
+
+	it->second.connected = true;
+}
+
+void HostDir::ReportSession(HostType type, const string& name, int connect_ms, uint64_t nbytes, int session_ms)
 {
-	if (!m_directory_servers.size())
+	if (type < 0 || type >= N_HostTypes || name.empty())
+		return;
+
+	if (connect_ms < 0)
+		s_connect_failures.Add();
+	else
+		s_connects.Add();
+
+	lock_guard<mutex> lock(classlock);
+
+	auto it = m_hosts[type].find(name);
+	if (it == m_hosts[type].end())
 		return;
 
+	auto& host = it->second;
+
+	host.leased = false;
+	host.connected = false;
+
+	if (connect_ms < 0)
+	{
+		++host.nfailures;
+		host.fail_ticks = ccticks();
+	}
+	else
+	{
+		if (!host.nsessions)
+			host.connect_ms = connect_ms;
+		else
+			host.connect_ms += HOSTDIR_SMOOTHING * (connect_ms - host.connect_ms);
+
+		if (session_ms >= HOSTDIR_MIN_SESSION_MS)
+		{
+			float bytes_per_sec = nbytes * (float)CCTICKS_PER_SEC / session_ms;
+
+			if (!host.bytes_per_sec)
+				host.bytes_per_sec = bytes_per_sec;
+			else
+				host.bytes_per_sec += HOSTDIR_SMOOTHING * (bytes_per_sec - host.bytes_per_sec);
+		}
+
+		++host.nsessions;
+		host.nfailures = 0;
+		host.last_seen = time(NULL);
+	}
+
+	m_save_needed = true;
+
+	if (TRACE_HOSTDIR) BOOST_LOG_TRIVIAL(trace) << "HostDir::ReportSession " << name << " connect ms " << connect_ms << " bytes " << nbytes << " session ms " << session_ms << " failures " << host.nfailures << " smoothed connect ms " << host.connect_ms << " bytes/sec " << host.bytes_per_sec;
+}
+
+void HostDir::QueryProc()
+{
+	BOOST_LOG_TRIVIAL(trace) << "HostDir::QueryProc started";
+
+	auto last_query = ccticks() - HOSTDIR_QUERY_INTERVAL * CCTICKS_PER_SEC;
+	auto last_save = ccticks();
+
+	unique_lock<mutex> lock(classlock);
+
+	while (!g_shutdown)
+	{
+		auto now = ccticks();
+
+		bool low = false;
+
+		for (unsigned type = 0; type < N_HostTypes; ++type)
+		{
+			if (CountAvailable((HostType)type, now) < HOSTDIR_PREFETCH_LOW)
+				low = true;
+		}
+
+		if (m_directory_servers.size() && (m_queries_requested || (low && ccticks_elapsed(last_query, now) >= HOSTDIR_QUERY_INTERVAL * CCTICKS_PER_SEC)))
+		{
+			if (m_queries_requested)
+				--m_queries_requested;
+
+			// the directory server round-trip goes through Tor and can take several seconds, so it is made without holding the lock
+
+			lock.unlock();
+
+			if (QueryServer())
+				s_query_failures.Add();
+
+			s_queries.Add();
+
+			lock.lock();
+
+			++m_queries_done;
+			last_query = ccticks();
+
+			m_query_cv.notify_all();
+
+			continue;
+		}
+
+		if (m_save_needed && ccticks_elapsed(last_save, now) >= HOSTDIR_SAVE_SECS * CCTICKS_PER_SEC)
+		{
+			SaveCache();
+
+			last_save = now;
+		}
+
+		m_query_cv.wait_for(lock, chrono::seconds(1));
+	}
+
+	m_query_cv.notify_all();	// release any waiters
+
+	BOOST_LOG_TRIVIAL(trace) << "HostDir::QueryProc ended";
+}
+
+bool HostDir::QueryServer()
+{
 	unsigned server;
 	CCPseudoRandom(&server, sizeof(server));
 	server %= m_directory_servers.size();
@@ -122,11 +396,14 @@ void HostDir::QueryServer()
 
 	string str = Socks::ConnectString(name);
 
-	if (g_relay_service.TorHostname().length())
-		str += "R:" + g_relay_service.TorHostname() + "\n";
+	auto relay_hostname = g_relay_service.TorHostname();
+	auto blockserve_hostname = g_blockserve_service.TorHostname();
+
+	if (relay_hostname.length())
+		str += "R:" + relay_hostname + "\n";
 
-	if (g_blockserve_service.TorHostname().length())
-		str += "B:" + g_blockserve_service.TorHostname() + "\n";
+	if (blockserve_hostname.length())
+		str += "B:" + blockserve_hostname + "\n";
 
 	str += "QRB";
 	str.push_back(0);
@@ -138,7 +415,7 @@ void HostDir::QueryServer()
 	auto e = Socks::SendString(g_params.torproxy_port, str, reply);
 
 	if (e)
-		return;
+		return true;
 
 	//cerr << "directory reply " << reply.length() << " bytes: " << reply << endl;
 
@@ -158,11 +435,34 @@ void HostDir::QueryServer()
 		cerr << "json root[" << i << "] = " << root.getMemberNames().at(i) << endl;
 	#endif
 
-	ParseNameArray(root, "Relay", Relay);
-	ParseNameArray(root, "Block", Blockserve);
+	array<vector<string>, N_HostTypes> names;
+
+	ParseNameArray(root, "Relay", Relay, names[Relay]);
+	ParseNameArray(root, "Block", Blockserve, names[Blockserve]);
+
+	auto now = time(NULL);
+
+	lock_guard<mutex> lock(classlock);
+
+	for (unsigned type = 0; type < N_HostTypes; ++type)
+	{
+		auto& own_hostname = (type == Relay ? relay_hostname : blockserve_hostname);
+
+		for (auto& name : names[type])
+		{
+			if (name == own_hostname)
+				continue;
+
+			m_hosts[type][name].last_seen = now;
+		}
+
+		Prune((HostType)type);
+	}
+
+	return false;
 }
 
-void HostDir::ParseNameArray(Json::Value &root, const char* label, const HostType type)
+void HostDir::ParseNameArray(Json::Value &root, const char* label, const HostType type, vector<string>& names)
 {
 	Json::Value value;
 
@@ -179,10 +479,160 @@ void HostDir::ParseNameArray(Json::Value &root, const char* label, const HostTyp
 		{
 			if (TRACE_HOSTDIR) BOOST_LOG_TRIVIAL(info) << "HostDir::QueryServer found " << label << " name " << name;
 
-			if (hostnames[type].size() > MAX_SAVED_HOSTS)
-				hostnames[type].pop_front();
+			if (names.size() < MAX_REPLY_HOSTS)
+				names.push_back(name);
+		}
+	}
+}
+
+// drops hosts that have failed too often or haven't been seen in a long time, then the worst ranked hosts until the cache fits
+// hosts that are leased or connected are kept so their sessions can report back
+
+void HostDir::Prune(HostType type)
+{
+	auto& hosts = m_hosts[type];
+	auto now = time(NULL);
+
+	for (auto it = hosts.begin(); it != hosts.end(); )
+	{
+		auto& host = it->second;
 
-			hostnames[type].push_back(name);
+		if (!host.leased && !host.connected && (host.nfailures >= HOSTDIR_MAX_FAILURES || now - host.last_seen > HOSTDIR_EXPIRE_SECS))
+		{
+			if (TRACE_HOSTDIR) BOOST_LOG_TRIVIAL(trace) << "HostDir::Prune dropping " << it->first << " failures " << host.nfailures << " last seen " << host.last_seen;
+
+			it = hosts.erase(it);
+
+			m_save_needed = true;
 		}
+		else
+			++it;
 	}
+
+	while (hosts.size() > MAX_SAVED_HOSTS)
+	{
+		auto worst = hosts.end();
+		float worst_cost = 0;
+
+		for (auto it = hosts.begin(); it != hosts.end(); ++it)
+		{
+			if (it->second.leased || it->second.connected)
+				continue;
+
+			auto cost = Cost(it->second);
+
+			if (worst == hosts.end() || cost > worst_cost)
+			{
+				worst = it;
+				worst_cost = cost;
+			}
+		}
+
+		if (worst == hosts.end())
+			break;
+
+		hosts.erase(worst);
+
+		m_save_needed = true;
+	}
+}
+
+// the cache file has one line per host: type (R or B), name, sessions, failures, smoothed connect ms, smoothed bytes/sec, and time last seen
+// only hosts that have connected at least once are saved
+
+void HostDir::LoadCache()
+{
+	auto fname = g_params.app_data_dir + WIDE(PATH_DELIMITER) + s2w(HOSTDIR_CACHE_FILE);
+
+	boost::filesystem::ifstream fs;
+	fs.open(fname, fstream::in);
+	if(!fs.is_open())
+	{
+		BOOST_LOG_TRIVIAL(debug) << " HostDir::LoadCache no host cache file \"" << w2s(fname) << "\"";
+
+		return;
+	}
+
+	auto now = ccticks();
+	unsigned count = 0;
+
+	while (true)
+	{
+		char type;
+		string name;
+		HostEntry host;
+
+		fs >> type >> name >> host.nsessions >> host.nfailures >> host.connect_ms >> host.bytes_per_sec >> host.last_seen;
+
+		if (fs.fail())
+		{
+			if (!fs.eof())
+				BOOST_LOG_TRIVIAL(warning) << " HostDir::LoadCache error reading host cache file \"" << w2s(fname) << "\"";
+
+			break;
+		}
+
+		if ((type != 'R' && type != 'B') || name.empty() || !host.nsessions)
+			continue;
+
+		// hosts that failed last run can be retried right away
+
+		if (host.nfailures)
+			host.fail_ticks = now - RetrySecs(host.nfailures) * CCTICKS_PER_SEC;
+
+		m_hosts[type == 'R' ? Relay : Blockserve][name] = host;
+
+		++count;
+	}
+
+	for (unsigned type = 0; type < N_HostTypes; ++type)
+		Prune((HostType)type);
+
+	m_save_needed = false;
+
+	BOOST_LOG_TRIVIAL(info) << " HostDir::LoadCache loaded " << count << " hosts from \"" << w2s(fname) << "\"";
+}
+
+void HostDir::SaveCache()
+{
+	auto fname = g_params.app_data_dir + WIDE(PATH_DELIMITER) + s2w(HOSTDIR_CACHE_FILE);
+	auto tempname = fname + L".tmp";
+
+	m_save_needed = false;
+
+	{
+		boost::filesystem::ofstream fs;
+		fs.open(tempname, fstream::out | fstream::trunc);
+		if(!fs.is_open())
+		{
+			BOOST_LOG_TRIVIAL(warning) << " HostDir::SaveCache error opening host cache file \"" << w2s(tempname) << "\"";
+
+			return;
+		}
+
+		for (unsigned type = 0; type < N_HostTypes; ++type)
+		{
+			for (auto& it : m_hosts[type])
+			{
+				auto& host = it.second;
+
+				if (host.nsessions)
+					fs << (type == Relay ? 'R' : 'B') << " " << it.first << " " << host.nsessions << " " << host.nfailures << " " << host.connect_ms << " " << host.bytes_per_sec << " " << host.last_seen << endl;
+			}
+		}
+
+		if (fs.fail())
+		{
+			BOOST_LOG_TRIVIAL(warning) << " HostDir::SaveCache error writing host cache file \"" << w2s(tempname) << "\"";
+
+			return;
+		}
+	}
+
+	boost::system::error_code e;
+	boost::filesystem::rename(tempname, fname, e);
+	if (e)
+		BOOST_LOG_TRIVIAL(warning) << " HostDir::SaveCache error renaming host cache file \"" << w2s(tempname) << "\": " << e.message();
+	else if (TRACE_HOSTDIR)
+		BOOST_LOG_TRIVIAL(trace) << " HostDir::SaveCache saved \"" << w2s(fname) << "\"";
 }
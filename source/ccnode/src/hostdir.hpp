@@ -11,6 +11,14 @@
 #include <boost/asio.hpp>
 #include <jsoncpp/json/json.h>
 
+#include <unordered_map>
+
+// Keeps a cache of peer hostnames for the relay and block sync services.
+// Tracker (directory server) queries run on a background thread, which refills the cache before it runs low,
+// so GetHostName normally returns immediately without a round-trip through Tor.
+// The outgoing connections report their connect latency and throughput back to the cache, which uses these to rank the hosts,
+// and the hosts known to be good are saved in the data directory so they can be used right away after a restart.
+
 class HostDir
 {
 public:
@@ -21,15 +29,75 @@ public:
 		N_HostTypes
 	};
 
+	HostDir()
+	 :	m_queries_requested(0),
+		m_queries_done(0),
+		m_save_needed(false)
+	{ }
+
 	bool Init();
+	void DeInit();
+
+	// returns the best available host of this type, or an empty string if none are known
+	// if none are available and wait is true, waits for a directory query
+	// type -1 asks the background thread to query a directory server, to let it know this node is here
+	string GetHostName(HostType type, bool wait = true);
 
-	string GetHostName(HostType type);
+	// called by the outgoing connections to hosts returned by GetHostName, when the connection is established and when it is finished
+	// connect_ms < 0 means the connection was never established
+	void ReportConnected(HostType type, const string& name, int connect_ms);
+	void ReportSession(HostType type, const string& name, int connect_ms, uint64_t nbytes, int session_ms);
 
 private:
-	void QueryServer();
-	void ParseNameArray(Json::Value &root, const char* label, const HostType type);
+	struct HostEntry
+	{
+		unsigned nsessions;			// sessions that connected
+		unsigned nfailures;			// consecutive failures to connect
+		float connect_ms;			// smoothed connect latency
+		float bytes_per_sec;		// smoothed receive throughput
+		int64_t last_seen;			// time last returned by a directory server or connected
+		uint32_t lease_ticks;		// time last returned by GetHostName
+		uint32_t fail_ticks;		// time of last failure
+		bool leased;
+		bool connected;
+
+		HostEntry()
+		 :	nsessions(0),
+			nfailures(0),
+			connect_ms(0),
+			bytes_per_sec(0),
+			last_seen(0),
+			lease_ticks(0),
+			fail_ticks(0),
+			leased(false),
+			connected(false)
+		{ }
+	};
+
+	typedef unordered_map<string, HostEntry> HostMap;
+
+	bool ReadServersFile();
+
+	void QueryProc();
+	bool QueryServer();
+	static void ParseNameArray(Json::Value &root, const char* label, const HostType type, vector<string>& names);
+
+	unsigned CountAvailable(HostType type, uint32_t now) const;
+	bool IsAvailable(const HostEntry& host, uint32_t now) const;
+	static float Cost(const HostEntry& host);
+	void Prune(HostType type);
+
+	void LoadCache();
+	void SaveCache();
 
 	mutex classlock;
+	condition_variable m_query_cv;		// signaled when a query is requested or done
+	thread m_query_thread;
+
 	vector<string> m_directory_servers;
-	array<deque<string>, N_HostTypes> hostnames;
+	array<HostMap, N_HostTypes> m_hosts;
+
+	unsigned m_queries_requested;
+	unsigned m_queries_done;
+	bool m_save_needed;
 };
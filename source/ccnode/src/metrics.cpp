@@ -0,0 +1,146 @@
+/*
+ * CredaCash (TM) cryptocurrency and blockchain
+ *
+ * Copyright (C) 2015-2016 Creda Software, Inc.
+ *
+ * metrics.cpp
+*/
+
+#include "CCdef.h"
+#include "metrics.hpp"
+
+#include <algorithm>
+
+static Metric *s_metrics;		// zero initialized before any constructor runs
+static mutex s_metrics_lock;
+
+static const auto s_start_time = chrono::steady_clock::now();
+
+void MetricWriter::Value(const string& name, int64_t val)
+{
+	if (m_json)
+	{
+		m_os << (m_first ? "{" : ",") << "\"" << name << "\":" << val;
+	}
+	else
+	{
+		m_os << name << " " << val << "\n";
+	}
+
+	m_first = false;
+}
+
+Metric::Metric(const string& name)
+ :	m_name(name)
+{
+	lock_guard<mutex> lock(s_metrics_lock);
+
+	m_next = s_metrics;
+	s_metrics = this;
+}
+
+string Metric::Snapshot(bool json)
+{
+	vector<Metric*> metrics;
+
+	{
+		lock_guard<mutex> lock(s_metrics_lock);
+
+		for (auto metric = s_metrics; metric; metric = metric->m_next)
+			metrics.push_back(metric);
+	}
+
+	sort(metrics.begin(), metrics.end(), [](Metric *a, Metric *b) { return a->Name() < b->Name(); });
+
+	ostringstream os;
+	MetricWriter writer(os, json);
+
+	writer.Value("uptime_secs", chrono::duration_cast<chrono::seconds>(chrono::steady_clock::now() - s_start_time).count());
+
+	for (auto metric : metrics)
+		metric->Write(writer);
+
+	if (json)
+		os << "}\n";
+
+	return os.str();
+}
+
+void MetricCounter::Write(MetricWriter& writer)
+{
+	writer.Value(Name(), m_value.load(memory_order_relaxed));
+}
+
+MetricHistogram::MetricHistogram(const string& name)
+ :	Metric(name),
+	m_sum(0),
+	m_max(0)
+{
+	for (auto& bucket : m_buckets)
+		bucket.store(0);
+}
+
+void MetricHistogram::Record(uint64_t usec)
+{
+	unsigned bucket = 0;
+
+	if (usec)
+		bucket = 64 - __builtin_clzll(usec);
+
+	if (bucket >= METRIC_HISTOGRAM_BUCKETS)
+		bucket = METRIC_HISTOGRAM_BUCKETS - 1;
+
+	m_buckets[bucket].fetch_add(1, memory_order_relaxed);
+	m_sum.fetch_add(usec, memory_order_relaxed);
+
+	auto max = m_max.load(memory_order_relaxed);
+	while (usec > max && !m_max.compare_exchange_weak(max, usec, memory_order_relaxed))
+	{ }
+}
+
+uint64_t MetricHistogram::Percentile(const array<uint64_t, METRIC_HISTOGRAM_BUCKETS>& buckets, uint64_t count, unsigned pct)
+{
+	uint64_t target = (count * pct + 99) / 100;
+	uint64_t sum = 0;
+
+	for (unsigned i = 0; i < METRIC_HISTOGRAM_BUCKETS; ++i)
+	{
+		sum += buckets[i];
+
+		if (sum >= target)
+			return ((uint64_t)1 << i) - 1;
+	}
+
+	return ((uint64_t)1 << (METRIC_HISTOGRAM_BUCKETS - 1)) - 1;
+}
+
+void MetricHistogram::Write(MetricWriter& writer)
+{
+	// the buckets are read one at a time while other threads may be recording,
+	// so the count is summed from the same reads to keep the percentiles consistent
+
+	array<uint64_t, METRIC_HISTOGRAM_BUCKETS> buckets;
+	uint64_t count = 0;
+
+	for (unsigned i = 0; i < METRIC_HISTOGRAM_BUCKETS; ++i)
+	{
+		buckets[i] = m_buckets[i].load(memory_order_relaxed);
+		count += buckets[i];
+	}
+
+	auto sum = m_sum.load(memory_order_relaxed);
+	auto max = m_max.load(memory_order_relaxed);
+
+	writer.Value(Name() + ".count", count);
+	writer.Value(Name() + ".mean", count ? sum / count : 0);
+
+	for (auto pct : {50, 90, 99})
+		writer.Value(Name() + ".p" + to_string(pct), count ? min(Percentile(buckets, count, pct), max) : 0);
+
+	writer.Value(Name() + ".max", max);
+}
+
+void MetricGauge::Write(MetricWriter& writer)
+{
+	writer.Value(Name(), m_getter());
+}
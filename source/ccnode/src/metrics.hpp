@@ -0,0 +1,135 @@
+/*
+ * CredaCash (TM) cryptocurrency and blockchain
+ *
+ * Copyright (C) 2015-2016 Creda Software, Inc.
+ *
+ * metrics.hpp
+*/
+
+#pragma once
+
+#include <boost/function.hpp>
+
+#include <chrono>
+
+// Lock-free counters and latency histograms for the node control service metrics snapshot.
+// Metrics are global objects that add themselves to a registry when they are constructed.
+// Updating a metric is one or two relaxed atomic adds, so they can be left in the hot paths;
+// all of the formatting work is done by Metric::Snapshot when the control service is queried.
+
+#define METRIC_HISTOGRAM_BUCKETS	40		// bucket i holds values < 2^i usec, so the top bucket is about 6 days
+
+class MetricWriter
+{
+	ostream& m_os;
+	bool m_json;
+	bool m_first;
+
+public:
+	MetricWriter(ostream& os, bool json)
+	 :	m_os(os),
+		m_json(json),
+		m_first(true)
+	{ }
+
+	void Value(const string& name, int64_t val);
+};
+
+class Metric
+{
+	const string m_name;
+	Metric *m_next;
+
+	Metric(const Metric&) = delete;
+	Metric& operator= (const Metric&) = delete;
+
+protected:
+	explicit Metric(const string& name);
+
+public:
+	virtual ~Metric() = default;
+
+	const string& Name() const
+	{
+		return m_name;
+	}
+
+	virtual void Write(MetricWriter& writer) = 0;
+
+	// Return a snapshot of all metrics, formatted as "name value" lines or as a flat JSON object
+	static string Snapshot(bool json);
+};
+
+class MetricCounter : public Metric
+{
+	atomic<uint64_t> m_value;
+
+public:
+	explicit MetricCounter(const string& name)
+	 :	Metric(name),
+		m_value(0)
+	{ }
+
+	void Add(uint64_t n = 1)
+	{
+		m_value.fetch_add(n, memory_order_relaxed);
+	}
+
+	void Write(MetricWriter& writer);
+};
+
+class MetricHistogram : public Metric
+{
+	array<atomic<uint64_t>, METRIC_HISTOGRAM_BUCKETS> m_buckets;
+	atomic<uint64_t> m_sum;
+	atomic<uint64_t> m_max;
+
+	static uint64_t Percentile(const array<uint64_t, METRIC_HISTOGRAM_BUCKETS>& buckets, uint64_t count, unsigned pct);
+
+public:
+	explicit MetricHistogram(const string& name);
+
+	void Record(uint64_t usec);
+
+	uint64_t Sum() const
+	{
+		return m_sum.load(memory_order_relaxed);
+	}
+
+	// Writes the count, mean, p50, p90, p99 and max; the percentiles are the upper bound of the bucket that holds them
+	void Write(MetricWriter& writer);
+};
+
+// Records the time from construction to destruction in a histogram
+
+class MetricTimer
+{
+	MetricHistogram& m_histogram;
+	chrono::steady_clock::time_point m_t0;
+
+public:
+	explicit MetricTimer(MetricHistogram& histogram)
+	 :	m_histogram(histogram),
+		m_t0(chrono::steady_clock::now())
+	{ }
+
+	~MetricTimer()
+	{
+		m_histogram.Record(chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - m_t0).count());
+	}
+};
+
+// A value that is computed when the snapshot is taken, for things like queue depths that already have a counter elsewhere
+
+class MetricGauge : public Metric
+{
+	const boost::function<int64_t()> m_getter;
+
+public:
+	MetricGauge(const string& name, const boost::function<int64_t()>& getter)
+	 :	Metric(name),
+		m_getter(getter)
+	{ }
+
+	void Write(MetricWriter& writer);
+};
@@ -8,17 +8,17 @@
 
 #include "CCdef.h"
 #include "processblock.hpp"
+#include "blocktree.hpp"
 #include "block.hpp"
 #include "blockchain.hpp"
 #include "witness.hpp"
+#include "metrics.hpp"
 #include "util.h"
 
 #include <CCobjects.hpp>
 #include <transaction.h>
 #include <ccserver/connection_registry.hpp>
 
-#define TRACE_PROCESS	(g_params.trace_block_validation)
-
 //#define TEST_CUZZ		1
 
 #ifndef TEST_CUZZ
@@ -27,11 +27,16 @@
 
 ProcessBlock g_processblock;
 
+static MetricCounter s_block_valid("processblock.valid");
+static MetricCounter s_block_invalid("processblock.invalid");
+static MetricHistogram s_block_validate_usec("processblock.validate_usec");
+static MetricGauge s_block_queued("processblock.queued", []{ return DbConnProcessQ::QueuedWork(PROCESS_Q_TYPE_BLOCK); });
+
 static DbConn *dbconn = NULL;
 
 void ProcessBlock::Init()
 {
-	if (TRACE_PROCESS) BOOST_LOG_TRIVIAL(trace) << "ProcessBlock::Init";
+	CCLOG(g_log_block_validation, trace) << "ProcessBlock::Init";
 
 	dbconn = new DbConn;
 
@@ -40,7 +45,7 @@ void ProcessBlock::Init()
 
 void ProcessBlock::DeInit()
 {
-	if (TRACE_PROCESS) BOOST_LOG_TRIVIAL(trace) << "ProcessBlock::DeInit";
+	CCLOG(g_log_block_validation, trace) << "ProcessBlock::DeInit";
 
 	DbConnProcessQ::StopQueuedWork(PROCESS_Q_TYPE_BLOCK);
 
@@ -55,7 +60,7 @@ void ProcessBlock::DeInit()
 
 	delete dbconn;
 
-	if (TRACE_PROCESS) BOOST_LOG_TRIVIAL(trace) << "ProcessBlock::DeInit done";
+	CCLOG(g_log_block_validation, trace) << "ProcessBlock::DeInit done";
 }
 
 int ProcessBlock::BlockValidate(DbConn *dbconn, SmartBuf smartobj, struct TxPay &txbuf)
@@ -67,7 +72,7 @@ int ProcessBlock::BlockValidate(DbConn *dbconn, SmartBuf smartobj, struct TxPay
 
 	CCASSERT(auxp);
 
-	if (TRACE_PROCESS) BOOST_LOG_TRIVIAL(trace) << "ProcessBlock::BlockValidate block bufp " << (uintptr_t)bufp << " level " << wire->level << " witness " << (unsigned)wire->witness << " oid " << buf2hex(&auxp->oid, sizeof(ccoid_t)) << " prior oid " << buf2hex(&wire->prior_oid, sizeof(ccoid_t));
+	CCLOG(g_log_block_validation, trace) << "ProcessBlock::BlockValidate block bufp " << (uintptr_t)bufp << " level " << wire->level << " witness " << (unsigned)wire->witness << " oid " << buf2hex(&auxp->oid, sizeof(ccoid_t)) << " prior oid " << buf2hex(&wire->prior_oid, sizeof(ccoid_t));
 
 	auto prune_level = g_blockchain.ComputePruneLevel(1, BLOCK_PRUNE_ROUNDS);
 
@@ -135,13 +140,13 @@ int ProcessBlock::BlockValidate(DbConn *dbconn, SmartBuf smartobj, struct TxPay
 	auto pdata = block->TxData();
 	auto pend = block->ObjEndPtr();
 
-	if (TRACE_PROCESS) BOOST_LOG_TRIVIAL(trace) << "ProcessBlock::BlockValidate block level " << wire->level << " bufp " << (uintptr_t)bufp << " objsize " << block->ObjSize() << " pdata " << (uintptr_t)pdata << " pend " << (uintptr_t)pend;
+	CCLOG(g_log_block_validation, trace) << "ProcessBlock::BlockValidate block level " << wire->level << " bufp " << (uintptr_t)bufp << " objsize " << block->ObjSize() << " pdata " << (uintptr_t)pdata << " pend " << (uintptr_t)pend;
 
 	while (pdata < pend)
 	{
 		auto txsize = *(uint32_t*)pdata;
 
-		//if (TRACE_PROCESS) BOOST_LOG_TRIVIAL(trace) << "ProcessBlock::BlockValidate ptxdata " << (uintptr_t)pdata << " txsize " << txsize << " data " << buf2hex(pdata, 16);
+		//CCLOG(g_log_block_validation, trace) << "ProcessBlock::BlockValidate ptxdata " << (uintptr_t)pdata << " txsize " << txsize << " data " << buf2hex(pdata, 16);
 
 		// !!! need to look up each tx in validobj's
 
@@ -196,7 +201,7 @@ void ProcessBlock::ValidObjsBlockInsert(DbConn *dbconn, SmartBuf smartobj, struc
 	auto wire = block->WireData();
 	auto auxp = block->AuxPtr();
 
-	if (TRACE_PROCESS) BOOST_LOG_TRIVIAL(trace) << "ProcessBlock::ValidObjsBlockInsert enqueue " << enqueue << " check indelible " << check_indelible << " block level " << wire->level << " witness " << (unsigned)wire->witness << " size " << block->ObjSize() << " oid " << buf2hex(&auxp->oid, sizeof(ccoid_t)) << " prior oid " << buf2hex(&wire->prior_oid, sizeof(ccoid_t));
+	CCLOG(g_log_block_validation, trace) << "ProcessBlock::ValidObjsBlockInsert enqueue " << enqueue << " check indelible " << check_indelible << " block level " << wire->level << " witness " << (unsigned)wire->witness << " size " << block->ObjSize() << " oid " << buf2hex(&auxp->oid, sizeof(ccoid_t)) << " prior oid " << buf2hex(&wire->prior_oid, sizeof(ccoid_t));
 
 	if (dbconn->ValidObjsInsert(smartobj))
 	{
@@ -213,10 +218,15 @@ void ProcessBlock::ValidObjsBlockInsert(DbConn *dbconn, SmartBuf smartobj, struc
 	if (enqueue)
 	{
 		dbconn->ProcessQEnqueueValidate(PROCESS_Q_TYPE_BLOCK, smartobj, &wire->prior_oid, wire->level, PROCESS_Q_STATUS_VALID, 0, 0, 0);
+
+		if (IsWitness())
+			g_blocktree.Add(smartobj);
 	}
 	else if (IsWitness())
 	{
 		dbconn->ProcessQUpdateValidObj(PROCESS_Q_TYPE_BLOCK, auxp->oid, PROCESS_Q_STATUS_VALID, 0);
+
+		g_blocktree.Add(smartobj);
 	}
 	else
 	{
@@ -242,6 +252,9 @@ void ProcessBlock::ValidObjsBlockInsert(DbConn *dbconn, SmartBuf smartobj, struc
 		if (done_level > prune_level)
 			dbconn->ProcessQDone(PROCESS_Q_TYPE_BLOCK, done_level);
 
+		if (IsWitness())
+			g_blocktree.Prune(done_level > prune_level ? done_level : prune_level);
+
 		static uint64_t last_pruned_level = 0;
 
 		if (prune_level > last_pruned_level && prune_level % 3 == 0)	// requires a table scan, so only do it every 4 levels
@@ -261,7 +274,7 @@ void ProcessBlock::ThreadProc()
 {
 	static TxPay txbuf;
 
-	if (TRACE_PROCESS) BOOST_LOG_TRIVIAL(trace) << "ProcessBlock::ThreadProc start dbconn " << (uintptr_t)dbconn;
+	CCLOG(g_log_block_validation, trace) << "ProcessBlock::ThreadProc start dbconn " << (uintptr_t)dbconn;
 
 	while (true)
 	{
@@ -291,6 +304,8 @@ void ProcessBlock::ThreadProc()
 				break;
 			}
 
+			MetricTimer timer(s_block_validate_usec);
+
 			result = BlockValidate(dbconn, smartobj, txbuf);
 			if (result)
 				break;
@@ -303,16 +318,19 @@ void ProcessBlock::ThreadProc()
 
 			ValidObjsBlockInsert(dbconn, smartobj, txbuf);
 
-			if (1)
-			{
-				int64_t age = time(NULL) - wire->timestamp;
-				lock_guard<FastSpinLock> lock(g_cout_lock);
-				cerr << " received block level " << wire->level << " witness " << (unsigned)wire->witness << " skip " << auxp->skip << " size " << (block->ObjSize() < 1000 ? " " : "") << block->ObjSize() << " oid " << buf2hex(&auxp->oid, 3, 0) << ".. prior " << buf2hex(&wire->prior_oid, 3, 0) << ".. age " << age << endl;
-			}
+			CCLOG(g_log_block_console, info) << " received block level " << wire->level << " witness " << (unsigned)wire->witness << " skip " << auxp->skip << " size " << (block->ObjSize() < 1000 ? " " : "") << block->ObjSize() << " oid " << buf2hex(&auxp->oid, 3, 0) << ".. prior " << buf2hex(&wire->prior_oid, 3, 0) << ".. age " << time(NULL) - wire->timestamp;
 
 			break;
 		}
 
+		if (smartobj)
+		{
+			if (result)
+				s_block_invalid.Add();
+			else
+				s_block_valid.Add();
+		}
+
 		if (conn_index && result < 0)
 		{
 			auto conn = g_connregistry.GetConn(conn_index);
@@ -321,5 +339,5 @@ void ProcessBlock::ThreadProc()
 		}
 	}
 
-	if (TRACE_PROCESS) BOOST_LOG_TRIVIAL(trace) << "ProcessBlock::ThreadProc end dbconn " << (uintptr_t)dbconn;
+	CCLOG(g_log_block_validation, trace) << "ProcessBlock::ThreadProc end dbconn " << (uintptr_t)dbconn;
 }
@@ -14,6 +14,7 @@
 #include "commitments.hpp"
 #include "dbparamkeys.h"
 #include "witness.hpp"
+#include "metrics.hpp"
 
 #include <transaction.hpp>
 #include <transaction.h>
@@ -21,10 +22,14 @@
 #include <CCobjects.hpp>
 #include <ccserver/connection_registry.hpp>
 
-#define TRACE_PROCESS	(g_params.trace_tx_validation)
-
 ProcessTx g_processtx;
 
+static MetricCounter s_tx_valid("processtx.valid");
+static MetricCounter s_tx_invalid("processtx.invalid");
+static MetricHistogram s_tx_validate_usec("processtx.validate_usec");
+static MetricHistogram s_proof_verify_usec("proof.verify_usec");
+static MetricGauge s_tx_queued("processtx.queued", []{ return DbConnProcessQ::QueuedWork(PROCESS_Q_TYPE_TX); });
+
 void ProcessTx::Init()
 {
 	if (g_params.tx_validation_threads < 0)
@@ -41,7 +46,7 @@ void ProcessTx::Init()
 
 void ProcessTx::DeInit()
 {
-	if (TRACE_PROCESS) BOOST_LOG_TRIVIAL(trace) << "ProcessTx::DeInit";
+	CCLOG(g_log_tx_validation, trace) << "ProcessTx::DeInit";
 
 	DbConnProcessQ::StopQueuedWork(PROCESS_Q_TYPE_TX);
 
@@ -53,12 +58,12 @@ void ProcessTx::DeInit()
 
 	m_threads.clear();
 
-	if (TRACE_PROCESS) BOOST_LOG_TRIVIAL(trace) << "ProcessTx::DeInit done";
+	CCLOG(g_log_tx_validation, trace) << "ProcessTx::DeInit done";
 }
 
 const char* ProcessTx::ResultString(int result)
 {
-	//if (TRACE_PROCESS) BOOST_LOG_TRIVIAL(trace) << "ProcessTx::ResultString result " << result;
+	//CCLOG(g_log_tx_validation, trace) << "ProcessTx::ResultString result " << result;
 
 	static const char *tx_result_warn_strings[] =
 	{
@@ -99,7 +104,7 @@ const char* ProcessTx::ResultString(int result)
 
 int ProcessTx::TxEnqueueValidate(DbConn *dbconn, int64_t priority, SmartBuf smartobj, unsigned conn_index, unsigned callback_id)
 {
-	if (TRACE_PROCESS) BOOST_LOG_TRIVIAL(debug) << "ProcessTx::TxEnqueueValidate priority " << priority << " smartobj " << (uintptr_t)&smartobj;
+	CCLOG(g_log_tx_validation, debug) << "ProcessTx::TxEnqueueValidate priority " << priority << " smartobj " << (uintptr_t)&smartobj;
 
 	auto obj = (CCObject*)smartobj.data();
 
@@ -109,7 +114,7 @@ int ProcessTx::TxEnqueueValidate(DbConn *dbconn, int64_t priority, SmartBuf smar
 
 	dbconn->RelayObjsInsert(0, CC_TAG_TX_WIRE, req_params, RELAY_STATUS_DOWNLOADED, 0);	// so we don't download it after sending it to someone else
 
-	if (TRACE_PROCESS) BOOST_LOG_TRIVIAL(trace) << "ProcessTx::TxEnqueueValidate priority " << priority << " bufp " << (uintptr_t)(smartobj.BasePtr()) << " oid " << buf2hex(obj->OidPtr(), sizeof(ccoid_t)) << " conn_index Conn-" << conn_index << " callback_id " << callback_id;
+	CCLOG(g_log_tx_validation, trace) << "ProcessTx::TxEnqueueValidate priority " << priority << " bufp " << (uintptr_t)(smartobj.BasePtr()) << " oid " << buf2hex(obj->OidPtr(), sizeof(ccoid_t)) << " conn_index Conn-" << conn_index << " callback_id " << callback_id;
 
 	auto rc = dbconn->ProcessQEnqueueValidate(PROCESS_Q_TYPE_TX, smartobj, NULL, 0, PROCESS_Q_STATUS_PENDING, priority, conn_index, callback_id);
 
@@ -188,7 +193,15 @@ int ProcessTx::TxValidate(DbConn *dbconn, struct TxPay& tx, SmartBuf smartobj)
 
 #endif // !TEST_EXTRA_ON_WIRE
 
-	if (CCProof_VerifyProof(tx))
+	int verify_failed;
+
+	{
+		MetricTimer timer(s_proof_verify_usec);
+
+		verify_failed = CCProof_VerifyProof(tx);
+	}
+
+	if (verify_failed)
 	{
 		BOOST_LOG_TRIVIAL(info) << "DbConnProcessQ::TxValidate error CCProof_VerifyProof failed";
 
@@ -254,7 +267,7 @@ void ProcessTx::ThreadProc()
 
 	struct TxPay& tx = *ptx;
 
-	if (TRACE_PROCESS) BOOST_LOG_TRIVIAL(trace) << "ProcessTx::ThreadProc start dbconn " << (uintptr_t)dbconn;
+	CCLOG(g_log_tx_validation, trace) << "ProcessTx::ThreadProc start dbconn " << (uintptr_t)dbconn;
 
 	while (true)
 	{
@@ -277,6 +290,8 @@ void ProcessTx::ThreadProc()
 				break;
 			}
 
+			MetricTimer timer(s_tx_validate_usec);
+
 			SmartBuf retobj;
 			auto obj = (CCObject*)smartobj.data();
 
@@ -360,6 +375,14 @@ void ProcessTx::ThreadProc()
 			break;
 		}
 
+		if (smartobj)
+		{
+			if (result < 0)
+				s_tx_invalid.Add();
+			else
+				s_tx_valid.Add();
+		}
+
 		if (conn_index)
 		{
 			auto conn = g_connregistry.GetConn(conn_index);
@@ -368,7 +391,7 @@ void ProcessTx::ThreadProc()
 		}
 	}
 
-	if (TRACE_PROCESS) BOOST_LOG_TRIVIAL(trace) << "ProcessTx::ThreadProc end dbconn " << (uintptr_t)dbconn;
+	CCLOG(g_log_tx_validation, trace) << "ProcessTx::ThreadProc end dbconn " << (uintptr_t)dbconn;
 
 	delete ptx;
 	delete dbconn;
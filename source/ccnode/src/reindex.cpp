@@ -0,0 +1,808 @@
+/*
+ * CredaCash (TM) cryptocurrency and blockchain
+ *
+ * Copyright (C) 2015-2016 Creda Software, Inc.
+ *
+ * reindex.cpp
+*/
+
+#include "CCdef.h"
+#include "reindex.hpp"
+#include "blockchain.hpp"
+#include "block.hpp"
+#include "blocksigs.hpp"
+#include "processblock.hpp"
+#include "metrics.hpp"
+#include "util.h"
+
+#include <CCobjects.hpp>
+#include <CCproof.h>
+#include <transaction.h>
+#include <dblog.h>
+#include <Finally.hpp>
+
+#include <iomanip>
+
+/*
+
+A block file holds a uint32 REINDEX_BLOCK_FILE_TAG, followed by each block of the blockchain in level order starting at the
+genesis block, stored exactly as in the Blockchain table (the block object starting with its CCObject::Header).
+
+The replay runs each block through the same steps a block takes when it is received and becomes indelible:
+	read			read the block from the source
+	hash			SetupAuxBuf and SetOrVerifyOid
+	signatures		batch verify the signatures of REINDEX_BATCH_BLOCKS blocks with g_blocksigs
+	validate		ProcessBlock::BlockValidate
+	proof queue		look up the Merkle root of each tx and queue it for proof verification (only with proof threads)
+	proof wait		wait for the worker threads to verify the proofs of the block's tx's (only with proof threads)
+	index txs		BlockChain::IndexTxs, inside SetNewlyIndelibleBlock
+	commit tree		Commitments::UpdateCommitTree, inside SetNewlyIndelibleBlock
+	block insert	the rest of SetNewlyIndelibleBlock: BlockchainInsert and the block aux parameters
+	db commit		committing the write transaction
+The proofs of a block's tx's are verified in parallel on the worker threads, and the block is only made indelible after all of
+them pass, so a bad proof never reaches the new persistent DB. The total worker thread time is reported separately.
+
+Each stage's time is recorded in a "reindex." metric histogram, and the totals are logged when the replay ends.
+
+*/
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+#define REINDEX_BLOCK_FILE_TAG		0x4b424343	// CCBK in little endian format
+
+#define REINDEX_BATCH_BLOCKS		64			// blocks read ahead so their signatures can be batch verified
+#define REINDEX_PROOF_QUEUE_MAX		4096		// tx's waiting for proof verification before the replay waits for the workers
+#define REINDEX_PRUNE_INTERVAL		64			// levels between pruning the Temp_Serials table
+#define REINDEX_PROGRESS_SECS		10
+
+static const char sqlite_file_header[] = "SQLite format 3";
+
+static MetricCounter s_blocks("reindex.blocks");
+static MetricCounter s_txs("reindex.txs");
+static MetricCounter s_proofs_verified("reindex.proofs_verified");
+static MetricCounter s_proofs_failed("reindex.proofs_failed");
+static MetricHistogram s_read_usec("reindex.read_usec");
+static MetricHistogram s_hash_usec("reindex.hash_usec");
+static MetricHistogram s_sigs_usec("reindex.sigs_usec");
+static MetricHistogram s_validate_usec("reindex.validate_usec");
+static MetricHistogram s_proof_queue_usec("reindex.proof_queue_usec");
+static MetricHistogram s_proof_wait_usec("reindex.proof_wait_usec");
+static MetricHistogram s_proof_usec("reindex.proof_usec");
+static MetricHistogram s_indelible_usec("reindex.indelible_usec");
+
+static bool CheckBlockHeader(const void *data, unsigned size)
+{
+	auto obj = (const CCObject::Header*)data;
+
+	if (size < sizeof(CCObject::Header) + sizeof(BlockWireHeader) || size > CC_BLOCK_MAX_SIZE)
+	{
+		BOOST_LOG_TRIVIAL(error) << "Reindex block size " << size << " < " << sizeof(CCObject::Header) + sizeof(BlockWireHeader) << " or > CC_BLOCK_MAX_SIZE " << CC_BLOCK_MAX_SIZE;
+
+		return true;
+	}
+
+	if (obj->tag != CC_TAG_BLOCK)
+	{
+		BOOST_LOG_TRIVIAL(error) << "Reindex block tag " << obj->tag << " != CC_TAG_BLOCK " << CC_TAG_BLOCK;
+
+		return true;
+	}
+
+	return false;
+}
+
+// source of the blocks to replay, in level order
+
+class ReindexSource
+{
+public:
+	virtual ~ReindexSource() = default;
+
+	// returns 0 and the next block, 1 after the last block, or -1 on error
+	virtual int Next(SmartBuf *retobj) = 0;
+};
+
+// another node's persistent DB, opened read only
+
+class ReindexDbSource : public ReindexSource
+{
+	sqlite3 *m_db;
+	sqlite3_stmt *m_stmt;
+
+public:
+	ReindexDbSource()
+	 :	m_db(NULL),
+		m_stmt(NULL)
+	{ }
+
+	~ReindexDbSource()
+	{
+		if (m_stmt)
+			sqlite3_finalize(m_stmt);
+
+		if (m_db)
+			sqlite3_close_v2(m_db);
+	}
+
+	bool Open(const wstring& path)
+	{
+		if (dblog(sqlite3_open_v2(w2s(path).c_str(), &m_db, SQLITE_OPEN_READONLY, NULL)))
+			return true;
+
+		if (dblog(sqlite3_prepare_v2(m_db, "select Block from Blockchain order by Level;", -1, &m_stmt, NULL)))
+			return true;
+
+		return false;
+	}
+
+	int Next(SmartBuf *retobj)
+	{
+		int rc;
+
+		if (dblog(rc = sqlite3_step(m_stmt), DB_STMT_SELECT)) return -1;
+
+		if (rc == SQLITE_DONE)
+			return 1;
+
+		if (rc != SQLITE_ROW)
+		{
+			BOOST_LOG_TRIVIAL(error) << "ReindexDbSource::Next select returned " << rc;
+
+			return -1;
+		}
+
+		auto data_blob = sqlite3_column_blob(m_stmt, 0);
+		auto datasize = sqlite3_column_bytes(m_stmt, 0);
+
+		if (!data_blob || CheckBlockHeader(data_blob, datasize))
+			return -1;
+
+		SmartBuf smartobj(datasize + sizeof(CCObject::Preamble));
+		if (!smartobj)
+			return -1;
+
+		memcpy(smartobj.data() + sizeof(CCObject::Preamble), data_blob, datasize);
+
+		*retobj = smartobj;
+
+		return 0;
+	}
+};
+
+// a block file written by Reindex::ExportBlocks
+
+class ReindexFileSource : public ReindexSource
+{
+	int m_fd;
+
+public:
+	ReindexFileSource()
+	 :	m_fd(-1)
+	{ }
+
+	~ReindexFileSource()
+	{
+		if (m_fd >= 0)
+			close(m_fd);
+	}
+
+	bool Open(const wstring& path)
+	{
+		m_fd = open_file(path, O_BINARY | O_RDONLY);
+		if (m_fd < 0)
+		{
+			BOOST_LOG_TRIVIAL(error) << "ReindexFileSource::Open error opening file \"" << w2s(path) << "\"; " << strerror(errno);
+
+			return true;
+		}
+
+		uint32_t tag;
+
+		if (read(m_fd, &tag, sizeof(tag)) != sizeof(tag) || tag != REINDEX_BLOCK_FILE_TAG)
+		{
+			BOOST_LOG_TRIVIAL(error) << "ReindexFileSource::Open \"" << w2s(path) << "\" is not a block file";
+
+			return true;
+		}
+
+		return false;
+	}
+
+	int Next(SmartBuf *retobj)
+	{
+		CCObject::Header header;
+
+		auto rc = read(m_fd, &header, sizeof(header));
+		if (rc == 0)
+			return 1;
+
+		if (rc != sizeof(header) || CheckBlockHeader(&header, header.size))
+		{
+			BOOST_LOG_TRIVIAL(error) << "ReindexFileSource::Next invalid block header";
+
+			return -1;
+		}
+
+		SmartBuf smartobj(header.size + sizeof(CCObject::Preamble));
+		if (!smartobj)
+			return -1;
+
+		auto bufp = smartobj.data() + sizeof(CCObject::Preamble);
+
+		memcpy(bufp, &header, sizeof(header));
+
+		auto nbytes = header.size - sizeof(header);
+
+		if (read(m_fd, bufp + sizeof(header), nbytes) != (ssize_t)nbytes)
+		{
+			BOOST_LOG_TRIVIAL(error) << "ReindexFileSource::Next error reading block; " << strerror(errno);
+
+			return -1;
+		}
+
+		*retobj = smartobj;
+
+		return 0;
+	}
+};
+
+static ReindexSource* OpenSource(const wstring& path)
+{
+	char header[sizeof(sqlite_file_header)];
+	memset(header, 0, sizeof(header));
+
+	auto fd = open_file(path, O_BINARY | O_RDONLY);
+	if (fd < 0)
+	{
+		BOOST_LOG_TRIVIAL(error) << "Reindex error opening file \"" << w2s(path) << "\"; " << strerror(errno);
+
+		return NULL;
+	}
+
+	auto rc = read(fd, header, sizeof(header));
+	(void)rc;
+
+	close(fd);
+
+	if (!memcmp(header, sqlite_file_header, sizeof(header)))
+	{
+		auto source = new ReindexDbSource;
+
+		if (!source->Open(path))
+			return source;
+
+		delete source;
+	}
+	else
+	{
+		auto source = new ReindexFileSource;
+
+		if (!source->Open(path))
+			return source;
+
+		delete source;
+	}
+
+	return NULL;
+}
+
+int Reindex::ExportBlocks(const wstring& path)
+{
+	DbConn dbconn;
+
+	uint64_t max_level;
+
+	auto rc = dbconn.BlockchainSelectMax(max_level);
+	if (rc)
+	{
+		BOOST_LOG_TRIVIAL(error) << "Reindex::ExportBlocks no blockchain to export";
+
+		return -1;
+	}
+
+	auto fd = open_file(path, O_BINARY | O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+	if (fd < 0)
+	{
+		BOOST_LOG_TRIVIAL(error) << "Reindex::ExportBlocks error opening file \"" << w2s(path) << "\"; " << strerror(errno);
+
+		return -1;
+	}
+
+	Finally finally([fd]{ close(fd); });
+
+	uint32_t tag = REINDEX_BLOCK_FILE_TAG;
+
+	if (write(fd, &tag, sizeof(tag)) != sizeof(tag))
+		goto write_error;
+
+	if (dbconn.BeginRead())
+		return -1;
+
+	for (uint64_t level = 0; level <= max_level; ++level)
+	{
+		SmartBuf smartobj;
+
+		if (dbconn.BlockchainSelect(level, &smartobj))
+		{
+			BOOST_LOG_TRIVIAL(error) << "Reindex::ExportBlocks error reading block level " << level;
+
+			dbconn.EndRead();
+
+			return -1;
+		}
+
+		auto obj = (CCObject*)smartobj.data();
+
+		if (write(fd, obj->ObjPtr(), obj->ObjSize()) != (ssize_t)obj->ObjSize())
+		{
+			dbconn.EndRead();
+
+			goto write_error;
+		}
+	}
+
+	dbconn.EndRead();
+
+	BOOST_LOG_TRIVIAL(info) << "Reindex::ExportBlocks wrote " << max_level + 1 << " blocks to \"" << w2s(path) << "\"";
+
+	return 0;
+
+write_error:
+
+	BOOST_LOG_TRIVIAL(error) << "Reindex::ExportBlocks error writing file \"" << w2s(path) << "\"; " << strerror(errno);
+
+	return -1;
+}
+
+void Reindex::StartProofThreads(int nthreads)
+{
+	m_threads.reserve(nthreads);
+
+	for (int i = 0; i < nthreads; ++i)
+	{
+		auto t = new thread(&Reindex::ProofThreadProc, this);
+		m_threads.push_back(t);
+	}
+}
+
+void Reindex::StopProofThreads()
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+
+		m_stop = true;
+	}
+
+	m_work_cv.notify_all();
+
+	for (auto t : m_threads)
+	{
+		t->join();
+		delete t;
+	}
+
+	m_threads.clear();
+}
+
+void Reindex::ProofThreadProc()
+{
+	auto ptx = new TxPay;
+	CCASSERT(ptx);
+
+	unique_lock<mutex> lock(m_mutex);
+
+	while (true)
+	{
+		while (m_queue.empty() && !m_stop)
+			m_work_cv.wait(lock);
+
+		if (m_queue.empty())
+			break;
+
+		auto job = m_queue.front();
+		m_queue.pop_front();
+
+		lock.unlock();
+
+		VerifyProof(job, *ptx);
+
+		job.smartobj.ClearRef();
+
+		lock.lock();
+
+		--m_npending;
+
+		m_done_cv.notify_all();
+	}
+
+	lock.unlock();
+
+	delete ptx;
+}
+
+void Reindex::VerifyProof(const ProofJob& job, struct TxPay& tx)
+{
+	auto block = (Block*)job.smartobj.data();
+	auto wire = block->WireData();
+
+	MetricTimer timer(s_proof_usec);
+
+	auto rc = tx_from_wire(tx, (char*)block->TxData() + job.offset, job.size);
+
+	if (!rc)
+	{
+		memcpy(&tx.merkle_root, &job.merkle_root, sizeof(tx.merkle_root));
+
+#if !TEST_EXTRA_ON_WIRE
+		tx.outvalmin = g_blockchain.proof_params.outvalmin;
+		tx.outvalmax = g_blockchain.proof_params.outvalmax;
+		tx.invalmax = g_blockchain.proof_params.invalmax;
+#endif
+
+		rc = CCProof_VerifyProof(tx);
+	}
+
+	if (rc)
+	{
+		BOOST_LOG_TRIVIAL(error) << "Reindex::VerifyProof proof verification failed for tx at offset " << job.offset << " in block level " << wire->level;
+
+		++m_proofs_failed;
+		s_proofs_failed.Add();
+	}
+	else
+	{
+		++m_proofs_verified;
+		s_proofs_verified.Add();
+	}
+}
+
+// the Merkle roots are looked up here because the DbConn can only be used by this thread
+
+bool Reindex::QueueProofs(DbConn *dbconn, SmartBuf smartobj, struct TxPay& txbuf)
+{
+	auto block = (Block*)smartobj.data();
+	auto pbegin = block->TxData();
+	auto pdata = pbegin;
+	auto pend = block->ObjEndPtr();
+
+	while (pdata < pend)
+	{
+		auto txsize = *(uint32_t*)pdata;
+
+		if (tx_from_wire(txbuf, (char*)pdata, txsize))
+			return true;
+
+		ProofJob job;
+		job.smartobj = smartobj;
+		job.offset = pdata - pbegin;
+		job.size = txsize;
+
+		uint64_t timestamp;
+
+		if (dbconn->CommitRootsSelect(txbuf.param_level, false, timestamp, &job.merkle_root, sizeof(job.merkle_root)))
+		{
+			BOOST_LOG_TRIVIAL(error) << "Reindex::QueueProofs Merkle root level " << txbuf.param_level << " not found for tx in block level " << block->WireData()->level;
+
+			return true;
+		}
+
+		pdata += txsize;
+
+		WaitForProofs(REINDEX_PROOF_QUEUE_MAX - 1);
+
+		lock_guard<mutex> lock(m_mutex);
+
+		m_queue.push_back(job);
+		++m_npending;
+
+		m_work_cv.notify_one();
+	}
+
+	return false;
+}
+
+void Reindex::WaitForProofs(unsigned max_pending)
+{
+	unique_lock<mutex> lock(m_mutex);
+
+	while (m_npending > max_pending)
+		m_done_cv.wait(lock);
+}
+
+int Reindex::Run(const wstring& source_path, int proof_threads)
+{
+	BOOST_LOG_TRIVIAL(info) << "Reindex::Run source \"" << w2s(source_path) << "\" proof threads " << proof_threads;
+
+	auto source = OpenSource(source_path);
+	if (!source)
+		return -1;
+
+	Finally finally_source([source]{ delete source; });
+
+	DbConn dbconn;
+
+	uint64_t last_level;
+
+	auto rc = dbconn.BlockchainSelectMax(last_level);
+	if (rc <= 0)
+	{
+		BOOST_LOG_TRIVIAL(error) << "Reindex::Run the data directory must not already hold a blockchain; reindex requires a new data directory";
+
+		return -1;
+	}
+
+	if (proof_threads > 0)
+	{
+		CCProof_Init();
+		CCProof_PreloadVerifyKeys();
+
+		StartProofThreads(proof_threads);
+	}
+
+	g_blocksigs.Init();
+
+	Finally finally_threads([this]{ g_blocksigs.DeInit(); StopProofThreads(); });
+
+	g_blockchain.Init();
+
+	if (g_blockchain.HasFatalError())
+		return -1;
+
+	auto priorobj = g_blockchain.GetLastIndelibleBlock();
+	auto genesis_auxp = ((Block*)priorobj.data())->AuxPtr();
+
+	// blocks are unlinked from their prior block once they fall this far behind, so the chain doesn't hold every block in memory
+	// CheckBadSigOrder and CheckSerialnum only look back a few rounds
+
+	unsigned chain_depth = (BLOCK_PRUNE_ROUNDS + 3) * MAX_NWITNESSES;
+	deque<SmartBuf> chain;
+
+	auto ptxbuf = new TxPay;
+	CCASSERT(ptxbuf);
+
+	Finally finally_txbuf([ptxbuf]{ delete ptxbuf; });
+
+	struct TxPay& txbuf = *ptxbuf;
+
+	// the metrics accumulate over the life of the process, so the stage times of this run are the change in their sums
+
+	auto read_usec0 = s_read_usec.Sum();
+	auto hash_usec0 = s_hash_usec.Sum();
+	auto sigs_usec0 = s_sigs_usec.Sum();
+	auto validate_usec0 = s_validate_usec.Sum();
+	auto queue_usec0 = s_proof_queue_usec.Sum();
+	auto wait_usec0 = s_proof_wait_usec.Sum();
+	auto indelible_usec0 = s_indelible_usec.Sum();
+	auto proof_usec0 = s_proof_usec.Sum();
+	auto index_usec0 = g_blockchain_index_txs_usec.Sum();
+	auto tree_usec0 = g_blockchain_commit_tree_usec.Sum();
+	auto commit_usec0 = g_blockchain_db_commit_usec.Sum();
+
+	uint64_t nblocks = 0, ntxs = 0;
+	uint64_t expected_level = 0;
+	bool have_error = false;
+	bool at_end = false;
+
+	auto t0 = chrono::steady_clock::now();
+	auto t_progress = t0;
+
+	while (!at_end && !have_error && !g_shutdown)
+	{
+		vector<SmartBuf> batch;
+		batch.reserve(REINDEX_BATCH_BLOCKS);
+
+		while (batch.size() < REINDEX_BATCH_BLOCKS)
+		{
+			SmartBuf smartobj;
+
+			{
+				MetricTimer timer(s_read_usec);
+
+				rc = source->Next(&smartobj);
+			}
+
+			if (rc)
+			{
+				at_end = true;
+				have_error = (rc < 0);
+
+				break;
+			}
+
+			auto block = (Block*)smartobj.data();
+			auto wire = block->WireData();
+
+			if (wire->level != expected_level)
+			{
+				BOOST_LOG_TRIVIAL(error) << "Reindex::Run block level " << wire->level << " expected level " << expected_level;
+
+				have_error = true;
+
+				break;
+			}
+
+			++expected_level;
+
+			{
+				MetricTimer timer(s_hash_usec);
+
+				if (!block->SetupAuxBuf(smartobj))
+				{
+					have_error = true;
+
+					break;
+				}
+
+				block->SetOrVerifyOid(true);
+			}
+
+			if (wire->level == 0)
+			{
+				// the source must be the same blockchain as the one started from this node's genesis data file
+
+				if (memcmp(&block->AuxPtr()->oid, &genesis_auxp->oid, sizeof(ccoid_t)))
+				{
+					BOOST_LOG_TRIVIAL(error) << "Reindex::Run source genesis block oid " << buf2hex(&block->AuxPtr()->oid, sizeof(ccoid_t)) << " != " << buf2hex(&genesis_auxp->oid, sizeof(ccoid_t)) << "; the source blockchain was not created from this genesis data file";
+
+					have_error = true;
+
+					break;
+				}
+
+				continue;
+			}
+
+			batch.push_back(smartobj);
+		}
+
+		if (have_error)
+			break;
+
+		{
+			MetricTimer timer(s_sigs_usec);
+
+			g_blocksigs.VerifyBlocks(priorobj, batch);
+		}
+
+		for (auto& smartobj : batch)
+		{
+			auto block = (Block*)smartobj.data();
+			auto wire = block->WireData();
+
+			{
+				MetricTimer timer(s_validate_usec);
+
+				block->ChainToPriorBlock(priorobj);
+
+				rc = g_processblock.BlockValidate(&dbconn, smartobj, txbuf);
+			}
+
+			if (rc)
+			{
+				BOOST_LOG_TRIVIAL(error) << "Reindex::Run BlockValidate result " << rc << " for block level " << wire->level;
+
+				have_error = true;
+
+				break;
+			}
+
+			if (m_threads.size())
+			{
+				MetricTimer timer(s_proof_queue_usec);
+
+				if (QueueProofs(&dbconn, smartobj, txbuf))
+				{
+					have_error = true;
+
+					break;
+				}
+			}
+
+			if (m_threads.size())
+			{
+				MetricTimer timer(s_proof_wait_usec);
+
+				WaitForProofs(0);
+			}
+
+			if (m_proofs_failed.load())
+			{
+				BOOST_LOG_TRIVIAL(error) << "Reindex::Run block level " << wire->level << " has a tx that failed proof verification; stopping before it is committed";
+
+				have_error = true;
+
+				break;
+			}
+
+			{
+				MetricTimer timer(s_indelible_usec);
+
+				rc = g_blockchain.ReplayIndelibleBlock(&dbconn, smartobj, txbuf);
+			}
+
+			if (rc)
+			{
+				have_error = true;
+
+				break;
+			}
+
+			uint64_t block_txs = 0;
+
+			for (auto pdata = block->TxData(); pdata < block->ObjEndPtr(); pdata += *(uint32_t*)pdata)
+				++block_txs;
+
+			ntxs += block_txs;
+			++nblocks;
+
+			s_txs.Add(block_txs);
+			s_blocks.Add();
+
+			chain.push_back(smartobj);
+
+			if (chain.size() > chain_depth)
+			{
+				chain.pop_front();
+
+				((Block*)chain.front().data())->SetPriorBlock(SmartBuf());
+			}
+
+			if (wire->level % REINDEX_PRUNE_INTERVAL == 0 && wire->level > chain_depth)
+				dbconn.TempSerialnumPruneLevel(wire->level - chain_depth);
+
+			priorobj = smartobj;
+		}
+
+		auto now = chrono::steady_clock::now();
+
+		if (now - t_progress >= chrono::seconds(REINDEX_PROGRESS_SECS))
+		{
+			t_progress = now;
+
+			auto secs = chrono::duration<double>(now - t0).count();
+
+			BOOST_LOG_TRIVIAL(info) << "Reindex::Run level " << expected_level - 1 << " blocks " << nblocks << " txs " << ntxs << " blocks/s " << (uint64_t)(nblocks / secs) << " txs/s " << (uint64_t)(ntxs / secs);
+		}
+	}
+
+	// proofs may still be queued if the replay stopped partway through a block
+
+	if (m_threads.size())
+		WaitForProofs(0);
+
+	auto secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+
+	auto t_indelible = s_indelible_usec.Sum() - indelible_usec0;
+	auto t_index = g_blockchain_index_txs_usec.Sum() - index_usec0;
+	auto t_tree = g_blockchain_commit_tree_usec.Sum() - tree_usec0;
+	auto t_commit = g_blockchain_db_commit_usec.Sum() - commit_usec0;
+	auto t_insert = t_indelible - min(t_indelible, t_index + t_tree + t_commit);
+
+	BOOST_LOG_TRIVIAL(info) << "Reindex::Run " << (have_error || g_shutdown ? "stopped" : "done") << " at level " << g_blockchain.GetLastIndelibleLevel()
+		<< " blocks " << nblocks << " txs " << ntxs << " elapsed " << secs << " sec blocks/s " << (secs > 0 ? nblocks / secs : 0) << " txs/s " << (secs > 0 ? ntxs / secs : 0);
+
+	for (auto stage : vector<pair<const char*, uint64_t>>{
+			{"read", s_read_usec.Sum() - read_usec0},
+			{"hash", s_hash_usec.Sum() - hash_usec0},
+			{"signatures", s_sigs_usec.Sum() - sigs_usec0},
+			{"validate", s_validate_usec.Sum() - validate_usec0},
+			{"proof queue", s_proof_queue_usec.Sum() - queue_usec0},
+			{"proof wait", s_proof_wait_usec.Sum() - wait_usec0},
+			{"index txs", t_index},
+			{"commit tree", t_tree},
+			{"block insert", t_insert},
+			{"db commit", t_commit}})
+	{
+		BOOST_LOG_TRIVIAL(info) << "Reindex::Run stage " << stage.first << " " << fixed << setprecision(3) << stage.second / 1e6 << " sec " << setprecision(1) << (secs > 0 ? stage.second / 1e4 / secs : 0) << "% of elapsed";
+	}
+
+	if (m_threads.size())
+		BOOST_LOG_TRIVIAL(info) << "Reindex::Run proof threads " << m_threads.size() << " verified " << m_proofs_verified.load() << " failed " << m_proofs_failed.load() << " thread time " << fixed << setprecision(3) << (s_proof_usec.Sum() - proof_usec0) / 1e6 << " sec";
+
+	if (have_error || m_proofs_failed.load())
+		return -1;
+
+	return 0;
+}
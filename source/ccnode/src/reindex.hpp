@@ -0,0 +1,64 @@
+/*
+ * CredaCash (TM) cryptocurrency and blockchain
+ *
+ * Copyright (C) 2015-2016 Creda Software, Inc.
+ *
+ * reindex.hpp
+*/
+
+#pragma once
+
+#include <SmartBuf.hpp>
+
+#include <transaction.hpp>
+
+#include <thread>
+#include <condition_variable>
+
+// Rebuilds the persistent DB of a new data directory offline, by replaying the blocks of an existing blockchain through the
+// same validation and indexing code the node uses when blocks become indelible, and logs the throughput of each stage.
+// The blocks can come from another node's persistent DB file, or from a block file written by ExportBlocks.
+// When proof_threads > 0, the zero knowledge proof of every transaction is also verified on a pool of worker threads,
+// and the replay stops at the first block with a bad proof, before that block is committed.
+
+class Reindex
+{
+	struct ProofJob
+	{
+		SmartBuf smartobj;
+		uint32_t offset;
+		uint32_t size;
+		bigint_t merkle_root;
+	};
+
+	vector<thread *> m_threads;
+
+	mutex m_mutex;
+	condition_variable m_work_cv;
+	condition_variable m_done_cv;
+	deque<ProofJob> m_queue;
+	unsigned m_npending;		// jobs queued or running; guarded by m_mutex
+	bool m_stop;
+
+	atomic<uint64_t> m_proofs_verified;
+	atomic<uint64_t> m_proofs_failed;
+
+	void StartProofThreads(int nthreads);
+	void StopProofThreads();
+	void ProofThreadProc();
+	void VerifyProof(const ProofJob& job, struct TxPay& tx);
+	bool QueueProofs(class DbConn *dbconn, SmartBuf smartobj, struct TxPay& txbuf);
+	void WaitForProofs(unsigned max_pending);
+
+public:
+	Reindex()
+	 :	m_npending(0),
+		m_stop(false),
+		m_proofs_verified(0),
+		m_proofs_failed(0)
+	{ }
+
+	int Run(const wstring& source, int proof_threads);
+
+	static int ExportBlocks(const wstring& path);
+};
@@ -14,11 +14,13 @@
 #include "transact.hpp"
 #include "hostdir.hpp"
 #include "dbconn.hpp"
+#include "metrics.hpp"
 #include "util.h"
 
 #include <CCobjects.hpp>
 
 #include <transaction.h>
+#include <blake2/blake2b.h>
 #include <ccserver/server.hpp>
 #include <ccserver/connection_manager.hpp>
 
@@ -27,8 +29,7 @@
 #include <boost/algorithm/string.hpp>
 
 #include <utility>
-
-#define TRACE_RELAY		(g_params.trace_relay)
+#include <unordered_map>
 
 #define RELAY_HEARTBEAT				100
 
@@ -37,6 +38,15 @@
 
 #define RELAY_DIR_REFRESH			(20*60)
 
+#define RELAY_COMPACT_FETCH_MAX		8	// if a compact block is missing more tx's than this, fetch the full block instead
+#define RELAY_COMPACT_PENDING_MAX	4	// max compact blocks waiting for missing tx's per connection
+
+#define RELAY_RECONCILE_OFFER_MAX	(8*CC_HAVE_MAX)	// tx's offered by short id that a connection remembers, to answer CC_CMD_SEND_HAVE_TX
+#define RELAY_RECONCILE_KNOWN_MAX	(1 << 18)		// tx short id's remembered by RelayTxShortIds
+#define RELAY_RECONCILE_SOURCES		2				// request a full tx announcement from this many peers, in case one disconnects before the tx is downloaded
+#define RELAY_RECONCILE_HELD		255				// RelayTxShortIds source count for tx's this node has validated
+#define RELAY_RECONCILE_SOURCE_SECS	30				// if a tx still isn't held this long after its last source was added, request it from more peers
+
 //#define TEST_DELAY_BLOCKS				1	// for testing
 //#define TEST_RANDOM_NO_SEND			7	// for testing
 //#define TEST_DOUBLECHECK_BLOCK_OIDS	1	// for testing
@@ -70,14 +80,209 @@ static uint32_t No_Obj_Reply[2] =				{CC_MSG_HEADER_SIZE, CC_ERROR_NO_OBJ};
 
 thread_local DbConn *relay_dbconn;
 
+CCLockSite RelayConnection::s_request_queue_lock_site("relay-request-queue");
+CCLockSite RelayConnection::s_send_queue_lock_site("relay-send-queue");
+CCLockSite RelayConnection::s_offered_lock_site("relay-offered-txs");
+
+static MetricCounter s_msgs_received("relay.msgs_received");
+static MetricCounter s_bytes_received("relay.bytes_received");
+static MetricCounter s_objs_sent("relay.objs_sent");
+static MetricCounter s_bytes_sent("relay.bytes_sent");
+static MetricCounter s_compact_sent("relay.compact_blocks_sent");
+static MetricCounter s_compact_received("relay.compact_blocks_received");
+static MetricCounter s_compact_rebuilt("relay.compact_blocks_rebuilt");
+static MetricCounter s_compact_txs_reused("relay.compact_txs_reused");
+static MetricCounter s_compact_txs_fetched("relay.compact_txs_fetched");
+static MetricCounter s_compact_full_fetched("relay.compact_full_blocks_fetched");
+
+static MetricCounter s_tx_announce_bytes("relay.tx_announce_bytes_sent");
+static MetricCounter s_reconcile_ids_sent("relay.reconcile_ids_sent");
+static MetricCounter s_reconcile_ids_received("relay.reconcile_ids_received");
+static MetricCounter s_reconcile_txs_requested("relay.reconcile_txs_requested");
+
+static atomic<int64_t> s_block_priority(VALID_BLOCK_SEQNUM_START);
+
+// In tx reconciliation mode, a tx is offered to peers by a short id, which is the first 8 bytes of its oid.
+// RelayTxShortIds tracks the tx's this node holds or has received full announcements for,
+// so it can pick out which of the short id's offered by a peer it needs to request.
+
+static uint64_t TxShortId(const ccoid_t& oid)
+{
+	uint64_t id;
+
+	memcpy(&id, &oid, sizeof(id));
+
+	return id;
+}
+
+class RelayTxShortIds
+{
+	struct Sources
+	{
+		uint8_t nsources;
+		uint32_t ticks;			// when the last source was added
+	};
+
+	FastSpinLock m_lock;
+	unordered_map<uint64_t, Sources> m_sources;
+	deque<uint64_t> m_order;
+
+	static CCLockSite s_lock_site;
+
+	// the sources of a tx can disconnect or fail to send it without this class being told, so once enough time has passed
+	// for the relay download timeout to expire, the count is ignored and the tx is requested from the next peer that offers it
+
+	static bool Expired(const Sources& entry, uint32_t now)
+	{
+		return entry.nsources != RELAY_RECONCILE_HELD && ccticks_elapsed(entry.ticks, now) > RELAY_RECONCILE_SOURCE_SECS * CCTICKS_PER_SEC;
+	}
+
+	Sources& Get(uint64_t id)	// caller must hold m_lock
+	{
+		Sources entry = {0, 0};
+
+		auto rc = m_sources.emplace(id, entry);
+
+		if (rc.second)
+		{
+			m_order.push_back(id);
+
+			if (m_order.size() > RELAY_RECONCILE_KNOWN_MAX)
+			{
+				m_sources.erase(m_order.front());
+				m_order.pop_front();
+			}
+		}
+
+		return rc.first->second;
+	}
+
+public:
+	RelayTxShortIds()
+	 :	m_lock(s_lock_site)
+	{ }
+
+	void SetHeld(uint64_t id)
+	{
+		lock_guard<FastSpinLock> lock(m_lock);
+
+		Get(id).nsources = RELAY_RECONCILE_HELD;
+	}
+
+	void AddSource(uint64_t id)
+	{
+		auto now = ccticks();
+
+		lock_guard<FastSpinLock> lock(m_lock);
+
+		auto& entry = Get(id);
+
+		if (Expired(entry, now))
+			entry.nsources = 0;
+
+		if (entry.nsources < RELAY_RECONCILE_SOURCES)
+		{
+			++entry.nsources;
+			entry.ticks = now;
+		}
+	}
+
+	bool Want(uint64_t id)
+	{
+		auto now = ccticks();
+
+		lock_guard<FastSpinLock> lock(m_lock);
+
+		auto it = m_sources.find(id);
+
+		return it == m_sources.end() || it->second.nsources < RELAY_RECONCILE_SOURCES || Expired(it->second, now);
+	}
+};
+
+CCLockSite RelayTxShortIds::s_lock_site("relay-tx-shortids");
+
+static RelayTxShortIds s_tx_shortids;
+
+// Returns a CC_TAG_BLOCK_COMPACT object that lists the oid and size of each tx in the block,
+// or an empty SmartBuf if the block has no tx's or can't be sent in compact form
+
+static SmartBuf MakeCompactBlock(const Block *block)
+{
+	if (TEST_SEQ_TX_OID || !block->HasTx())
+		return SmartBuf();
+
+	auto pbegin = block->TxData();
+	auto pend = block->ObjEndPtr();
+	uint32_t ntx = 0;
+
+	for (auto pdata = pbegin; pdata < pend; ++ntx)
+	{
+		auto txsize = *(uint32_t*)pdata;
+
+		if (txsize <= CC_MSG_HEADER_SIZE || txsize > pend - pdata)
+		{
+			BOOST_LOG_TRIVIAL(error) << "MakeCompactBlock invalid tx size " << txsize << " in block oid " << buf2hex(block->OidPtr(), sizeof(ccoid_t));
+
+			return SmartBuf();
+		}
+
+		pdata += txsize;
+	}
+
+	uint32_t size = CC_MSG_HEADER_SIZE + sizeof(BlockWireHeader) + sizeof(ntx) + ntx * sizeof(relay_compact_tx_t);
+
+	if (size >= block->ObjSize())
+		return SmartBuf();
+
+	auto smartobj = SmartBuf(size + sizeof(CCObject::Preamble));
+	if (!smartobj)
+	{
+		BOOST_LOG_TRIVIAL(error) << "MakeCompactBlock smartobj failed";
+
+		return SmartBuf();
+	}
+
+	auto obj = (CCObject*)smartobj.data();
+
+	obj->SetTag(CC_TAG_BLOCK_COMPACT);
+	obj->SetSize(size);
+
+	auto output = obj->DataPtr();
+
+	memcpy(output, block->WireData(), sizeof(BlockWireHeader));
+	memcpy(output + sizeof(BlockWireHeader), &ntx, sizeof(ntx));
+
+	auto entry = (relay_compact_tx_t*)(output + sizeof(BlockWireHeader) + sizeof(ntx));
+
+	for (auto pdata = pbegin; pdata < pend; ++entry)
+	{
+		auto txsize = *(uint32_t*)pdata;
+
+		// same hash as CCObject::SetObjId, which covers the tx body without the tag or proof-of-work
+
+		auto rc = blake2b(&entry->oid, sizeof(ccoid_t), NULL, 0, pdata + CC_MSG_HEADER_SIZE, txsize - CC_MSG_HEADER_SIZE);
+		CCASSERTZ(rc);
+
+		entry->size = txsize;
+
+		pdata += txsize;
+	}
+
+	return smartobj;
+}
+
 void RelayConnection::StartConnection()
 {
-	if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::StartConnection";
+	CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::StartConnection";
 
 	if (private_peer_index >= 0)
 		g_privrelay_service.PrivateConnected(private_peer_index);
 
 	peer_error_count = 0;
+	session_bytes = 0;
+
+	if (m_tor_host.length() && private_peer_index < 0)
+		g_hostdir.ReportConnected(HostDir::Relay, m_tor_host, m_connect_ms);
 
 	db_next_new_block_seqnum = VALID_BLOCK_SEQNUM_START;			// announce existing blocks
 
@@ -94,12 +299,57 @@ void RelayConnection::StartConnection()
 	send_queue.clear();
 	send_one.clear();
 
+	compact_blocks.clear();
+
+	peer_features.store(0);
+
 	if (SetTimer())
 		return;
 
+	SendFeatures();
+
 	Connection::StartConnection();
 }
 
+// Tells the peer which optional relay features this node has enabled, so it only uses the ones both sides support
+
+void RelayConnection::SendFeatures()
+{
+	uint32_t features = 0;
+
+	if (g_params.relay_compact_blocks)
+		features |= RELAY_FEATURE_COMPACT_BLOCKS;
+
+	if (g_params.relay_tx_reconcile)
+		features |= RELAY_FEATURE_TX_RECONCILE;
+
+	if (!features)
+		return;
+
+	uint32_t msgsize = CC_MSG_HEADER_SIZE + sizeof(features);
+	uint32_t tag = CC_MSG_RELAY_FEATURES;
+
+	auto msgbuf = SmartBuf(msgsize);
+	if (!msgbuf)
+	{
+		BOOST_LOG_TRIVIAL(error) << Name() << " Conn-" << m_conn_index << " RelayConnection::SendFeatures error msgbuf failed";
+
+		return;
+	}
+
+	auto output = msgbuf.data();
+	uint32_t bufpos = 0;
+
+	copy_to_buf(&msgsize, sizeof(msgsize), bufpos, output, msgsize);
+	copy_to_buf(&tag, sizeof(tag), bufpos, output, msgsize);
+	copy_to_buf(&features, sizeof(features), bufpos, output, msgsize);
+
+	CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::SendFeatures sending CC_MSG_RELAY_FEATURES " << features;
+
+	WriteAsync("RelayConnection::SendFeatures", boost::asio::buffer(output, msgsize),
+			boost::bind(&Connection::HandleWriteSmartBuf, this, boost::asio::placeholders::error, msgbuf, AutoCount(this)));
+}
+
 void RelayConnection::HandleReadComplete()
 {
 	if (m_nred < CC_MSG_HEADER_SIZE)
@@ -112,7 +362,15 @@ void RelayConnection::HandleReadComplete()
 	unsigned size = *(uint32_t*)m_pread;
 	unsigned tag = *(uint32_t*)(m_pread + 4);
 
-	if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleReadComplete read " << m_nred << " bytes msg size " << size << " tag " << tag;
+	CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleReadComplete read " << m_nred << " bytes msg size " << size << " tag " << tag;
+
+	if (m_request_ticks)
+	{
+		if (m_tor_host.length() && private_peer_index < 0)
+			g_relay_service.m_torpool.RecordFirstByte(m_from_warm_pool, m_request_ticks);
+
+		m_request_ticks = 0;
+	}
 
 	if (size < CC_MSG_HEADER_SIZE || size > CC_BLOCK_MAX_SIZE)
 	{
@@ -123,7 +381,7 @@ void RelayConnection::HandleReadComplete()
 
 	SmartBuf smartobj;
 
-	if (tag == CC_TAG_BLOCK || tag == CC_TAG_TX_WIRE)
+	if (tag == CC_TAG_BLOCK || tag == CC_TAG_TX_WIRE || tag == CC_TAG_BLOCK_COMPACT)
 	{
 		CCASSERT(CC_MSG_HEADER_SIZE == sizeof(CCObject::Header));
 
@@ -152,7 +410,7 @@ void RelayConnection::HandleReadComplete()
 
 	if (m_maxread > m_nred)
 	{
-		if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleReadComplete queueing read size " << m_maxread - m_nred;
+		CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleReadComplete queueing read size " << m_maxread - m_nred;
 
 		ReadAsync("RelayConnection::HandleReadComplete", boost::asio::buffer(m_pread + m_nred, m_maxread - m_nred), boost::asio::transfer_exactly(m_maxread - m_nred),
 				boost::bind(&RelayConnection::HandleMsgReadComplete, this, boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred, smartobj, AutoCount(this)));
@@ -194,7 +452,11 @@ void RelayConnection::HandleMsgReadComplete(const boost::system::error_code& e,
 		return Stop();
 	}
 
-	if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleMsgReadComplete read " << m_nred << " bytes msg size " << msgsize << " tag " << tag;
+	CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleMsgReadComplete read " << m_nred << " bytes msg size " << msgsize << " tag " << tag;
+
+	s_msgs_received.Add();
+	s_bytes_received.Add(msgsize);
+	session_bytes += msgsize;
 
 	CCASSERT(msgsize >= CC_MSG_HEADER_SIZE);
 
@@ -207,13 +469,13 @@ void RelayConnection::HandleMsgReadComplete(const boost::system::error_code& e,
 
 	case CC_MSG_HAVE_BLOCK:
 
-		if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleMsgReadComplete received CC_MSG_HAVE_BLOCK";
+		CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleMsgReadComplete received CC_MSG_HAVE_BLOCK";
 
 		goto handle_have;
 
 	case CC_MSG_HAVE_TX:
 
-		if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleMsgReadComplete received CC_MSG_HAVE_TX";
+		CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleMsgReadComplete received CC_MSG_HAVE_TX";
 	{
 
 	handle_have:
@@ -248,6 +510,9 @@ void RelayConnection::HandleMsgReadComplete(const boost::system::error_code& e,
 				copy_from_buf(&req_params.oid, sizeof(ccoid_t), bufpos, m_pread, msgsize);
 				copy_from_buf(&req_params.size, sizeof(req_params.size), bufpos, m_pread, msgsize);
 				copy_from_buf(&req_params.level, sizeof(req_params.level), bufpos, m_pread, msgsize);
+
+				if (bufpos <= msgsize)
+					s_tx_shortids.AddSource(TxShortId(req_params.oid));
 			}
 
 			if (bufpos > msgsize)
@@ -273,12 +538,47 @@ void RelayConnection::HandleMsgReadComplete(const boost::system::error_code& e,
 		break;
 	}
 
+	case CC_MSG_RELAY_FEATURES:
+	{
+		if (msgsize < CC_MSG_HEADER_SIZE + sizeof(uint32_t))
+		{
+			BOOST_LOG_TRIVIAL(debug) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleMsgReadComplete CC_MSG_RELAY_FEATURES error invalid msgsize " << msgsize;
+
+			break;
+		}
+
+		// a longer message may carry fields added later, so only the part this node knows about is read
+
+		uint32_t features;
+
+		memcpy(&features, m_pread + CC_MSG_HEADER_SIZE, sizeof(features));
+
+		peer_features.store(features);
+
+		CCLOG(g_log_relay, debug) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleMsgReadComplete received CC_MSG_RELAY_FEATURES " << features;
+
+		break;
+	}
+
+	case CC_MSG_HAVE_TX_SHORTIDS:
+
+		HandleTxShortIds(msgsize);
+
+		break;
+
+	case CC_CMD_SEND_HAVE_TX:
+
+		HandleSendHaveTx(msgsize);
+
+		break;
+
 	case CC_CMD_SEND_BLOCK:
+	case CC_CMD_SEND_BLOCK_COMPACT:
 	case CC_CMD_SEND_TX:
 	{
 		unsigned nobjs = (msgsize - CC_MSG_HEADER_SIZE) / sizeof(ccoid_t);
 
-		if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleMsgReadComplete tag " << tag << " received CC_CMD_SEND_BLOCK/CC_CMD_SEND_TX nobjs " << nobjs;
+		CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleMsgReadComplete tag " << tag << " received CC_CMD_SEND_BLOCK/CC_CMD_SEND_TX nobjs " << nobjs;
 
 		if (msgsize != CC_MSG_HEADER_SIZE + nobjs * sizeof(ccoid_t))
 		{
@@ -312,7 +612,12 @@ void RelayConnection::HandleMsgReadComplete(const boost::system::error_code& e,
 
 		for (unsigned i = 0; i < nobjs; ++i)
 		{
-			auto rc = send_queue.push(m_pread + CC_MSG_HEADER_SIZE + i * sizeof(ccoid_t));
+			relay_send_params_t send_params;
+
+			memcpy(&send_params.oid, m_pread + CC_MSG_HEADER_SIZE + i * sizeof(ccoid_t), sizeof(ccoid_t));
+			send_params.compact = (tag == CC_CMD_SEND_BLOCK_COMPACT);
+
+			auto rc = send_queue.push(&send_params);
 
 			CCASSERTZ(rc);
 		}
@@ -337,7 +642,7 @@ void RelayConnection::HandleMsgReadComplete(const boost::system::error_code& e,
 
 			*(uint32_t*)(msgbuf.data() + 8) = qlen;
 
-			if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleMsgReadComplete sending CC_SUCCESS_QUEUE_LEN " << qlen;
+			CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleMsgReadComplete sending CC_SUCCESS_QUEUE_LEN " << qlen;
 
 			WriteAsync("RelayConnection::HandleMsgReadComplete", boost::asio::buffer(msgbuf.data(), sizeof(Success_Reply_Queue_Len)),
 					boost::bind(&Connection::HandleWriteSmartBuf, this, boost::asio::placeholders::error, msgbuf, AutoCount(this)), true);
@@ -354,7 +659,7 @@ void RelayConnection::HandleMsgReadComplete(const boost::system::error_code& e,
 #if 0 // CC_SUCCESS_QUEUE_LEN not implemented
 	case CC_SUCCESS_QUEUE_LEN:
 	{
-		if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleMsgReadComplete received CC_SUCCESS_QUEUE_LEN";
+		CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleMsgReadComplete received CC_SUCCESS_QUEUE_LEN";
 
 		if (msgsize != sizeof(Success_Reply_Queue_Len))
 		{
@@ -367,7 +672,7 @@ void RelayConnection::HandleMsgReadComplete(const boost::system::error_code& e,
 
 		// would need to sanity check this nobjs
 
-		if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleMsgReadComplete received CC_SUCCESS_QUEUE_LEN " << nobjs;
+		CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleMsgReadComplete received CC_SUCCESS_QUEUE_LEN " << nobjs;
 
 		request_objs_pending.store(nobjs);
 
@@ -378,6 +683,7 @@ void RelayConnection::HandleMsgReadComplete(const boost::system::error_code& e,
 	case CC_ERROR_NO_OBJ:
 	{
 		int64_t bytes_pending;
+		relay_request_params_extended_t req_params;
 
 		{
 			lock_guard<FastSpinLock> lock(request_queue_lock);
@@ -393,24 +699,59 @@ void RelayConnection::HandleMsgReadComplete(const boost::system::error_code& e,
 			objs_pending = request_objs_pending.fetch_sub(1) - 1;
 			bytes_pending = request_bytes_pending.fetch_sub(params->size) - params->size;
 
-			if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleMsgReadComplete received CC_ERROR_NO_OBJ; still pending " << objs_pending << " objects in " << bytes_pending << " bytes";
+			CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleMsgReadComplete received CC_ERROR_NO_OBJ; still pending " << objs_pending << " objects in " << bytes_pending << " bytes";
 
 			CCASSERT(objs_pending >= 0);
 			CCASSERT(bytes_pending >= 0);
+
+			memcpy(&req_params, params, sizeof(req_params));
+		}
+
+		if (req_params.compact_fill)
+			CompactBlockAbandon(req_params.oid);
+
+		break;
+	}
+
+	case CC_TAG_BLOCK_COMPACT:
+	{
+		relay_request_params_extended_t req_params;
+
+		{
+			lock_guard<FastSpinLock> lock(request_queue_lock);
+
+			auto params = (relay_request_params_extended_t*)request_param_queue.pop();
+			if (!params)
+			{
+				BOOST_LOG_TRIVIAL(info) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleMsgReadComplete error received CC_TAG_BLOCK_COMPACT but no object was expected";
+
+				return Stop();
+			}
+
+			memcpy(&req_params, params, sizeof(req_params));
 		}
 
+		CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleMsgReadComplete CC_TAG_BLOCK_COMPACT size " << msgsize << " request params oid " << buf2hex(&req_params.oid, sizeof(ccoid_t)) << " size " << req_params.size << " level " << req_params.level << " witness " << (unsigned)req_params.witness;
+
+		CCASSERT(m_pread == ((CCObject*)smartobj.data())->ObjPtr());
+
+		s_compact_received.Add();
+
+		if (CompactBlockReceived(smartobj, req_params))
+			return Stop();
+
 		break;
 	}
 
 	case CC_TAG_BLOCK:
 
-		//if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleMsgReadComplete received CC_TAG_BLOCK";
+		//CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleMsgReadComplete received CC_TAG_BLOCK";
 
 		goto enqueue_obj;
 
 	case CC_TAG_TX_WIRE:
 
-		//if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleMsgReadComplete received CC_TAG_TX_WIRE";
+		//CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleMsgReadComplete received CC_TAG_TX_WIRE";
 	{
 
 	enqueue_obj:
@@ -434,7 +775,7 @@ void RelayConnection::HandleMsgReadComplete(const boost::system::error_code& e,
 			memcpy(&req_params, params, sizeof(req_params));
 		}
 
-		if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleMsgReadComplete tag " << tag << (tag == CC_TAG_BLOCK ? " CC_TAG_BLOCK" : " CC_TAG_TX_WIRE") << " request params oid " << buf2hex(&req_params.oid, sizeof(ccoid_t)) << " size " << req_params.size << " level " << req_params.level << " witness " << (unsigned)req_params.witness;
+		CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleMsgReadComplete tag " << tag << (tag == CC_TAG_BLOCK ? " CC_TAG_BLOCK" : " CC_TAG_TX_WIRE") << " request params oid " << buf2hex(&req_params.oid, sizeof(ccoid_t)) << " size " << req_params.size << " level " << req_params.level << " witness " << (unsigned)req_params.witness;
 
 		if (req_params.size != msgsize)
 		{
@@ -446,7 +787,7 @@ void RelayConnection::HandleMsgReadComplete(const boost::system::error_code& e,
 		auto objs_pending = request_objs_pending.fetch_sub(1) - 1;
 		auto bytes_pending = request_bytes_pending.fetch_sub(msgsize) - msgsize;
 
-		if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleMsgReadComplete still pending " << objs_pending << " objects in " << bytes_pending << " bytes";
+		CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleMsgReadComplete still pending " << objs_pending << " objects in " << bytes_pending << " bytes";
 
 		CCASSERT(objs_pending >= 0);
 		CCASSERT(bytes_pending >= 0);
@@ -470,6 +811,9 @@ void RelayConnection::HandleMsgReadComplete(const boost::system::error_code& e,
 			{
 				BOOST_LOG_TRIVIAL(info) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleMsgReadComplete CC_TAG_TX_WIRE error next request tx oid " << buf2hex(&req_params.oid, sizeof(ccoid_t)) << "; received oid " << buf2hex(obj->OidPtr(), sizeof(ccoid_t));
 
+				if (req_params.compact_fill)
+					CompactBlockAbandon(req_params.oid);
+
 				lock_guard<FastSpinLock> lock(request_queue_lock);
 
 				auto params = (relay_request_params_extended_t*)request_param_queue.pop();
@@ -483,6 +827,16 @@ void RelayConnection::HandleMsgReadComplete(const boost::system::error_code& e,
 				memcpy(&req_params, params, sizeof(req_params));
 			}
 
+			if (req_params.compact_fill)
+			{
+				// the tx oid was checked above, and the rebuilt block will be checked against its oid, so the tx doesn't need proof-of-work or separate validation
+
+				if (CompactBlockFill(smartobj))
+					return Stop();
+
+				break;
+			}
+
 			// note: we could/should check that the tx param_level matches the requested level, but we don't, so that will instead get caught if the param_level is too high and the tx fails validation
 
 			if (tx_set_work((char*)(obj->ObjPtr()), obj->OidPtr(), 0, TX_POW_NPROOFS, 1, g_params.tx_work_difficulty))
@@ -510,71 +864,13 @@ void RelayConnection::HandleMsgReadComplete(const boost::system::error_code& e,
 				return Stop();
 			}
 
-			while (memcmp(&req_params.prior_oid, &wire->prior_oid, sizeof(ccoid_t)))
-			{
-				BOOST_LOG_TRIVIAL(info) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleMsgReadComplete CC_TAG_BLOCK error next request block prior oid " << buf2hex(&req_params.prior_oid, sizeof(ccoid_t)) << "; received block prior oid " << buf2hex(&wire->prior_oid, sizeof(ccoid_t));
-
-				lock_guard<FastSpinLock> lock(request_queue_lock);
-
-				auto params = (relay_request_params_extended_t*)request_param_queue.pop();
-				if (!params)
-				{
-					BOOST_LOG_TRIVIAL(info) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleMsgReadComplete CC_TAG_BLOCK error object not requested";
-
-					return Stop();
-				}
-
-				memcpy(&req_params, params, sizeof(req_params));
-			}
-
-			if (req_params.level != wire->level)
-			{
-				BOOST_LOG_TRIVIAL(info) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleMsgReadComplete CC_TAG_BLOCK error requested block level " << req_params.level << "; received block level " << wire->level;
-
-				return Stop();
-			}
-
-			if (req_params.witness != wire->witness)
-			{
-				BOOST_LOG_TRIVIAL(info) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleMsgReadComplete CC_TAG_BLOCK error requested block witness " << (unsigned)req_params.witness << "; received block witness " << (unsigned)wire->witness;
-
-				return Stop();
-			}
-
-			block_hash_t block_hash;
-			block->CalcHash(block_hash);
-
-			ccoid_t oid;
-			block->CalcOid(block_hash, oid);
-
-			if (TEST_SEQ_BLOCK_OID)
-				memcpy(&oid, &req_params.oid, sizeof(ccoid_t));
-
-			if (memcmp(&req_params.oid, &oid, sizeof(ccoid_t)))
-			{
-				BOOST_LOG_TRIVIAL(info) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleMsgReadComplete CC_TAG_BLOCK error requested block size " << block->ObjSize() << " oid " << buf2hex(&req_params.oid, sizeof(ccoid_t)) << " does not match computed oid " << buf2hex(&oid, sizeof(ccoid_t));
-				//BOOST_LOG_TRIVIAL(info) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleMsgReadComplete block dump " << buf2hex(block, block->ObjSize());
-
-				//raise(SIGTERM);	// for debugging
-
+			if (CheckBlockRequestParams(wire, req_params))
 				return Stop();
-			}
-
-			auto auxp = block->SetupAuxBuf(smartobj);
-			if (!auxp)
-			{
-				BOOST_LOG_TRIVIAL(error) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleMsgReadComplete CC_TAG_BLOCK error SetupAuxBuf failed";
 
+			if (SetupReceivedBlock(smartobj, req_params))
 				return Stop();
-			}
 
-			auxp->SetHash(block_hash);
-			auxp->SetOid(oid);
-
-			auxp->announce_time = req_params.announce_time;
-
-			static atomic<int64_t> hipriority(VALID_BLOCK_SEQNUM_START);
-			priority = hipriority.fetch_add(1, memory_order_acq_rel);
+			priority = s_block_priority.fetch_add(1, memory_order_acq_rel);
 
 			prior_oid = &wire->prior_oid;
 			level = wire->level;
@@ -600,75 +896,489 @@ void RelayConnection::HandleMsgReadComplete(const boost::system::error_code& e,
 		CheckToDownload();
 }
 
-void RelayConnection::CheckToSend()
+int RelayConnection::CheckBlockRequestParams(const BlockWireHeader *wire, relay_request_params_extended_t& req_params)
 {
-	if (send_one.test_and_set())		// ensure only one object is "in-flight" at a time
-		return;
-
-	while (true)
+	while (memcmp(&req_params.prior_oid, &wire->prior_oid, sizeof(ccoid_t)))
 	{
-		ccoid_t oid;
-
-		{
-			lock_guard<FastSpinLock> lock2(send_queue_lock);
-
-			auto oidp = send_queue.pop();
-			if (!oidp)
-			{
-				if (TRACE_RELAY) BOOST_LOG_TRIVIAL(debug) << Name() << " Conn-" << m_conn_index << " RelayConnection::CheckToSend nothing in queue";
+		BOOST_LOG_TRIVIAL(info) << Name() << " Conn-" << m_conn_index << " RelayConnection::CheckBlockRequestParams error next request block prior oid " << buf2hex(&req_params.prior_oid, sizeof(ccoid_t)) << "; received block prior oid " << buf2hex(&wire->prior_oid, sizeof(ccoid_t));
 
-				send_one.clear();
-
-				return;
-			}
+		if (req_params.compact_fill)
+			CompactBlockAbandon(req_params.oid);
 
-			memcpy(&oid, oidp, sizeof(ccoid_t));
-		}
+		lock_guard<FastSpinLock> lock(request_queue_lock);
 
-		if ((TEST_RANDOM_NO_SEND & rand()) == 1)	// for testing
+		auto params = (relay_request_params_extended_t*)request_param_queue.pop();
+		if (!params)
 		{
-			if (TRACE_RELAY) BOOST_LOG_TRIVIAL(debug) << Name() << " Conn-" << m_conn_index << " RelayConnection::CheckToSend test skipping send of object oid " << buf2hex(&oid, sizeof(ccoid_t));
+			BOOST_LOG_TRIVIAL(info) << Name() << " Conn-" << m_conn_index << " RelayConnection::CheckBlockRequestParams error block not requested";
 
-			continue;
+			return -1;
 		}
 
-		SmartBuf smartobj;
+		memcpy(&req_params, params, sizeof(req_params));
+	}
 
-		auto rc = relay_dbconn->ValidObjsGetObj(oid, &smartobj);
-		if (rc)
-		{
-			if (TRACE_RELAY) BOOST_LOG_TRIVIAL(debug) << Name() << " Conn-" << m_conn_index << " RelayConnection::CheckToSend unable to retrieve object oid " << buf2hex(&oid, sizeof(ccoid_t));
+	if (req_params.level != wire->level)
+	{
+		BOOST_LOG_TRIVIAL(info) << Name() << " Conn-" << m_conn_index << " RelayConnection::CheckBlockRequestParams error requested block level " << req_params.level << "; received block level " << wire->level;
 
-			WriteAsync("RelayConnection::HandleMsgReadComplete", boost::asio::buffer(No_Obj_Reply, sizeof(No_Obj_Reply)),
-					boost::bind(&Connection::HandleWrite, this, boost::asio::placeholders::error, AutoCount(this)));
+		return -1;
+	}
 
-			continue;		// try the next object in the queue
-		}
+	if (req_params.witness != wire->witness)
+	{
+		BOOST_LOG_TRIVIAL(info) << Name() << " Conn-" << m_conn_index << " RelayConnection::CheckBlockRequestParams error requested block witness " << (unsigned)req_params.witness << "; received block witness " << (unsigned)wire->witness;
 
-		auto obj = (CCObject*)smartobj.data();
-		CCASSERT(obj);
+		return -1;
+	}
 
-		if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::CheckToSend buf " << (uintptr_t)smartobj.BasePtr() << " oid " << buf2hex(obj->OidPtr(), sizeof(ccoid_t)) << " size " << obj->ObjSize() << " tag " << obj->ObjTag();
+	return 0;
+}
 
-		auto size = obj->ObjSize();
+int RelayConnection::SetupReceivedBlock(SmartBuf smartobj, const relay_request_params_extended_t& req_params)
+{
+	auto block = (Block*)smartobj.data();
 
-		if (size < CC_MSG_HEADER_SIZE || size > CC_BLOCK_MAX_SIZE)
-		{
-			BOOST_LOG_TRIVIAL(error) << Name() << " Conn-" << m_conn_index << " RelayConnection::CheckToSend error object invalid size " << size;
+	block_hash_t block_hash;
+	block->CalcHash(block_hash);
 
-			continue;		// try the next object in the queue
-		}
+	ccoid_t oid;
+	block->CalcOid(block_hash, oid);
 
-		switch (obj->ObjTag())
-		{
-		case CC_TAG_BLOCK:
-			if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::CheckToSend sending CC_TAG_BLOCK size " << obj->ObjSize() << " oid " << buf2hex(obj->OidPtr(), sizeof(ccoid_t)); // << " block dump " << buf2hex(obj, obj->ObjSize());
+	if (TEST_SEQ_BLOCK_OID)
+		memcpy(&oid, &req_params.oid, sizeof(ccoid_t));
 
-			if (TEST_DOUBLECHECK_BLOCK_OIDS) ((Block*)obj)->SetOrVerifyOid(false);
+	if (memcmp(&req_params.oid, &oid, sizeof(ccoid_t)))
+	{
+		BOOST_LOG_TRIVIAL(info) << Name() << " Conn-" << m_conn_index << " RelayConnection::SetupReceivedBlock error requested block size " << block->ObjSize() << " oid " << buf2hex(&req_params.oid, sizeof(ccoid_t)) << " does not match computed oid " << buf2hex(&oid, sizeof(ccoid_t));
+		//BOOST_LOG_TRIVIAL(info) << Name() << " Conn-" << m_conn_index << " RelayConnection::SetupReceivedBlock block dump " << buf2hex(block, block->ObjSize());
+
+		//raise(SIGTERM);	// for debugging
+
+		return -1;
+	}
+
+	auto auxp = block->SetupAuxBuf(smartobj);
+	if (!auxp)
+	{
+		BOOST_LOG_TRIVIAL(error) << Name() << " Conn-" << m_conn_index << " RelayConnection::SetupReceivedBlock error SetupAuxBuf failed";
+
+		return -1;
+	}
+
+	auxp->SetHash(block_hash);
+	auxp->SetOid(oid);
+
+	auxp->announce_time = req_params.announce_time;
+
+	return 0;
+}
+
+// Starts rebuilding a block from a CC_TAG_BLOCK_COMPACT, using the tx's already in Valid_Objs.
+// Any tx's we don't have are requested from the peer, and the block is finished by CompactBlockFill when they arrive.
+
+int RelayConnection::CompactBlockReceived(SmartBuf smartobj, const relay_request_params_extended_t& params)
+{
+	auto obj = (CCObject*)smartobj.data();
+	auto msgsize = obj->ObjSize();
+
+	CompactBlock cblock;
+	memcpy(&cblock.req_params, &params, sizeof(cblock.req_params));
+	cblock.compact_msg = smartobj;
+
+	if (msgsize < CC_MSG_HEADER_SIZE + sizeof(BlockWireHeader) + sizeof(uint32_t))
+	{
+		BOOST_LOG_TRIVIAL(info) << Name() << " Conn-" << m_conn_index << " RelayConnection::CompactBlockReceived error object too small size " << msgsize;
+
+		return -1;
+	}
+
+	auto wire = (const BlockWireHeader*)obj->DataPtr();
+	auto ntx = *(const uint32_t*)(obj->DataPtr() + sizeof(BlockWireHeader));
+	auto entries = (const relay_compact_tx_t*)(obj->DataPtr() + sizeof(BlockWireHeader) + sizeof(uint32_t));
+
+	if (msgsize != CC_MSG_HEADER_SIZE + sizeof(BlockWireHeader) + sizeof(uint32_t) + (uint64_t)ntx * sizeof(relay_compact_tx_t))
+	{
+		BOOST_LOG_TRIVIAL(info) << Name() << " Conn-" << m_conn_index << " RelayConnection::CompactBlockReceived error size " << msgsize << " does not match tx count " << ntx;
+
+		return -1;
+	}
+
+	if (CheckBlockRequestParams(wire, cblock.req_params))
+		return -1;
+
+	auto& req_params = cblock.req_params;
+
+	auto objs_pending = request_objs_pending.fetch_sub(1) - 1;
+	auto bytes_pending = request_bytes_pending.fetch_sub(req_params.size) - req_params.size;
+
+	CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::CompactBlockReceived still pending " << objs_pending << " objects in " << bytes_pending << " bytes";
+
+	CCASSERT(objs_pending >= 0);
+	CCASSERT(bytes_pending >= 0);
+
+	uint64_t blocksize = CC_MSG_HEADER_SIZE + sizeof(BlockWireHeader);
+
+	for (unsigned i = 0; i < ntx; ++i)
+		blocksize += entries[i].size;
+
+	if (blocksize != req_params.size)
+	{
+		BOOST_LOG_TRIVIAL(info) << Name() << " Conn-" << m_conn_index << " RelayConnection::CompactBlockReceived error expected block size " << req_params.size << "; compact block tx's add up to " << blocksize;
+
+		return -1;
+	}
+
+	cblock.txs.resize(ntx);
+	cblock.nmissing = 0;
+
+	for (unsigned i = 0; i < ntx; ++i)
+	{
+		auto& txobj = cblock.txs[i];
+
+		auto rc = relay_dbconn->ValidObjsGetObj(entries[i].oid, &txobj);
+
+		if (!rc && txobj)
+		{
+			auto tx = (CCObject*)txobj.data();
+
+			if (tx->ObjTag() != CC_TAG_TX_WIRE || tx->BodySize() + CC_MSG_HEADER_SIZE != entries[i].size)
+				txobj.ClearRef();
+		}
+
+		if (!txobj)
+			++cblock.nmissing;
+	}
+
+	s_compact_txs_reused.Add(ntx - cblock.nmissing);
+
+	CCLOG(g_log_relay, debug) << Name() << " Conn-" << m_conn_index << " RelayConnection::CompactBlockReceived block level " << wire->level << " oid " << buf2hex(&req_params.oid, sizeof(ccoid_t)) << " ntx " << ntx << " missing " << cblock.nmissing;
+
+	if (!cblock.nmissing)
+		return CompactBlockFinish(cblock);
+
+	return CompactBlockRequestMissing(cblock);
+}
+
+// Requests the tx's missing from a compact block, or the full block if fetch_block is true or too many tx's are missing
+
+int RelayConnection::CompactBlockRequestMissing(CompactBlock& cblock, bool fetch_block)
+{
+	auto obj = (CCObject*)cblock.compact_msg.data();
+	auto entries = (const relay_compact_tx_t*)(obj->DataPtr() + sizeof(BlockWireHeader) + sizeof(uint32_t));
+
+	unique_lock<FastSpinLock> lock(request_queue_lock);
+
+	// if too many tx's are missing, it's cheaper to fetch the full block
+
+	fetch_block = (fetch_block || cblock.nmissing > RELAY_COMPACT_FETCH_MAX || cblock.nmissing > request_param_queue.space());
+
+	if (fetch_block && !request_param_queue.space())
+	{
+		// the block will be downloaded again after the relay download timeout
+
+		CCLOG(g_log_relay, debug) << Name() << " Conn-" << m_conn_index << " RelayConnection::CompactBlockRequestMissing no space in request queue to fetch block oid " << buf2hex(&cblock.req_params.oid, sizeof(ccoid_t));
+
+		return 0;
+	}
+
+	unsigned nobjs = (fetch_block ? 1 : cblock.nmissing);
+	uint32_t msgsize = CC_MSG_HEADER_SIZE + nobjs * sizeof(ccoid_t);
+	uint32_t tag = (fetch_block ? CC_CMD_SEND_BLOCK : CC_CMD_SEND_TX);
+
+	auto msgbuf = SmartBuf(msgsize);
+	if (!msgbuf)
+	{
+		BOOST_LOG_TRIVIAL(error) << Name() << " Conn-" << m_conn_index << " RelayConnection::CompactBlockRequestMissing error msgbuf failed";
+
+		return 0;
+	}
+
+	auto output = msgbuf.data();
+	uint32_t bufpos = 0;
+
+	copy_to_buf(&msgsize, sizeof(msgsize), bufpos, output, msgsize);
+	copy_to_buf(&tag, sizeof(tag), bufpos, output, msgsize);
+
+	int64_t reqsize = 0;
+
+	if (fetch_block)
+	{
+		cblock.req_params.compact_fill = 0;
+
+		copy_to_buf(&cblock.req_params.oid, sizeof(ccoid_t), bufpos, output, msgsize);
+
+		request_param_queue.push(&cblock.req_params);
+		reqsize += cblock.req_params.size;
+
+		s_compact_full_fetched.Add();
+	}
+	else
+	{
+		for (unsigned i = 0; i < cblock.txs.size(); ++i)
+		{
+			if (cblock.txs[i])
+				continue;
+
+			relay_request_params_extended_t fill_params;
+			memset(&fill_params, 0, sizeof(fill_params));
+
+			memcpy(&fill_params.oid, &entries[i].oid, sizeof(ccoid_t));
+			fill_params.size = entries[i].size + TX_POW_SIZE;
+			fill_params.compact_fill = 1;
+
+			copy_to_buf(&fill_params.oid, sizeof(ccoid_t), bufpos, output, msgsize);
+
+			request_param_queue.push(&fill_params);
+			reqsize += fill_params.size;
+		}
+
+		s_compact_txs_fetched.Add(nobjs);
+	}
+
+	CCASSERT(bufpos == msgsize);
+
+	auto objs_pending = request_objs_pending.fetch_add(nobjs) + nobjs;
+	auto bytes_pending = request_bytes_pending.fetch_add(reqsize) + reqsize;
+
+	CCLOG(g_log_relay, debug) << Name() << " Conn-" << m_conn_index << " RelayConnection::CompactBlockRequestMissing block oid " << buf2hex(&cblock.req_params.oid, sizeof(ccoid_t)) << (fetch_block ? " requesting full block" : " requesting missing tx's ") << (fetch_block ? "" : to_string(nobjs)) << "; total now pending " << objs_pending << " objects in " << bytes_pending;
+
+	if (!fetch_block)
+	{
+		if (compact_blocks.size() >= RELAY_COMPACT_PENDING_MAX)
+		{
+			CCLOG(g_log_relay, debug) << Name() << " Conn-" << m_conn_index << " RelayConnection::CompactBlockRequestMissing dropping oldest pending compact block oid " << buf2hex(&compact_blocks.front().req_params.oid, sizeof(ccoid_t));
+
+			compact_blocks.pop_front();
+		}
+
+		compact_blocks.push_back(move(cblock));
+	}
+
+	lock_guard<mutex> write_pending_lock(next_writer_mutex);
+
+	lock.unlock();	// unlock this after taking next_writer_mutex, so requests go out in the same order their params are queued
+
+	WriteAsync("RelayConnection::CompactBlockRequestMissing", boost::asio::buffer(msgbuf.data(), msgsize),
+			boost::bind(&Connection::HandleWriteSmartBuf, this, boost::asio::placeholders::error, msgbuf, AutoCount(this)), true);
+
+	return 0;
+}
+
+int RelayConnection::CompactBlockFill(SmartBuf smartobj)
+{
+	auto obj = (CCObject*)smartobj.data();
+
+	for (auto it = compact_blocks.begin(); it != compact_blocks.end(); ++it)
+	{
+		auto entries = (const relay_compact_tx_t*)(((CCObject*)it->compact_msg.data())->DataPtr() + sizeof(BlockWireHeader) + sizeof(uint32_t));
+		bool filled = false;
+
+		for (unsigned i = 0; i < it->txs.size(); ++i)
+		{
+			if (!it->txs[i] && !memcmp(&entries[i].oid, obj->OidPtr(), sizeof(ccoid_t)) && obj->BodySize() + CC_MSG_HEADER_SIZE == entries[i].size)
+			{
+				it->txs[i] = smartobj;
+				--it->nmissing;
+				filled = true;
+			}
+		}
+
+		if (!filled)
+			continue;
+
+		CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::CompactBlockFill block oid " << buf2hex(&it->req_params.oid, sizeof(ccoid_t)) << " received tx oid " << buf2hex(obj->OidPtr(), sizeof(ccoid_t)) << " still missing " << it->nmissing;
+
+		if (it->nmissing)
+			return 0;
+
+		CompactBlock cblock(move(*it));
+		compact_blocks.erase(it);
+
+		return CompactBlockFinish(cblock);
+	}
+
+	CCLOG(g_log_relay, debug) << Name() << " Conn-" << m_conn_index << " RelayConnection::CompactBlockFill no compact block waiting for tx oid " << buf2hex(obj->OidPtr(), sizeof(ccoid_t));
+
+	return 0;
+}
+
+void RelayConnection::CompactBlockAbandon(const ccoid_t& oid)
+{
+	// the peer did not send a tx we requested for a compact block, which happens when it has pruned the tx or not yet validated it,
+	// so drop the compact block and ask the same peer for the full block right away instead of waiting for the relay download timeout
+
+	for (auto it = compact_blocks.begin(); it != compact_blocks.end(); )
+	{
+		auto entries = (const relay_compact_tx_t*)(((CCObject*)it->compact_msg.data())->DataPtr() + sizeof(BlockWireHeader) + sizeof(uint32_t));
+		bool waiting = false;
+
+		for (unsigned i = 0; i < it->txs.size() && !waiting; ++i)
+			waiting = (!it->txs[i] && !memcmp(&entries[i].oid, &oid, sizeof(ccoid_t)));
+
+		if (!waiting)
+		{
+			++it;
+
+			continue;
+		}
+
+		BOOST_LOG_TRIVIAL(debug) << Name() << " Conn-" << m_conn_index << " RelayConnection::CompactBlockAbandon dropping compact block oid " << buf2hex(&it->req_params.oid, sizeof(ccoid_t)) << " missing tx oid " << buf2hex(&oid, sizeof(ccoid_t)) << " and requesting full block";
+
+		CompactBlock cblock(move(*it));
+		it = compact_blocks.erase(it);
+
+		CompactBlockRequestMissing(cblock, true);
+	}
+}
+
+int RelayConnection::CompactBlockFinish(CompactBlock& cblock)
+{
+	auto& req_params = cblock.req_params;
+	auto compact = (CCObject*)cblock.compact_msg.data();
+
+	auto smartobj = SmartBuf(req_params.size + sizeof(CCObject::Preamble));
+	if (!smartobj)
+	{
+		BOOST_LOG_TRIVIAL(error) << Name() << " Conn-" << m_conn_index << " RelayConnection::CompactBlockFinish error smartobj failed";
+
+		return 0;
+	}
+
+	auto block = (Block*)smartobj.data();
+
+	block->SetTag(CC_TAG_BLOCK);
+	block->SetSize(req_params.size);
+
+	memcpy(block->WireData(), compact->DataPtr(), sizeof(BlockWireHeader));
+
+	// each tx is stored in the block the same way Witness::BuildNewBlock stores it: size, CC_TAG_TX_BLOCK, and the tx body
+
+	auto output = block->TxData();
+	uint32_t bufpos = 0;
+	uint32_t bufsize = block->TxDataSize();
+
+	for (auto& txobj : cblock.txs)
+	{
+		auto tx = (CCObject*)txobj.data();
+		uint32_t txsize = tx->BodySize() + CC_MSG_HEADER_SIZE;
+		const uint32_t txtag = CC_TAG_TX_BLOCK;
+
+		copy_to_buf(&txsize, sizeof(txsize), bufpos, output, bufsize);
+		copy_to_buf(&txtag, sizeof(txtag), bufpos, output, bufsize);
+		copy_to_buf(tx->BodyPtr(), tx->BodySize(), bufpos, output, bufsize);
+	}
+
+	cblock.txs.clear();
+
+	if (bufpos != bufsize)
+	{
+		BOOST_LOG_TRIVIAL(info) << Name() << " Conn-" << m_conn_index << " RelayConnection::CompactBlockFinish error rebuilt block tx data size " << bufpos << " expected " << bufsize;
+
+		return -1;
+	}
+
+	if (SetupReceivedBlock(smartobj, req_params))
+		return -1;
+
+	auto wire = block->WireData();
+
+	s_compact_rebuilt.Add();
+
+	BOOST_LOG_TRIVIAL(debug) << Name() << " Conn-" << m_conn_index << " RelayConnection::CompactBlockFinish rebuilt block bufp " << (uintptr_t)smartobj.BasePtr() << " size " << block->ObjSize() << " level " << wire->level << " oid " << buf2hex(block->OidPtr(), sizeof(ccoid_t));
+
+	relay_dbconn->RelayObjsSetStatus(*block->OidPtr(), RELAY_STATUS_DOWNLOADED, 0);
+
+	relay_dbconn->ProcessQEnqueueValidate(PROCESS_Q_TYPE_BLOCK, smartobj, &wire->prior_oid, wire->level, PROCESS_Q_STATUS_PENDING, s_block_priority.fetch_add(1, memory_order_acq_rel), m_conn_index, m_use_count.load());
+
+	return 0;
+}
+
+void RelayConnection::CheckToSend()
+{
+	if (send_one.test_and_set())		// ensure only one object is "in-flight" at a time
+		return;
+
+	while (true)
+	{
+		relay_send_params_t send_params;
+		auto& oid = send_params.oid;
+
+		{
+			lock_guard<FastSpinLock> lock2(send_queue_lock);
+
+			auto paramsp = send_queue.pop();
+			if (!paramsp)
+			{
+				CCLOG(g_log_relay, debug) << Name() << " Conn-" << m_conn_index << " RelayConnection::CheckToSend nothing in queue";
+
+				send_one.clear();
+
+				return;
+			}
+
+			memcpy(&send_params, paramsp, sizeof(send_params));
+		}
+
+		if ((TEST_RANDOM_NO_SEND & rand()) == 1)	// for testing
+		{
+			CCLOG(g_log_relay, debug) << Name() << " Conn-" << m_conn_index << " RelayConnection::CheckToSend test skipping send of object oid " << buf2hex(&oid, sizeof(ccoid_t));
+
+			continue;
+		}
+
+		SmartBuf smartobj;
+
+		auto rc = relay_dbconn->ValidObjsGetObj(oid, &smartobj);
+		if (rc)
+		{
+			CCLOG(g_log_relay, debug) << Name() << " Conn-" << m_conn_index << " RelayConnection::CheckToSend unable to retrieve object oid " << buf2hex(&oid, sizeof(ccoid_t));
+
+			WriteAsync("RelayConnection::HandleMsgReadComplete", boost::asio::buffer(No_Obj_Reply, sizeof(No_Obj_Reply)),
+					boost::bind(&Connection::HandleWrite, this, boost::asio::placeholders::error, AutoCount(this)));
+
+			continue;		// try the next object in the queue
+		}
+
+		auto obj = (CCObject*)smartobj.data();
+		CCASSERT(obj);
+
+		CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::CheckToSend buf " << (uintptr_t)smartobj.BasePtr() << " oid " << buf2hex(obj->OidPtr(), sizeof(ccoid_t)) << " size " << obj->ObjSize() << " tag " << obj->ObjTag();
+
+		auto size = obj->ObjSize();
+
+		if (size < CC_MSG_HEADER_SIZE || size > CC_BLOCK_MAX_SIZE)
+		{
+			BOOST_LOG_TRIVIAL(error) << Name() << " Conn-" << m_conn_index << " RelayConnection::CheckToSend error object invalid size " << size;
+
+			continue;		// try the next object in the queue
+		}
+
+		switch (obj->ObjTag())
+		{
+		case CC_TAG_BLOCK:
+			CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::CheckToSend sending CC_TAG_BLOCK size " << obj->ObjSize() << " oid " << buf2hex(obj->OidPtr(), sizeof(ccoid_t)); // << " block dump " << buf2hex(obj, obj->ObjSize());
+
+			if (TEST_DOUBLECHECK_BLOCK_OIDS) ((Block*)obj)->SetOrVerifyOid(false);
+
+			if (send_params.compact)
+			{
+				auto compact = MakeCompactBlock((Block*)obj);
+				if (compact)
+				{
+					CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::CheckToSend sending CC_TAG_BLOCK_COMPACT size " << ((CCObject*)compact.data())->ObjSize() << " instead of full block";
+
+					smartobj = compact;
+					obj = (CCObject*)smartobj.data();
+					size = obj->ObjSize();
+
+					s_compact_sent.Add();
+				}
+			}
 
 			break;
 		case CC_TAG_TX_WIRE:
-			if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::CheckToSend sending CC_TAG_TX_WIRE size " << obj->ObjSize() << " oid " << buf2hex(obj->OidPtr(), sizeof(ccoid_t));
+			CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::CheckToSend sending CC_TAG_TX_WIRE size " << obj->ObjSize() << " oid " << buf2hex(obj->OidPtr(), sizeof(ccoid_t));
 			break;
 		default:
 			BOOST_LOG_TRIVIAL(warning) << Name() << " Conn-" << m_conn_index << " RelayConnection::CheckToSend unknown object tag " << obj->ObjTag() << " size " << obj->ObjSize() << " oid " << buf2hex(obj->OidPtr(), sizeof(ccoid_t));
@@ -691,6 +1401,8 @@ void RelayConnection::HandleObjWrite(const boost::system::error_code& e, SmartBu
 
 	send_one.clear();
 
+	auto size = ((CCObject*)smartobj.data())->ObjSize();
+
 	smartobj.ClearRef();	// we're done with this, so might as well free it now
 
 	bool sim_err = ((TEST_RANDOM_WRITE_ERRORS & rand()) == 1);
@@ -703,7 +1415,10 @@ void RelayConnection::HandleObjWrite(const boost::system::error_code& e, SmartBu
 		return Stop();
 	}
 
-	if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleObjWrite ok";
+	CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleObjWrite ok";
+
+	s_objs_sent.Add();
+	s_bytes_sent.Add(size);
 
 	CheckToSend();
 }
@@ -712,7 +1427,7 @@ void RelayConnection::CheckToDownload()
 {
 	if (request_msg_buf_in_use.test_and_set())
 	{
-		if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::CheckToDownload buffer in use";
+		CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::CheckToDownload buffer in use";
 
 		return;
 	}
@@ -721,14 +1436,14 @@ void RelayConnection::CheckToDownload()
 
 	if (objs_pending > RELAY_DOWNLOAD_LOW_WATER)
 	{
-		if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::CheckToDownload still have " << objs_pending << " objects pending";
+		CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::CheckToDownload still have " << objs_pending << " objects pending";
 
 		request_msg_buf_in_use.clear();
 
 		return;
 	}
 
-	if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::CheckToDownload checking for downloads...";
+	CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::CheckToDownload checking for downloads...";
 
 	unsigned nobjs = 0;
 	unsigned nbytes = 0;
@@ -737,15 +1452,20 @@ void RelayConnection::CheckToDownload()
 
 	relay_dbconn->RelayObjsFindDownloads(m_conn_index, g_blockchain.GetLastIndelibleLevel(), &request_msg_buf[0], sizeof(request_msg_buf), req_param_buf, CC_TX_SEND_MAX - RELAY_DOWNLOAD_HIGH_WATER - objs_pending, request_bytes_pending.load(), nobjs, nbytes);
 
+	if (nbytes && g_params.relay_compact_blocks && (peer_features.load() & RELAY_FEATURE_COMPACT_BLOCKS) && *(uint32_t*)(&request_msg_buf[4]) == CC_CMD_SEND_BLOCK)
+		*(uint32_t*)(&request_msg_buf[4]) = CC_CMD_SEND_BLOCK_COMPACT;
+
+	unique_lock<FastSpinLock> lock(request_queue_lock, defer_lock);
+
 	if (nobjs)
 	{
-		lock_guard<FastSpinLock> lock(request_queue_lock);
+		lock.lock();
 
 		int64_t reqsize = 0;
 
 		for (unsigned i = 0; i < nobjs; ++i)
 		{
-			if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::CheckToDownload queuing request params oid " << buf2hex(&req_param_buf[i].oid, sizeof(ccoid_t)) << " size " << req_param_buf[i].size << " level " << req_param_buf[i].level << " witness " << (unsigned)req_param_buf[i].witness;
+			CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::CheckToDownload queuing request params oid " << buf2hex(&req_param_buf[i].oid, sizeof(ccoid_t)) << " size " << req_param_buf[i].size << " level " << req_param_buf[i].level << " witness " << (unsigned)req_param_buf[i].witness;
 
 			request_param_queue.push(&req_param_buf[i]);
 			reqsize += req_param_buf[i].size;
@@ -756,11 +1476,11 @@ void RelayConnection::CheckToDownload()
 		auto objs_pending = request_objs_pending.fetch_add(nobjs) + nobjs;
 		auto bytes_pending = request_bytes_pending.fetch_add(reqsize) + reqsize;
 
-		if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::CheckToDownload found " << nobjs << " objects in " << reqsize << " bytes; total now pending " << objs_pending << " objects in " << bytes_pending;
+		CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::CheckToDownload found " << nobjs << " objects in " << reqsize << " bytes; total now pending " << objs_pending << " objects in " << bytes_pending;
 	}
 
-	if (TRACE_RELAY && nbytes) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::CheckToDownload RelayObjsFindDownloads returned " << nobjs << " objects in " << nbytes << " bytes sending CC_CMD_SEND_BLOCK/CC_CMD_SEND_TX";
-	else if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::CheckToDownload RelayObjsFindDownloads returned " << nobjs << " objects in " << nbytes;
+	if (nbytes) CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::CheckToDownload RelayObjsFindDownloads returned " << nobjs << " objects in " << nbytes << " bytes sending CC_CMD_SEND_BLOCK/CC_CMD_SEND_TX";
+	else CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::CheckToDownload RelayObjsFindDownloads returned " << nobjs << " objects in " << nbytes;
 
 	if (!nbytes)
 	{
@@ -769,8 +1489,13 @@ void RelayConnection::CheckToDownload()
 		return;
 	}
 
+	lock_guard<mutex> write_pending_lock(next_writer_mutex);
+
+	if (lock.owns_lock())
+		lock.unlock();	// unlock this after taking next_writer_mutex, so requests go out in the same order their params are queued
+
 	if (WriteAsync("RelayConnection::CheckToDownload", boost::asio::buffer(&request_msg_buf, nbytes),
-			boost::bind(&RelayConnection::HandleSendMsgWrite, this, boost::asio::placeholders::error, AutoCount(this))))
+			boost::bind(&RelayConnection::HandleSendMsgWrite, this, boost::asio::placeholders::error, AutoCount(this)), true))
 	{
 		request_msg_buf_in_use.clear();
 	}
@@ -792,14 +1517,198 @@ void RelayConnection::HandleSendMsgWrite(const boost::system::error_code& e, Aut
 		return Stop();
 	}
 
-	if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleSendMsgWrite ok";
+	CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleSendMsgWrite ok";
 
 	//CheckToDownload(); // commented out cause we don't need to check again here
 }
 
+// Replaces the CC_MSG_HAVE_TX in announce_msg_buf with a CC_MSG_HAVE_TX_SHORTIDS when both this node and the peer have tx reconciliation enabled
+// returns the new message size
+
+unsigned RelayConnection::OfferTxShortIds(unsigned nbytes)
+{
+	unsigned nentries = (nbytes - CC_MSG_HEADER_SIZE) / sizeof(relay_have_tx_entry_t);
+	auto entries = (const relay_have_tx_entry_t*)&announce_msg_buf[CC_MSG_HEADER_SIZE];
+
+	CCASSERT(nbytes == CC_MSG_HEADER_SIZE + nentries * sizeof(relay_have_tx_entry_t));
+
+	for (unsigned i = 0; i < nentries; ++i)
+		s_tx_shortids.SetHeld(TxShortId(entries[i].oid));
+
+	if (!g_params.relay_tx_reconcile || !(peer_features.load() & RELAY_FEATURE_TX_RECONCILE))
+	{
+		s_tx_announce_bytes.Add(nbytes);
+
+		return nbytes;
+	}
+
+	{
+		lock_guard<FastSpinLock> lock(offered_lock);
+
+		for (unsigned i = 0; i < nentries; ++i)
+		{
+			auto id = TxShortId(entries[i].oid);
+
+			if (!offered_txs.emplace(id, entries[i]).second)
+				continue;
+
+			offered_order.push_back(id);
+
+			if (offered_order.size() > RELAY_RECONCILE_OFFER_MAX)
+			{
+				offered_txs.erase(offered_order.front());
+				offered_order.pop_front();
+			}
+		}
+	}
+
+	// rewrite the message in place; each short id is written at or before the start of the entry it replaces, after that entry has been read
+
+	auto ids = &announce_msg_buf[CC_MSG_HEADER_SIZE];
+
+	for (unsigned i = 0; i < nentries; ++i)
+	{
+		auto id = TxShortId(entries[i].oid);
+
+		memcpy(ids + i * sizeof(id), &id, sizeof(id));
+	}
+
+	uint32_t msgsize = CC_MSG_HEADER_SIZE + nentries * sizeof(uint64_t);
+	uint32_t tag = CC_MSG_HAVE_TX_SHORTIDS;
+
+	memcpy(&announce_msg_buf[0], &msgsize, sizeof(msgsize));
+	memcpy(&announce_msg_buf[4], &tag, sizeof(tag));
+
+	s_reconcile_ids_sent.Add(nentries);
+	s_tx_announce_bytes.Add(msgsize);
+
+	CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::OfferTxShortIds offering " << nentries << " tx's in " << msgsize << " bytes instead of " << nbytes;
+
+	return msgsize;
+}
+
+// Handles a peer's CC_MSG_HAVE_TX_SHORTIDS by requesting full announcements for the tx's this node doesn't have
+
+void RelayConnection::HandleTxShortIds(uint32_t msgsize)
+{
+	unsigned nids = (msgsize - CC_MSG_HEADER_SIZE) / sizeof(uint64_t);
+
+	CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleTxShortIds received CC_MSG_HAVE_TX_SHORTIDS nids " << nids;
+
+	if (msgsize != CC_MSG_HEADER_SIZE + nids * sizeof(uint64_t))
+	{
+		BOOST_LOG_TRIVIAL(debug) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleTxShortIds error invalid msgsize " << msgsize;
+
+		return;
+	}
+
+	s_reconcile_ids_received.Add(nids);
+
+	auto msgbuf = SmartBuf(msgsize);
+	if (!msgbuf)
+	{
+		BOOST_LOG_TRIVIAL(error) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleTxShortIds error msgbuf failed";
+
+		return;
+	}
+
+	auto output = msgbuf.data();
+	uint32_t bufpos = CC_MSG_HEADER_SIZE;
+
+	for (unsigned i = 0; i < nids; ++i)
+	{
+		uint64_t id;
+
+		memcpy(&id, m_pread + CC_MSG_HEADER_SIZE + i * sizeof(id), sizeof(id));
+
+		if (s_tx_shortids.Want(id))
+			copy_to_buf(&id, sizeof(id), bufpos, output, msgsize);
+	}
+
+	unsigned nwant = (bufpos - CC_MSG_HEADER_SIZE) / sizeof(uint64_t);
+
+	CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleTxShortIds requesting " << nwant << " of " << nids << " tx's";
+
+	if (!nwant)
+		return;
+
+	s_reconcile_txs_requested.Add(nwant);
+	s_tx_announce_bytes.Add(bufpos);
+
+	uint32_t tag = CC_CMD_SEND_HAVE_TX;
+
+	memcpy(output, &bufpos, sizeof(bufpos));
+	memcpy(output + 4, &tag, sizeof(tag));
+
+	WriteAsync("RelayConnection::HandleTxShortIds", boost::asio::buffer(output, bufpos),
+			boost::bind(&Connection::HandleWriteSmartBuf, this, boost::asio::placeholders::error, msgbuf, AutoCount(this)));
+}
+
+// Handles a peer's CC_CMD_SEND_HAVE_TX by sending a CC_MSG_HAVE_TX for the requested tx's that were recently offered to it
+
+void RelayConnection::HandleSendHaveTx(uint32_t msgsize)
+{
+	unsigned nids = (msgsize - CC_MSG_HEADER_SIZE) / sizeof(uint64_t);
+
+	CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleSendHaveTx received CC_CMD_SEND_HAVE_TX nids " << nids;
+
+	if (msgsize != CC_MSG_HEADER_SIZE + nids * sizeof(uint64_t) || nids > CC_HAVE_MAX)
+	{
+		BOOST_LOG_TRIVIAL(debug) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleSendHaveTx error invalid msgsize " << msgsize << " sending CC_ERROR_BAD_CMD";
+
+		WriteAsync("RelayConnection::HandleSendHaveTx", boost::asio::buffer(Bad_Cmd_Reply, sizeof(Bad_Cmd_Reply)),
+				boost::bind(&Connection::HandleWrite, this, boost::asio::placeholders::error, AutoCount(this)));
+
+		return;
+	}
+
+	uint32_t bufsize = CC_MSG_HEADER_SIZE + nids * sizeof(relay_have_tx_entry_t);
+
+	auto msgbuf = SmartBuf(bufsize);
+	if (!msgbuf)
+	{
+		BOOST_LOG_TRIVIAL(error) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleSendHaveTx error msgbuf failed";
+
+		return;
+	}
+
+	auto output = msgbuf.data();
+	uint32_t bufpos = CC_MSG_HEADER_SIZE;
+
+	{
+		lock_guard<FastSpinLock> lock(offered_lock);
+
+		for (unsigned i = 0; i < nids; ++i)
+		{
+			uint64_t id;
+
+			memcpy(&id, m_pread + CC_MSG_HEADER_SIZE + i * sizeof(id), sizeof(id));
+
+			auto it = offered_txs.find(id);
+			if (it != offered_txs.end())
+				copy_to_buf(&it->second, sizeof(it->second), bufpos, output, bufsize);
+		}
+	}
+
+	CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleSendHaveTx sending " << (bufpos - CC_MSG_HEADER_SIZE) / sizeof(relay_have_tx_entry_t) << " of " << nids << " requested tx's";
+
+	if (bufpos == CC_MSG_HEADER_SIZE)
+		return;
+
+	s_tx_announce_bytes.Add(bufpos);
+
+	uint32_t tag = CC_MSG_HAVE_TX;
+
+	memcpy(output, &bufpos, sizeof(bufpos));
+	memcpy(output + 4, &tag, sizeof(tag));
+
+	WriteAsync("RelayConnection::HandleSendHaveTx", boost::asio::buffer(output, bufpos),
+			boost::bind(&Connection::HandleWriteSmartBuf, this, boost::asio::placeholders::error, msgbuf, AutoCount(this)));
+}
+
 bool RelayConnection::SetTimer()
 {
-	//if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::SetTimer";
+	//CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::SetTimer";
 
 	uint32_t ms = RELAY_HEARTBEAT;
 	if (g_params.trace_level >= 6 && g_params.trace_relay && ms > CCTICKS_PER_SEC)
@@ -814,7 +1723,7 @@ void RelayConnection::HandleHeartbeat(const boost::system::error_code& e, AutoCo
 	if (e == boost::asio::error::operation_aborted)
 		return;
 
-	if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleHeartbeat " << uintptr_t(this) << " e = " << e << " " << e.message();
+	CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleHeartbeat " << uintptr_t(this) << " e = " << e << " " << e.message();
 
 	if (g_shutdown)
 		return;
@@ -825,9 +1734,12 @@ void RelayConnection::HandleHeartbeat(const boost::system::error_code& e, AutoCo
 
 	nbytes = relay_dbconn->ValidObjsFindNew(db_next_new_block_seqnum, db_next_new_tx_seqnum, &announce_msg_buf[0], sizeof(announce_msg_buf));
 
+	if (nbytes && *(uint32_t*)(&announce_msg_buf[4]) == CC_MSG_HAVE_TX)
+		nbytes = OfferTxShortIds(nbytes);
+
 	if (nbytes)
 	{
-		if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleHeartbeat sending CC_MSG_HAVE_BLOCK/CC_MSG_HAVE_TX";
+		CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleHeartbeat sending CC_MSG_HAVE_BLOCK/CC_MSG_HAVE_TX";
 
 		WriteAsync("RelayConnection::HandleHeartbeat", boost::asio::buffer(&announce_msg_buf, nbytes),
 				boost::bind(&RelayConnection::HandleAnnounceMsgWrite, this, boost::asio::placeholders::error, AutoCount(this)));
@@ -850,7 +1762,7 @@ void RelayConnection::HandleAnnounceMsgWrite(const boost::system::error_code& e,
 		return Stop();
 	}
 
-	if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleAnnounceMsgWrite ok";
+	CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::HandleAnnounceMsgWrite ok";
 
 	// announce_msg_buf is no longer in use, so we can now restart the timer to look for more objects to announce
 
@@ -859,12 +1771,14 @@ void RelayConnection::HandleAnnounceMsgWrite(const boost::system::error_code& e,
 
 void RelayConnection::FinishConnection()
 {
-	if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::FinishConnection";
+	CCLOG(g_log_relay, trace) << Name() << " Conn-" << m_conn_index << " RelayConnection::FinishConnection";
 
 	relay_dbconn->RelayObjsDeletePeer(m_conn_index);
 
 	if (private_peer_index >= 0)
 		g_privrelay_service.PrivateDisconnected(private_peer_index);
+	else if (m_tor_host.length())
+		g_hostdir.ReportSession(HostDir::Relay, m_tor_host, m_connect_ms, session_bytes, m_connect_ms < 0 ? 0 : ccticks_elapsed(m_connect_ticks, ccticks()) - m_connect_ms);
 }
 
 void RelayService::Start()
@@ -874,15 +1788,17 @@ void RelayService::Start()
 
 	g_hostdir.Init();
 
-	if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << Name() << " RelayService port " << port;
+	CCLOG(g_log_relay, trace) << Name() << " RelayService port " << port;
 
 	// unsigned conn_nreadbuf, unsigned conn_nwritebuf, unsigned sock_nreadbuf, unsigned sock_nwritebuf, unsigned headersize, bool noclose, bool bregister
 	CCServer::ConnectionFactoryInstantiation<RelayConnection> connfac(CC_MAX_MSG_SIZE + 2, 0, -1, -1, CC_MSG_HEADER_SIZE, 1, 1);
 	CCThreadFactoryInstantiation<RelayThread> threadfac;
 
-	unsigned maxconns = (unsigned)(max_inconns + max_outconns);
+	unsigned maxconns = (unsigned)(max_inconns + max_outconns + warm_conns);
 	unsigned nthreads = maxconns * threads_per_conn;
 
+	m_service.SetIoContexts(io_contexts, IoLeastLoaded());
+
 	// unsigned nthreads, unsigned maxconns, unsigned maxincoming, unsigned backlog
 	m_service.Start(boost::asio::ip::tcp::endpoint(address, port),
 			nthreads, maxconns, max_inconns, 0, connfac, threadfac);
@@ -918,7 +1834,7 @@ void RelayService::ConnMonitorProc()
 	{
 		unsigned outcount = m_service.GetServer(si).GetConnectionManager().GetOutgoingConnectionCount();
 
-		if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << Name() << " RelayService::ConnMonitorProc currently " << outcount << " outgoing connections";
+		CCLOG(g_log_relay, trace) << Name() << " RelayService::ConnMonitorProc currently " << outcount << " outgoing connections";
 
 		if ((int)outcount < max_outconns)
 		{
@@ -931,6 +1847,8 @@ void RelayService::ConnMonitorProc()
 			last_dir_refresh_time = ccticks();
 		}
 
+		m_torpool.Maintain(m_service.GetServer(si), warm_conns, warm_conn_secs);
+
 		ccsleep(12);
 	}
 
@@ -939,20 +1857,9 @@ void RelayService::ConnMonitorProc()
 
 void RelayService::ConnectOutgoing()
 {
-	if (TRACE_RELAY) BOOST_LOG_TRIVIAL(info) << Name() << " RelayService::ConnectOutgoing calling GetHostName()";
-
-	auto peer = g_hostdir.GetHostName(HostDir::Relay);
-
-	if (!peer.size())
-	{
-		BOOST_LOG_TRIVIAL(info) << Name() << " RelayService::ConnectOutgoing no relay peers found";
-
-		return;
-	}
-
-	if (TRACE_RELAY) BOOST_LOG_TRIVIAL(info) << Name() << " RelayService::ConnectOutgoing connecting to " << peer;
+	CCLOG(g_log_relay, info) << Name() << " RelayService::ConnectOutgoing";
 
-	m_service.GetServer(0).ConnectThruTor(peer, g_params.torproxy_port);
+	m_torpool.Connect(m_service.GetServer(0), warm_conn_secs, Name());
 }
 
 void RelayService::PrivateConfigPreset()
@@ -1113,7 +2020,7 @@ void RelayService::PrivateConnMonitorProc()
 
 void RelayService::PrivateConnectOutgoing(int peer)
 {
-	if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << Name() << " RelayService::PrivateConnectOutgoing connecting to peer " << peer << " " << m_privhosts[peer];
+	CCLOG(g_log_relay, trace) << Name() << " RelayService::PrivateConnectOutgoing connecting to peer " << peer << " " << m_privhosts[peer];
 
 	auto host = m_privhosts[peer];
 	static const string onion = ".onion";
@@ -1143,7 +2050,7 @@ void RelayService::PrivateConnectOutgoing(int peer)
 	}
 	else
 	{
-		if (TRACE_RELAY) BOOST_LOG_TRIVIAL(debug) << Name() << " RelayService::PrivateConnectOutgoing unable to connect to peer " << peer << " " << host;
+		CCLOG(g_log_relay, debug) << Name() << " RelayService::PrivateConnectOutgoing unable to connect to peer " << peer << " " << host;
 
 		PrivateConnectReschedule(peer);
 	}
@@ -1162,19 +2069,19 @@ void RelayService::PrivateConnectReschedule(int peer)
 	if (!m_connect_time[peer])
 		m_connect_time[peer] = 1;
 
-	if (TRACE_RELAY) BOOST_LOG_TRIVIAL(debug) << Name() << " RelayService::PrivateConnectReschedule scehduling connection to peer " << peer << " in " << delay << " seconds";
+	CCLOG(g_log_relay, debug) << Name() << " RelayService::PrivateConnectReschedule scehduling connection to peer " << peer << " in " << delay << " seconds";
 }
 
 void RelayService::PrivateConnected(int peer)
 {
-	if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << Name() << " RelayService::PrivateConnected peer index " << peer;
+	CCLOG(g_log_relay, trace) << Name() << " RelayService::PrivateConnected peer index " << peer;
 
 	m_connect_error_count[peer] = 0;
 }
 
 void RelayService::PrivateDisconnected(int peer)
 {
-	if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << Name() << " RelayService::PrivateDisconnected peer index " << peer;
+	CCLOG(g_log_relay, trace) << Name() << " RelayService::PrivateDisconnected peer index " << peer;
 
 	PrivateConnectReschedule(peer);
 }
@@ -1194,11 +2101,11 @@ void RelayThread::ThreadProc(boost::function<void()> threadproc)
 {
 	relay_dbconn = new DbConn;
 
-	if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << "RelayThread::ThreadProc start " << (uintptr_t)this << " dbconn " << (uintptr_t)relay_dbconn;
+	CCLOG(g_log_relay, trace) << "RelayThread::ThreadProc start " << (uintptr_t)this << " dbconn " << (uintptr_t)relay_dbconn;
 
 	threadproc();
 
-	if (TRACE_RELAY) BOOST_LOG_TRIVIAL(trace) << "RelayThread::ThreadProc end " << (uintptr_t)this << " dbconn " << (uintptr_t)relay_dbconn;
+	CCLOG(g_log_relay, trace) << "RelayThread::ThreadProc end " << (uintptr_t)this << " dbconn " << (uintptr_t)relay_dbconn;
 
 	delete relay_dbconn;
 }
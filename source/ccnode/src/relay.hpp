@@ -12,19 +12,28 @@
 #include <ccserver/connection.hpp>
 
 #include "service_base.hpp"
+#include "torpool.hpp"
 #include "relay_request_params.h"
 
 #include <CCobjdefs.h>
 #include <ObjQueue.hpp>
 
+#include <unordered_map>
+
+struct BlockWireHeader;
+
 class RelayConnection : public CCServer::Connection
 {
 public:
 	RelayConnection(class CCServer::ConnectionManager& manager, boost::asio::io_service& io_service, const class CCServer::ConnectionFactory& connfac)
 	 :	CCServer::Connection(manager, io_service, connfac),
 		private_peer_index(-1),
+		session_bytes(0),
 		request_param_queue(sizeof(relay_request_params_extended_t), CC_TX_SEND_MAX),
-		send_queue(sizeof(ccoid_t), CC_TX_SEND_MAX)
+		request_queue_lock(s_request_queue_lock_site),
+		send_queue(sizeof(relay_send_params_t), CC_TX_SEND_MAX),
+		send_queue_lock(s_send_queue_lock_site),
+		offered_lock(s_offered_lock_site)
 	{ }
 
 	int private_peer_index;
@@ -32,6 +41,9 @@ public:
 private:
 
 	unsigned peer_error_count;
+	uint64_t session_bytes;		// bytes received this session, reported to g_hostdir
+
+	atomic<uint32_t> peer_features;		// RELAY_FEATURE bits from the peer's CC_MSG_RELAY_FEATURES
 
 	int64_t db_next_new_block_seqnum;
 	int64_t db_next_new_tx_seqnum;
@@ -48,13 +60,43 @@ private:
 
 	ObjQueue send_queue;
 	FastSpinLock send_queue_lock;
+
+	static CCLockSite s_request_queue_lock_site;
+	static CCLockSite s_send_queue_lock_site;
 	atomic_flag send_one;
 
+	unordered_map<uint64_t, relay_have_tx_entry_t> offered_txs;	// tx's recently offered by short id, to answer CC_CMD_SEND_HAVE_TX
+	deque<uint64_t> offered_order;
+	FastSpinLock offered_lock;
+
+	static CCLockSite s_offered_lock_site;
+
+	struct CompactBlock
+	{
+		relay_request_params_extended_t req_params;
+		SmartBuf compact_msg;
+		vector<SmartBuf> txs;
+		unsigned nmissing;
+	};
+
+	deque<CompactBlock> compact_blocks;	// compact blocks waiting for missing tx's; only used by the read handler, which runs one message at a time
+
 	void StartConnection();
+	void SendFeatures();
 
 	void HandleReadComplete();
 	void HandleMsgReadComplete(const boost::system::error_code& e, size_t bytes_transferred, SmartBuf smartobj, AutoCount pending_op_counter);
+	int CheckBlockRequestParams(const BlockWireHeader *wire, relay_request_params_extended_t& req_params);
+	int SetupReceivedBlock(SmartBuf smartobj, const relay_request_params_extended_t& req_params);
+	int CompactBlockReceived(SmartBuf smartobj, const relay_request_params_extended_t& req_params);
+	int CompactBlockRequestMissing(CompactBlock& cblock, bool fetch_block = false);
+	int CompactBlockFill(SmartBuf smartobj);
+	void CompactBlockAbandon(const ccoid_t& oid);
+	int CompactBlockFinish(CompactBlock& cblock);
 	void CheckToDownload();
+	unsigned OfferTxShortIds(unsigned nbytes);
+	void HandleTxShortIds(uint32_t msgsize);
+	void HandleSendHaveTx(uint32_t msgsize);
 	void HandleSendMsgWrite(const boost::system::error_code& e, AutoCount pending_op_counter);
 
 	void CheckToSend();
@@ -98,11 +140,14 @@ public:
 		m_service(n),
 		m_bprivate(b),
 		m_nprivhosts(0),
+		m_torpool(HostDir::Relay),
 		priv_host_index(-1)
 	{ }
 
 	// TODO: instead of making this class polymorphic, make a RelayServiceBase class that is subclassed for RelayService and PrivateRelayService
 
+	TorPool m_torpool;
+
 	wstring priv_hosts_file;
 	int priv_host_index;
 
@@ -133,6 +178,11 @@ public:
 	void PrivateDisconnected(int peer);
 
 	void WaitForShutdown();
+
+	void GetConnectionCounts(unsigned& nincoming, unsigned& noutgoing)
+	{
+		m_service.GetConnectionCounts(nincoming, noutgoing);
+	}
 };
 
 class RelayThread : public CCThread
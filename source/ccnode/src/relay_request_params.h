@@ -10,6 +10,12 @@
 
 #include <CCobjdefs.h>
 
+// feature bits in a CC_MSG_RELAY_FEATURES, which each side of a relay connection sends when the connection starts
+// a peer that never sends one is treated as supporting none of them
+
+#define RELAY_FEATURE_COMPACT_BLOCKS	1	// answers CC_CMD_SEND_BLOCK_COMPACT and wants to be sent it
+#define RELAY_FEATURE_TX_RECONCILE		2	// answers CC_CMD_SEND_HAVE_TX and wants to be sent CC_MSG_HAVE_TX_SHORTIDS
+
 #pragma pack(push, 1)
 
 struct relay_request_wire_params_t
@@ -29,6 +35,30 @@ struct relay_request_params_extended_t
 	uint32_t size;
 	uint32_t announce_time;
 	uint8_t witness;
+	uint8_t compact_fill;		// tx requested to fill in a compact block
+};
+
+// one tx in a CC_MSG_HAVE_TX
+
+struct relay_have_tx_entry_t
+{
+	ccoid_t oid;
+	uint32_t size;
+	uint64_t level;
+};
+
+struct relay_send_params_t
+{
+	ccoid_t oid;
+	uint8_t compact;			// send a block as a CC_TAG_BLOCK_COMPACT
+};
+
+// a compact block is a BlockWireHeader and a tx count, followed by one of these for each tx in the block
+
+struct relay_compact_tx_t
+{
+	ccoid_t oid;
+	uint32_t size;				// size of the tx in the block
 };
 
 typedef array<relay_request_params_extended_t, CC_TX_SEND_MAX> relay_request_param_buf_t;
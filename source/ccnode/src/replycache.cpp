@@ -0,0 +1,161 @@
+/*
+ * CredaCash (TM) cryptocurrency and blockchain
+ *
+ * Copyright (C) 2015-2016 Creda Software, Inc.
+ *
+ * replycache.cpp
+*/
+
+#include "CCdef.h"
+#include "replycache.hpp"
+#include "metrics.hpp"
+
+#include <CCticks.hpp>
+
+#define ENTRY_OVERHEAD	128		// rough allowance for the list node, map node and string headers
+
+ReplyCache g_reply_cache;
+
+static MetricCounter s_hits("replycache.hits");
+static MetricCounter s_misses("replycache.misses");
+static MetricCounter s_evictions("replycache.evictions");
+static MetricCounter s_invalidations("replycache.invalidations");
+static MetricGauge s_bytes("replycache.bytes", []{ return g_reply_cache.Bytes(); });
+
+void ReplyCache::Init(size_t max_bytes, unsigned max_age_secs)
+{
+	lock_guard<mutex> lock(m_lock);
+
+	m_max_bytes = max_bytes;
+	m_max_age = max_age_secs * CCTICKS_PER_SEC;
+
+	BOOST_LOG_TRIVIAL(info) << "ReplyCache::Init max bytes " << m_max_bytes << " max age secs " << max_age_secs;
+}
+
+size_t ReplyCache::Bytes()
+{
+	lock_guard<mutex> lock(m_lock);
+
+	return m_bytes;
+}
+
+void ReplyCache::Clear()
+{
+	m_lru.clear();
+	m_map.clear();
+	m_bytes = 0;
+}
+
+void ReplyCache::Erase(EntryList::iterator it)
+{
+	m_bytes -= it->key.size() + it->reply.size() + ENTRY_OVERHEAD;
+	m_map.erase(it->key);
+	m_lru.erase(it);
+}
+
+void ReplyCache::SetLevel(uint64_t level)
+{
+	if (!Enabled())
+		return;
+
+	lock_guard<mutex> lock(m_lock);
+
+	if (level == m_level)
+		return;
+
+	if (m_map.size())
+		s_invalidations.Add();
+
+	BOOST_LOG_TRIVIAL(trace) << "ReplyCache::SetLevel level " << level << " dropping " << m_map.size() << " entries";
+
+	Clear();
+
+	m_level = level;
+}
+
+unsigned ReplyCache::Lookup(uint64_t level, const string& key, void *buf, unsigned bufsize)
+{
+	if (!Enabled())
+		return 0;
+
+	lock_guard<mutex> lock(m_lock);
+
+	if (level != m_level)
+	{
+		if (level > m_level)
+		{
+			// the level can advance in the db before SetLevel is called, or SetLevel might not have been called since startup
+
+			Clear();
+
+			m_level = level;
+		}
+
+		s_misses.Add();
+
+		return 0;
+	}
+
+	auto mit = m_map.find(key);
+	if (mit == m_map.end())
+	{
+		s_misses.Add();
+
+		return 0;
+	}
+
+	auto it = mit->second;
+
+	if (ccticks_elapsed(it->ticks, ccticks()) > (int)m_max_age || it->reply.size() > bufsize)
+	{
+		Erase(it);
+
+		s_misses.Add();
+
+		return 0;
+	}
+
+	m_lru.splice(m_lru.begin(), m_lru, it);
+
+	memcpy(buf, it->reply.data(), it->reply.size());
+
+	s_hits.Add();
+
+	return it->reply.size();
+}
+
+void ReplyCache::Insert(uint64_t level, const string& key, const void *reply, unsigned size)
+{
+	if (!Enabled())
+		return;
+
+	size_t nbytes = key.size() + size + ENTRY_OVERHEAD;
+
+	if (nbytes > m_max_bytes / 4)
+		return;		// too big to be worth caching
+
+	lock_guard<mutex> lock(m_lock);
+
+	if (level != m_level)
+		return;		// produced from an older snapshot
+
+	auto mit = m_map.find(key);
+	if (mit != m_map.end())
+		Erase(mit->second);		// another connection got there first; replace it with the newer reply
+
+	while (m_bytes + nbytes > m_max_bytes && m_lru.size())
+	{
+		Erase(--m_lru.end());
+
+		s_evictions.Add();
+	}
+
+	m_lru.emplace_front();
+	auto& entry = m_lru.front();
+	entry.key = key;
+	entry.reply.assign((const char*)reply, size);
+	entry.ticks = ccticks();
+
+	m_map[key] = m_lru.begin();
+	m_bytes += nbytes;
+}
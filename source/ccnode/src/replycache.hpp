@@ -0,0 +1,71 @@
+/*
+ * CredaCash (TM) cryptocurrency and blockchain
+ *
+ * Copyright (C) 2015-2016 Creda Software, Inc.
+ *
+ * replycache.hpp
+*/
+
+#pragma once
+
+#include <list>
+#include <unordered_map>
+
+// Caches the tx server's replies to queries, keyed on the query tag and content.
+// Every entry is tagged with the DB_KEY_COMMIT_BLOCK_LEVEL that was current in the read transaction that produced it,
+// and a lookup only hits if the caller's read transaction sees the same level, so a cached reply is always the same as a fresh one,
+// except for the timestamp in some replies, which is kept fresh by max_age.
+// Commitments::UpdateCommitTree calls SetLevel when the level advances, which drops all entries from older levels.
+// Memory is bounded by evicting the least recently used entries.
+
+class ReplyCache
+{
+	struct Entry
+	{
+		string key;
+		string reply;
+		uint32_t ticks;
+	};
+
+	typedef list<Entry> EntryList;
+
+	mutex m_lock;
+	EntryList m_lru;							// most recently used at front
+	unordered_map<string, EntryList::iterator> m_map;
+
+	uint64_t m_level;
+	size_t m_bytes;
+	size_t m_max_bytes;
+	uint32_t m_max_age;
+
+	void Clear();
+	void Erase(EntryList::iterator it);
+
+public:
+	ReplyCache()
+	 :	m_level(0),
+		m_bytes(0),
+		m_max_bytes(0),
+		m_max_age(0)
+	{ }
+
+	// max_bytes = 0 disables the cache
+	void Init(size_t max_bytes, unsigned max_age_secs);
+
+	bool Enabled() const
+	{
+		return m_max_bytes;
+	}
+
+	// drops all entries if the level has changed
+	void SetLevel(uint64_t level);
+
+	// copies the reply into buf and returns its size, or returns 0 if not found
+	unsigned Lookup(uint64_t level, const string& key, void *buf, unsigned bufsize);
+
+	void Insert(uint64_t level, const string& key, const void *reply, unsigned size);
+
+	size_t Bytes();
+};
+
+extern ReplyCache g_reply_cache;
@@ -131,11 +131,22 @@ void ServiceBase::DumpConfig()
 		}
 		cout << "   max incoming connections = " << max_inconns << endl;
 		cout << "   max outgoing connections = " << max_outconns << endl;
+		if (warm_conns > 0)
+		{
+			cout << "   pre-warmed outgoing connections = " << warm_conns << endl;
+			cout << "   max seconds to keep pre-warmed connection = " << warm_conn_secs << endl;
+		}
 		cout << "   threads per connection = " << threads_per_conn << endl;
+		cout << "   io contexts = " << io_contexts << (io_contexts ? "" : " (one per core)") << endl;
 	}
 	cout << endl;
 }
 
+bool ServiceBase::IoLeastLoaded() const
+{
+	return g_params.io_balance == "least-loaded";
+}
+
 const string& ServiceBase::TorHostname()
 {
 	if (!enabled || !tor_service || !tor_advertise)
@@ -30,7 +30,10 @@ public:
 
 	int max_outconns;
 	int max_inconns;
+	int warm_conns;			// outgoing connections kept pre-warmed by TorPool
+	int warm_conn_secs;		// max time a pre-warmed connection is kept before it is used
 	float threads_per_conn;
+	int io_contexts;
 
 	const string& Name() const
 	{
@@ -48,7 +51,10 @@ public:
 		tor_advertise(false),
 		max_outconns(0),
 		max_inconns(0),
-		threads_per_conn(1)
+		warm_conns(0),
+		warm_conn_secs(0),
+		threads_per_conn(1),
+		io_contexts(1)
 	{ }
 
 	virtual ~ServiceBase() = default;
@@ -63,22 +69,17 @@ public:
 	void DumpConfig();
 
 	const string& TorHostname();
-};
 
+	bool IoLeastLoaded() const;
 
-class ControlService : public ServiceBase
-{
-public:
-	ControlService(string n, string s)
-		: ServiceBase(n, s)
-	{ }
-
-	void ConfigPostset()
+	virtual void GetConnectionCounts(unsigned& nincoming, unsigned& noutgoing)
 	{
-		tor_advertise = false;
+		nincoming = 0;
+		noutgoing = 0;
 	}
 };
 
+
 class TorControlService : public ServiceBase
 {
 public:
@@ -12,6 +12,7 @@
 #include "transact.hpp"
 #include "relay.hpp"
 #include "blockserve.hpp"
+#include "control.hpp"
 #include "util.h"
 
 static void tor_hidden_service_config(wostringstream& params, wstring& service_port_list, const ServiceBase& service)
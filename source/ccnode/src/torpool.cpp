@@ -0,0 +1,95 @@
+/*
+ * CredaCash (TM) cryptocurrency and blockchain
+ *
+ * Copyright (C) 2015-2016 Creda Software, Inc.
+ *
+ * torpool.cpp
+*/
+
+#include "CCdef.h"
+#include "torpool.hpp"
+#include "metrics.hpp"
+
+static MetricCounter s_relay_hits("torpool.relay_hits");
+static MetricCounter s_relay_misses("torpool.relay_misses");
+static MetricCounter s_relay_expired("torpool.relay_expired");
+static MetricHistogram s_relay_ttfb_usec("torpool.relay_ttfb_usec");
+static MetricHistogram s_relay_ttfb_pool_usec("torpool.relay_ttfb_pool_usec");
+
+static MetricCounter s_blocksync_hits("torpool.blocksync_hits");
+static MetricCounter s_blocksync_misses("torpool.blocksync_misses");
+static MetricCounter s_blocksync_expired("torpool.blocksync_expired");
+static MetricHistogram s_blocksync_ttfb_usec("torpool.blocksync_ttfb_usec");
+static MetricHistogram s_blocksync_ttfb_pool_usec("torpool.blocksync_ttfb_pool_usec");
+
+TorPool::TorPool(HostDir::HostType type)
+ :	m_type(type)
+{
+	CCASSERT(type == HostDir::Relay || type == HostDir::Blockserve);
+
+	bool relay = (type == HostDir::Relay);
+
+	m_hits = relay ? &s_relay_hits : &s_blocksync_hits;
+	m_misses = relay ? &s_relay_misses : &s_blocksync_misses;
+	m_expired = relay ? &s_relay_expired : &s_blocksync_expired;
+	m_ttfb_usec = relay ? &s_relay_ttfb_usec : &s_blocksync_ttfb_usec;
+	m_ttfb_pool_usec = relay ? &s_relay_ttfb_pool_usec : &s_blocksync_ttfb_pool_usec;
+}
+
+void TorPool::Maintain(CCServer::Server& server, unsigned size, unsigned max_age)
+{
+	auto& manager = server.GetConnectionManager();
+
+	auto nexpired = manager.ExpireWarmConnections(max_age * CCTICKS_PER_SEC);
+	if (nexpired)
+	{
+		CCLOG(g_log_ccserver, trace) << server.Name() << " TorPool::Maintain expired " << nexpired << " warm connections";
+
+		m_expired->Add(nexpired);
+	}
+
+	for (unsigned count = manager.GetWarmConnectionCount(); count < size && !g_shutdown; ++count)
+	{
+		auto peer = g_hostdir.GetHostName(m_type, false);	// don't wait for a directory query
+
+		if (!peer.size())
+			break;
+
+		CCLOG(g_log_ccserver, trace) << server.Name() << " TorPool::Maintain prewarming connection to " << peer;
+
+		if (!server.ConnectThruTor(peer, g_params.torproxy_port, true))
+			break;
+	}
+}
+
+bool TorPool::Connect(CCServer::Server& server, unsigned max_age, const string& name)
+{
+	if (server.ClaimWarmConnection(max_age * CCTICKS_PER_SEC))
+	{
+		m_hits->Add();
+
+		return true;
+	}
+
+	m_misses->Add();
+
+	auto peer = g_hostdir.GetHostName(m_type);
+
+	if (!peer.size())
+	{
+		BOOST_LOG_TRIVIAL(info) << name << " TorPool::Connect no peers found";
+
+		return false;
+	}
+
+	BOOST_LOG_TRIVIAL(info) << name << " TorPool::Connect connecting to " << peer;
+
+	return server.ConnectThruTor(peer, g_params.torproxy_port);
+}
+
+void TorPool::RecordFirstByte(bool from_pool, uint32_t request_ticks)
+{
+	uint64_t usec = (uint64_t)ccticks_elapsed(request_ticks, ccticks()) * (1000000 / CCTICKS_PER_SEC);
+
+	(from_pool ? m_ttfb_pool_usec : m_ttfb_usec)->Record(usec);
+}
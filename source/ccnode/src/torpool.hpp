@@ -0,0 +1,42 @@
+/*
+ * CredaCash (TM) cryptocurrency and blockchain
+ *
+ * Copyright (C) 2015-2016 Creda Software, Inc.
+ *
+ * torpool.hpp
+*/
+
+#pragma once
+
+#include "hostdir.hpp"
+
+#include <ccserver/server.hpp>
+
+// Keeps a few outgoing connections to peers from HostDir connected through Tor and parked in the service's ConnectionManager,
+// so when a peer drops, a replacement can start right away instead of waiting seconds for a new hidden service circuit.
+// The service's monitor thread calls Maintain to expire and refill the pool, and calls Connect instead of ConnectThruTor.
+// A parked connection is open at the peer too, so max_age must be less than the peer's idle timeout.
+
+class TorPool
+{
+	const HostDir::HostType m_type;
+
+	class MetricCounter *m_hits;
+	class MetricCounter *m_misses;
+	class MetricCounter *m_expired;
+	class MetricHistogram *m_ttfb_usec;
+	class MetricHistogram *m_ttfb_pool_usec;
+
+public:
+	explicit TorPool(HostDir::HostType type);
+
+	// stops parked connections older than max_age secs, then starts new ones until there are size
+	void Maintain(CCServer::Server& server, unsigned size, unsigned max_age);
+
+	// claims a parked connection if there is one, otherwise connects to the next host from HostDir
+	// returns true if a connection was started
+	bool Connect(CCServer::Server& server, unsigned max_age, const string& name);
+
+	// called when the first message is received on an outgoing connection
+	void RecordFirstByte(bool from_pool, uint32_t request_ticks);
+};
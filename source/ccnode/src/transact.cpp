@@ -13,6 +13,8 @@
 #include "commitments.hpp"
 #include "dbconn.hpp"
 #include "dbparamkeys.h"
+#include "metrics.hpp"
+#include "replycache.hpp"
 #include "util.h"
 
 #include <CCobjects.hpp>
@@ -37,17 +39,42 @@
 #define TRANSACT_MAX_REPLY_SIZE			64000
 
 #define TRANSACT_QUERY_MAX_COMMITS		2
+#define TRANSACT_QUERY_PAGE_OUTPUTS		100		// max outputs returned by one tx-addresses-query
 
 #define TRANSACT_READ_TIMEOUT			10
 #define TRANSACT_VALIDATION_TIMEOUT		20
-
-#define TRACE_TRANSACT	(g_params.trace_tx_server)
+#define TRANSACT_SESSION_IDLE_TIMEOUT	60
+#define TRANSACT_SESSION_TIMER_TICK		2
 
 thread_local DbConn *tx_dbconn;
 
+static MetricCounter s_requests("tx_server.requests");
+static MetricCounter s_txs_submitted("tx_server.txs_submitted");
+static MetricCounter s_timeouts("tx_server.timeouts");
+static MetricHistogram s_tx_reply_usec("tx_server.tx_reply_usec");
+static MetricCounter s_sessions("tx_server.sessions");
+static MetricCounter s_session_requests("tx_server.session_requests");
+
+void TransactConnection::InitNewConnection()
+{
+	Connection::InitNewConnection();
+
+	m_noclose = false;
+	m_session = false;
+
+	lock_guard<FastSpinLock> lock(m_session_lock);
+
+	m_session_txs.clear();
+}
+
+static bool IsBinaryQuery(unsigned tag)
+{
+	return (tag & CC_TAG_TX_QUERY_BINARY) && (tag & ~CC_TAG_TX_QUERY_BINARY & 0xFFFF0000) == (CC_TAG_TX_QUERY_PARAMS & 0xFFFF0000);
+}
+
 void TransactConnection::StartConnection()
 {
-	if (TRACE_TRANSACT) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::StartConnection";
+	CCLOG(g_log_tx_server, trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::StartConnection";
 
 	if (SetTimer(TRANSACT_READ_TIMEOUT))
 		return;
@@ -56,15 +83,96 @@ void TransactConnection::StartConnection()
 }
 
 void TransactConnection::HandleReadComplete()
+{
+	unsigned size = *(uint32_t*)m_pread;
+	unsigned tag = *(uint32_t*)(m_pread + 4);
+
+	if (tag != CC_TAG_TX_SESSION && !m_session)
+		return HandleRequest();
+
+	// session frame
+
+	if (tag != CC_TAG_TX_SESSION || size < TX_SESSION_HEADER_SIZE + CC_MSG_HEADER_SIZE + TX_POW_SIZE || size > TRANSACT_MAX_REQUEST_SIZE)
+	{
+		BOOST_LOG_TRIVIAL(info) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleReadComplete error invalid session frame size " << size << " tag " << tag;
+
+		return Stop();
+	}
+
+	if (!m_session)
+	{
+		if (g_transact_service.session_max_txs <= 0)
+		{
+			static const string outbuf = "ERROR:sessions not enabled";
+
+			BOOST_LOG_TRIVIAL(debug) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleReadComplete sessions not enabled; sending " << outbuf;
+
+			SendText("TransactConnection::HandleReadComplete", outbuf.c_str(), outbuf.size());
+
+			return;
+		}
+
+		CCLOG(g_log_tx_server, trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleReadComplete starting session";
+
+		s_sessions.Add();
+
+		m_session = true;
+		m_noclose = true;
+		m_session_ticks = ccticks();
+
+		if (SetSessionTimer())	// replaces the read timeout
+			return;
+	}
+
+	m_maxread = size;
+
+	CCASSERT(m_maxread > m_nred);	// the frame is always bigger than the headersize
+
+	ReadAsync("TransactConnection::HandleReadComplete", boost::asio::buffer(m_pread + m_nred, m_maxread - m_nred), boost::asio::transfer_exactly(m_maxread - m_nred),
+			boost::bind(&TransactConnection::HandleSessionReadComplete, this, boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred, AutoCount(this)));
+}
+
+void TransactConnection::HandleSessionReadComplete(const boost::system::error_code& e, size_t bytes_transferred, AutoCount pending_op_counter)
+{
+	bool sim_err = ((TEST_RANDOM_READ_ERRORS & rand()) == 1);
+	if (sim_err) BOOST_LOG_TRIVIAL(info) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleSessionReadComplete simulating read error";
+
+	if (e || sim_err)
+	{
+		BOOST_LOG_TRIVIAL(info) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleSessionReadComplete error " << e << " " << e.message() << "; read " << bytes_transferred << " total " << m_nred;
+
+		return Stop();
+	}
+
+	m_nred += bytes_transferred;
+
+	m_request_id = *(uint32_t*)(m_pread + CC_MSG_HEADER_SIZE);
+	m_session_ticks = ccticks();
+
+	CCLOG(g_log_tx_server, trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleSessionReadComplete read " << m_nred << " bytes request id " << m_request_id;
+
+	s_session_requests.Add();
+
+	// unwrap the request and handle it; since the whole request has already been read, HandleRequest runs synchronously
+	// and on return, the reply has been queued or the tx has been handed off for validation, so the next frame can be read
+
+	m_pread += TX_SESSION_HEADER_SIZE;
+	m_nred -= TX_SESSION_HEADER_SIZE;
+
+	HandleRequest();
+
+	StartRead();
+}
+
+void TransactConnection::HandleRequest()
 {
 	if (m_nred < CC_MSG_HEADER_SIZE + TX_POW_SIZE)
 	{
 		static const string outbuf = "ERROR:unexpected short read";
 
-		BOOST_LOG_TRIVIAL(info) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleReadComplete error short read " << m_nred << "; sending " << outbuf;
+		BOOST_LOG_TRIVIAL(info) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleRequest error short read " << m_nred << "; sending " << outbuf;
 
-		WriteAsync("TransactConnection::HandleReadComplete", boost::asio::buffer(outbuf.c_str(), outbuf.size()),
-				boost::bind(&Connection::HandleWrite, this, boost::asio::placeholders::error, AutoCount(this)));
+		SendText("TransactConnection::HandleRequest", outbuf.c_str(), outbuf.size());
 
 		return;
 	}
@@ -72,27 +180,34 @@ void TransactConnection::HandleReadComplete()
 	unsigned size = *(uint32_t*)m_pread;
 	unsigned tag = *(uint32_t*)(m_pread + 4);
 
-	if (TRACE_TRANSACT) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleReadComplete read " << m_nred << " bytes msg size " << size << " tag " << tag;
+	CCLOG(g_log_tx_server, trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleRequest read " << m_nred << " bytes msg size " << size << " tag " << tag;
 
-	if (size < CC_MSG_HEADER_SIZE + TX_POW_SIZE || size > TRANSACT_MAX_REQUEST_SIZE)
+	if (size < CC_MSG_HEADER_SIZE + TX_POW_SIZE || size > TRANSACT_MAX_REQUEST_SIZE || (m_session && size != m_nred))
 	{
 		static const string outbuf = "ERROR:message size field invalid";
 
-		BOOST_LOG_TRIVIAL(debug) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleReadComplete error invalid size " << size << "; sending " << outbuf;
+		BOOST_LOG_TRIVIAL(debug) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleRequest error invalid size " << size << "; sending " << outbuf;
 
-		WriteAsync("TransactConnection::HandleReadComplete", boost::asio::buffer(outbuf.c_str(), outbuf.size()),
-				boost::bind(&Connection::HandleWrite, this, boost::asio::placeholders::error, AutoCount(this)));
+		SendText("TransactConnection::HandleRequest", outbuf.c_str(), outbuf.size());
 
 		return;
 	}
 
+	s_requests.Add();
+
+	m_cache_key.clear();
+
+	m_binary_reply = IsBinaryQuery(tag);
+	if (m_binary_reply)
+		tag &= ~CC_TAG_TX_QUERY_BINARY;
+
 	unsigned clock_allowance;
 	SmartBuf smartobj;
 
 	switch (tag)
 	{
 	case CC_TAG_TX_QUERY_PARAMS:
-		BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleReadComplete CC_TAG_TX_QUERY_PARAMS";
+		BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleRequest CC_TAG_TX_QUERY_PARAMS";
 
 		clock_allowance = 0;
 		break;
@@ -100,14 +215,15 @@ void TransactConnection::HandleReadComplete()
 	case CC_TAG_TX_QUERY_ADDRESS:
 	case CC_TAG_TX_QUERY_INPUTS:
 	case CC_TAG_TX_QUERY_SERIAL:
-		BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleReadComplete CC_TAG_TX_QUERY_ADDRESS/INPUTS/SERIAL";
+	case CC_TAG_TX_QUERY_ADDRESSES:
+		BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleRequest CC_TAG_TX_QUERY_ADDRESS/INPUTS/SERIAL/ADDRESSES";
 
 		clock_allowance = 5*60;
 		break;
 
 	case CC_TAG_TX_WIRE:
 	{
-		BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleReadComplete CC_TAG_TX_WIRE";
+		BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleRequest CC_TAG_TX_WIRE";
 
 		clock_allowance = 5*60;
 
@@ -116,7 +232,7 @@ void TransactConnection::HandleReadComplete()
 		smartobj = SmartBuf(size + sizeof(CCObject::Preamble));
 		if (!smartobj)
 		{
-			BOOST_LOG_TRIVIAL(error) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleReadComplete error smartobj failed";
+			BOOST_LOG_TRIVIAL(error) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleRequest error smartobj failed";
 
 			return Stop();
 		}
@@ -135,10 +251,9 @@ void TransactConnection::HandleReadComplete()
 
 		static const string outbuf = "ERROR:unrecognized message type";
 
-		BOOST_LOG_TRIVIAL(debug) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleReadComplete error unrecognized message tag " << tag << "; sending " << outbuf;
+		BOOST_LOG_TRIVIAL(debug) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleRequest error unrecognized message tag " << tag << "; sending " << outbuf;
 
-		WriteAsync("TransactConnection::HandleReadComplete", boost::asio::buffer(outbuf.c_str(), outbuf.size()),
-				boost::bind(&Connection::HandleWrite, this, boost::asio::placeholders::error, AutoCount(this)));
+		SendText("TransactConnection::HandleRequest", outbuf.c_str(), outbuf.size());
 
 		return;
 	}
@@ -155,8 +270,7 @@ void TransactConnection::HandleReadComplete()
 
 		BOOST_LOG_TRIVIAL(debug) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleMsgReadComplete error invalid timestamp; sending " << outbuf;
 
-		WriteAsync("TransactConnection::HandleMsgReadComplete", boost::asio::buffer(outbuf, strlen(outbuf)),
-				boost::bind(&Connection::HandleWrite, this, boost::asio::placeholders::error, AutoCount(this)));
+		SendText("TransactConnection::HandleMsgReadComplete", outbuf, strlen(outbuf));
 
 		return;
 	}
@@ -165,9 +279,9 @@ void TransactConnection::HandleReadComplete()
 
 	if (m_maxread > m_nred)
 	{
-		if (TRACE_TRANSACT) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleReadComplete queueing read size " << m_maxread - m_nred;
+		CCLOG(g_log_tx_server, trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleRequest queueing read size " << m_maxread - m_nred;
 
-		ReadAsync("TransactConnection::HandleReadComplete", boost::asio::buffer(m_pread + m_nred, m_maxread - m_nred), boost::asio::transfer_exactly(m_maxread - m_nred),
+		ReadAsync("TransactConnection::HandleRequest", boost::asio::buffer(m_pread + m_nred, m_maxread - m_nred), boost::asio::transfer_exactly(m_maxread - m_nred),
 				boost::bind(&TransactConnection::HandleMsgReadComplete, this, boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred, smartobj, AutoCount(this)));
 	}
 	else
@@ -190,12 +304,15 @@ void TransactConnection::HandleMsgReadComplete(const boost::system::error_code&
 
 	m_nred += bytes_transferred;
 
-	if (TRACE_TRANSACT) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleMsgReadComplete read " << bytes_transferred << " total " << m_nred;
+	CCLOG(g_log_tx_server, trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleMsgReadComplete read " << bytes_transferred << " total " << m_nred;
 
 	unsigned size = *(uint32_t*)m_pread;
 	unsigned tag = *(uint32_t*)(m_pread + 4);
 
-	if (TRACE_TRANSACT) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleMsgReadComplete read " << m_nred << " bytes msg size " << size << " tag " << tag;
+	CCLOG(g_log_tx_server, trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleMsgReadComplete read " << m_nred << " bytes msg size " << size << " tag " << tag;
+
+	if (m_binary_reply)
+		tag &= ~CC_TAG_TX_QUERY_BINARY;
 
 	if (size != m_nred)
 	{
@@ -203,8 +320,7 @@ void TransactConnection::HandleMsgReadComplete(const boost::system::error_code&
 
 		BOOST_LOG_TRIVIAL(debug) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleMsgReadComplete error size " << size << " mismatch " << m_nred << "; sending " << outbuf;
 
-		WriteAsync("TransactConnection::HandleMsgReadComplete", boost::asio::buffer(outbuf.c_str(), outbuf.size()),
-				boost::bind(&Connection::HandleWrite, this, boost::asio::placeholders::error, AutoCount(this)));
+		SendText("TransactConnection::HandleMsgReadComplete", outbuf.c_str(), outbuf.size());
 
 		return;
 	}
@@ -223,6 +339,7 @@ void TransactConnection::HandleMsgReadComplete(const boost::system::error_code&
 	case CC_TAG_TX_QUERY_ADDRESS:
 	case CC_TAG_TX_QUERY_INPUTS:
 	case CC_TAG_TX_QUERY_SERIAL:
+	case CC_TAG_TX_QUERY_ADDRESSES:
 	{
 		proof_difficulty = g_params.query_work_difficulty;
 		const unsigned data_offset = CC_MSG_HEADER_SIZE + TX_POW_SIZE;
@@ -241,8 +358,7 @@ void TransactConnection::HandleMsgReadComplete(const boost::system::error_code&
 
 			BOOST_LOG_TRIVIAL(debug) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleMsgReadComplete error object IsValid false; sending " << outbuf;
 
-			WriteAsync("TransactConnection::HandleTx", boost::asio::buffer(outbuf.c_str(), outbuf.size()),
-					boost::bind(&Connection::HandleWrite, this, boost::asio::placeholders::error, AutoCount(this)));
+			SendText("TransactConnection::HandleTx", outbuf.c_str(), outbuf.size());
 
 			return;
 		}
@@ -274,8 +390,7 @@ void TransactConnection::HandleMsgReadComplete(const boost::system::error_code&
 
 		BOOST_LOG_TRIVIAL(debug) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleMsgReadComplete error proof of work failed; sending " << outbuf;
 
-		WriteAsync("TransactConnection::HandleMsgReadComplete", boost::asio::buffer(outbuf, strlen(outbuf)),
-				boost::bind(&Connection::HandleWrite, this, boost::asio::placeholders::error, AutoCount(this)));
+		SendText("TransactConnection::HandleMsgReadComplete", outbuf, strlen(outbuf));
 
 		return;
 	}
@@ -297,6 +412,9 @@ void TransactConnection::HandleMsgReadComplete(const boost::system::error_code&
 	case CC_TAG_TX_QUERY_SERIAL:
 		return HandleTxQuerySerial(m_pread, size);
 
+	case CC_TAG_TX_QUERY_ADDRESSES:
+		return HandleTxQueryAddresses(m_pread, size);
+
 	case CC_TAG_TX_WIRE:
 		return HandleTx(smartobj);
 
@@ -307,7 +425,7 @@ void TransactConnection::HandleMsgReadComplete(const boost::system::error_code&
 
 void TransactConnection::HandleTx(SmartBuf smartobj)
 {
-	if (TRACE_TRANSACT) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleTx";
+	CCLOG(g_log_tx_server, trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleTx";
 
 	// !!! check now to see if queue is over full
 
@@ -316,21 +434,66 @@ void TransactConnection::HandleTx(SmartBuf smartobj)
 	// Note 2: at the moment, nothing needs to be done to finish use of this connection.
 
 	// set the timer before TxEnqueueValidate so pending ops gets incremented first
+	// in a session, each tx gets its own callback id and the session timer handles the timeouts
+
+	uint32_t callback_id;
+	bool too_many = false;
+
+	if (m_session)
+	{
+		callback_id = expected_callback_id.fetch_add(1);
+
+		lock_guard<FastSpinLock> lock(m_session_lock);
+
+		if (m_session_txs.size() >= (unsigned)g_transact_service.session_max_txs)
+			too_many = true;
+		else
+		{
+			auto& tx = m_session_txs[callback_id];
+			tx.request_id = m_request_id;
+			tx.t0 = chrono::steady_clock::now();
+		}
+	}
+	else
+	{
+		if (SetTimer(TRANSACT_VALIDATION_TIMEOUT))
+			return;
+
+		callback_id = expected_callback_id.load();
+
+		m_tx_t0 = chrono::steady_clock::now();
+	}
+
+	if (too_many)
+	{
+		static const string outbuf = "ERROR:too many transactions in progress";
+
+		BOOST_LOG_TRIVIAL(debug) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleTx session has " << g_transact_service.session_max_txs << " txs in progress; sending " << outbuf;
+
+		SendText("TransactConnection::HandleTx", outbuf.c_str(), outbuf.size());
 
-	if (SetTimer(TRANSACT_VALIDATION_TIMEOUT))
 		return;
+	}
 
 	// queue Tx for validation
 
+	s_txs_submitted.Add();
+
 	static atomic<int64_t> medpriority(1);
 
 	auto priority = medpriority.fetch_add(1, memory_order_acq_rel);
-	auto callback_id = expected_callback_id.load();
 
 	auto rc = ProcessTx::TxEnqueueValidate(tx_dbconn, priority, smartobj, m_conn_index, callback_id);
 	if (rc)
 	{
-		CancelTimer();
+		if (m_session)
+		{
+			lock_guard<FastSpinLock> lock(m_session_lock);
+
+			m_session_txs.erase(callback_id);
+		}
+		else
+			CancelTimer();
 
 		return SendServerError(__LINE__);
 	}
@@ -338,15 +501,44 @@ void TransactConnection::HandleTx(SmartBuf smartobj)
 
 void TransactConnection::HandleValidateDone(unsigned callback_id, int64_t result)
 {
-	// increment expected_callback_id so either HandleTimeout or HandleValidateDone will run, but not both
+	uint32_t request_id = 0;
+	chrono::steady_clock::time_point t0;
 
-	uint32_t expected = callback_id;
-	if (!expected_callback_id.compare_exchange_strong(expected, expected + 1))
+	if (m_session)
 	{
-		BOOST_LOG_TRIVIAL(info) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleValidateDone ignoring late or unexpected callback id " << callback_id;
+		// remove the tx from m_session_txs so either HandleSessionTimer or HandleValidateDone will reply, but not both
 
-		return;
+		lock_guard<FastSpinLock> lock(m_session_lock);
+
+		auto it = m_session_txs.find(callback_id);
+		if (it == m_session_txs.end())
+		{
+			BOOST_LOG_TRIVIAL(info) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleValidateDone ignoring late or unexpected session callback id " << callback_id;
+
+			return;
+		}
+
+		request_id = it->second.request_id;
+		t0 = it->second.t0;
+
+		m_session_txs.erase(it);
 	}
+	else
+	{
+		// increment expected_callback_id so either HandleTimeout or HandleValidateDone will run, but not both
+
+		uint32_t expected = callback_id;
+		if (!expected_callback_id.compare_exchange_strong(expected, expected + 1))
+		{
+			BOOST_LOG_TRIVIAL(info) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleValidateDone ignoring late or unexpected callback id " << callback_id;
+
+			return;
+		}
+
+		t0 = m_tx_t0;
+	}
+
+	s_tx_reply_usec.Record(chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - t0).count());
 
 	// HandleValidateDone was not passed an AutoCount object since we don't want stop to be delayed while the Tx validation runs
 	// But because HandleValidateDone is an async op, we need to acquire an AutoCount now while holding the stop lock
@@ -354,21 +546,21 @@ void TransactConnection::HandleValidateDone(unsigned callback_id, int64_t result
 	auto op_pending = AcquireRef();
 	if (!op_pending)
 	{
-		if (TRACE_TRANSACT) BOOST_LOG_TRIVIAL(debug) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleValidateDone connection is closing";
+		CCLOG(g_log_tx_server, debug) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleValidateDone connection is closing";
 
 		return;
 	}
 
-	CancelTimer();
+	if (!m_session)
+		CancelTimer();
 
 	const char *poutbuf;
+	char outbuf[32];	// in a session, m_writebuf may be in use by the request being read
 
 	if (result < 0)
 		poutbuf = ProcessTx::ResultString(result);
 	else
 	{
-		char *outbuf = (char*)m_writebuf.data();
-
 		#if ULONG_MAX == 0xffffffffffffffff
 		sprintf(outbuf, "OK:%lu", result);
 		#else
@@ -378,20 +570,29 @@ void TransactConnection::HandleValidateDone(unsigned callback_id, int64_t result
 		poutbuf = outbuf;
 	}
 
-	if (!poutbuf)
+	if (!poutbuf && !m_session)
 		return SendServerError(__LINE__);
 
-	if (TRACE_TRANSACT) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleValidateDone result " << result << " sending " << poutbuf;
+	if (!poutbuf)
+	{
+		BOOST_LOG_TRIVIAL(error) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleValidateDone no result string for result " << result;
+
+		poutbuf = "ERROR:server error";
+	}
+
+	CCLOG(g_log_tx_server, trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleValidateDone result " << result << " request id " << request_id << " sending " << poutbuf;
 
-	WriteAsync("TransactConnection::HandleValidateDone", boost::asio::buffer(poutbuf, strlen(poutbuf)),
-			boost::bind(&Connection::HandleWrite, this, boost::asio::placeholders::error, AutoCount(this)));
+	if (m_session)
+		SendSessionReply("TransactConnection::HandleValidateDone", request_id, poutbuf, strlen(poutbuf));
+	else
+		SendText("TransactConnection::HandleValidateDone", poutbuf, strlen(poutbuf));
 }
 
 bool TransactConnection::SetTimer(unsigned sec)
 {
 	auto callback_id = expected_callback_id.load();
 
-	if (TRACE_TRANSACT) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::SetTimer callback id " << callback_id;
+	CCLOG(g_log_tx_server, trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::SetTimer callback id " << callback_id;
 
 	auto op_counter = AutoCount();
 	return AsyncTimerWait("TransactConnection::SetTimer", sec*1000, boost::bind(&TransactConnection::HandleTimeout, this, callback_id, boost::asio::placeholders::error, op_counter), op_counter);
@@ -420,6 +621,69 @@ void TransactConnection::HandleTimeout(unsigned callback_id, const boost::system
 		return SendTimeout();
 }
 
+bool TransactConnection::SetSessionTimer()
+{
+	auto op_counter = AutoCount();
+	return AsyncTimerWait("TransactConnection::SetSessionTimer", TRANSACT_SESSION_TIMER_TICK*1000, boost::bind(&TransactConnection::HandleSessionTimer, this, boost::asio::placeholders::error, op_counter), op_counter);
+}
+
+// times out the session's txs that have been validating too long, and closes the session when it's idle
+
+void TransactConnection::HandleSessionTimer(const boost::system::error_code& e, AutoCount pending_op_counter)
+{
+	if (e == boost::asio::error::operation_aborted)
+		return;
+
+	if (e)
+	{
+		BOOST_LOG_TRIVIAL(info) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleSessionTimer error " << e << " " << e.message();
+
+		return Stop();
+	}
+
+	vector<uint32_t> expired;
+	bool idle;
+
+	{
+		lock_guard<FastSpinLock> lock(m_session_lock);
+
+		auto now = chrono::steady_clock::now();
+
+		for (auto it = m_session_txs.begin(); it != m_session_txs.end(); )
+		{
+			if (now - it->second.t0 >= chrono::seconds(TRANSACT_VALIDATION_TIMEOUT))
+			{
+				expired.push_back(it->second.request_id);
+				it = m_session_txs.erase(it);
+			}
+			else
+				++it;
+		}
+
+		idle = m_session_txs.empty();
+	}
+
+	for (auto request_id : expired)
+	{
+		s_timeouts.Add();
+
+		static const string outbuf = "ERROR:server timeout";
+
+		BOOST_LOG_TRIVIAL(error) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleSessionTimer request id " << request_id << " sending " << outbuf;
+
+		SendSessionReply("TransactConnection::HandleSessionTimer", request_id, outbuf.c_str(), outbuf.size());
+	}
+
+	if (idle && ccticks_elapsed(m_session_ticks, ccticks()) >= TRANSACT_SESSION_IDLE_TIMEOUT * CCTICKS_PER_SEC)
+	{
+		CCLOG(g_log_tx_server, debug) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleSessionTimer closing idle session";
+
+		return Stop();
+	}
+
+	SetSessionTimer();
+}
+
 static void StreamNetParams(ostream &os)
 {
 	os << " \"timestamp\":\"0x" << _time64(NULL) << "\"" JSON_ENDL
@@ -444,9 +708,86 @@ static void StreamValueLimits(ostream &os)
 	os << ",\"maximum-input-value\":\"0x" << g_blockchain.proof_params.invalmax << "\"" JSON_ENDL
 }
 
+// Binary replies are sent when the query tag has CC_TAG_TX_QUERY_BINARY set.
+// They hold the same values as the JSON replies, in the same order, as little-endian integers and fixed size hashes,
+// and cclib's "tx-query-reply-from-wire" command converts them back to the JSON.
+// Status and error replies ("Not Found", "ERROR:...") are text in either case.
+
+static void CopyUint64(uint64_t val, uint32_t& bufpos, vector<uint8_t>& buf)
+{
+	copy_to_buf(&val, sizeof(val), bufpos, buf.data(), buf.size());
+}
+
+static void CopyNetParams(uint32_t& bufpos, vector<uint8_t>& buf)
+{
+	CopyUint64(_time64(NULL), bufpos, buf);
+	CopyUint64(g_params.query_work_difficulty, bufpos, buf);
+	CopyUint64(g_params.tx_work_difficulty, bufpos, buf);
+	CopyUint64(0, bufpos, buf);		// merkle-tree-oldest-commitment-number
+	CopyUint64(g_commitments.GetNextCommitnum(), bufpos, buf);
+}
+
+static void CopyDonationParams(uint32_t& bufpos, vector<uint8_t>& buf)
+{
+	CopyUint64(g_blockchain.proof_params.donation_per_tx, bufpos, buf);
+	CopyUint64(g_blockchain.proof_params.donation_per_byte, bufpos, buf);
+	CopyUint64(g_blockchain.proof_params.donation_per_output, bufpos, buf);
+	CopyUint64(g_blockchain.proof_params.donation_per_input, bufpos, buf);
+}
+
+static void CopyValueLimits(uint32_t& bufpos, vector<uint8_t>& buf)
+{
+	CopyUint64(g_blockchain.proof_params.outvalmin, bufpos, buf);
+	CopyUint64(g_blockchain.proof_params.outvalmax, bufpos, buf);
+	CopyUint64(g_blockchain.proof_params.invalmax, bufpos, buf);
+}
+
+// address, encrypted-value, commitment-iv, commitment, commitment-number
+
+static void CopyOutput(const bigint_t *address, uint64_t value_enc, const bigint_t& commitment_iv, const bigint_t& commitment, uint64_t commitnum, uint32_t& bufpos, vector<uint8_t>& buf)
+{
+	if (address)
+		copy_to_buf(address, sizeof(bigint_t), bufpos, buf.data(), buf.size());
+	CopyUint64(value_enc, bufpos, buf);
+	copy_to_buf(&commitment_iv, TX_COMMIT_IV_BITS/8, bufpos, buf.data(), buf.size());
+	copy_to_buf(&commitment, sizeof(bigint_t), bufpos, buf.data(), buf.size());
+	CopyUint64(commitnum, bufpos, buf);
+}
+
+uint32_t TransactConnection::StartBinaryReply(uint32_t tag)
+{
+	uint32_t bufpos = sizeof(uint32_t);		// leave space for the size word
+
+	tag |= CC_TAG_TX_QUERY_BINARY;
+
+	copy_to_buf(&tag, sizeof(tag), bufpos, m_writebuf.data(), m_writebuf.size());
+
+	return bufpos;
+}
+
+void TransactConnection::SendBinaryReply(uint32_t bufpos)
+{
+	if (bufpos > m_writebuf.size())
+		return SendReplyWriteError();
+
+	memcpy(m_writebuf.data(), &bufpos, sizeof(bufpos));
+
+	CacheReply((const char*)m_writebuf.data(), bufpos);
+
+	SendText("TransactConnection::SendBinaryReply", (const char*)m_writebuf.data(), bufpos);
+}
+
 void TransactConnection::HandleTxQueryParams(const uint8_t *msg, unsigned size)
 {
-	if (TRACE_TRANSACT) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleTxQueryParams size " << size;
+	CCLOG(g_log_tx_server, trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleTxQueryParams size " << size;
+
+	if (m_binary_reply)
+	{
+		auto bufpos = StartBinaryReply(CC_TAG_TX_QUERY_PARAMS);
+		CopyNetParams(bufpos, m_writebuf);
+
+		return SendBinaryReply(bufpos);
+	}
 
 	ostringstream os;
 	os << hex;
@@ -463,7 +804,7 @@ void TransactConnection::HandleTxQueryParams(const uint8_t *msg, unsigned size)
 
 void TransactConnection::HandleTxQueryAddress(const uint8_t *msg, unsigned size)
 {
-	if (TRACE_TRANSACT) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleTxQueryAddress size " << size;
+	CCLOG(g_log_tx_server, trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleTxQueryAddress size " << size;
 
 	bigint_t address;
 	uint64_t commitstart;
@@ -480,12 +821,20 @@ void TransactConnection::HandleTxQueryAddress(const uint8_t *msg, unsigned size)
 
 		BOOST_LOG_TRIVIAL(debug) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleTxQueryAddress error malformed query; sending " << outbuf;
 
-		WriteAsync("TransactConnection::HandleTxQueryAddress", boost::asio::buffer(outbuf.c_str(), outbuf.size()),
-				boost::bind(&Connection::HandleWrite, this, boost::asio::placeholders::error, AutoCount(this)));
+		SendText("TransactConnection::HandleTxQueryAddress", outbuf.c_str(), outbuf.size());
 
 		return;
 	}
 
+	Finally finally(boost::bind(&DbConnPersistData::EndRead, tx_dbconn));
+
+	auto rc = tx_dbconn->BeginRead();
+	if (rc)
+		return SendServerError(__LINE__);
+
+	if (SendCachedReply(CC_TAG_TX_QUERY_ADDRESS, msg, size))
+		return;
+
 	array<uint64_t, TRANSACT_QUERY_MAX_COMMITS> value_enc, commitnums;
 	array<bigint_t, TRANSACT_QUERY_MAX_COMMITS> commitment_iv, commitment;
 	bool have_more;
@@ -499,14 +848,30 @@ void TransactConnection::HandleTxQueryAddress(const uint8_t *msg, unsigned size)
 
 		BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleTxQueryAddress not found; sending " << outbuf;
 
-		WriteAsync("TransactConnection::HandleTxQueryAddress", boost::asio::buffer(outbuf.c_str(), outbuf.size()),
-				boost::bind(&Connection::HandleWrite, this, boost::asio::placeholders::error, AutoCount(this)));
+		CacheReply(outbuf.c_str(), outbuf.size());
+
+		SendText("TransactConnection::HandleTxQueryAddress", outbuf.c_str(), outbuf.size());
 
 		return;
 	}
 
 	//memset(m_writebuf.data(), 0, m_writebuf.size());	// for testing
 
+	if (m_binary_reply)
+	{
+		auto bufpos = StartBinaryReply(CC_TAG_TX_QUERY_ADDRESS);
+		copy_to_buf(&address, sizeof(address), bufpos, m_writebuf.data(), m_writebuf.size());
+		CopyUint64(commitstart, bufpos, m_writebuf);
+		CopyUint64(have_more, bufpos, m_writebuf);
+		CopyUint64(nfound, bufpos, m_writebuf);
+		for (int i = 0; i < nfound; ++i)
+			CopyOutput(NULL, value_enc[i], commitment_iv[i], commitment[i], commitnums[i], bufpos, m_writebuf);
+
+		BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleTxQueryAddress found; sending binary reply size " << bufpos;
+
+		return SendBinaryReply(bufpos);
+	}
+
 	ostringstream os;
 	os << hex;
 	os.rdbuf()->pubsetbuf((char*)m_writebuf.data(), m_writebuf.size());
@@ -538,7 +903,7 @@ void TransactConnection::HandleTxQueryAddress(const uint8_t *msg, unsigned size)
 
 void TransactConnection::HandleTxQueryInputs(const uint8_t *msg, unsigned size)
 {
-	if (TRACE_TRANSACT) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleTxQueryInputs size " << size;
+	CCLOG(g_log_tx_server, trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleTxQueryInputs size " << size;
 
 	bigint_t address, commitment_iv, commitment, hash, nullhash;
 	uint64_t param_level, row_end, commitstart, value_enc, commitnum;
@@ -555,8 +920,7 @@ void TransactConnection::HandleTxQueryInputs(const uint8_t *msg, unsigned size)
 
 		BOOST_LOG_TRIVIAL(debug) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleTxQueryInputs error malformed query; sending " << outbuf;
 
-		WriteAsync("TransactConnection::HandleTxQueryInputs", boost::asio::buffer(outbuf.c_str(), outbuf.size()),
-				boost::bind(&Connection::HandleWrite, this, boost::asio::placeholders::error, AutoCount(this)));
+		SendText("TransactConnection::HandleTxQueryInputs", outbuf.c_str(), outbuf.size());
 
 		return;
 	}
@@ -569,6 +933,9 @@ void TransactConnection::HandleTxQueryInputs(const uint8_t *msg, unsigned size)
 	if (rc)
 		return SendServerError(__LINE__);
 
+	if (SendCachedReply(CC_TAG_TX_QUERY_INPUTS, msg, size))
+		return;
+
 	CCASSERT(COMMITMENT_HASH_BYTES <= sizeof(hash));
 
 	rc = tx_dbconn->ParameterSelect(DB_KEY_COMMIT_BLOCK_LEVEL, 0, &param_level, sizeof(param_level));
@@ -594,24 +961,42 @@ void TransactConnection::HandleTxQueryInputs(const uint8_t *msg, unsigned size)
 	//cerr << "merkle-root " << hash << endl;
 
 	ostringstream os;
-	os << hex;
-	os.rdbuf()->pubsetbuf((char*)m_writebuf.data(), m_writebuf.size());
+	uint32_t replypos = 0;
 
-	os << "{\"tx-input-query-report\":{" JSON_ENDL
-	StreamNetParams(os);
-	StreamDonationParams(os);
-	os << ",\"tx-input-query-results\":" JSON_ENDL
-	os << "{\"parameter-level\":\"0x" << param_level << "\"" JSON_ENDL
-	os << ",\"merkle-root\":\"0x" << hash << "\"" JSON_ENDL
-	StreamValueLimits(os);
-	os << ",\"inputs\":[" JSON_ENDL
+	if (m_binary_reply)
+	{
+		replypos = StartBinaryReply(CC_TAG_TX_QUERY_INPUTS);
+		CopyNetParams(replypos, m_writebuf);
+		CopyDonationParams(replypos, m_writebuf);
+		CopyUint64(param_level, replypos, m_writebuf);
+		copy_to_buf(&hash, COMMITMENT_HASH_BYTES, replypos, m_writebuf.data(), m_writebuf.size());
+		CopyValueLimits(replypos, m_writebuf);
+		CopyUint64(param_level ? nin : 0, replypos, m_writebuf);
+	}
+	else
+	{
+		os << hex;
+		os.rdbuf()->pubsetbuf((char*)m_writebuf.data(), m_writebuf.size());
+
+		os << "{\"tx-input-query-report\":{" JSON_ENDL
+		StreamNetParams(os);
+		StreamDonationParams(os);
+		os << ",\"tx-input-query-results\":" JSON_ENDL
+		os << "{\"parameter-level\":\"0x" << param_level << "\"" JSON_ENDL
+		os << ",\"merkle-root\":\"0x" << hash << "\"" JSON_ENDL
+		StreamValueLimits(os);
+		os << ",\"inputs\":[" JSON_ENDL
+	}
 
 	if (!param_level)
 	{
-		os << "]}}}";
-
 		BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleTxQueryInputs Merkle tree is empty"; // sending " << (char*)m_writebuf.data();
 
+		if (m_binary_reply)
+			return SendBinaryReply(replypos);
+
+		os << "]}}}";
+
 		return SendReply(os);
 	}
 
@@ -636,8 +1021,9 @@ void TransactConnection::HandleTxQueryInputs(const uint8_t *msg, unsigned size)
 
 			BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleTxQueryInputs not found"; // sending " << outbuf;
 
-			WriteAsync("TransactConnection::HandleTxQueryInputs", boost::asio::buffer(outbuf, strlen(outbuf)),
-					boost::bind(&Connection::HandleWrite, this, boost::asio::placeholders::error, AutoCount(this)));
+			CacheReply(outbuf, strlen(outbuf));
+
+			SendText("TransactConnection::HandleTxQueryInputs", outbuf, strlen(outbuf));
 
 			return;
 		}
@@ -646,55 +1032,68 @@ void TransactConnection::HandleTxQueryInputs(const uint8_t *msg, unsigned size)
 		for (unsigned j = 2; j < commitment_iv.numberLimbs(); ++j)
 			commitment_iv.data()[j] = 0;
 
-		if (i)
-			os << ",";
-		os << "{\"address\":\"0x" << address << "\"" JSON_ENDL
-		os << ",\"encrypted-value\":\"0x" << value_enc << "\"" JSON_ENDL
-		os << ",\"commitment-iv\":\"0x" << commitment_iv << "\"" JSON_ENDL
-		os << ",\"commitment\":\"0x" << commitment << "\"" JSON_ENDL
-		os << ",\"commitment-number\":\"0x" << commitnum << "\"" JSON_ENDL
-		os << ",\"merkle-path\":[" JSON_ENDL
+		if (m_binary_reply)
+			CopyOutput(&address, value_enc, commitment_iv, commitment, commitnum, replypos, m_writebuf);
+		else
+		{
+			if (i)
+				os << ",";
+			os << "{\"address\":\"0x" << address << "\"" JSON_ENDL
+			os << ",\"encrypted-value\":\"0x" << value_enc << "\"" JSON_ENDL
+			os << ",\"commitment-iv\":\"0x" << commitment_iv << "\"" JSON_ENDL
+			os << ",\"commitment\":\"0x" << commitment << "\"" JSON_ENDL
+			os << ",\"commitment-number\":\"0x" << commitnum << "\"" JSON_ENDL
+			os << ",\"merkle-path\":[" JSON_ENDL
+		}
 		uint64_t offset = commitnum;
 		uint64_t end = row_end;
 		for (unsigned height = 0; height < TX_MERKLE_DEPTH; ++height)
 		{
-			if (height)
-				os << ",";
-
 			offset ^= 1;	// fetch the other hash input
 
 			//cerr << "HandleTxQueryInputs commitnum " << commitnum << " height " << height << " offset " << offset << " row_end " << end << endl;
 
-			if (offset > end)
-			{
-				os << "\"0x" << nullhash << "\"" JSON_ENDL
-			}
-			else
+			const bigint_t *phash = &nullhash;
+
+			if (offset <= end)
 			{
 				auto rc = tx_dbconn->CommitTreeSelect(height, offset, &hash, COMMITMENT_HASH_BYTES);
 				if (rc)
 					return SendServerError(__LINE__);
-				os << "\"0x" << hash << "\"" JSON_ENDL
+				phash = &hash;
+			}
+
+			if (m_binary_reply)
+				copy_to_buf(phash, COMMITMENT_HASH_BYTES, replypos, m_writebuf.data(), m_writebuf.size());
+			else
+			{
+				if (height)
+					os << ",";
+				os << "\"0x" << *phash << "\"" JSON_ENDL
 			}
 
 			offset /= 2;
 			end /= 2;
 		}
-		os << "]}" JSON_ENDL
+		if (!m_binary_reply)
+			os << "]}" JSON_ENDL
 	}
 
 	CCASSERT(bufpos == size);
 
-	os << "]}}}";
-
 	BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleTxQueryInputs found"; // sending " << (char*)m_writebuf.data();
 
+	if (m_binary_reply)
+		return SendBinaryReply(replypos);
+
+	os << "]}}}";
+
 	SendReply(os);
 }
 
 void TransactConnection::HandleTxQuerySerial(const uint8_t *msg, unsigned size)
 {
-	if (TRACE_TRANSACT) BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleTxQuerySerial size " << size;
+	CCLOG(g_log_tx_server, trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleTxQuerySerial size " << size;
 
 	bigint_t serialnum;
 	static const bool bhex = false;
@@ -709,8 +1108,7 @@ void TransactConnection::HandleTxQuerySerial(const uint8_t *msg, unsigned size)
 
 		BOOST_LOG_TRIVIAL(debug) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleTxQuerySerial error malformed query; sending " << outbuf;
 
-		WriteAsync("TransactConnection::HandleTxQuerySerial", boost::asio::buffer(outbuf.c_str(), outbuf.size()),
-				boost::bind(&Connection::HandleWrite, this, boost::asio::placeholders::error, AutoCount(this)));
+		SendText("TransactConnection::HandleTxQuerySerial", outbuf.c_str(), outbuf.size());
 
 		return;
 	}
@@ -724,8 +1122,7 @@ void TransactConnection::HandleTxQuerySerial(const uint8_t *msg, unsigned size)
 
 		BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleTxQuerySerial not found; sending " << outbuf;
 
-		WriteAsync("TransactConnection::HandleTxQuerySerial", boost::asio::buffer(outbuf.c_str(), outbuf.size()),
-				boost::bind(&Connection::HandleWrite, this, boost::asio::placeholders::error, AutoCount(this)));
+		SendText("TransactConnection::HandleTxQuerySerial", outbuf.c_str(), outbuf.size());
 
 		return;
 	}
@@ -735,13 +1132,163 @@ void TransactConnection::HandleTxQuerySerial(const uint8_t *msg, unsigned size)
 
 		BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleTxQuerySerial found; sending " << outbuf;
 
-		WriteAsync("TransactConnection::HandleTxQuerySerial", boost::asio::buffer(outbuf.c_str(), outbuf.size()),
-				boost::bind(&Connection::HandleWrite, this, boost::asio::placeholders::error, AutoCount(this)));
+		SendText("TransactConnection::HandleTxQuerySerial", outbuf.c_str(), outbuf.size());
 
 		return;
 	}
 }
 
+// Returns the outputs sent to a set of addresses, each starting at its own commitment number cursor.
+// The addresses are scanned in (Address, Commitnum) key order in a single read transaction, so the results are consistent.
+// If more-results-available is set, the page filled up: the wallet should repeat the query, with the cursor of each address that
+// had results advanced past the last commitment number returned for it.
+
+void TransactConnection::HandleTxQueryAddresses(const uint8_t *msg, unsigned size)
+{
+	CCLOG(g_log_tx_server, trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleTxQueryAddresses size " << size;
+
+	struct AddressCursor
+	{
+		bigint_t address;
+		uint64_t commitstart;
+	};
+
+	static const bool bhex = false;
+
+	static const unsigned entry_size = sizeof(bigint_t) + sizeof(uint64_t);
+	unsigned naddrs = size / entry_size;
+
+	if (naddrs * entry_size != size || !naddrs || naddrs > TX_QUERY_MAX_ADDRESSES)
+	{
+		static const string outbuf = "ERROR:malformed binary tx-addresses-query";
+
+		BOOST_LOG_TRIVIAL(debug) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleTxQueryAddresses error malformed query; sending " << outbuf;
+
+		SendText("TransactConnection::HandleTxQueryAddresses", outbuf.c_str(), outbuf.size());
+
+		return;
+	}
+
+	vector<AddressCursor> cursors(naddrs);
+
+	uint32_t bufpos = 0;
+
+	for (auto& cursor : cursors)
+	{
+		copy_from_buf(&cursor.address, sizeof(cursor.address), bufpos, msg, size, bhex);
+		copy_from_buf(&cursor.commitstart, sizeof(cursor.commitstart), bufpos, msg, size, bhex);
+	}
+
+	CCASSERT(bufpos == size);
+
+	// sort into the order the addresses are stored in the Tx_Outputs primary key, which sqlite compares with memcmp
+
+	sort(cursors.begin(), cursors.end(), [](const AddressCursor& a, const AddressCursor& b)
+	{
+		auto cmp = memcmp(&a.address, &b.address, sizeof(a.address));
+		return cmp < 0 || (!cmp && a.commitstart < b.commitstart);
+	});
+
+	// ensure we get a consistent snapshot
+
+	Finally finally(boost::bind(&DbConnPersistData::EndRead, tx_dbconn));
+
+	auto rc = tx_dbconn->BeginRead();
+	if (rc)
+		return SendServerError(__LINE__);
+
+	if (SendCachedReply(CC_TAG_TX_QUERY_ADDRESSES, msg, size))
+		return;
+
+	array<uint64_t, TRANSACT_QUERY_PAGE_OUTPUTS> value_enc, commitnums;
+	array<bigint_t, TRANSACT_QUERY_PAGE_OUTPUTS> commitment_iv, commitment;
+
+	ostringstream os;
+	uint32_t replypos = 0, countpos = 0;
+
+	if (m_binary_reply)
+	{
+		replypos = StartBinaryReply(CC_TAG_TX_QUERY_ADDRESSES);
+		countpos = replypos;
+		CopyUint64(0, replypos, m_writebuf);	// filled in below
+	}
+	else
+	{
+		os << hex;
+		os.rdbuf()->pubsetbuf((char*)m_writebuf.data(), m_writebuf.size());
+
+		os << "{\"tx-addresses-query-report\":" JSON_ENDL
+		os << "{\"tx-addresses-query-results\":[" JSON_ENDL
+	}
+
+	unsigned noutputs = 0;
+	bool have_more = false;
+
+	for (unsigned i = 0; i < naddrs && !have_more; ++i)
+	{
+		auto& cursor = cursors[i];
+
+		if (i && !memcmp(&cursor.address, &cursors[i-1].address, sizeof(cursor.address)))
+			continue;	// duplicate address; the first one has the lowest cursor
+
+		if (noutputs >= TRANSACT_QUERY_PAGE_OUTPUTS)
+		{
+			have_more = true;	// there might be more
+
+			break;
+		}
+
+		unsigned limit = TRANSACT_QUERY_PAGE_OUTPUTS - noutputs;
+
+		auto nfound = tx_dbconn->TxOutputsSelect(&cursor.address, sizeof(cursor.address), cursor.commitstart, INT64_MAX, &value_enc[0], (char*)&commitment_iv, sizeof(bigint_t), (char*)&commitment, sizeof(bigint_t), &commitnums[0], limit, &have_more);
+		if (nfound < 0)
+			return SendServerError(__LINE__);
+
+		if (limit == 1 && nfound == 1)
+			have_more = true;	// TxOutputsSelect only checks for more when limit > 1
+
+		for (int j = 0; j < nfound; ++j)
+		{
+			CCASSERT(TX_COMMIT_IV_BITS == 128);
+			for (unsigned k = 2; k < commitment_iv[j].numberLimbs(); ++k)
+				commitment_iv[j].data()[k] = 0;
+
+			if (m_binary_reply)
+			{
+				CopyOutput(&cursor.address, value_enc[j], commitment_iv[j], commitment[j], commitnums[j], replypos, m_writebuf);
+				++noutputs;
+				continue;
+			}
+
+			if (noutputs++)
+				os << ",";
+			os << "{\"address\":\"0x" << cursor.address << "\"" JSON_ENDL
+			os << ",\"encrypted-value\":\"0x" << value_enc[j] << "\"" JSON_ENDL
+			os << ",\"commitment-iv\":\"0x" << commitment_iv[j] << "\"" JSON_ENDL
+			os << ",\"commitment\":\"0x" << commitment[j] << "\"" JSON_ENDL
+			os << ",\"commitment-number\":\"0x" << commitnums[j] << "\"" JSON_ENDL
+			os << "}" JSON_ENDL
+		}
+	}
+
+	BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::HandleTxQueryAddresses addresses " << naddrs << " found " << noutputs << " more " << have_more;
+
+	if (m_binary_reply)
+	{
+		uint64_t count = noutputs;
+		memcpy(m_writebuf.data() + countpos, &count, sizeof(count));
+		CopyUint64(have_more, replypos, m_writebuf);
+
+		return SendBinaryReply(replypos);
+	}
+
+	os << "]" JSON_ENDL
+	os << ",\"more-results-available\":\"0x" << (int)have_more << "\"" JSON_ENDL
+	os << "}}";
+
+	SendReply(os);
+}
+
 void TransactConnection::SendReply(ostringstream& os)
 {
 	unsigned size = os.tellp();
@@ -751,20 +1298,101 @@ void TransactConnection::SendReply(ostringstream& os)
 
 	//BOOST_LOG_TRIVIAL(trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::SendReply sending " << (char*)m_writebuf.data();
 
-	WriteAsync("TransactConnection::SendReply", boost::asio::buffer(m_writebuf.data(), size),
-			boost::bind(&Connection::HandleWrite, this, boost::asio::placeholders::error, AutoCount(this)));
+	CacheReply((const char*)m_writebuf.data(), size);
+
+	SendText("TransactConnection::SendReply", (const char*)m_writebuf.data(), size);
 
 	//cerr << "SendReply done" << endl;
 }
 
+// Must be called inside the read transaction that will produce the reply, so the reply is tagged with the level it was produced from.
+// On a miss, saves the key so CacheReply can add the reply to the cache.
+
+bool TransactConnection::SendCachedReply(uint32_t tag, const uint8_t *msg, unsigned size)
+{
+	m_cache_key.clear();
+
+	if (!g_reply_cache.Enabled())
+		return false;
+
+	if (tx_dbconn->ParameterSelect(DB_KEY_COMMIT_BLOCK_LEVEL, 0, &m_cache_level, sizeof(m_cache_level)))
+		return false;	// merkle tree is empty or db error; the caller will handle it
+
+	if (m_binary_reply)
+		tag |= CC_TAG_TX_QUERY_BINARY;
+
+	string key((const char*)&tag, sizeof(tag));
+	key.append((const char*)msg, size);
+
+	auto nbytes = g_reply_cache.Lookup(m_cache_level, key, m_writebuf.data(), m_writebuf.size());
+	if (!nbytes)
+	{
+		m_cache_key.swap(key);
+
+		return false;
+	}
+
+	CCLOG(g_log_tx_server, trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::SendCachedReply tag " << hex << tag << dec << " level " << m_cache_level << " sending cached reply size " << nbytes;
+
+	SendText("TransactConnection::SendCachedReply", (const char*)m_writebuf.data(), nbytes);
+
+	return true;
+}
+
+void TransactConnection::CacheReply(const char *text, unsigned size)
+{
+	if (!m_cache_key.size())
+		return;
+
+	g_reply_cache.Insert(m_cache_level, m_cache_key, text, size);
+
+	m_cache_key.clear();
+}
+
+void TransactConnection::SendText(const char *function, const char *text, unsigned size)
+{
+	if (m_session)
+		return SendSessionReply(function, m_request_id, text, size);
+
+	WriteAsync(function, boost::asio::buffer(text, size),
+			boost::bind(&Connection::HandleWrite, this, boost::asio::placeholders::error, AutoCount(this)));
+}
+
+// copies the reply into its own buffer, so it doesn't need m_writebuf while the next request is handled
+
+void TransactConnection::SendSessionReply(const char *function, uint32_t request_id, const char *text, unsigned size)
+{
+	uint32_t msgsize = TX_SESSION_HEADER_SIZE + size;
+	uint32_t tag = CC_TAG_TX_SESSION_REPLY;
+
+	SmartBuf msgbuf(msgsize);
+	if (!msgbuf)
+	{
+		BOOST_LOG_TRIVIAL(error) << Name() << " Conn-" << m_conn_index << " TransactConnection::SendSessionReply error smartbuf failed";
+
+		return Stop();
+	}
+
+	auto output = msgbuf.data();
+
+	memcpy(output, &msgsize, sizeof(msgsize));
+	memcpy(output + 4, &tag, sizeof(tag));
+	memcpy(output + CC_MSG_HEADER_SIZE, &request_id, sizeof(request_id));
+	memcpy(output + TX_SESSION_HEADER_SIZE, text, size);
+
+	CCLOG(g_log_tx_server, trace) << Name() << " Conn-" << m_conn_index << " TransactConnection::SendSessionReply request id " << request_id << " size " << msgsize;
+
+	WriteAsync(function, boost::asio::buffer(output, msgsize),
+			boost::bind(&Connection::HandleWriteSmartBuf, this, boost::asio::placeholders::error, msgbuf, AutoCount(this)));
+}
+
 void TransactConnection::SendServerError(unsigned line)
 {
 	static const string outbuf = "ERROR:server error";
 
 	BOOST_LOG_TRIVIAL(error) << Name() << " Conn-" << m_conn_index << " TransactConnection::SendServerError from line " << line << " sending " << outbuf;
 
-	WriteAsync("TransactConnection::SendServerError", boost::asio::buffer(outbuf.c_str(), outbuf.size()),
-			boost::bind(&Connection::HandleWrite, this, boost::asio::placeholders::error, AutoCount(this)));
+	SendText("TransactConnection::SendServerError", outbuf.c_str(), outbuf.size());
 }
 
 void TransactConnection::SendReplyWriteError()
@@ -773,18 +1401,18 @@ void TransactConnection::SendReplyWriteError()
 
 	BOOST_LOG_TRIVIAL(error) << Name() << " Conn-" << m_conn_index << " TransactConnection::SendReplyWriteError sending " << outbuf;
 
-	WriteAsync("TransactConnection::SendReplyWriteError", boost::asio::buffer(outbuf.c_str(), outbuf.size()),
-			boost::bind(&Connection::HandleWrite, this, boost::asio::placeholders::error, AutoCount(this)));
+	SendText("TransactConnection::SendReplyWriteError", outbuf.c_str(), outbuf.size());
 }
 
 void TransactConnection::SendTimeout()
 {
+	s_timeouts.Add();
+
 	static const string outbuf = "ERROR:server timeout";
 
 	BOOST_LOG_TRIVIAL(error) << Name() << " Conn-" << m_conn_index << " TransactConnection::SendTimeout sending " << outbuf;
 
-	WriteAsync("TransactConnection::SendTimeout", boost::asio::buffer(outbuf.c_str(), outbuf.size()),
-			boost::bind(&Connection::HandleWrite, this, boost::asio::placeholders::error, AutoCount(this)));
+	SendText("TransactConnection::SendTimeout", outbuf.c_str(), outbuf.size());
 }
 
 void TransactService::Start()
@@ -792,7 +1420,9 @@ void TransactService::Start()
 	if (!enabled)
 		return;
 
-	if (TRACE_TRANSACT) BOOST_LOG_TRIVIAL(trace) << Name() << " TransactService port " << port;
+	CCLOG(g_log_tx_server, trace) << Name() << " TransactService port " << port;
+
+	g_reply_cache.Init((size_t)cache_mb * 1024 * 1024, cache_secs);
 
 	// unsigned conn_nreadbuf, unsigned conn_nwritebuf, unsigned sock_nreadbuf, unsigned sock_nwritebuf, unsigned headersize, bool noclose, bool bregister
 	CCServer::ConnectionFactoryInstantiation<TransactConnection> connfac(TRANSACT_MAX_REQUEST_SIZE, TRANSACT_MAX_REPLY_SIZE, 0, 0, CC_MSG_HEADER_SIZE + TX_POW_SIZE, 0, 1);
@@ -801,6 +1431,8 @@ void TransactService::Start()
 	unsigned maxconns = (unsigned)(max_inconns + max_outconns);
 	unsigned nthreads = maxconns * threads_per_conn;	//!!! threads_per_conn can be changed if TransactConnection's do not block
 
+	m_service.SetIoContexts(io_contexts, IoLeastLoaded());
+
 	// unsigned nthreads, unsigned maxconns, unsigned maxincoming, unsigned backlog
 	m_service.Start(boost::asio::ip::tcp::endpoint(address, port),
 			nthreads, maxconns, max_inconns, 0, connfac, threadfac);
@@ -815,11 +1447,11 @@ void TransactThread::ThreadProc(boost::function<void()> threadproc)
 {
 	tx_dbconn = new DbConn;
 
-	if (TRACE_TRANSACT) BOOST_LOG_TRIVIAL(trace) << "TransactThread::ThreadProc start " << (uintptr_t)this << " dbconn " << (uintptr_t)tx_dbconn;
+	CCLOG(g_log_tx_server, trace) << "TransactThread::ThreadProc start " << (uintptr_t)this << " dbconn " << (uintptr_t)tx_dbconn;
 
 	threadproc();
 
-	if (TRACE_TRANSACT) BOOST_LOG_TRIVIAL(trace) << "TransactThread::ThreadProc end " << (uintptr_t)this << " dbconn " << (uintptr_t)tx_dbconn;
+	CCLOG(g_log_tx_server, trace) << "TransactThread::ThreadProc end " << (uintptr_t)this << " dbconn " << (uintptr_t)tx_dbconn;
 
 	delete tx_dbconn;
 }
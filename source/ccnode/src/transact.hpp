@@ -15,31 +15,73 @@
 
 #include <boost/bind.hpp>
 
+#include <unordered_map>
+
+// By default, a TransactConnection answers one request and then closes.
+// A wallet can instead open a session by sending each request wrapped in a CC_TAG_TX_SESSION frame that carries a request id.
+// The connection then stays open and reads the next frame as soon as the previous request has been handed off, so several
+// transactions can be validating at once, and each reply is sent back in a CC_TAG_TX_SESSION_REPLY frame with the id of
+// the request it answers, in whatever order the replies complete.
+
 class TransactConnection : public CCServer::Connection
 {
 
 public:
 	TransactConnection(class CCServer::ConnectionManager& manager, boost::asio::io_service& io_service, const class CCServer::ConnectionFactory& connfac)
 	:	CCServer::Connection(manager, io_service, connfac),
-		expected_callback_id(0)
+		expected_callback_id(0),
+		m_binary_reply(false),
+		m_cache_level(0),
+		m_session(false),
+		m_request_id(0),
+		m_session_ticks(0)
 	{ }
 
 	void HandleValidateDone(unsigned callback_id, int64_t result);
 
 private:
 	atomic<uint32_t> expected_callback_id;
+	chrono::steady_clock::time_point m_tx_t0;	// when the tx was queued for validation
+
+	struct SessionTx
+	{
+		uint32_t request_id;
+		chrono::steady_clock::time_point t0;
+	};
+
+	bool m_binary_reply;						// the request being handled asked for a binary reply
+	string m_cache_key;							// set when the reply to the request being handled should be cached
+	uint64_t m_cache_level;
 
+	bool m_session;								// session mode, set by the first CC_TAG_TX_SESSION frame
+	uint32_t m_request_id;						// id of the session request being read
+	uint32_t m_session_ticks;					// time of the last session request, for the idle timeout
+	FastSpinLock m_session_lock;
+	unordered_map<uint32_t, SessionTx> m_session_txs;	// txs being validated, by callback id; guarded by m_session_lock
+
+	void InitNewConnection();
 	void StartConnection();
 	void HandleReadComplete();
+	void HandleSessionReadComplete(const boost::system::error_code& e, size_t bytes_transferred, AutoCount pending_op_counter);
+	void HandleRequest();
 	void HandleMsgReadComplete(const boost::system::error_code& e, size_t bytes_transferred, SmartBuf smartobj, AutoCount pending_op_counter);
 	void HandleTx(SmartBuf smartobj);
 	bool SetTimer(unsigned sec);
 	void HandleTimeout(unsigned callback_id, const boost::system::error_code& e, AutoCount pending_op_counter);
+	bool SetSessionTimer();
+	void HandleSessionTimer(const boost::system::error_code& e, AutoCount pending_op_counter);
 	void HandleTxQueryParams(const uint8_t *msg, unsigned size);
 	void HandleTxQueryAddress(const uint8_t *msg, unsigned size);
 	void HandleTxQueryInputs(const uint8_t *msg, unsigned size);
 	void HandleTxQuerySerial(const uint8_t *msg, unsigned size);
+	void HandleTxQueryAddresses(const uint8_t *msg, unsigned size);
+	bool SendCachedReply(uint32_t tag, const uint8_t *msg, unsigned size);
+	void CacheReply(const char *text, unsigned size);
+	uint32_t StartBinaryReply(uint32_t tag);
+	void SendBinaryReply(uint32_t bufpos);
 	void SendReply(ostringstream& os);
+	void SendText(const char *function, const char *text, unsigned size);
+	void SendSessionReply(const char *function, uint32_t request_id, const char *text, unsigned size);
 	void SendServerError(unsigned line);
 	void SendReplyWriteError();
 	void SendTimeout();
@@ -53,9 +95,16 @@ class TransactService : public ServiceBase
 public:
 	TransactService(string n, string s)
 	 :	ServiceBase(n, s),
-		m_service(n)
+		m_service(n),
+		session_max_txs(0),
+		cache_mb(0),
+		cache_secs(0)
 	{ }
 
+	int session_max_txs;	// max txs a session can have validating at once; 0 = sessions not allowed
+	int cache_mb;			// size of the query reply cache; 0 = no cache
+	int cache_secs;			// max age of a cached reply
+
 	void ConfigPostset()
 	{
 		tor_advertise = false;
@@ -64,6 +113,11 @@ public:
 	void Start();
 
 	void WaitForShutdown();
+
+	void GetConnectionCounts(unsigned& nincoming, unsigned& noutgoing)
+	{
+		m_service.GetConnectionCounts(nincoming, noutgoing);
+	}
 };
 
 class TransactThread : public CCThread
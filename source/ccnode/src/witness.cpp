@@ -11,6 +11,7 @@
 #include "block.hpp"
 #include "blockchain.hpp"
 #include "processblock.hpp"
+#include "blocktree.hpp"
 #include "dbconn.hpp"
 #include "util.h"
 
@@ -280,8 +281,18 @@ uint64_t Witness::FindBestOwnScore(SmartBuf last_indelible_block)
 	uint64_t bestscore = 0;
 	SmartBuf smartobj;
 
-	if (m_test_ignore_order)
-		m_dbconn->ProcessQClearValidObjs(PROCESS_Q_TYPE_BLOCK);
+	if (!m_test_ignore_order)
+	{
+		bestscore = g_blocktree.FindBestOwnScore(witness_index, last_indelible_block, m_score_genstamp);
+
+		if (TRACE_WITNESS) BOOST_LOG_TRIVIAL(trace) << "Witness::FindBestOwnScore witness " << witness_index << " returning " << hex << bestscore << dec;
+
+		return bestscore;
+	}
+
+	// maltest scans the Process_Q, because it stores scores there
+
+	m_dbconn->ProcessQClearValidObjs(PROCESS_Q_TYPE_BLOCK);
 
 	for (unsigned offset = 0; ; ++offset)
 	{
@@ -318,8 +329,26 @@ SmartBuf Witness::FindBestBuildingBlock(SmartBuf last_indelible_block, uint64_t
 
 	SmartBuf smartobj, bestobj;
 
-	if (m_test_ignore_order || TEST_BUILD_ON_RANDOM)
-		m_dbconn->ProcessQRandomizeValidObjs(PROCESS_Q_TYPE_BLOCK);
+	if (!m_test_ignore_order && !TEST_BUILD_ON_RANDOM)
+	{
+		bestobj = g_blocktree.FindBestBuildingBlock(witness_index, last_indelible_block, m_score_genstamp, m_highest_witnessed_level, bestscore);
+
+		if (bestobj && TRACE_WITNESS)
+		{
+			auto block = (Block*)bestobj.data();
+			auto wire = block->WireData();
+			auto auxp = block->AuxPtr();
+
+			BOOST_LOG_TRIVIAL(trace) << "Witness::FindBestBuildingBlock witness " << witness_index << " returning best score " << hex << bestscore << dec << " best block level " << wire->level << " oid " << buf2hex(&auxp->oid, sizeof(ccoid_t));
+		}
+		else if (TRACE_WITNESS) BOOST_LOG_TRIVIAL(trace) << "Witness::FindBestBuildingBlock witness " << witness_index << " found no building block";
+
+		return bestobj;
+	}
+
+	// the tests that take the first acceptable block in random order scan the Process_Q
+
+	m_dbconn->ProcessQRandomizeValidObjs(PROCESS_Q_TYPE_BLOCK);
 
 	for (unsigned offset = 0; ; ++offset)
 	{
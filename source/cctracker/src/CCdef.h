@@ -34,6 +34,9 @@
 #include <iostream>
 #include <thread>
 #include <mutex>
+#include <atomic>
+#include <chrono>
+#include <array>
 
 #include <unistd.h>
 #include <wchar.h>
@@ -47,6 +50,7 @@
 #include <boost/program_options/variables_map.hpp>
 
 #include <CCassert.h>
+#include <CCticks.hpp>
 
 using namespace std;
 using namespace boost::log::trivial;
@@ -68,6 +72,12 @@ extern int g_datamem;
 extern int g_blockfrac;
 extern int g_hashfill;
 extern int g_expire;
+extern int g_dirshards;
+extern string g_snapshot_file;
+extern int g_snapshot_interval;
+extern int g_cache_slots;
+extern int g_io_contexts;
+extern string g_io_balance;
 
 extern class Dir g_relaydir;
 extern class Dir g_blockdir;
@@ -84,6 +94,12 @@ int g_datamem;
 int g_blockfrac;
 int g_hashfill;
 int g_expire;
+int g_dirshards;
+string g_snapshot_file;
+int g_snapshot_interval;
+int g_cache_slots;
+int g_io_contexts;
+string g_io_balance;
 
 #include "dir.hpp"
 
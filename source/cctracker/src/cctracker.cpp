@@ -10,6 +10,9 @@
 
 #include "CCdef.h"
 #include "dirserver.h"
+#include "dir.hpp"
+
+#include <CCutil.h>
 
 #include <memory>
 #include <utility>
@@ -26,6 +29,7 @@
 
 #define DEFAULT_TRACE_LEVEL			4
 #define DEFAULT_THREADS_PER_SERVICE	"32"
+#define DEFAULT_DIR_SHARDS			"16"
 
 static void set_trace_level(int level)
 {
@@ -91,6 +95,36 @@ static int check_config_values()
 		return -1;
 	}
 
+	if (g_dirshards < 1 || g_dirshards > DIR_MAX_SHARDS)
+	{
+		BOOST_LOG_TRIVIAL(fatal) << "FATAL ERROR: directory shards not in valid range";
+		return -1;
+	}
+
+	if (g_cache_slots < 0 || g_cache_slots > DIR_MAX_CACHE_SLOTS)
+	{
+		BOOST_LOG_TRIVIAL(fatal) << "FATAL ERROR: response cache slots not in valid range";
+		return -1;
+	}
+
+	if (g_snapshot_interval < 10 || g_snapshot_interval > 24*60*60)
+	{
+		BOOST_LOG_TRIVIAL(fatal) << "FATAL ERROR: snapshot interval not in valid range";
+		return -1;
+	}
+
+	if (g_io_contexts < 0 || g_io_contexts > g_nthreads)
+	{
+		BOOST_LOG_TRIVIAL(fatal) << "FATAL ERROR: io contexts value not in valid range";
+		return -1;
+	}
+
+	if (g_io_balance != "round-robin" && g_io_balance != "least-loaded")
+	{
+		BOOST_LOG_TRIVIAL(fatal) << "FATAL ERROR: io balance value must be round-robin or least-loaded";
+		return -1;
+	}
+
 	return 0;
 }
 
@@ -114,6 +148,14 @@ static int process_options(int argc, char **argv)
 		("blockfrac", po::value<int>(&g_blockfrac)->default_value(2), "Percentage of memory for blockserver directory.")
 		("hashfill", po::value<int>(&g_hashfill)->default_value(70), "Hash table fill percentage.")
 		("expire", po::value<int>(&g_expire)->default_value(300), "Number of minutes until a directory entry expires.")
+		("cache-slots", po::value<int>(&g_cache_slots)->default_value(64), "Number of pre-rendered query responses kept for each directory (0 = disabled).")
+		("snapshot", po::value<string>(&g_snapshot_file), "Path prefix for directory snapshot files;"
+				" if set, the directories are periodically saved and are reloaded at startup.")
+		("snapshot-interval", po::value<int>(&g_snapshot_interval)->default_value(300), "Seconds between directory snapshots.")
+		("shards", po::value<int>(&g_dirshards)->default_value(atoi(DEFAULT_DIR_SHARDS)), "Number of independently locked partitions in each directory (1 to " STRINGIFY(DIR_MAX_SHARDS) ").")
+		("io-contexts", po::value<int>(&g_io_contexts)->default_value(1), "Number of io contexts that share the server threads and connections;"
+				" 1 runs all connections on a single shared context, 0 uses one context per core.")
+		("io-balance", po::value<string>(&g_io_balance)->default_value("round-robin"), "How accepted connections are assigned to io contexts (round-robin or least-loaded).")
 	;
 
 	po::options_description all;
@@ -12,6 +12,12 @@
 #include <CCutil.h>
 #include <siphash/siphash.h>
 
+#include <boost/filesystem.hpp>
+
+#ifdef _WIN32
+#include <io.h>
+#endif
+
 #define TRACE_EXPIRE	0
 
 #define NULL_INDEX						((uint64_t)(-1))
@@ -23,6 +29,11 @@
 #define SECONDS_PER_EXPIRE_COUNT	60
 //#define SECONDS_PER_EXPIRE_COUNT	4	// for testing
 
+#define LOCK_STATS_INTERVAL			600	// seconds between lock contention reports
+
+#define SNAPSHOT_MAGIC				"CCDIRSNP"
+#define SNAPSHOT_VERSION			1
+
 void Dir::DeInit()
 {
 	if (m_expire_thread.joinable())
@@ -33,7 +44,32 @@ void Dir::DeInit()
 
 	BOOST_LOG_TRIVIAL(info) << m_label << ": cleaning up...";
 
-	lock_guard<mutex> lock(m_lock);
+	if (m_shards)
+	{
+		SaveSnapshot();
+
+		DumpLockStats();
+		DumpCacheStats();
+
+		for (unsigned i = 0; i < m_nshards; ++i)
+			m_shards[i].DeInit();
+
+		delete [] m_shards;
+		m_shards = NULL;
+	}
+
+	if (m_cache)
+	{
+		delete [] m_cache;
+		m_cache = NULL;
+	}
+
+	BOOST_LOG_TRIVIAL(info) << m_label << ": done";
+}
+
+void DirShard::DeInit()
+{
+	lock_guard<DirShardLock> lock(m_lock);
 
 #if 0	// for testing
 	for (uint64_t i = 0; i < m_hash_size; ++i)
@@ -41,7 +77,7 @@ void Dir::DeInit()
 		pointer_t p = m_hashtable[i].pointer;
 
 		if (p != HASH_POINTER_NULL)
-			BOOST_LOG_TRIVIAL(warning) << m_label << ": warning hashtable at index " << i << " is not NULL";
+			BOOST_LOG_TRIVIAL(warning) << m_label << " shard " << m_shard_index << ": warning hashtable at index " << i << " is not NULL";
 	}
 #endif
 
@@ -50,33 +86,83 @@ void Dir::DeInit()
 		free(m_namelist);
 		m_namelist = NULL;
 	}
-
-	BOOST_LOG_TRIVIAL(info) << m_label << ": done";
 }
 
-void Dir::Init(const char* label, int memfrac)
+void Dir::Init(const char* label, int memfrac, unsigned cache_npick)
 {
-	CCASSERT(!m_namelist);
+	CCASSERT(!m_shards);
 
 	strcpy(m_label, label);
 
+	m_nshards = g_dirshards;
+
+	CCASSERT(m_nshards > 0 && m_nshards <= DIR_MAX_SHARDS);
+
 	uint64_t nbytes = ((uint64_t)g_datamem) << 30;
 	nbytes = (nbytes * memfrac) / 1000;
 	//nbytes = 50*(2*NAME_BYTES + POINTER_BYTES);	// for testing
+
+	BOOST_LOG_TRIVIAL(info) << m_label << ": Shards " << m_nshards << " memory per shard " << nbytes / m_nshards;
+
+	CCASSERT(sizeof(hostname_t) == NAME_BYTES);
+
+	random_device rd;
+
+	if (rd.entropy() < 8*sizeof(unsigned) - 1)
+		BOOST_LOG_TRIVIAL(warning) << m_label << " random_device reports low entropy of " << rd.entropy();
+
+	for (unsigned i = 0; i < sizeof(m_hash_key); ++i)
+	{
+		m_hash_key[i] = rd();
+		//BOOST_LOG_TRIVIAL(trace) << m_label << ": hashkey[" << i << "] = " << m_hash_key[i];
+	}
+
+	m_shards = new DirShard[m_nshards];
+
+	for (unsigned i = 0; i < m_nshards; ++i)
+		m_shards[i].Init(m_label, i, nbytes / m_nshards);
+
+	LoadSnapshot();
+
+	InitCache(cache_npick);
+
+	//return;	// for testing
+
+	BOOST_LOG_TRIVIAL(trace) << m_label << ": creating thread for ExpireProc this = " << this;
+	thread worker(&Dir::ExpireProc, this);
+	m_expire_thread.swap(worker);
+}
+
+void DirShard::Init(const char *label, unsigned shard_index, uint64_t nbytes)
+{
+	CCASSERT(!m_namelist);
+
+	m_label = label;
+	m_shard_index = shard_index;
+
 	uint64_t hash_entries = nbytes/(unsigned)((NAME_BYTES + POINTER_BYTES) + NAME_BYTES * g_hashfill/100U);
 	uint64_t hash_bytes = hash_entries * (NAME_BYTES + POINTER_BYTES);
 	uint64_t list_entries = (nbytes - hash_bytes) / NAME_BYTES;
 	uint64_t list_bytes = list_entries * NAME_BYTES;
 	nbytes = hash_bytes + list_bytes;
 
-	BOOST_LOG_TRIVIAL(info) << m_label << ": Hash table entries " << hash_entries << " nbytes " << hash_bytes;
-	BOOST_LOG_TRIVIAL(info) << m_label << ": List entries " << list_entries << " nbytes " << list_bytes;
-	BOOST_LOG_TRIVIAL(info) << m_label << ": Total memory " << nbytes;
+	if (!shard_index)
+	{
+		BOOST_LOG_TRIVIAL(info) << m_label << ": Hash table entries per shard " << hash_entries << " nbytes " << hash_bytes;
+		BOOST_LOG_TRIVIAL(info) << m_label << ": List entries per shard " << list_entries << " nbytes " << list_bytes;
+	}
 
 	CCASSERT(sizeof(hostname_t) == NAME_BYTES);
 	CCASSERT(sizeof(pointer_t) == POINTER_BYTES);
 	CCASSERT(sizeof(hashentry_t) == NAME_BYTES + POINTER_BYTES);
 
+	if (!hash_entries || !list_entries)
+	{
+		BOOST_LOG_TRIVIAL(fatal) << m_label << ": FATAL ERROR: insufficient memory for " << g_dirshards << " directory shards";
+		exit(-1);
+		throw exception();
+	}
+
 	char *p = (char *)malloc(nbytes);
 	if (!p)
 	{
@@ -95,7 +181,8 @@ void Dir::Init(const char* label, int memfrac)
 
 	m_list_entries_per_pointer = ((m_list_size - 1 + N_SPECIAL_HASH_POINTER_VALS) >> (8*POINTER_BYTES)) + 1;
 
-	BOOST_LOG_TRIVIAL(info) << m_label << ": List entries per hash table pointer = " << m_list_entries_per_pointer;
+	if (!shard_index)
+		BOOST_LOG_TRIVIAL(info) << m_label << ": List entries per hash table pointer = " << m_list_entries_per_pointer;
 
 	if (m_list_entries_per_pointer != 1)
 	{
@@ -104,59 +191,47 @@ void Dir::Init(const char* label, int memfrac)
 		throw exception();
 	}
 
-	random_device rd;
-
-	if (rd.entropy() < 8*sizeof(unsigned) - 1)
-		BOOST_LOG_TRIVIAL(warning) << m_label << " random_device reports low entropy of " << rd.entropy();
-
-	for (unsigned i = 0; i < sizeof(m_hash_key); ++i)
-	{
-		m_hash_key[i] = rd();
-		//BOOST_LOG_TRIVIAL(trace) << m_label << ": hashkey[" << i << "] = " << m_hash_key[i];
-	}
-
 	m_expire_end_time = time(NULL) + g_expire * (unsigned)SECONDS_PER_EXPIRE_COUNT / (unsigned)EXPIRE_ENTRIES;
+}
 
-	//return;	// for testing
+// the low part of the hash selects the shard, and the high part selects the hashtable index within the shard
 
-	BOOST_LOG_TRIVIAL(trace) << m_label << ": creating thread for ExpireProc this = " << this;
-	thread worker(&Dir::ExpireProc, this);
-	m_expire_thread.swap(worker);
+uint64_t Dir::Hash(const hostname_t& name) const
+{
+	return sip_hash24(&m_hash_key[0], &name.bytes[0], NAME_BYTES, false);
 }
 
-uint64_t Dir::HashIndex(const string& namestr, hostname_t& name) const
+// returns expiration seconds from now
+int Dir::Add(const string& namestr)
 {
+	hostname_t name;
+
 	if (NameToBinary(namestr, name))
-		return NULL_INDEX;
+		return -1;
 
-	return HashIndex2(namestr, name);
-}
+	auto hash = Hash(name);
 
-uint64_t Dir::HashIndex2(const string& namestr, const hostname_t& name) const
-{
-	uint64_t hash_index = sip_hash24(&m_hash_key[0], &name.bytes[0], NAME_BYTES, false) % m_hash_size;
+	auto rc = m_shards[hash % m_nshards].Add(namestr, name, hash / m_nshards);
 
-	//BOOST_LOG_TRIVIAL(trace) << m_label << ": hostname " << namestr << " hashes to " << hash_index;
+	if (rc == g_expire * SECONDS_PER_EXPIRE_COUNT)
+		m_changes.fetch_add(1, memory_order_relaxed);	// hostname was added or moved to the end of the list
 
-	return hash_index;
+	return rc;
 }
 
-// returns expiration seconds from now
-int Dir::Add(const string& namestr)
+int DirShard::Add(const string& namestr, const hostname_t& name, uint64_t hash)
 {
-	hostname_t name;
+	uint64_t hash_index = hash % m_hash_size;
 
-	uint64_t hash_index = HashIndex(namestr, name);
-	if (hash_index == NULL_INDEX)
-		return -1;
+	//BOOST_LOG_TRIVIAL(trace) << m_label << ": hostname " << namestr << " hashes to shard " << m_shard_index << " index " << hash_index;
 
-	lock_guard<mutex> lock(m_lock);
+	lock_guard<DirShardLock> lock(m_lock);
 
 	// prepare to add to hashlist
 
 	if (m_list_nentries == m_list_size)
 	{
-		BOOST_LOG_TRIVIAL(trace) << m_label << ": no room in hashlist for hostname " << namestr;
+		BOOST_LOG_TRIVIAL(trace) << m_label << ": no room in hashlist shard " << m_shard_index << " for hostname " << namestr;
 		return (unsigned)(-1);
 	}
 
@@ -185,7 +260,7 @@ int Dir::Add(const string& namestr)
 		}
 		else if (CompareHostnames(m_hashtable[hash_find].hostname, name))
 		{
-			BOOST_LOG_TRIVIAL(trace) << m_label << ": hostname " << namestr << " already in hashtable at " << hash_find << " (start " << hash_index << ")";
+			BOOST_LOG_TRIVIAL(trace) << m_label << ": hostname " << namestr << " already in hashtable shard " << m_shard_index << " at " << hash_find << " (start " << hash_index << ")";
 			return Update(namestr, name, hash_find);
 		}
 
@@ -197,12 +272,12 @@ int Dir::Add(const string& namestr)
 
 	AddList(namestr, name, hash_add);
 
-	BOOST_LOG_TRIVIAL(trace) << m_label << ": hostname " << namestr << " added to hashtable at index " << hash_add << " (initial index " << hash_index << ")";
+	BOOST_LOG_TRIVIAL(trace) << m_label << ": hostname " << namestr << " added to hashtable shard " << m_shard_index << " at index " << hash_add << " (initial index " << hash_index << ")";
 
 	return g_expire * SECONDS_PER_EXPIRE_COUNT;
 }
 
-int Dir::Update(const string& namestr, const hostname_t& name, uint64_t hash_find)
+int DirShard::Update(const string& namestr, const hostname_t& name, uint64_t hash_find)
 {
 	uint64_t list_find = FindTable(namestr, name, hash_find);
 	if (list_find == NULL_INDEX)
@@ -224,12 +299,12 @@ int Dir::Update(const string& namestr, const hostname_t& name, uint64_t hash_fin
 
 	AddList(namestr, name, hash_find);
 
-	BOOST_LOG_TRIVIAL(trace) << m_label << ": hostname " << namestr << " entry expiring in " << expires << " updated in hashtable at index " << hash_find;
+	BOOST_LOG_TRIVIAL(trace) << m_label << ": hostname " << namestr << " entry expiring in " << expires << " updated in hashtable shard " << m_shard_index << " at index " << hash_find;
 
 	return g_expire * SECONDS_PER_EXPIRE_COUNT;
 }
 
-void Dir::AddList(const string& namestr, const hostname_t& name, uint64_t hash_find)
+void DirShard::AddList(const string& namestr, const hostname_t& name, uint64_t hash_find)
 {
 	// add to hashlist
 
@@ -240,7 +315,7 @@ void Dir::AddList(const string& namestr, const hostname_t& name, uint64_t hash_f
 
 	CopyHostname(m_namelist[list_index], name);
 
-	BOOST_LOG_TRIVIAL(trace) << m_label << ": hostname " << namestr << " added to namelist at index " << list_index << " (head " << m_list_head << " nentries " << m_list_nentries << ")";
+	BOOST_LOG_TRIVIAL(trace) << m_label << ": hostname " << namestr << " added to namelist shard " << m_shard_index << " at index " << list_index << " (head " << m_list_head << " nentries " << m_list_nentries << ")";
 
 	// update hashtable
 
@@ -248,20 +323,68 @@ void Dir::AddList(const string& namestr, const hostname_t& name, uint64_t hash_f
 	CopyHostname(m_hashtable[hash_find].hostname, name);
 }
 
+// queries for the cached number of hostnames are answered from a rotating set of pre-rendered fragments
 
 void Dir::PickN(unsigned seed, unsigned n, string& namestr, uint8_t *buf, unsigned &bufpos)
 {
+	if (m_cache && n == m_cache_npick)
+	{
+		auto& slot = m_cache[seed % m_cache_nslots];
+
+		lock_guard<FastSpinLock> lock(slot.lock);
+
+		if (slot.valid)
+		{
+			memcpy(&buf[bufpos], slot.buf.data(), slot.len);
+			bufpos += slot.len;
+
+			m_cache_hits.fetch_add(1, memory_order_relaxed);
+
+			return;
+		}
+	}
+
+	m_cache_misses.fetch_add(1, memory_order_relaxed);
+
+	PickNLive(seed, n, namestr, buf, bufpos);
+}
+
+// picks are spread across the shards starting at a random shard
+// if a shard has fewer entries than its share, the remainder is carried forward to the following shards
+
+void Dir::PickNLive(unsigned seed, unsigned n, string& namestr, uint8_t *buf, unsigned &bufpos)
+{
+	bool need_comma = false;
+
+	unsigned shard = seed % m_nshards;
+
+	for (unsigned i = 0; i < m_nshards && n; ++i)
+	{
+		unsigned shards_left = m_nshards - i;
+		unsigned quota = (n + shards_left - 1) / shards_left;
+
+		n -= m_shards[shard].PickN(seed, quota, namestr, buf, bufpos, need_comma);
+
+		if (++shard == m_nshards)
+			shard = 0;
+	}
+}
+
+unsigned DirShard::PickN(unsigned seed, unsigned n, string& namestr, uint8_t *buf, unsigned &bufpos, bool &need_comma)
+{
+	lock_guard<DirShardLock> lock(m_lock);
+
 	auto ne = m_list_nentries;
 
 	if (ne == 0)
-		return;
+		return 0;
 
 	if (n > ne)
 		n = ne;
 
 	uint64_t pos = seed % ne;
 
-	bool need_comma = false;
+	unsigned npicked = 0;
 
 	for (unsigned i = 0; i < n; ++i)
 	{
@@ -271,7 +394,11 @@ void Dir::PickN(unsigned seed, unsigned n, string& namestr, uint8_t *buf, unsign
 
 		while (pos != nextpos)
 		{
-			hostname_t& hostname = m_namelist[m_list_head + pos];
+			uint64_t list_index = m_list_head + pos;
+			if (list_index >= m_list_size)
+				list_index -= m_list_size;
+
+			hostname_t& hostname = m_namelist[list_index];
 			if (IsClearedHostname(hostname))
 			{
 				pos = (pos + 1) % ne;
@@ -285,57 +412,31 @@ void Dir::PickN(unsigned seed, unsigned n, string& namestr, uint8_t *buf, unsign
 
 			buf[bufpos++] = '"';
 
-			NameToString(hostname, namestr);
+			Dir::NameToString(hostname, namestr);
 			memcpy(&buf[bufpos], &namestr[0], namestr.size());
 			bufpos += namestr.size();
 
 			buf[bufpos++] = '"';
 
+			++npicked;
+
 			break;
 		}
 
 		pos = nextpos;
 	}
-}
-
-// not used
-#if 0	// note: if this were used, pointer = HASH_POINTER_NULL would need to be fixed
-void Dir::Delete(const string& namestr)
-{
-	hostname_t name;
-
-	uint64_t hash_index = HashIndex(namestr, name);
-	if (hash_index == NULL_INDEX)
-		return;
-
-	lock_guard<mutex> lock(m_lock);
-
-	uint64_t hash_find = Find2(namestr, name, hash_index);
-	if (hash_find == NULL_INDEX)
-		return;
-
-	uint64_t list_find = FindTable(namestr, name, hash_find);
-
-	m_hashtable[hash_find].pointer = HASH_POINTER_NULL;
-
-	BOOST_LOG_TRIVIAL(trace) << m_label << ": hostname " << namestr << " deleted from hashtable at index " << hash_find;
 
-	if (list_find == NULL_INDEX)
-		return;
-
-	// we just clear the list entry at this point -- to keep expiration simple, that is the only way they come out
-	ClearHostname(m_namelist[list_find]);
-
-	BOOST_LOG_TRIVIAL(trace) << m_label << ": hostname " << namestr << " cleared from hashlist at index " << list_find << " (head " << m_list_head << " nentries " << m_list_nentries << ")";
+	return npicked;
 }
-#endif
 
-void Dir::ExpireHead()
+// returns true if a hostname was removed from the list
+
+bool DirShard::ExpireHead(const Dir& dir)
 {
-	lock_guard<mutex> lock(m_lock);
+	lock_guard<DirShardLock> lock(m_lock);
 
 	if (m_list_nentries == 0)
-		return;
+		return false;
 
 	uint64_t list_find = m_list_head;
 	const hostname_t& name = m_namelist[list_find];
@@ -346,24 +447,24 @@ void Dir::ExpireHead()
 
 	if (IsClearedHostname(name))
 	{
-		BOOST_LOG_TRIVIAL(trace) << m_label << ": cleared entry expired from hashlist at index " << list_find << " (new head " << m_list_head << " nentries " << m_list_nentries << ")";
+		BOOST_LOG_TRIVIAL(trace) << m_label << ": cleared entry expired from hashlist shard " << m_shard_index << " at index " << list_find << " (new head " << m_list_head << " nentries " << m_list_nentries << ")";
 
-		return;
+		return false;
 	}
 
 	string namestr(NAME_CHARS, 0);
-	NameToString(name, namestr);
+	Dir::NameToString(name, namestr);
 
-	uint64_t hash_index = HashIndex2(namestr, name);
+	uint64_t hash_index = (dir.Hash(name) / g_dirshards) % m_hash_size;
 
 	uint64_t hash_find = Find2(namestr, name, hash_index);
 	if (hash_find == NULL_INDEX)
-		return;
+		return true;
 
 	// mark temporarily as chained to right
 	m_hashtable[hash_find].pointer = HASH_POINTER_CHAINED;
 
-	BOOST_LOG_TRIVIAL(trace) << m_label << ": hostname " << namestr << " expired from hashlist at index " << list_find << " (new head " << m_list_head << " nentries " << m_list_nentries << ") and hashtable at index " << hash_find;
+	BOOST_LOG_TRIVIAL(trace) << m_label << ": hostname " << namestr << " expired from hashlist shard " << m_shard_index << " at index " << list_find << " (new head " << m_list_head << " nentries " << m_list_nentries << ") and hashtable at index " << hash_find;
 
 	// look to right to see if there are any entries in use
 	while (true)
@@ -377,7 +478,7 @@ void Dir::ExpireHead()
 			break;	// found no entries in use
 
 		if (p != HASH_POINTER_CHAINED)
-			return;	// found an entry in use, so leave expired entry as HASH_POINTER_CHAINED
+			return true;	// found an entry in use, so leave expired entry as HASH_POINTER_CHAINED
 	}
 
 	// found no entry in use on right, so all pointers to left of the HASH_POINTER_NULL should also be set to HASH_POINTER_NULL
@@ -389,11 +490,11 @@ void Dir::ExpireHead()
 		pointer_t p = m_hashtable[hash_find].pointer;
 
 		if (p != HASH_POINTER_CHAINED)
-			return;	// found an entry in use so we're done
+			return true;	// found an entry in use so we're done
 
 		m_hashtable[hash_find].pointer = HASH_POINTER_NULL;
 
-		BOOST_LOG_TRIVIAL(trace) << m_label << ": hashtable at index " << hash_find << " set to NULL";
+		BOOST_LOG_TRIVIAL(trace) << m_label << ": hashtable shard " << m_shard_index << " at index " << hash_find << " set to NULL";
 	}
 }
 
@@ -401,52 +502,85 @@ void Dir::ExpireProc()
 {
 	BOOST_LOG_TRIVIAL(trace) << m_label << ": expire thread this=" << this;
 
-	uint64_t expired = 0;
+	time_t next_lock_stats = time(NULL) + LOCK_STATS_INTERVAL;
+	time_t next_snapshot = time(NULL) + g_snapshot_interval;
 
 	while (!g_shutdown)
 	{
-		time_t now = time(NULL);
-		int delta_t = (int)m_expire_end_time - (int)now;
-		if (delta_t < -600)
-			m_expire_end_time = now - 600;
+		uint64_t expired = 0;
+
+		for (unsigned i = 0; i < m_nshards; ++i)
+			expired += m_shards[i].ExpireTick(*this);
+
+		RefreshCache(m_changes.exchange(0, memory_order_relaxed) + expired);
 
-		uint64_t nexpire = m_expire_count[m_expire_count_index] - expired;
+		if (time(NULL) >= next_lock_stats)
+		{
+			DumpLockStats();
+			DumpCacheStats();
+
+			next_lock_stats += LOCK_STATS_INTERVAL;
+		}
 
-		if (TRACE_EXPIRE) BOOST_LOG_TRIVIAL(trace) << m_label << ": left to expire " << nexpire << " in time " << delta_t;
+		if (time(NULL) >= next_snapshot)
+		{
+			SaveSnapshot();
 
-		if (delta_t > 1)
-			nexpire /= delta_t;
+			next_snapshot = time(NULL) + g_snapshot_interval;
+		}
 
-		if (TRACE_EXPIRE) BOOST_LOG_TRIVIAL(trace) << m_label << ": expiring " << nexpire;
+		sleep(1);
+	}
+}
 
-		for (uint64_t i = 0; i < nexpire; ++i)
-			ExpireHead();
+// called once per second by the expire thread
+// returns the number of hostnames expired
 
-		expired += nexpire;
+uint64_t DirShard::ExpireTick(const Dir& dir)
+{
+	time_t now = time(NULL);
+	int delta_t = (int)m_expire_end_time - (int)now;
+	if (delta_t < -600)
+		m_expire_end_time = now - 600;
 
-		if (delta_t <= 0)
-		{
-			m_expire_end_time += g_expire * SECONDS_PER_EXPIRE_COUNT / (unsigned)EXPIRE_ENTRIES;
+	uint64_t nexpire = m_expire_count[m_expire_count_index] - m_expire_expired;
 
-			CCASSERT(expired == m_expire_count[m_expire_count_index]);
+	if (TRACE_EXPIRE) BOOST_LOG_TRIVIAL(trace) << m_label << " shard " << m_shard_index << ": left to expire " << nexpire << " in time " << delta_t;
 
-			if (TRACE_EXPIRE) BOOST_LOG_TRIVIAL(trace) << m_label << ": adding to expire " << expired << " + " << m_list_nentries << " - " << m_expire_last_list_nentries;
+	if (delta_t > 1)
+		nexpire /= delta_t;
 
-			lock_guard<mutex> lock(m_lock);
+	if (TRACE_EXPIRE) BOOST_LOG_TRIVIAL(trace) << m_label << " shard " << m_shard_index << ": expiring " << nexpire;
 
-			m_expire_count[m_expire_count_index] = expired + m_list_nentries - m_expire_last_list_nentries;
-			m_expire_last_list_nentries = m_list_nentries;
-			expired = 0;
+	uint64_t nremoved = 0;
 
-			if (++m_expire_count_index == EXPIRE_ENTRIES)
-				m_expire_count_index = 0;
-		}
+	for (uint64_t i = 0; i < nexpire; ++i)
+		nremoved += ExpireHead(dir);
 
-		sleep(1);
+	m_expire_expired += nexpire;
+
+	if (delta_t <= 0)
+	{
+		m_expire_end_time += g_expire * SECONDS_PER_EXPIRE_COUNT / (unsigned)EXPIRE_ENTRIES;
+
+		CCASSERT(m_expire_expired == m_expire_count[m_expire_count_index]);
+
+		if (TRACE_EXPIRE) BOOST_LOG_TRIVIAL(trace) << m_label << " shard " << m_shard_index << ": adding to expire " << m_expire_expired << " + " << m_list_nentries << " - " << m_expire_last_list_nentries;
+
+		lock_guard<DirShardLock> lock(m_lock);
+
+		m_expire_count[m_expire_count_index] = m_expire_expired + m_list_nentries - m_expire_last_list_nentries;
+		m_expire_last_list_nentries = m_list_nentries;
+		m_expire_expired = 0;
+
+		if (++m_expire_count_index == EXPIRE_ENTRIES)
+			m_expire_count_index = 0;
 	}
+
+	return nremoved;
 }
 
-int Dir::FindExpire(uint64_t list_find)
+int DirShard::FindExpire(uint64_t list_find)
 {
 	uint64_t list_hi = m_list_head;
 	unsigned expire_count_index = m_expire_count_index;
@@ -457,7 +591,7 @@ int Dir::FindExpire(uint64_t list_find)
 		uint64_t list_lo = list_hi;
 		list_hi += m_expire_count[expire_count_index];
 
-		if (TRACE_EXPIRE) BOOST_LOG_TRIVIAL(trace) << m_label << ": period " << period << " expire_count_index " << expire_count_index << " expire_count " << m_expire_count[expire_count_index] << " list_lo " << list_lo << " list_find " << list_find << " list_hi " << list_hi;
+		if (TRACE_EXPIRE) BOOST_LOG_TRIVIAL(trace) << m_label << " shard " << m_shard_index << ": period " << period << " expire_count_index " << expire_count_index << " expire_count " << m_expire_count[expire_count_index] << " list_lo " << list_lo << " list_find " << list_find << " list_hi " << list_hi;
 
 		if (list_lo <= list_find && list_find < list_hi)
 			return period * g_expire * SECONDS_PER_EXPIRE_COUNT / EXPIRE_ENTRIES;
@@ -470,20 +604,7 @@ int Dir::FindExpire(uint64_t list_find)
 	}
 }
 
-#if 0 // not used
-uint64_t Dir::Find(const string& namestr) const
-{
-	hostname_t name;
-
-	uint64_t hash_index = HashIndex(namestr, name);
-	if (hash_index == NULL_INDEX)
-		return hash_index;
-
-	return Find2(namestr, name, hash_index);
-}
-#endif
-
-uint64_t Dir::Find2(const string& namestr, const hostname_t& name, uint64_t hash_index) const
+uint64_t DirShard::Find2(const string& namestr, const hostname_t& name, uint64_t hash_index) const
 {
 	uint64_t hash_find = hash_index;
 
@@ -493,13 +614,13 @@ uint64_t Dir::Find2(const string& namestr, const hostname_t& name, uint64_t hash
 
 		if (p == HASH_POINTER_NULL)
 		{
-			BOOST_LOG_TRIVIAL(trace) << m_label << ": hostname " << namestr << " not found in hashtable (start " << hash_index << " stop " << hash_find << ")";
+			BOOST_LOG_TRIVIAL(trace) << m_label << ": hostname " << namestr << " not found in hashtable shard " << m_shard_index << " (start " << hash_index << " stop " << hash_find << ")";
 			return NULL_INDEX;
 		}
 
 		if (p != HASH_POINTER_CHAINED && CompareHostnames(m_hashtable[hash_find].hostname, name))
 		{
-			BOOST_LOG_TRIVIAL(trace) << m_label << ": hostname " << namestr << " found in hashtable at " << hash_find << " (start " << hash_index << ")";
+			BOOST_LOG_TRIVIAL(trace) << m_label << ": hostname " << namestr << " found in hashtable shard " << m_shard_index << " at " << hash_find << " (start " << hash_index << ")";
 			return hash_find;
 		}
 
@@ -508,12 +629,12 @@ uint64_t Dir::Find2(const string& namestr, const hostname_t& name, uint64_t hash
 	}
 }
 
-uint64_t Dir::FindTable(const string& namestr, const hostname_t& name, uint64_t hash_find) const
+uint64_t DirShard::FindTable(const string& namestr, const hostname_t& name, uint64_t hash_find) const
 {
 	pointer_t p = m_hashtable[hash_find].pointer;
 	if (p >= m_list_size)
 	{
-		BOOST_LOG_TRIVIAL(error) << m_label << ": ERROR in FindTable: invalid pointer for hostname " << namestr << " hash index " << hash_find << " list size " << m_list_size;
+		BOOST_LOG_TRIVIAL(error) << m_label << ": ERROR in FindTable: invalid pointer for hostname " << namestr << " shard " << m_shard_index << " hash index " << hash_find << " list size " << m_list_size;
 		return NULL_INDEX;
 	}
 
@@ -524,7 +645,7 @@ uint64_t Dir::FindTable(const string& namestr, const hostname_t& name, uint64_t
 	{
 		if (CompareHostnames(m_namelist[list_find], name))
 		{
-			BOOST_LOG_TRIVIAL(trace) << m_label << ": hostname " << namestr << " found in hashlist at " << list_find << " (start " << list_index << ")";
+			BOOST_LOG_TRIVIAL(trace) << m_label << ": hostname " << namestr << " found in hashlist shard " << m_shard_index << " at " << list_find << " (start " << list_index << ")";
 			return list_find;
 		}
 
@@ -535,11 +656,495 @@ uint64_t Dir::FindTable(const string& namestr, const hostname_t& name, uint64_t
 			list_find = 0;
 	}
 
-	BOOST_LOG_TRIVIAL(trace) << m_label << ": hostname " << namestr << " not found in hashlist (start " << list_index << " stop " << list_find << ")";
+	BOOST_LOG_TRIVIAL(trace) << m_label << ": hostname " << namestr << " not found in hashlist shard " << m_shard_index << " (start " << list_index << " stop " << list_find << ")";
 
 	return NULL_INDEX;
 }
 
+void Dir::InitCache(unsigned npick)
+{
+	CCASSERT(!m_cache);
+
+	if (!g_cache_slots || !npick)
+		return;
+
+	CCASSERT(g_cache_slots <= DIR_MAX_CACHE_SLOTS);
+
+	m_cache_nslots = g_cache_slots;
+	m_cache_npick = npick;
+
+	random_device rd;
+	m_cache_random.seed(rd());
+
+	m_cache = new DirCacheSlot[m_cache_nslots];
+
+	for (unsigned i = 0; i < m_cache_nslots; ++i)
+	{
+		m_cache[i].buf.resize(m_cache_npick * (NAME_CHARS + 3));
+
+		RefreshCacheSlot(i);
+	}
+
+	BOOST_LOG_TRIVIAL(info) << m_label << ": response cache slots " << m_cache_nslots << " hostnames per slot " << m_cache_npick;
+}
+
+// called by the expire thread
+// the number of slots re-rendered is proportional to the fraction of the directory that changed since the last call
+
+void Dir::RefreshCache(uint64_t changes)
+{
+	if (!m_cache || !changes)
+		return;
+
+	uint64_t nentries = 0;
+	for (unsigned i = 0; i < m_nshards; ++i)
+		nentries += m_shards[i].NEntries();
+
+	uint64_t nrefresh = m_cache_nslots;
+	if (nentries > changes)
+		nrefresh = (m_cache_nslots * changes + nentries - 1) / nentries;
+
+	auto t0 = chrono::steady_clock::now();
+
+	for (uint64_t i = 0; i < nrefresh; ++i)
+	{
+		RefreshCacheSlot(m_cache_next_refresh);
+
+		if (++m_cache_next_refresh >= m_cache_nslots)
+			m_cache_next_refresh = 0;
+	}
+
+	auto t1 = chrono::steady_clock::now();
+
+	m_cache_refreshes += nrefresh;
+	m_cache_refresh_usec += chrono::duration_cast<chrono::microseconds>(t1 - t0).count();
+
+	if (TRACE_EXPIRE) BOOST_LOG_TRIVIAL(trace) << m_label << ": changes " << changes << " nentries " << nentries << " refreshed " << nrefresh << " cache slots";
+}
+
+void Dir::RefreshCacheSlot(unsigned slot)
+{
+	auto& cache = m_cache[slot];
+
+	string namestr(NAME_CHARS, 0);
+	vector<uint8_t> buf(cache.buf.size());
+	unsigned bufpos = 0;
+
+	PickNLive(m_cache_random(), m_cache_npick, namestr, buf.data(), bufpos);
+
+	CCASSERT(bufpos <= buf.size());
+
+	lock_guard<FastSpinLock> lock(cache.lock);
+
+	memcpy(cache.buf.data(), buf.data(), bufpos);
+	cache.len = bufpos;
+	cache.valid = true;
+}
+
+void Dir::DumpCacheStats()
+{
+	if (!m_cache)
+		return;
+
+	uint64_t hits = m_cache_hits.load(memory_order_relaxed);
+	uint64_t misses = m_cache_misses.load(memory_order_relaxed);
+
+	BOOST_LOG_TRIVIAL(info) << m_label << ": response cache hits " << hits << " misses " << misses
+		<< " (" << (hits + misses ? 100.0 * hits / (hits + misses) : 0.0) << "% hits) slot refreshes " << m_cache_refreshes
+		<< " refresh usec " << m_cache_refresh_usec << " (" << (m_cache_refreshes ? m_cache_refresh_usec / m_cache_refreshes : 0) << " per slot)";
+}
+
+void DirShard::DumpLockStats(uint64_t& acquisitions, uint64_t& contended, uint64_t& wait_usec)
+{
+	acquisitions = m_lock.acquisitions.load(memory_order_relaxed);
+	contended = m_lock.contended.load(memory_order_relaxed);
+	wait_usec = m_lock.wait_usec.load(memory_order_relaxed);
+
+	BOOST_LOG_TRIVIAL(debug) << m_label << " shard " << m_shard_index << " lock acquisitions " << acquisitions << " contended " << contended << " wait usec " << wait_usec;
+}
+
+void Dir::DumpLockStats()
+{
+	uint64_t total_acquisitions = 0, total_contended = 0, total_wait_usec = 0;
+
+	for (unsigned i = 0; i < m_nshards; ++i)
+	{
+		uint64_t acquisitions, contended, wait_usec;
+
+		m_shards[i].DumpLockStats(acquisitions, contended, wait_usec);
+
+		total_acquisitions += acquisitions;
+		total_contended += contended;
+		total_wait_usec += wait_usec;
+	}
+
+	BOOST_LOG_TRIVIAL(info) << m_label << ": lock acquisitions " << total_acquisitions << " contended " << total_contended
+		<< " (" << (total_acquisitions ? 100.0 * total_contended / total_acquisitions : 0.0) << "%) wait usec " << total_wait_usec;
+}
+
+/*
+
+Snapshot file format (native byte order):
+
+	header:
+		char[8]		magic
+		uint32_t	version
+		uint32_t	nshards
+		uint32_t	expire entries
+		int32_t		expire minutes
+		uint64_t	hash table entries per shard
+		uint64_t	list entries per shard
+		uint8_t[16]	hash key
+		int64_t		time written
+
+	for each shard:
+		uint64_t	list head
+		uint64_t	list nentries
+		int64_t		expire end time
+		uint64_t	expire last list nentries
+		uint64_t	expire expired
+		uint32_t	expire count index
+		uint64_t[]	expire counts
+		uint64_t	number of hash table entries in use
+		hostname_t[list nentries]	list entries starting at list head, including cleared entries
+		{uint64_t index, hashentry_t entry}[number in use]	hash table entries that are not HASH_POINTER_NULL
+
+	trailer:
+		char[8]		magic
+
+Since the hash key and the shard geometry are saved, the list and hash table entries are restored
+to their original positions without rehashing.  The snapshot is only usable if the shard count,
+memory and hash fill settings are unchanged.
+
+*/
+
+#pragma pack(push, 1)
+
+struct dir_snapshot_header_t
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t nshards;
+	uint32_t expire_entries;
+	int32_t expire_minutes;
+	uint64_t hash_size;
+	uint64_t list_size;
+	uint8_t hash_key[16];
+	int64_t time_written;
+};
+
+struct dir_snapshot_shard_t
+{
+	uint64_t list_head;
+	uint64_t list_nentries;
+	int64_t expire_end_time;
+	uint64_t expire_last_list_nentries;
+	uint64_t expire_expired;
+	uint32_t expire_count_index;
+	uint64_t expire_count[EXPIRE_ENTRIES];
+	uint64_t hash_nused;
+};
+
+#pragma pack(pop)
+
+string Dir::SnapshotFileName() const
+{
+	return g_snapshot_file + "-" + m_label;
+}
+
+static int SyncFile(FILE *fd)
+{
+#ifdef _WIN32
+	return _commit(_fileno(fd));
+#else
+	return fsync(fileno(fd));
+#endif
+}
+
+int Dir::SaveSnapshot()
+{
+	if (g_snapshot_file.empty())
+		return 0;
+
+	auto t0 = ccticks();
+
+	auto fname = SnapshotFileName();
+	auto tempname = fname + ".tmp";
+
+	FILE *fd = fopen(tempname.c_str(), "wb");
+	if (!fd)
+	{
+		BOOST_LOG_TRIVIAL(error) << m_label << ": error opening snapshot file \"" << tempname << "\"";
+
+		return -1;
+	}
+
+	dir_snapshot_header_t header;
+	memset(&header, 0, sizeof(header));
+
+	memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+	header.version = SNAPSHOT_VERSION;
+	header.nshards = m_nshards;
+	header.expire_entries = EXPIRE_ENTRIES;
+	header.expire_minutes = g_expire;
+	m_shards[0].GetGeometry(header.hash_size, header.list_size);
+	memcpy(header.hash_key, &m_hash_key[0], sizeof(header.hash_key));
+	header.time_written = time(NULL);
+
+	bool failed = (fwrite(&header, sizeof(header), 1, fd) != 1);
+
+	for (unsigned i = 0; i < m_nshards && !failed; ++i)
+		failed = m_shards[i].WriteSnapshot(fd);
+
+	if (!failed)
+		failed = (fwrite(SNAPSHOT_MAGIC, sizeof(header.magic), 1, fd) != 1);
+
+	// the data must be on disk before the rename, or a power loss could leave a renamed file that is empty or partial
+
+	if (!failed)
+		failed = (fflush(fd) || SyncFile(fd));
+
+	if (fclose(fd))
+		failed = true;
+
+	if (failed)
+	{
+		BOOST_LOG_TRIVIAL(error) << m_label << ": error writing snapshot file \"" << tempname << "\"";
+
+		remove(tempname.c_str());
+
+		return -1;
+	}
+
+	boost::system::error_code e;
+	boost::filesystem::rename(tempname, fname, e);
+	if (e)
+	{
+		BOOST_LOG_TRIVIAL(error) << m_label << ": error renaming snapshot file \"" << tempname << "\" to \"" << fname << "\": " << e.message();
+
+		return -1;
+	}
+
+	BOOST_LOG_TRIVIAL(info) << m_label << ": wrote snapshot \"" << fname << "\" in " << ccticks_elapsed(t0, ccticks()) << " ms";
+
+	return 0;
+}
+
+int DirShard::WriteSnapshot(FILE *fd)
+{
+	// copy the shard into memory while holding the lock, then write it out after releasing the lock
+
+	dir_snapshot_shard_t header;
+	vector<hostname_t> list;
+	vector<pair<uint64_t, hashentry_t>> table;
+
+	{
+		lock_guard<DirShardLock> lock(m_lock);
+
+		header.list_head = m_list_head;
+		header.list_nentries = m_list_nentries;
+		header.expire_end_time = m_expire_end_time;
+		header.expire_last_list_nentries = m_expire_last_list_nentries;
+		header.expire_expired = m_expire_expired;
+		header.expire_count_index = m_expire_count_index;
+		for (unsigned i = 0; i < EXPIRE_ENTRIES; ++i)
+			header.expire_count[i] = m_expire_count[i];
+
+		list.reserve(m_list_nentries);
+
+		for (uint64_t i = 0; i < m_list_nentries; ++i)
+		{
+			uint64_t list_index = m_list_head + i;
+			if (list_index >= m_list_size)
+				list_index -= m_list_size;
+
+			list.push_back(m_namelist[list_index]);
+		}
+
+		table.reserve(m_list_nentries);
+
+		for (uint64_t i = 0; i < m_hash_size; ++i)
+		{
+			if (m_hashtable[i].pointer != HASH_POINTER_NULL)
+				table.push_back(make_pair(i, m_hashtable[i]));
+		}
+
+		header.hash_nused = table.size();
+	}
+
+	if (fwrite(&header, sizeof(header), 1, fd) != 1)
+		return -1;
+
+	if (list.size() && fwrite(list.data(), sizeof(hostname_t), list.size(), fd) != list.size())
+		return -1;
+
+	for (auto& entry : table)
+	{
+		if (fwrite(&entry.first, sizeof(entry.first), 1, fd) != 1)
+			return -1;
+
+		if (fwrite(&entry.second, sizeof(entry.second), 1, fd) != 1)
+			return -1;
+	}
+
+	return 0;
+}
+
+int Dir::LoadSnapshot()
+{
+	if (g_snapshot_file.empty())
+		return 0;
+
+	auto t0 = ccticks();
+
+	auto fname = SnapshotFileName();
+
+	FILE *fd = fopen(fname.c_str(), "rb");
+	if (!fd)
+	{
+		BOOST_LOG_TRIVIAL(info) << m_label << ": no snapshot file \"" << fname << "\"; starting with an empty directory";
+
+		return -1;
+	}
+
+	dir_snapshot_header_t header;
+	uint64_t hash_size, list_size;
+	m_shards[0].GetGeometry(hash_size, list_size);
+
+	if (fread(&header, sizeof(header), 1, fd) != 1
+			|| memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic))
+			|| header.version != SNAPSHOT_VERSION)
+	{
+		BOOST_LOG_TRIVIAL(warning) << m_label << ": ignoring invalid snapshot file \"" << fname << "\"";
+
+		fclose(fd);
+
+		return -1;
+	}
+
+	if (header.nshards != m_nshards
+			|| header.expire_entries != EXPIRE_ENTRIES
+			|| header.hash_size != hash_size
+			|| header.list_size != list_size)
+	{
+		BOOST_LOG_TRIVIAL(warning) << m_label << ": ignoring snapshot file \"" << fname << "\" because the shards, memory or hash fill settings have changed";
+
+		fclose(fd);
+
+		return -1;
+	}
+
+	if (header.expire_minutes != g_expire || header.time_written + g_expire * SECONDS_PER_EXPIRE_COUNT < time(NULL))
+	{
+		BOOST_LOG_TRIVIAL(warning) << m_label << ": ignoring snapshot file \"" << fname << "\" because it has expired or the expire setting has changed";
+
+		fclose(fd);
+
+		return -1;
+	}
+
+	memcpy(&m_hash_key[0], header.hash_key, sizeof(header.hash_key));
+
+	bool failed = false;
+
+	for (unsigned i = 0; i < m_nshards && !failed; ++i)
+		failed = m_shards[i].ReadSnapshot(fd);
+
+	char trailer[sizeof(header.magic)];
+
+	if (!failed)
+		failed = (fread(trailer, sizeof(trailer), 1, fd) != 1 || memcmp(trailer, SNAPSHOT_MAGIC, sizeof(trailer)));
+
+	fclose(fd);
+
+	if (failed)
+	{
+		// the shards may have been partly filled, so put them back the way Init left them
+
+		BOOST_LOG_TRIVIAL(warning) << m_label << ": ignoring truncated or corrupt snapshot file \"" << fname << "\"; starting with an empty directory";
+
+		for (unsigned i = 0; i < m_nshards; ++i)
+			m_shards[i].Clear();
+
+		return -1;
+	}
+
+	BOOST_LOG_TRIVIAL(info) << m_label << ": loaded snapshot \"" << fname << "\" written " << time(NULL) - header.time_written << " seconds ago in " << ccticks_elapsed(t0, ccticks()) << " ms";
+
+	return 0;
+}
+
+int DirShard::ReadSnapshot(FILE *fd)
+{
+	// called before the expire thread starts, so no lock is needed
+
+	dir_snapshot_shard_t header;
+
+	if (fread(&header, sizeof(header), 1, fd) != 1)
+		return -1;
+
+	if (header.list_head >= m_list_size || header.list_nentries > m_list_size || header.expire_count_index >= EXPIRE_ENTRIES)
+		return -1;
+
+	m_list_head = header.list_head;
+	m_list_nentries = header.list_nentries;
+	m_expire_end_time = header.expire_end_time;
+	m_expire_last_list_nentries = header.expire_last_list_nentries;
+	m_expire_expired = header.expire_expired;
+	m_expire_count_index = header.expire_count_index;
+	for (unsigned i = 0; i < EXPIRE_ENTRIES; ++i)
+		m_expire_count[i] = header.expire_count[i];
+
+	// the list is circular, so read it in at most two pieces
+
+	uint64_t n1 = m_list_size - m_list_head;
+	if (n1 > m_list_nentries)
+		n1 = m_list_nentries;
+	uint64_t n2 = m_list_nentries - n1;
+
+	if (n1 && fread(&m_namelist[m_list_head], sizeof(hostname_t), n1, fd) != n1)
+		return -1;
+
+	if (n2 && fread(&m_namelist[0], sizeof(hostname_t), n2, fd) != n2)
+		return -1;
+
+	for (uint64_t i = 0; i < header.hash_nused; ++i)
+	{
+		uint64_t index;
+
+		if (fread(&index, sizeof(index), 1, fd) != 1 || index >= m_hash_size)
+			return -1;
+
+		if (fread(&m_hashtable[index], sizeof(hashentry_t), 1, fd) != 1)
+			return -1;
+
+		auto p = m_hashtable[index].pointer;
+
+		if (p != HASH_POINTER_CHAINED && p >= m_list_size)
+			return -1;
+	}
+
+	BOOST_LOG_TRIVIAL(debug) << m_label << " shard " << m_shard_index << ": restored " << m_list_nentries << " list entries and " << header.hash_nused << " hash table entries";
+
+	return 0;
+}
+
+// empties the shard, for use before the expire thread starts
+
+void DirShard::Clear()
+{
+	memset(m_namelist, -1, m_list_size * sizeof(hostname_t));
+	memset(m_hashtable, -1, m_hash_size * sizeof(hashentry_t));
+
+	m_list_head = 0;
+	m_list_nentries = 0;
+	m_expire_end_time = time(NULL) + g_expire * (unsigned)SECONDS_PER_EXPIRE_COUNT / (unsigned)EXPIRE_ENTRIES;
+	m_expire_last_list_nentries = 0;
+	m_expire_expired = 0;
+	m_expire_count_index = 0;
+	m_expire_count.fill(0);
+}
+
 int Dir::NameToBinary(const string& namestr, hostname_t& name)
 {
 	if (namestr.size() != NAME_CHARS)
@@ -8,6 +8,8 @@
 
 #pragma once
 
+#include <SpinLock.hpp>
+
 #define NAME_CHARS		16
 #define NAME_BYTES		10
 #define POINTER_BYTES	4
@@ -15,23 +17,75 @@
 #define EXPIRE_ENTRIES	120
 //#define EXPIRE_ENTRIES	20		// for testing
 
-class Dir
-{
-	typedef uint32_t pointer_t;
+#define DIR_MAX_SHARDS	64
+
+#define DIR_MAX_CACHE_SLOTS	4096
 
 #pragma pack(push, 1)
 
-	union hostname_t
+union dir_hostname_t
+{
+	array<uint8_t, NAME_BYTES> bytes;
+
+	struct
 	{
-		array<uint8_t, NAME_BYTES> bytes;
+		uint64_t a;
+		uint16_t b;
+
+	} words;
+};
+
+#pragma pack(pop)
+
+// mutex that counts acquisitions, contended acquisitions and time spent waiting
+
+class DirShardLock
+{
+	mutex m_mutex;
+
+public:
+	atomic<uint64_t> acquisitions;
+	atomic<uint64_t> contended;
+	atomic<uint64_t> wait_usec;
+
+	DirShardLock()
+	 :	acquisitions(0),
+		contended(0),
+		wait_usec(0)
+	{ }
 
-		struct
+	void lock()
+	{
+		if (!m_mutex.try_lock())
 		{
-			uint64_t a;
-			uint16_t b;
+			auto t0 = chrono::steady_clock::now();
 
-		} words;
-	};
+			m_mutex.lock();
+
+			auto t1 = chrono::steady_clock::now();
+
+			contended.fetch_add(1, memory_order_relaxed);
+			wait_usec.fetch_add(chrono::duration_cast<chrono::microseconds>(t1 - t0).count(), memory_order_relaxed);
+		}
+
+		acquisitions.fetch_add(1, memory_order_relaxed);
+	}
+
+	void unlock()
+	{
+		m_mutex.unlock();
+	}
+};
+
+// one independently locked partition of a Dir
+// a hostname is always stored in the shard selected by its hash
+
+class DirShard
+{
+	typedef uint32_t pointer_t;
+	typedef dir_hostname_t hostname_t;
+
+#pragma pack(push, 1)
 
 	struct hashentry_t
 	{
@@ -41,7 +95,8 @@ class Dir
 
 #pragma pack(pop)
 
-	char m_label[20];
+	const char *m_label;
+	unsigned m_shard_index;
 
 	hostname_t *m_namelist;
 	hashentry_t *m_hashtable;
@@ -49,18 +104,17 @@ class Dir
 	uint64_t m_list_size;
 	uint64_t m_hash_size;
 	unsigned m_list_entries_per_pointer;
-	array<uint8_t, 16> m_hash_key;
 
 	uint64_t m_list_head;
 	uint64_t m_list_nentries;
 
 	time_t m_expire_end_time;
 	uint64_t m_expire_last_list_nentries;
+	uint64_t m_expire_expired;
 	unsigned m_expire_count_index;
 	array<uint64_t, EXPIRE_ENTRIES> m_expire_count;
-	thread m_expire_thread;
 
-	mutex m_lock;
+	DirShardLock m_lock;
 
 	void inline ClearHostname(hostname_t& dest) const
 	{
@@ -84,28 +138,141 @@ class Dir
 		return h1.words.a == h2.words.a && h1.words.b == h2.words.b;
 	}
 
-	uint64_t HashIndex(const string& namestr, hostname_t& name) const;
-	uint64_t HashIndex2(const string& namestr, const hostname_t& name) const;
 	uint64_t Find2(const string& namestr, const hostname_t& name, uint64_t hash_index) const;
 	uint64_t FindTable(const string& namestr, const hostname_t& name, uint64_t hash_find) const;
 	int Update(const string& namestr, const hostname_t& name, uint64_t hash_find);
 	int FindExpire(uint64_t list_find);
 	void AddList(const string& namestr, const hostname_t& name, uint64_t hash_find);
 
-	void ExpireHead();
+	bool ExpireHead(const class Dir& dir);
+
+public:
+	DirShard()
+	 :	m_label(NULL),
+		m_shard_index(0),
+		m_namelist(NULL),
+		m_hashtable(NULL),
+		m_list_size(0),
+		m_hash_size(0),
+		m_list_entries_per_pointer(0),
+		m_list_head(0),
+		m_list_nentries(0),
+		m_expire_end_time(0),
+		m_expire_last_list_nentries(0),
+		m_expire_expired(0),
+		m_expire_count_index(0)
+	{
+		m_expire_count.fill(0);
+	}
+
+	void Init(const char *label, unsigned shard_index, uint64_t nbytes);
+	void DeInit();
+
+	int Add(const string& namestr, const hostname_t& name, uint64_t hash);
+	unsigned PickN(unsigned seed, unsigned n, string& namestr, uint8_t *buf, unsigned &bufpos, bool &need_comma);
+
+	uint64_t ExpireTick(const class Dir& dir);
+
+	void DumpLockStats(uint64_t& acquisitions, uint64_t& contended, uint64_t& wait_usec);
+
+	uint64_t NEntries()
+	{
+		lock_guard<DirShardLock> lock(m_lock);
+
+		return m_list_nentries;
+	}
+
+	void GetGeometry(uint64_t& hash_size, uint64_t& list_size) const
+	{
+		hash_size = m_hash_size;
+		list_size = m_list_size;
+	}
+
+	int WriteSnapshot(FILE *fd);
+	int ReadSnapshot(FILE *fd);
+	void Clear();
+};
+
+// a pre-rendered PickN response fragment
+
+struct DirCacheSlot
+{
+	FastSpinLock lock;
+	vector<uint8_t> buf;
+	unsigned len;
+	bool valid;
+
+	DirCacheSlot()
+	 :	len(0),
+		valid(false)
+	{ }
+};
+
+class Dir
+{
+	typedef dir_hostname_t hostname_t;
+
+	char m_label[20];
+
+	DirShard *m_shards;
+	unsigned m_nshards;
+
+	array<uint8_t, 16> m_hash_key;
+
+	thread m_expire_thread;
+
+	DirCacheSlot *m_cache;
+	unsigned m_cache_nslots;
+	unsigned m_cache_npick;
+	unsigned m_cache_next_refresh;
+	mt19937 m_cache_random;
+
+	atomic<uint64_t> m_changes;
+	atomic<uint64_t> m_cache_hits;
+	atomic<uint64_t> m_cache_misses;
+	uint64_t m_cache_refreshes;
+	uint64_t m_cache_refresh_usec;
+
+	string SnapshotFileName() const;
+	int LoadSnapshot();
+
+	void PickNLive(unsigned seed, unsigned n, string& namestr, uint8_t *buf, unsigned &bufpos);
+
+	void InitCache(unsigned npick);
+	void RefreshCache(uint64_t changes);
+	void RefreshCacheSlot(unsigned slot);
 
 public:
-	void Init(const char* label, int memfrac);
+	Dir()
+	 :	m_shards(NULL),
+		m_nshards(0),
+		m_cache(NULL),
+		m_cache_nslots(0),
+		m_cache_npick(0),
+		m_cache_next_refresh(0),
+		m_changes(0),
+		m_cache_hits(0),
+		m_cache_misses(0),
+		m_cache_refreshes(0),
+		m_cache_refresh_usec(0)
+	{ }
+
+	void Init(const char* label, int memfrac, unsigned cache_npick);
 	void DeInit();
 
 	int Add(const string& namestr);
 	void PickN(unsigned seed, unsigned n, string& namestr, uint8_t *buf, unsigned &bufpos);
-	//void Delete(const string& namestr);
-	//uint64_t Find(const string& namestr) const;
+
+	uint64_t Hash(const hostname_t& name) const;
 
 	static int NameToBinary(const string& namestr, hostname_t& name);
 	static void NameToString(const hostname_t& name, string& namestr);
 	static string NameToHex(const hostname_t& name);
 
 	void ExpireProc();
+
+	void DumpLockStats();
+	void DumpCacheStats();
+
+	int SaveSnapshot();
 };
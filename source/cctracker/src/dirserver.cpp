@@ -172,8 +172,8 @@ void add_test_names(Dir &dir, char prefix)
 
 void RunServer()
 {
-	g_relaydir.Init("RelayDir", 100 - g_blockfrac);
-	g_blockdir.Init("BlockDir", g_blockfrac);
+	g_relaydir.Init("RelayDir", 100 - g_blockfrac, RELAY_QUERY_RETURNS);
+	g_blockdir.Init("BlockDir", g_blockfrac, BLOCK_QUERY_RETURNS);
 
 	//add_test_names(g_relaydir, 'a');	// for testing
 	//add_test_names(g_blockdir, 'z');	// for testing
@@ -183,6 +183,8 @@ void RunServer()
 
 	CCServer::Service s("Directory Service");
 
+	s.SetIoContexts(g_io_contexts, g_io_balance == "least-loaded");
+
 	// unsigned nthreads, unsigned maxconns, unsigned maxincoming, unsigned backlog
 	s.Start(boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string(LOCALHOST), g_port),
 			g_nthreads, g_nthreads*g_nconns, g_nthreads*g_nconns, 0, connfac);
@@ -0,0 +1,195 @@
+'''
+CredaCash(TM) CCServer Loopback Benchmark Script
+
+Part of the CredaCash (TM) cryptocurrency and blockchain
+
+Copyright (C) 2015-2016 Creda Software, Inc.
+
+This program measures how many messages per second a CCServer::Service can
+handle over the loopback interface as the number of server threads and io
+contexts changes.
+
+For each configuration, it starts a local cctracker with:
+
+	--threads=<threads> --io-contexts=<contexts> --io-balance=<balance>
+
+then runs client processes that each open a connection, send a directory query
+and read the reply as fast as possible, and reports messages per second.
+
+A query and its reply are counted as one message. Since cctracker closes each
+connection after replying, every message also exercises the acceptor and the
+assignment of the accepted socket to an io context.
+
+'''
+
+import sys
+import time
+import socket
+import subprocess
+import multiprocessing
+
+####################################################################################
+#
+# Test Parameters (these can be changed)
+#
+
+# Server thread counts to test (CCServer::Service runs at least 20 threads, so that it has enough to shut down)
+
+thread_counts = [20, 32, 64, 128]
+
+# io contexts to test for each thread count (0 = one per core; values larger than the thread count are skipped)
+
+context_counts = [1, 4, 0]
+
+# io context balancing methods to test when there is more than one io context
+
+balance_methods = ['round-robin', 'least-loaded']
+
+# Seconds to run each configuration
+
+duration = 10
+
+# Port for the benchmark server
+
+port = 9291
+
+# Memory for the tracker directory, in tenths of a GB
+
+datamem = 1
+
+# Seconds to wait for the server to start (cctracker pauses 7 seconds at startup)
+
+startup_timeout = 30
+
+net_timeout = 10
+
+####################################################################################
+
+query = 'QRB' + chr(0)
+
+def Query():
+	sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+	sock.settimeout(net_timeout)
+	sock.connect(('127.0.0.1', port))
+	sock.sendall(query)
+	reply = ''
+	while True:
+		data = sock.recv(4096)
+		if not data:
+			break
+		reply += data
+		if reply.endswith(chr(0)):
+			break
+	sock.close()
+	if not reply.startswith('{"Relay":['):
+		raise Exception('bad reply')
+
+def Worker(duration, results):
+	nmsg = 0
+	nerror = 0
+	t0 = time.time()
+	while time.time() - t0 < duration:
+		try:
+			Query()
+			nmsg += 1
+		except Exception:
+			nerror += 1
+	results.put((nmsg, nerror))
+
+def WaitForServer(proc):
+	t0 = time.time()
+	while time.time() - t0 < startup_timeout:
+		if proc.poll() is not None:
+			return False
+		try:
+			Query()
+			return True
+		except Exception:
+			time.sleep(0.5)
+	return False
+
+def RunConfig(tracker, nthreads, ncontexts, balance, nworkers):
+	args = [tracker, '--port=%d' % port, '--datamem=%d' % datamem, '--trace=3',
+			'--threads=%d' % nthreads, '--io-contexts=%d' % ncontexts, '--io-balance=' + balance]
+
+	proc = subprocess.Popen(args)
+
+	try:
+		if not WaitForServer(proc):
+			print 'server failed to start:', ' '.join(args)
+			return None
+
+		results = multiprocessing.Queue()
+		workers = [multiprocessing.Process(target = Worker, args = (duration, results)) for i in range(nworkers)]
+
+		t0 = time.time()
+		for w in workers:
+			w.start()
+
+		nmsg = 0
+		nerror = 0
+		for w in workers:
+			m, e = results.get()
+			nmsg += m
+			nerror += e
+
+		elapsed = time.time() - t0
+
+		for w in workers:
+			w.join()
+
+		return (nmsg / elapsed, nerror)
+
+	finally:
+		proc.terminate()
+		proc.wait()
+
+####################################################################################
+#
+# main
+#
+
+def main(argv):
+	if len(argv) < 2 or len(argv) > 3:
+		print
+		print 'Usage: python ccserver-bench.py <path to cctracker> [<client processes>]'
+		print
+		exit()
+
+	tracker = argv[1]
+
+	nworkers = 2 * multiprocessing.cpu_count()
+	if len(argv) > 2:
+		nworkers = int(argv[2])
+
+	ncores = multiprocessing.cpu_count()
+
+	print 'cores', ncores, 'client processes', nworkers, 'seconds per configuration', duration
+
+	results = []
+
+	for nthreads in thread_counts:
+		for ncontexts in context_counts:
+			if ncontexts > nthreads:
+				continue
+			if ncontexts == 0 and ncores < 2:
+				continue
+			for balance in balance_methods:
+				if ncontexts == 1 and balance != balance_methods[0]:
+					continue
+				r = RunConfig(tracker, nthreads, ncontexts, balance, nworkers)
+				if r is None:
+					continue
+				msgs, nerror = r
+				print 'threads', nthreads, 'io contexts', ncontexts, balance, 'msgs/sec', int(msgs), 'errors', nerror
+				results.append((nthreads, ncontexts, balance, msgs, nerror))
+
+	print
+	print '%8s %12s %14s %12s %8s' % ('threads', 'io contexts', 'balance', 'msgs/sec', 'errors')
+	for nthreads, ncontexts, balance, msgs, nerror in results:
+		if ncontexts == 1:
+			balance = '-'
+		print '%8d %12s %14s %12d %8d' % (nthreads, ncontexts if ncontexts else 'per core', balance, msgs, nerror)
+
+if __name__ == '__main__':
+	main(sys.argv)
@@ -0,0 +1,190 @@
+'''
+CredaCash(TM) Relay Transaction Announcement Simulation
+
+Part of the CredaCash (TM) cryptocurrency and blockchain
+
+Copyright (C) 2015-2016 Creda Software, Inc.
+
+This program simulates transaction announcement between relay nodes and reports the
+announcement bytes and Relay_Objs inserts per transaction, for both relay modes:
+
+	flood:		each new tx is announced to every peer in a CC_MSG_HAVE_TX
+				(oid, size and level = 28 bytes per tx), and every announcement
+				received is inserted into Relay_Objs
+
+	reconcile:	(relay-tx-reconcile=1) each new tx is offered to every peer by an
+				8 byte short id in a CC_MSG_HAVE_TX_SHORTIDS; the peer requests full
+				announcements with a CC_CMD_SEND_HAVE_TX only for the tx's it doesn't
+				already hold or have RELAY_RECONCILE_SOURCES announcements for
+
+Time advances in relay heartbeats. A full announcement received in one heartbeat
+is downloaded and validated in the next, after which the tx is announced onward.
+
+Usage: relay-reconcile-sim.py [nnodes [outconns [ntxs [seed]]]]
+
+'''
+
+import sys
+import random
+
+####################################################################################
+#
+# Test Parameters (these can be changed)
+#
+
+# Transactions submitted per heartbeat, each to a random node
+
+txs_per_heartbeat = 20
+
+####################################################################################
+#
+# Protocol constants (these match the node)
+#
+
+CC_MSG_HEADER_SIZE = 8
+CC_HAVE_MAX = 100
+HAVE_TX_ENTRY_SIZE = 16 + 4 + 8
+SHORTID_SIZE = 8
+RELAY_RECONCILE_SOURCES = 2
+
+####################################################################################
+
+def MakeNetwork(nnodes, outconns, rng):
+	peers = [set() for i in range(nnodes)]
+	for n in range(nnodes):
+		while len(peers[n]) < min(outconns, nnodes - 1):
+			p = rng.randrange(nnodes)
+			if p != n:
+				peers[n].add(p)
+				peers[p].add(n)
+	return [sorted(p) for p in peers]
+
+class Node:
+	def __init__(self, npeers):
+		self.held = set()			# tx's validated by this node
+		self.order = []				# tx's in the order validated, like the Valid_Objs seqnum
+		self.next = [0] * npeers	# next tx to announce to each peer, like db_next_new_tx_seqnum
+		self.sources = {}			# full announcements received per tx, like RelayTxShortIds
+		self.pending = {}			# tx -> heartbeat its download completes
+
+	def Validate(self, tx):
+		if tx not in self.held:
+			self.held.add(tx)
+			self.order.append(tx)
+
+def Simulate(peers, ntxs, reconcile, rng):
+	nodes = [Node(len(p)) for p in peers]
+	peer_index = [dict((p, i) for i, p in enumerate(pl)) for pl in peers]
+
+	stats = {'bytes': 0, 'inserts': 0, 'msgs': 0}
+	first_seen = {}
+	done_at = {}
+
+	requests = []		# (from node, to node, tx list) sent this heartbeat, answered in the next
+	heartbeat = 0
+	submitted = 0
+
+	while True:
+		heartbeat += 1
+
+		# new tx's
+
+		for i in range(txs_per_heartbeat):
+			if submitted >= ntxs:
+				break
+			tx = submitted
+			submitted += 1
+			nodes[rng.randrange(len(nodes))].Validate(tx)
+			first_seen[tx] = heartbeat
+
+		# finish downloads
+
+		for node in nodes:
+			for tx, when in node.pending.items():
+				if when <= heartbeat:
+					node.Validate(tx)
+					del node.pending[tx]
+
+		# answer last heartbeat's CC_CMD_SEND_HAVE_TX requests with full announcements
+
+		answers = []
+		for frm, to, txs in requests:
+			for i in range(0, len(txs), CC_HAVE_MAX):
+				chunk = txs[i:i+CC_HAVE_MAX]
+				stats['bytes'] += CC_MSG_HEADER_SIZE + len(chunk) * HAVE_TX_ENTRY_SIZE
+				stats['msgs'] += 1
+				answers.append((to, frm, chunk))
+		requests = []
+
+		# announce new tx's to each peer
+
+		announces = []
+		for n, node in enumerate(nodes):
+			for pi, p in enumerate(peers[n]):
+				while node.next[pi] < len(node.order):
+					chunk = node.order[node.next[pi]:node.next[pi]+CC_HAVE_MAX]
+					node.next[pi] += len(chunk)
+					stats['msgs'] += 1
+					if reconcile:
+						stats['bytes'] += CC_MSG_HEADER_SIZE + len(chunk) * SHORTID_SIZE
+						wanted = [tx for tx in chunk if tx not in nodes[p].held and nodes[p].sources.get(tx, 0) < RELAY_RECONCILE_SOURCES]
+						if wanted:
+							stats['bytes'] += CC_MSG_HEADER_SIZE + len(wanted) * SHORTID_SIZE
+							stats['msgs'] += 1
+							requests.append((p, n, wanted))
+					else:
+						stats['bytes'] += CC_MSG_HEADER_SIZE + len(chunk) * HAVE_TX_ENTRY_SIZE
+						announces.append((n, p, chunk))
+
+		# process full announcements: insert into Relay_Objs and start a download
+
+		for frm, to, txs in announces + answers:
+			node = nodes[to]
+			for tx in txs:
+				stats['inserts'] += 1
+				node.sources[tx] = node.sources.get(tx, 0) + 1
+				if tx not in node.held and tx not in node.pending:
+					node.pending[tx] = heartbeat + 1
+
+		# done when every tx is held by every node
+
+		for tx in range(submitted):
+			if tx not in done_at and all(tx in node.held for node in nodes):
+				done_at[tx] = heartbeat
+
+		if submitted >= ntxs and len(done_at) == ntxs:
+			break
+
+	latency = [done_at[tx] - first_seen[tx] for tx in range(ntxs)]
+	latency.sort()
+
+	return stats, float(sum(latency)) / len(latency), latency[len(latency) * 99 / 100]
+
+def main(argv):
+	nnodes = 50
+	outconns = 8
+	ntxs = 2000
+	seed = 1
+
+	if len(argv) > 1:
+		nnodes = int(argv[1])
+	if len(argv) > 2:
+		outconns = int(argv[2])
+	if len(argv) > 3:
+		ntxs = int(argv[3])
+	if len(argv) > 4:
+		seed = int(argv[4])
+
+	peers = MakeNetwork(nnodes, outconns, random.Random(seed))
+	nlinks = sum(len(p) for p in peers) / 2
+
+	print 'nodes %d links %d (average %.1f peers per node) txs %d' % (nnodes, nlinks, 2.0 * nlinks / nnodes, ntxs)
+	print
+	print '%-10s %12s %12s %12s %14s %14s' % ('mode', 'bytes/tx', 'bytes/tx/node', 'inserts/tx', 'mean heartbeats', 'p99 heartbeats')
+
+	for mode, reconcile in (('flood', False), ('reconcile', True)):
+		stats, mean_latency, p99_latency = Simulate(peers, ntxs, reconcile, random.Random(seed))
+		print '%-10s %12.1f %12.1f %12.1f %14.2f %14d' % (mode, float(stats['bytes']) / ntxs, float(stats['bytes']) / ntxs / nnodes, float(stats['inserts']) / ntxs, mean_latency, p99_latency)
+
+if __name__ == '__main__':
+	main(sys.argv)
@@ -0,0 +1,178 @@
+'''
+CredaCash(TM) Tracker Load Test Script
+
+Part of the CredaCash (TM) cryptocurrency and blockchain
+
+Copyright (C) 2015-2016 Creda Software, Inc.
+
+This program drives the directory server protocol against a local cctracker at a
+high query rate and reports queries per second, reply latency and errors.
+
+Each query registers a random relay and blockserve hostname and asks for a list of
+peers, exactly as HostDir::QueryServer does:
+
+	R:<relay hostname>\n
+	B:<blockserve hostname>\n
+	QRB\0
+
+The tracker replies with a nul-terminated JSON object.
+
+To measure lock contention, run cctracker with --trace=5 and compare the
+"lock acquisitions ... contended" lines it logs for different --shards values.
+
+'''
+
+import sys
+import time
+import random
+import socket
+import multiprocessing
+
+####################################################################################
+#
+# Test Parameters (these can be changed)
+#
+
+# Number of distinct hostnames each worker registers before reusing them
+
+names_per_worker = 2000
+
+# Probability a query registers a hostname (otherwise it only queries)
+
+prob_register = 0.5
+
+# Seconds between progress reports
+
+report_interval = 5
+
+net_timeout = 10
+
+####################################################################################
+
+base32_chars = 'abcdefghijklmnopqrstuvwxyz234567'
+
+def RandomHostname():
+	return ''.join(random.choice(base32_chars) for i in range(16))
+
+def BuildQuery(names):
+	msg = ''
+	if random.random() < prob_register:
+		msg += 'R:' + random.choice(names) + '\n'
+		msg += 'B:' + random.choice(names) + '\n'
+	msg += 'QRB'
+	msg += chr(0)
+	return msg
+
+def QueryTracker(port, msg):
+	sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+	sock.settimeout(net_timeout)
+	sock.connect(('127.0.0.1', port))
+	sock.sendall(msg)
+	reply = ''
+	while True:
+		data = sock.recv(4096)
+		if not data:
+			break
+		reply += data
+		if reply.endswith(chr(0)):
+			break
+	sock.close()
+	return reply
+
+def Worker(port, duration, qps, results):
+	random.seed()
+	names = [RandomHostname() for i in range(names_per_worker)]
+	nquery = 0
+	nerror = 0
+	latency = []
+	t0 = time.time()
+	while time.time() - t0 < duration:
+		if qps > 0:
+			delay = t0 + float(nquery + nerror) / qps - time.time()
+			if delay > 0:
+				time.sleep(delay)
+		msg = BuildQuery(names)
+		start = time.time()
+		try:
+			reply = QueryTracker(port, msg)
+			if not reply.startswith('{"Relay":['):
+				raise Exception('bad reply')
+			nquery += 1
+			latency.append(time.time() - start)
+		except Exception:
+			nerror += 1
+	results.put((nquery, nerror, latency))
+
+def Percentile(values, p):
+	if not values:
+		return 0
+	return values[min(len(values) - 1, int(len(values) * p))]
+
+####################################################################################
+#
+# main
+#
+
+def main(argv):
+	if len(argv) < 2 or len(argv) > 5:
+		print
+		print 'Usage: python tracker-load.py <port> [<workers>] [<seconds>] [<qps_per_worker>]'
+		print
+		print ' Note: cctracker by default listens at port 9221'
+		print '       qps_per_worker = 0 sends queries as fast as possible'
+		print
+		exit()
+
+	port = int(argv[1])
+
+	nworkers = 4 * multiprocessing.cpu_count()
+	if len(argv) > 2:
+		nworkers = int(argv[2])
+
+	duration = 30
+	if len(argv) > 3:
+		duration = int(argv[3])
+
+	qps = 0
+	if len(argv) > 4:
+		qps = float(argv[4])
+
+	print 'starting', nworkers, 'workers for', duration, 'seconds against port', port
+
+	results = multiprocessing.Queue()
+	workers = [multiprocessing.Process(target = Worker, args = (port, duration, qps, results)) for i in range(nworkers)]
+
+	t0 = time.time()
+	for w in workers:
+		w.start()
+
+	while any(w.is_alive() for w in workers) and time.time() - t0 < duration:
+		time.sleep(report_interval)
+		print 'elapsed', int(time.time() - t0), 'seconds'
+
+	nquery = 0
+	nerror = 0
+	latency = []
+	for w in workers:
+		q, e, l = results.get()
+		nquery += q
+		nerror += e
+		latency += l
+
+	for w in workers:
+		w.join()
+
+	elapsed = time.time() - t0
+	latency.sort()
+
+	print
+	print 'queries         ', nquery
+	print 'errors          ', nerror
+	print 'queries/sec     ', int(nquery / elapsed)
+	print 'latency ms p50  ', round(1000 * Percentile(latency, 0.50), 2)
+	print 'latency ms p90  ', round(1000 * Percentile(latency, 0.90), 2)
+	print 'latency ms p99  ', round(1000 * Percentile(latency, 0.99), 2)
+	print 'latency ms max  ', round(1000 * Percentile(latency, 1.0), 2)
+
+if __name__ == '__main__':
+	main(sys.argv)